@@ -0,0 +1,222 @@
+/**
+ * diffuse magnetic scattering of large spin configurations
+ * @author Tobias Weber
+ * @date Nov-2018
+ * @license see 'LICENSE.EUPL' file
+ */
+
+#ifndef __MAG_DIFFUSE_H__
+#define __MAG_DIFFUSE_H__
+
+#include <vector>
+#include <array>
+#include <complex>
+#include <algorithm>
+#include <cmath>
+
+#include "math_fft.h"
+#include "parallel.h"
+
+
+// ----------------------------------------------------------------------------
+/**
+ * magnetic scattering S(Q) = |F_perp(Q)|^2 / N of a supercell of L1 x L2 x L3 unit cells
+ *
+ * the spins of each sublattice (basis atom) live on a grid over the unit cells, each spin
+ * component of each sublattice is fourier transformed with a real 3d fft. the sublattices are
+ * combined with their basis phase factors exp(-2pi i Q*r_b), the sign convention follows
+ * m::structure_factor. S is given on the full grid Q = G + (n1/L1, n2/L2, n3/L3) of the
+ * brillouin zone G, the half spectra of the real transforms are expanded via F(-q) = F(q)^*.
+ * the spins are given in the cartesian frame of the B matrix.
+ */
+template<class t_real = double>
+class MagDiffuse
+{
+public:
+	using t_cplx = std::complex<t_real>;
+
+private:
+	std::array<std::size_t, 3> m_dims{{ 1, 1, 1 }};
+
+	// basis positions (rlu), 3 elements per sublattice
+	std::vector<t_real> m_basis;
+
+	// spins, [sublattice][component][i1][i2][i3]
+	std::vector<t_real> m_spins;
+
+	// B matrix (row-major) for the cartesian Q
+	std::array<t_real, 9> m_B{{ 1,0,0, 0,1,0, 0,0,1 }};
+
+	m::FFT3Real<t_real> m_fft;
+	unsigned int m_iNumThreads = 0;
+
+protected:
+	static constexpr t_real s_pi = t_real(3.14159265358979323846);
+
+	std::size_t GetSpinIndex(std::size_t i1, std::size_t i2, std::size_t i3,
+		std::size_t iSub, std::size_t iComp) const
+	{
+		return (iSub*3 + iComp)*GetNumCells() + (i1*m_dims[1] + i2)*m_dims[2] + i3;
+	}
+
+public:
+	MagDiffuse() = default;
+	~MagDiffuse() = default;
+
+	void SetNumThreads(unsigned int iNumThreads)
+	{
+		m_iNumThreads = iNumThreads;
+		m_fft.SetNumThreads(iNumThreads);
+	}
+
+	/**
+	 * supercell size in unit cells, clears the spins
+	 */
+	void SetSupercell(std::size_t L1, std::size_t L2, std::size_t L3)
+	{
+		m_dims = {{ std::max<std::size_t>(L1, 1), std::max<std::size_t>(L2, 1), std::max<std::size_t>(L3, 1) }};
+		m_fft.Init(m_dims[0], m_dims[1], m_dims[2]);
+		m_spins.assign(GetNumSublattices()*3*GetNumCells(), t_real(0));
+	}
+
+	/**
+	 * B matrix (row-major) to calculate the cartesian Q for the projection perpendicular to Q
+	 */
+	void SetBMatrix(const t_real* B) { std::copy(B, B+9, m_B.begin()); }
+
+	const std::array<std::size_t, 3>& GetSupercell() const { return m_dims; }
+	std::size_t GetNumCells() const { return m_dims[0]*m_dims[1]*m_dims[2]; }
+	std::size_t GetNumSublattices() const { return m_basis.size() / 3; }
+	const t_real* GetBasisPosition(std::size_t iSub) const { return m_basis.data() + iSub*3; }
+
+	/**
+	 * adds a basis atom at the position pos (rlu), returns its index
+	 */
+	std::size_t AddSublattice(const t_real* pos)
+	{
+		m_basis.insert(m_basis.end(), pos, pos+3);
+		m_spins.resize(GetNumSublattices()*3*GetNumCells(), t_real(0));
+		return GetNumSublattices() - 1;
+	}
+
+	void SetSpin(std::size_t i1, std::size_t i2, std::size_t i3, std::size_t iSub, const t_real* spin)
+	{
+		for(std::size_t iComp=0; iComp<3; ++iComp)
+			m_spins[GetSpinIndex(i1, i2, i3, iSub, iComp)] = spin[iComp];
+	}
+
+	/**
+	 * spin grid of one component of a sublattice, [i1][i2][i3]
+	 */
+	t_real* GetSpins(std::size_t iSub, std::size_t iComp) { return m_spins.data() + (iSub*3 + iComp)*GetNumCells(); }
+
+	/**
+	 * size of the spin grids and the work buffers of Calc() in bytes
+	 */
+	std::size_t GetMemoryUsage() const
+	{
+		return m_spins.size()*sizeof(t_real)
+			+ 3*GetNumCells()*sizeof(t_cplx)		// full-grid structure factors
+			+ 3*m_fft.GetSpectrumSize()*sizeof(t_cplx);	// half spectra
+	}
+
+	/**
+	 * calculates S(Q) at Q = G + (n1/L1, n2/L2, n3/L3) into S[n1][n2][n3],
+	 * with bPerp the components of F parallel to Q are removed
+	 */
+	void Calc(const int* G, t_real* S, bool bPerp = true) const
+	{
+		const std::size_t N1 = m_dims[0], N2 = m_dims[1], N3 = m_dims[2];
+		const std::size_t N3h = N3/2 + 1;
+		const std::size_t numCells = GetNumCells();
+		const std::size_t numSpec = m_fft.GetSpectrumSize();
+
+		std::vector<t_cplx> F(3*numCells, t_cplx(0));
+		std::vector<t_cplx> spec(3*numSpec);
+
+		for(std::size_t iSub=0; iSub<GetNumSublattices(); ++iSub)
+		{
+			for(std::size_t iComp=0; iComp<3; ++iComp)
+				m_fft.Forward(m_spins.data() + (iSub*3 + iComp)*numCells, spec.data() + iComp*numSpec);
+
+			// separable basis phase factors exp(-2pi i Q_k*r_k) along each axis
+			const t_real* r = GetBasisPosition(iSub);
+			std::array<std::vector<t_cplx>, 3> phases;
+			for(std::size_t k=0; k<3; ++k)
+			{
+				phases[k].resize(m_dims[k]);
+				for(std::size_t n=0; n<m_dims[k]; ++n)
+				{
+					const t_real Q = t_real(G[k]) + t_real(n)/t_real(m_dims[k]);
+					phases[k][n] = std::polar(t_real(1), -2*s_pi*Q*r[k]);
+				}
+			}
+
+			m::run_parallel(N1, [&, N2, N3, N3h](std::size_t n1)
+			{
+				const std::size_t m1 = (N1 - n1) % N1;
+
+				for(std::size_t n2=0; n2<N2; ++n2)
+				{
+					const std::size_t m2 = (N2 - n2) % N2;
+					const t_cplx ph12 = phases[0][n1] * phases[1][n2];
+
+					for(std::size_t n3=0; n3<N3; ++n3)
+					{
+						const t_cplx ph = ph12 * phases[2][n3];
+						const std::size_t iCell = (n1*N2 + n2)*N3 + n3;
+
+						// hermitian symmetry of the real transforms
+						const bool bLower = n3 < N3h;
+						const std::size_t iSpec = bLower
+							? (n1*N2 + n2)*N3h + n3
+							: (m1*N2 + m2)*N3h + (N3 - n3);
+
+						for(std::size_t iComp=0; iComp<3; ++iComp)
+						{
+							const t_cplx val = spec[iComp*numSpec + iSpec];
+							F[iComp*numCells + iCell] += ph * (bLower ? val : std::conj(val));
+						}
+					}
+				}
+			}, m_iNumThreads);
+		}
+
+		const t_real norm = t_real(1) / t_real(std::max<std::size_t>(numCells*GetNumSublattices(), 1));
+
+		m::run_parallel(N1, [&, N2, N3](std::size_t n1)
+		{
+			for(std::size_t n2=0; n2<N2; ++n2)
+			{
+				for(std::size_t n3=0; n3<N3; ++n3)
+				{
+					const std::size_t iCell = (n1*N2 + n2)*N3 + n3;
+					const t_cplx Fx = F[iCell], Fy = F[numCells + iCell], Fz = F[2*numCells + iCell];
+					t_real I = std::norm(Fx) + std::norm(Fy) + std::norm(Fz);
+
+					if(bPerp)
+					{
+						const t_real hkl[3] = {
+							t_real(G[0]) + t_real(n1)/t_real(N1),
+							t_real(G[1]) + t_real(n2)/t_real(N2),
+							t_real(G[2]) + t_real(n3)/t_real(N3) };
+
+						t_real Q[3];
+						for(std::size_t i=0; i<3; ++i)
+							Q[i] = m_B[i*3 + 0]*hkl[0] + m_B[i*3 + 1]*hkl[1] + m_B[i*3 + 2]*hkl[2];
+						const t_real Q2 = Q[0]*Q[0] + Q[1]*Q[1] + Q[2]*Q[2];
+
+						if(Q2 > t_real(0))
+							I -= std::norm(Q[0]*Fx + Q[1]*Fy + Q[2]*Fz) / Q2;
+					}
+
+					S[iCell] = I * norm;
+				}
+			}
+		}, m_iNumThreads);
+	}
+};
+// ----------------------------------------------------------------------------
+
+
+#endif
@@ -0,0 +1,488 @@
+/**
+ * magnon dynamics using linear spin-wave theory
+ * @author Tobias Weber
+ * @date Nov-2018
+ * @license see 'LICENSE.EUPL' file
+ *
+ * References:
+ *  - S. Toth and B. Lake, J. Phys.: Condens. Matter 27, 166002 (2015),
+ *    https://doi.org/10.1088/0953-8984/27/16/166002
+ *  - J. H. P. Colpa, Physica A 93, 327 (1978),
+ *    https://doi.org/10.1016/0378-4371(78)90160-7
+ */
+
+#ifndef __MAG_DYN_H__
+#define __MAG_DYN_H__
+
+#include <vector>
+#include <tuple>
+#include <algorithm>
+#include <iostream>
+
+#include "math_concepts.h"
+#include "math_algos.h"
+#include "parallel.h"
+
+
+
+// ----------------------------------------------------------------------------
+/**
+ * a magnetic site in the unit cell
+ */
+template<class t_vec, class t_vec_cplx>
+struct MagDynSite
+{
+	using t_real = typename t_vec::value_type;
+
+	// position in the unit cell (rlu)
+	t_vec pos;
+
+	// spin direction (normalised) and spin length
+	t_vec spin_dir;
+	t_real spin = 0;
+
+	// local spin frame: u = x' + i y', v = z' = spin_dir
+	t_vec_cplx u, u_conj;
+	t_vec v;
+};
+
+
+/**
+ * an exchange coupling between two sites
+ * the bond connects site1 in the origin cell to site2 in the cell at dist
+ */
+template<class t_mat, class t_vec>
+struct MagDynCoupling
+{
+	std::size_t site1 = 0, site2 = 0;
+
+	// cell distance (rlu)
+	t_vec dist;
+
+	// exchange matrix: isotropic, DMI and anisotropic parts
+	t_mat J;
+};
+
+
+/**
+ * a magnon mode at a given Q
+ */
+template<class t_mat_cplx>
+struct MagDynMode
+{
+	using t_real = decltype(std::abs(typename t_mat_cplx::value_type{}));
+
+	t_real E = 0;
+
+	// dynamical correlation function S^{alpha beta}, and its part perpendicular to Q
+	t_mat_cplx S;
+	t_real weight = 0;
+};
+// ----------------------------------------------------------------------------
+
+
+
+
+// ----------------------------------------------------------------------------
+/**
+ * linear spin-wave calculator
+ * builds the holstein-primakoff hamiltonian and diagonalises it paraunitarily
+ */
+template<class t_mat, class t_vec, class t_mat_cplx, class t_vec_cplx>
+requires m::is_mat<t_mat> && m::is_vec<t_vec> && m::is_mat<t_mat_cplx> && m::is_vec<t_vec_cplx>
+class MagDyn
+{
+public:
+	using t_real = typename t_vec::value_type;
+	using t_cplx = typename t_vec_cplx::value_type;
+
+	using t_site = MagDynSite<t_vec, t_vec_cplx>;
+	using t_coupling = MagDynCoupling<t_mat, t_vec>;
+	using t_mode = MagDynMode<t_mat_cplx>;
+
+
+private:
+	std::vector<t_site> m_sites;
+	std::vector<t_coupling> m_couplings;
+
+	// crystal B matrix to transform Q into the orthonormal spin frame
+	t_mat m_B = m::unit<t_mat>(3);
+
+	// shift of the hamiltonian's diagonal to make goldstone modes positive-definite
+	t_real m_eps_shift = 1e-8;
+	t_real m_eps = 1e-6;
+
+
+protected:
+	/**
+	 * rotation of the z axis onto the spin direction,
+	 * also defined for spins antiparallel to z
+	 */
+	static t_mat spin_frame(const t_vec& dir)
+	{
+		const t_vec z = m::create<t_vec>({0, 0, 1});
+
+		if(m::equals<t_real>(m::inner<t_vec>(z, dir), t_real(-1), t_real(1e-6)))
+		{
+			// rotation by 180 degrees around x
+			t_mat rot = m::unit<t_mat>(3);
+			rot(1,1) = rot(2,2) = t_real(-1);
+			return rot;
+		}
+
+		return m::rotation<t_mat, t_vec>(z, dir);
+	}
+
+
+	/**
+	 * u^T J v for complex u, v and real J
+	 */
+	static t_cplx bilinear(const t_vec_cplx& u, const t_mat& J, const t_vec_cplx& v)
+	{
+		t_cplx val = t_cplx(0);
+
+		for(std::size_t i=0; i<3; ++i)
+			for(std::size_t j=0; j<3; ++j)
+				val += u[i] * J(i,j) * v[j];
+
+		return val;
+	}
+
+
+	static t_cplx phase(const t_vec& Q, const t_vec& r)
+	{
+		const t_real arg = t_real(2)*m::pi<t_real> * m::inner<t_vec>(Q, r);
+		return std::exp(t_cplx(0, arg));
+	}
+
+
+public:
+	MagDyn() = default;
+	~MagDyn() = default;
+
+	void Clear()
+	{
+		m_sites.clear();
+		m_couplings.clear();
+	}
+
+	void SetBMatrix(const t_mat& B) { m_B = B; }
+	void SetEpsilon(t_real eps) { m_eps = eps; }
+
+	const std::vector<t_site>& GetSites() const { return m_sites; }
+	const std::vector<t_coupling>& GetCouplings() const { return m_couplings; }
+
+
+	/**
+	 * adds a magnetic site, the spin length is the length of the given moment
+	 * returns the index of the new site
+	 */
+	std::size_t AddSite(const t_vec& pos, const t_vec& moment)
+	{
+		t_site site;
+		site.pos = pos;
+		site.spin = m::norm<t_vec>(moment);
+		site.spin_dir = moment / site.spin;
+
+		const t_mat rot = spin_frame(site.spin_dir);
+		const t_vec xp = m::col<t_mat, t_vec>(rot, 0);
+		const t_vec yp = m::col<t_mat, t_vec>(rot, 1);
+
+		site.u = m::zero<t_vec_cplx>(3);
+		site.u_conj = m::zero<t_vec_cplx>(3);
+		for(std::size_t i=0; i<3; ++i)
+		{
+			site.u[i] = t_cplx(xp[i], yp[i]);
+			site.u_conj[i] = t_cplx(xp[i], -yp[i]);
+		}
+		site.v = m::col<t_mat, t_vec>(rot, 2);
+
+		m_sites.emplace_back(std::move(site));
+		return m_sites.size() - 1;
+	}
+
+
+	/**
+	 * adds a coupling with a general exchange matrix
+	 * each bond has to be given only once
+	 */
+	void AddCoupling(std::size_t site1, std::size_t site2, const t_vec& dist, const t_mat& J)
+	{
+		t_coupling coupling;
+		coupling.site1 = site1;
+		coupling.site2 = site2;
+		coupling.dist = dist;
+		coupling.J = J;
+
+		m_couplings.emplace_back(std::move(coupling));
+	}
+
+
+	/**
+	 * adds an isotropic coupling with an optional dzyaloshinskii-moriya vector
+	 * H = J S_1*S_2 + D*(S_1 x S_2)
+	 */
+	void AddCoupling(std::size_t site1, std::size_t site2, const t_vec& dist,
+		t_real J, const t_vec* dmi = nullptr)
+	{
+		t_mat matJ = J * m::unit<t_mat>(3);
+		if(dmi)
+			matJ = matJ + m::trans<t_mat>(m::skewsymmetric<t_mat, t_vec>(*dmi));
+
+		AddCoupling(site1, site2, dist, matJ);
+	}
+
+
+	/**
+	 * checks the site indices of all couplings
+	 */
+	bool IsValid() const
+	{
+		if(m_sites.size() == 0)
+			return false;
+
+		for(const t_coupling& coupling : m_couplings)
+		{
+			if(coupling.site1 >= m_sites.size() || coupling.site2 >= m_sites.size())
+				return false;
+		}
+
+		return true;
+	}
+
+
+	/**
+	 * hamiltonian h(Q) in the basis (b_i(Q), b_i^+(-Q)), see (Toth 2015), eq. (25)
+	 *  h = 2 * [[ A(Q) - C, B(Q) ], [ B^+(Q), A^*(-Q) - C ]]
+	 */
+	t_mat_cplx GetHamiltonian(const t_vec& Q) const
+	{
+		const std::size_t N = m_sites.size();
+
+		t_mat_cplx A = m::zero<t_mat_cplx>(N, N);
+		t_mat_cplx A_mQ = m::zero<t_mat_cplx>(N, N);
+		t_mat_cplx B = m::zero<t_mat_cplx>(N, N);
+		std::vector<t_real> C(N, t_real(0));
+
+		for(const t_coupling& coupling : m_couplings)
+		{
+			const std::size_t i = coupling.site1;
+			const std::size_t j = coupling.site2;
+			const t_site& site_i = m_sites[i];
+			const t_site& site_j = m_sites[j];
+
+			// J_ij(Q) gets J*exp(iQd)/2, J_ji(Q) gets J^T*exp(-iQd)/2
+			const t_cplx ph = phase(Q, coupling.dist);
+			const t_cplx ph_conj = std::conj(ph);
+			const t_mat Jt = m::trans<t_mat>(coupling.J);
+			const t_real fac = std::sqrt(site_i.spin*site_j.spin) / t_real(2) / t_real(2);
+
+			const t_cplx uJuc_ij = fac * bilinear(site_i.u, coupling.J, site_j.u_conj);
+			const t_cplx uJuc_ji = fac * bilinear(site_j.u, Jt, site_i.u_conj);
+			const t_cplx uJu_ij = fac * bilinear(site_i.u, coupling.J, site_j.u);
+			const t_cplx uJu_ji = fac * bilinear(site_j.u, Jt, site_i.u);
+
+			A(i,j) += uJuc_ij * ph;
+			A(j,i) += uJuc_ji * ph_conj;
+			A_mQ(i,j) += uJuc_ij * ph_conj;
+			A_mQ(j,i) += uJuc_ji * ph;
+			B(i,j) += uJu_ij * ph;
+			B(j,i) += uJu_ji * ph_conj;
+
+			// C_ii = sum_l S_l v_i^T J_il(0) v_l
+			const t_real vJv = m::inner<t_vec>(site_i.v, coupling.J * site_j.v) / t_real(2);
+			C[i] += site_j.spin * vJv;
+			C[j] += site_i.spin * vJv;
+		}
+
+		t_mat_cplx h = m::zero<t_mat_cplx>(2*N, 2*N);
+		for(std::size_t i=0; i<N; ++i)
+		{
+			for(std::size_t j=0; j<N; ++j)
+			{
+				h(i,j) = t_real(2) * A(i,j);
+				h(i,j+N) = t_real(2) * B(i,j);
+				h(i+N,j) = t_real(2) * std::conj(B(j,i));
+				h(i+N,j+N) = t_real(2) * std::conj(A_mQ(i,j));
+			}
+
+			h(i,i) -= t_real(2) * C[i];
+			h(i+N,i+N) -= t_real(2) * C[i];
+		}
+
+		return h;
+	}
+
+
+	/**
+	 * magnon energies and correlation functions at Q (rlu)
+	 * using the paraunitary diagonalisation of (Colpa 1978)
+	 * returns [modes, ok]
+	 */
+	std::tuple<std::vector<t_mode>, bool> GetModes(const t_vec& Q, bool bOnlyEnergies = false) const
+	{
+		const std::size_t N = m_sites.size();
+		std::vector<t_mode> modes;
+
+		t_mat_cplx h = GetHamiltonian(Q);
+
+		// h = K^+ K, retry with a larger shift for (nearly) singular goldstone modes
+		auto [L, bChol] = m::chol<t_mat_cplx>(h);
+		for(t_real shift = m_eps_shift; !bChol && shift < m_eps; shift *= t_real(10))
+		{
+			t_mat_cplx hShifted = h;
+			for(std::size_t i=0; i<2*N; ++i)
+				hShifted(i,i) += shift;
+			std::tie(L, bChol) = m::chol<t_mat_cplx>(hShifted);
+		}
+		if(!bChol)
+			return std::make_tuple(modes, false);
+
+		// K g K^+ with the paraunitary metric g = diag(1, ..., 1, -1, ..., -1)
+		const t_mat_cplx K = m::herm<t_mat_cplx>(L);
+		t_mat_cplx gKh = L;
+		for(std::size_t i=N; i<2*N; ++i)
+			for(std::size_t j=0; j<2*N; ++j)
+				gKh(i,j) = -gKh(i,j);
+		const t_mat_cplx KgK = K * gKh;
+
+		// the positive eigenvalues are the magnon creation energies
+		auto set_energies = [&modes, N](const std::vector<t_real>& evals)
+		{
+			modes.reserve(N);
+			for(std::size_t n=0; n<N; ++n)
+			{
+				t_mode mode;
+				mode.E = evals[N + n];
+				modes.emplace_back(std::move(mode));
+			}
+		};
+
+		if(bOnlyEnergies)
+		{
+			auto [evals, bEigOk] = m::eigenval_herm<t_mat_cplx>(KgK);
+			if(bEigOk)
+				set_energies(evals);
+			return std::make_tuple(modes, bEigOk);
+		}
+
+		auto [evals, evecs, bEigOk] = m::eigenvec_herm<t_mat_cplx, t_vec_cplx>(KgK);
+		if(!bEigOk)
+			return std::make_tuple(modes, false);
+		set_energies(evals);
+
+		// T = K^(-1) U sqrt(E), only the columns of the creation modes are needed
+		auto [Kinv, bInvOk] = m::inv_triangular<t_mat_cplx>(K, false);
+		if(!bInvOk)
+			return std::make_tuple(modes, false);
+
+		// spin operator coefficients in the (b, b^+) basis
+		std::vector<t_vec_cplx> a(3, m::zero<t_vec_cplx>(2*N));
+		for(std::size_t i=0; i<N; ++i)
+		{
+			const t_site& site = m_sites[i];
+			const t_cplx ph = std::sqrt(site.spin/t_real(2)) * std::conj(phase(Q, site.pos));
+
+			for(std::size_t alpha=0; alpha<3; ++alpha)
+			{
+				a[alpha][i] = ph * site.u_conj[alpha];
+				a[alpha][i+N] = ph * site.u[alpha];
+			}
+		}
+
+		// projector perpendicular to Q
+		t_vec Q_cart = m_B * Q;
+		const t_real lenQ = m::norm<t_vec>(Q_cart);
+		t_mat proj_perp = m::unit<t_mat>(3);
+		if(lenQ > m_eps)
+			proj_perp = m::ortho_projector<t_mat, t_vec>(Q_cart / lenQ, true);
+
+		for(std::size_t n=0; n<N; ++n)
+		{
+			t_mode& mode = modes[n];
+			const t_vec_cplx& U_n = evecs[N + n];
+			const t_real sqrtE = std::sqrt(std::abs(mode.E));
+
+			// <0|S^alpha(Q)|n>
+			t_cplx Sn[3] = { t_cplx(0), t_cplx(0), t_cplx(0) };
+			for(std::size_t idx=0; idx<2*N; ++idx)
+			{
+				t_cplx T_mn = t_cplx(0);
+				for(std::size_t k=idx; k<2*N; ++k)
+					T_mn += Kinv(idx,k) * U_n[k];
+				T_mn *= sqrtE;
+
+				for(std::size_t alpha=0; alpha<3; ++alpha)
+					Sn[alpha] += a[alpha][idx] * T_mn;
+			}
+
+			mode.S = m::zero<t_mat_cplx>(3, 3);
+			for(std::size_t alpha=0; alpha<3; ++alpha)
+				for(std::size_t beta=0; beta<3; ++beta)
+					mode.S(alpha, beta) = Sn[alpha] * std::conj(Sn[beta]) / t_real(N);
+
+			mode.weight = 0;
+			for(std::size_t alpha=0; alpha<3; ++alpha)
+				for(std::size_t beta=0; beta<3; ++beta)
+					mode.weight += std::real(proj_perp(alpha, beta) * mode.S(beta, alpha));
+		}
+
+		return std::make_tuple(modes, true);
+	}
+
+
+	/**
+	 * dispersion for a list of Q points, the Q points are distributed over the threads
+	 * returns [modes per Q, ok per Q]
+	 */
+	std::tuple<std::vector<std::vector<t_mode>>, std::vector<bool>>
+	GetDispersion(const std::vector<t_vec>& Qs, unsigned int iNumThreads = 0,
+		bool bOnlyEnergies = false) const
+	{
+		std::vector<std::vector<t_mode>> results(Qs.size());
+		std::vector<char> oks(Qs.size(), 0);
+
+		m::run_parallel(Qs.size(), [this, &Qs, &results, &oks, bOnlyEnergies](std::size_t idx)
+		{
+			auto [modes, ok] = GetModes(Qs[idx], bOnlyEnergies);
+			results[idx] = std::move(modes);
+			oks[idx] = ok;
+		}, iNumThreads);
+
+		return std::make_tuple(results, std::vector<bool>(oks.begin(), oks.end()));
+	}
+
+
+	/**
+	 * Q points along a path of vertices, iNumPts per segment
+	 */
+	static std::vector<t_vec> GetQPath(const std::vector<t_vec>& vertices, std::size_t iNumPts)
+	{
+		std::vector<t_vec> Qs;
+		if(vertices.size() == 1)
+			Qs.push_back(vertices[0]);
+
+		for(std::size_t iVert=1; iVert<vertices.size(); ++iVert)
+		{
+			const t_vec& Q1 = vertices[iVert-1];
+			const t_vec& Q2 = vertices[iVert];
+			const bool bLast = (iVert == vertices.size()-1);
+
+			for(std::size_t i=0; i<iNumPts; ++i)
+			{
+				// skip the end point except for the last segment
+				if(!bLast && i == iNumPts-1)
+					break;
+
+				const t_real t = iNumPts > 1 ? t_real(i) / t_real(iNumPts-1) : t_real(0);
+				Qs.emplace_back(Q1 + (Q2 - Q1) * t);
+			}
+		}
+
+		return Qs;
+	}
+};
+// ----------------------------------------------------------------------------
+
+
+#endif
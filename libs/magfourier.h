@@ -0,0 +1,279 @@
+/**
+ * fourier synthesis of (magnetisation) densities from structure factors
+ * @author Tobias Weber
+ * @date Nov-2018
+ * @license see 'LICENSE.EUPL' file
+ */
+
+#ifndef __MAG_FOURIER_H__
+#define __MAG_FOURIER_H__
+
+#include <vector>
+#include <array>
+#include <map>
+#include <string>
+#include <fstream>
+#include <complex>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+
+#include "math_fft.h"
+
+
+// ----------------------------------------------------------------------------
+/**
+ * density on a grid over the unit cell, e.g. the three components of the magnetisation
+ *
+ * binary file format, native byte order:
+ *	char[8]         "MAGDENS1"
+ *	uint32[3]       grid dimensions N1, N2, N3
+ *	uint32          number of components
+ *	float32[9]      real-space basis, lattice vectors as columns (A)
+ *	float32[...]    values, component-major, the last grid index running fastest
+ * the grid point (i1, i2, i3) is at the fractional coordinates (i1/N1, i2/N2, i3/N3).
+ */
+template<class t_real = double>
+struct MagDensityGrid
+{
+	std::array<std::size_t, 3> dims{{ 0, 0, 0 }};
+	std::size_t numComps = 0;
+
+	// real-space basis (row-major 3x3), lattice vectors as columns
+	std::array<t_real, 9> basis{{ 1,0,0, 0,1,0, 0,0,1 }};
+
+	std::vector<t_real> values;
+
+
+	std::size_t GetNumPoints() const { return dims[0]*dims[1]*dims[2]; }
+
+	t_real& operator()(std::size_t iComp, std::size_t i1, std::size_t i2, std::size_t i3)
+	{ return values[iComp*GetNumPoints() + (i1*dims[1] + i2)*dims[2] + i3]; }
+
+	const t_real& operator()(std::size_t iComp, std::size_t i1, std::size_t i2, std::size_t i3) const
+	{ return values[iComp*GetNumPoints() + (i1*dims[1] + i2)*dims[2] + i3]; }
+
+
+	bool Save(const std::string& strFile) const
+	{
+		std::ofstream ofstr(strFile, std::ios::binary);
+		if(!ofstr)
+		{
+			std::cerr << "Cannot open \"" << strFile << "\"." << std::endl;
+			return false;
+		}
+
+		const std::uint32_t header[4] = { std::uint32_t(dims[0]), std::uint32_t(dims[1]),
+			std::uint32_t(dims[2]), std::uint32_t(numComps) };
+		float fbasis[9];
+		std::copy(basis.begin(), basis.end(), fbasis);
+
+		ofstr.write("MAGDENS1", 8);
+		ofstr.write(reinterpret_cast<const char*>(header), sizeof(header));
+		ofstr.write(reinterpret_cast<const char*>(fbasis), sizeof(fbasis));
+
+		std::vector<float> fvalues(values.begin(), values.end());
+		ofstr.write(reinterpret_cast<const char*>(fvalues.data()), fvalues.size()*sizeof(float));
+
+		return bool(ofstr);
+	}
+
+
+	bool Load(const std::string& strFile)
+	{
+		std::ifstream ifstr(strFile, std::ios::binary);
+		if(!ifstr)
+		{
+			std::cerr << "Cannot open \"" << strFile << "\"." << std::endl;
+			return false;
+		}
+
+		char magic[8];
+		std::uint32_t header[4];
+		float fbasis[9];
+		ifstr.read(magic, 8);
+		ifstr.read(reinterpret_cast<char*>(header), sizeof(header));
+		ifstr.read(reinterpret_cast<char*>(fbasis), sizeof(fbasis));
+		if(!ifstr || std::memcmp(magic, "MAGDENS1", 8) != 0)
+		{
+			std::cerr << "\"" << strFile << "\" is not a density grid." << std::endl;
+			return false;
+		}
+
+		dims = {{ header[0], header[1], header[2] }};
+		numComps = header[3];
+		std::copy(fbasis, fbasis+9, basis.begin());
+
+		std::vector<float> fvalues(numComps*GetNumPoints());
+		ifstr.read(reinterpret_cast<char*>(fvalues.data()), fvalues.size()*sizeof(float));
+		if(!ifstr)
+		{
+			std::cerr << "\"" << strFile << "\" is truncated." << std::endl;
+			return false;
+		}
+
+		values.assign(fvalues.begin(), fvalues.end());
+		return true;
+	}
+};
+// ----------------------------------------------------------------------------
+
+
+
+
+// ----------------------------------------------------------------------------
+/**
+ * fourier synthesis rho(r) = 1/V sum_Q F(Q) exp(2pi i Q*r) on a grid over the unit cell
+ *
+ * the structure factors follow the sign convention of m::structure_factor.
+ * reflections are given at integer hkl, missing friedel mates are completed with
+ * F(-Q) = F(Q)^*, so that the density is real. each component (e.g. of F_M) is
+ * synthesised with a real-valued 3d fft.
+ */
+template<class t_real = double>
+class MagFourierSynth
+{
+public:
+	using t_cplx = std::complex<t_real>;
+	using t_hkl = std::array<int, 3>;
+
+private:
+	std::size_t m_iNumComps = 3;
+	std::array<std::size_t, 3> m_dims{{ 0, 0, 0 }};
+	unsigned int m_iNumThreads = 0;
+
+	std::map<t_hkl, std::vector<t_cplx>> m_refls;
+
+protected:
+	static std::size_t GetIndex(int h, std::size_t N)
+	{
+		const int iN = int(N);
+		return std::size_t(((h % iN) + iN) % iN);
+	}
+
+public:
+	MagFourierSynth(std::size_t iNumComps = 3) : m_iNumComps{iNumComps} {}
+	~MagFourierSynth() = default;
+
+	void SetNumThreads(unsigned int iNumThreads) { m_iNumThreads = iNumThreads; }
+	std::size_t GetNumComponents() const { return m_iNumComps; }
+	std::size_t GetNumReflections() const { return m_refls.size(); }
+
+	void Clear() { m_refls.clear(); }
+
+	/**
+	 * grid dimensions, 0: smallest fft-friendly size holding all reflections
+	 */
+	void SetDims(std::size_t N1, std::size_t N2, std::size_t N3) { m_dims = {{ N1, N2, N3 }}; }
+
+	std::array<std::size_t, 3> GetDims() const
+	{
+		std::array<int, 3> maxHKL{{ 0, 0, 0 }};
+		for(const auto& refl : m_refls)
+			for(int i=0; i<3; ++i)
+				maxHKL[i] = std::max(maxHKL[i], std::abs(refl.first[i]));
+
+		std::array<std::size_t, 3> dims = m_dims;
+		for(int i=0; i<3; ++i)
+		{
+			if(dims[i] == 0)
+				dims[i] = m::FFT<t_real>::GetNiceSize(std::size_t(2*maxHKL[i] + 1));
+		}
+		return dims;
+	}
+
+	/**
+	 * adds the structure factor components at a reflection, returns false if hkl is not integer
+	 * a reflection given twice is summed up
+	 */
+	bool AddReflection(const t_real* hkl, const t_cplx* F, t_real eps = 1e-6)
+	{
+		t_hkl ihkl;
+		for(int i=0; i<3; ++i)
+		{
+			const t_real h = std::round(hkl[i]);
+			if(std::abs(h - hkl[i]) > eps)
+				return false;
+			ihkl[i] = int(h);
+		}
+
+		auto& Fs = m_refls[ihkl];
+		Fs.resize(m_iNumComps, t_cplx(0));
+		for(std::size_t iComp=0; iComp<m_iNumComps; ++iComp)
+			Fs[iComp] += F[iComp];
+
+		return true;
+	}
+
+	/**
+	 * synthesises the density, vol is the unit cell volume
+	 * returns the number of reflections beyond the grid resolution, which are skipped
+	 */
+	std::size_t Synthesise(MagDensityGrid<t_real>& grid, t_real vol = 1) const
+	{
+		const std::array<std::size_t, 3> dims = GetDims();
+		const std::size_t N3h = dims[2]/2 + 1;
+
+		m::FFT3Real<t_real> fft(dims[0], dims[1], dims[2]);
+		fft.SetNumThreads(m_iNumThreads);
+
+		grid.dims = dims;
+		grid.numComps = m_iNumComps;
+		grid.values.resize(m_iNumComps * fft.GetSize());
+
+		// hermitian half spectrum of each component
+		std::vector<std::vector<t_cplx>> specs(m_iNumComps,
+			std::vector<t_cplx>(fft.GetSpectrumSize(), t_cplx(0)));
+		std::size_t iNumSkipped = 0;
+
+		auto put = [&specs, &dims, N3h](const t_hkl& hkl, std::size_t iComp, const t_cplx& F)
+		{
+			const std::size_t i3 = GetIndex(hkl[2], dims[2]);
+			if(i3 >= N3h)
+				return;		// given by the friedel mate
+			const std::size_t i1 = GetIndex(hkl[0], dims[0]);
+			const std::size_t i2 = GetIndex(hkl[1], dims[1]);
+			specs[iComp][(i1*dims[1] + i2)*N3h + i3] = F;
+		};
+
+		for(const auto& [hkl, Fs] : m_refls)
+		{
+			// would alias to another grid frequency
+			bool bResolved = true;
+			for(int i=0; i<3; ++i)
+				if(std::size_t(2*std::abs(hkl[i])) >= dims[i])
+					bResolved = false;
+			if(!bResolved)
+			{
+				++iNumSkipped;
+				continue;
+			}
+
+			const t_hkl hklMinus{{ -hkl[0], -hkl[1], -hkl[2] }};
+			auto iterMinus = m_refls.find(hklMinus);
+
+			for(std::size_t iComp=0; iComp<m_iNumComps; ++iComp)
+			{
+				// hermitian part, F(Q) and F(-Q)^* are averaged if both are given
+				t_cplx F = Fs[iComp];
+				if(iterMinus != m_refls.end())
+					F = t_real(0.5) * (F + std::conj(iterMinus->second[iComp]));
+
+				put(hkl, iComp, F / vol);
+				if(iterMinus == m_refls.end())
+					put(hklMinus, iComp, std::conj(F) / vol);
+			}
+		}
+
+		for(std::size_t iComp=0; iComp<m_iNumComps; ++iComp)
+			fft.Inverse(specs[iComp].data(), grid.values.data() + iComp*fft.GetSize());
+
+		return iNumSkipped;
+	}
+};
+// ----------------------------------------------------------------------------
+
+
+#endif
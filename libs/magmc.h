@@ -0,0 +1,875 @@
+/**
+ * classical monte carlo simulation of heisenberg spin models
+ * @author Tobias Weber
+ * @date Nov-2018
+ * @license see 'LICENSE.EUPL' file
+ *
+ * References:
+ *  - D. Hinzke and U. Nowak, Comput. Phys. Commun. 121-122, 334 (1999),
+ *    https://doi.org/10.1016/S0010-4655(99)00348-3
+ *  - K. Hukushima and K. Nemoto, J. Phys. Soc. Jpn. 65, 1604 (1996),
+ *    https://doi.org/10.1143/JPSJ.65.1604
+ */
+
+#ifndef __MAG_MC_H__
+#define __MAG_MC_H__
+
+#include <vector>
+#include <array>
+#include <tuple>
+#include <random>
+#include <limits>
+#include <algorithm>
+#include <iostream>
+#include <cstdint>
+#include <cmath>
+
+#include "parallel.h"
+
+
+// ----------------------------------------------------------------------------
+/**
+ * monte carlo engine for classical spins on a periodic supercell
+ *
+ * H = sum_bonds S_i^T J_ij S_j + sum_i S_i^T A_i S_i - sum_i h*S_i
+ *
+ * the exchange matrices J contain the isotropic, dzyaloshinskii-moriya and anisotropic parts
+ * (same convention as MagDyn), A are the single-ion anisotropies and h is the zeeman field
+ * in energy units. the spins are given in an orthonormal frame, the temperatures in the energy
+ * units of the couplings (k_B = 1).
+ *
+ * the bonds of every spin are stored in a compressed row list of neighbour indices and
+ * references to the few distinct exchange matrices. the spins are greedily coloured such that
+ * no two coupled spins share a colour, the spins of one colour are then updated in parallel
+ * chunks, each with its own random number generator, so that the results do not depend on the
+ * number of threads. several replicas at different temperatures can be simulated at once and
+ * exchanged by parallel tempering.
+ */
+template<class t_real = double>
+class MagMC
+{
+public:
+	enum class Update
+	{
+		METROPOLIS,	// gaussian trial moves
+		HEATBATH,	// exact for the exchange and zeeman terms, anisotropies via metropolis
+	};
+
+	using t_rng = std::mt19937_64;
+
+private:
+	struct Site
+	{
+		t_real pos[3];
+		t_real dir[3];
+		t_real len = 1;
+		bool bAniso = false;
+		t_real A[9];
+	};
+
+	struct Coupling
+	{
+		std::size_t site1 = 0, site2 = 0;
+		long dist[3];
+		t_real J[9];
+	};
+
+	struct Replica
+	{
+		std::vector<t_real> spins;
+		std::size_t iTemp = 0;
+		std::vector<t_rng> rngs;
+	};
+
+	// unit cell
+	std::vector<Site> m_sites;
+	std::vector<Coupling> m_couplings;
+	t_real m_field[3] = { 0, 0, 0 };
+	std::array<std::size_t, 3> m_dims{{ 1, 1, 1 }};
+
+	// neighbour list: the bonds of spin i are [m_nbOffs[i], m_nbOffs[i+1]),
+	// each referencing a neighbour spin and one of the matrices J or J^T (9 elements each)
+	std::vector<std::size_t> m_nbOffs;
+	std::vector<std::uint32_t> m_nbSpins, m_nbMats;
+	std::vector<t_real> m_mats;
+
+	// spins sorted by colour, the spins of colour c are [m_colOffs[c], m_colOffs[c+1])
+	std::vector<std::size_t> m_colOffs;
+	std::vector<std::uint32_t> m_colSpins;
+	std::vector<std::size_t> m_chunkOffs;
+
+	// temperatures (ascending) and the replica currently at each temperature
+	std::vector<t_real> m_temps;
+	std::vector<std::size_t> m_replicaAtTemp;
+	std::vector<Replica> m_replicas;
+
+	// metropolis step size per temperature
+	std::vector<t_real> m_steps;
+
+	// statistics per temperature
+	std::vector<std::size_t> m_tried, m_accepted;
+	std::vector<std::size_t> m_swapsTried, m_swapsAccepted;
+	std::vector<std::array<t_real, 4>> m_sums;	// E, E^2, |M|, M^2
+	std::size_t m_numMeasurements = 0;
+	std::size_t m_iNumExchanges = 0;
+
+	Update m_update = Update::HEATBATH;
+	t_real m_stepInit = t_real(0.5);
+	std::size_t m_iChunkSize = 1024;
+	unsigned int m_iNumThreads = 0;
+	unsigned int m_iSeed = 5489u;
+	t_rng m_rng;
+
+protected:
+
+	std::size_t GetSpinIndex(std::size_t iCell, std::size_t iSite) const
+	{
+		return iCell*m_sites.size() + iSite;
+	}
+
+	const Site& GetSpinSite(std::size_t iSpin) const
+	{
+		return m_sites.size() == 1 ? m_sites[0] : m_sites[iSpin % m_sites.size()];
+	}
+
+	/**
+	 * index of the cell shifted by dist, with periodic boundaries
+	 */
+	std::size_t ShiftCell(std::size_t iCell, const long* dist) const
+	{
+		std::size_t idx[3] = { iCell / (m_dims[1]*m_dims[2]), (iCell / m_dims[2]) % m_dims[1], iCell % m_dims[2] };
+
+		for(std::size_t k=0; k<3; ++k)
+		{
+			const long L = long(m_dims[k]);
+			idx[k] = std::size_t(((long(idx[k]) + dist[k]) % L + L) % L);
+		}
+
+		return (idx[0]*m_dims[1] + idx[1])*m_dims[2] + idx[2];
+	}
+
+	static t_real quadratic(const t_real* s, const t_real* A)
+	{
+		t_real E = 0;
+		for(std::size_t i=0; i<3; ++i)
+			E += s[i] * (A[i*3 + 0]*s[0] + A[i*3 + 1]*s[1] + A[i*3 + 2]*s[2]);
+		return E;
+	}
+
+	/**
+	 * local field H with the single-spin energy E_i(s) = s*H + s^T A s
+	 */
+	void GetLocalField(const t_real* spins, std::size_t iSpin, t_real* H) const
+	{
+		H[0] = -m_field[0]; H[1] = -m_field[1]; H[2] = -m_field[2];
+
+		for(std::size_t iNb=m_nbOffs[iSpin]; iNb<m_nbOffs[iSpin+1]; ++iNb)
+		{
+			const t_real* J = m_mats.data() + std::size_t(m_nbMats[iNb])*9;
+			const t_real* s = spins + std::size_t(m_nbSpins[iNb])*3;
+
+			H[0] += J[0]*s[0] + J[1]*s[1] + J[2]*s[2];
+			H[1] += J[3]*s[0] + J[4]*s[1] + J[5]*s[2];
+			H[2] += J[6]*s[0] + J[7]*s[1] + J[8]*s[2];
+		}
+	}
+
+	/**
+	 * updates a single spin, returns true if the new state was accepted
+	 */
+	bool UpdateSpin(t_real* spins, std::size_t iSpin, t_real T, t_real step, t_rng& rng) const
+	{
+		const Site& site = GetSpinSite(iSpin);
+		t_real* s = spins + iSpin*3;
+
+		t_real H[3];
+		GetLocalField(spins, iSpin, H);
+
+		const bool bZeroT = !(T > t_real(0));
+		const t_real beta = bZeroT ? t_real(0) : t_real(1)/T;
+		std::uniform_real_distribution<t_real> uni(0, 1);
+
+		t_real snew[3];
+		t_real dE = 0;
+
+		if(m_update == Update::HEATBATH)
+		{
+			// sample the direction from exp(-beta s*H) around -H
+			const t_real Hlen = std::sqrt(H[0]*H[0] + H[1]*H[1] + H[2]*H[2]);
+			const t_real x = beta * site.len * Hlen;
+
+			t_real axis[3] = { 0, 0, 1 };
+			if(Hlen > t_real(0))
+				for(std::size_t i=0; i<3; ++i)
+					axis[i] = -H[i] / Hlen;
+
+			// cosine of the polar angle, at zero temperature the spin follows the field
+			t_real c = 1;
+			if(!(Hlen > t_real(0)) || (!bZeroT && x <= t_real(1e-8)))
+				c = t_real(2)*uni(rng) - t_real(1);
+			else if(!bZeroT)
+				c = t_real(1) + std::log(std::exp(t_real(-2)*x) + uni(rng)*(t_real(1) - std::exp(t_real(-2)*x))) / x;
+			c = std::clamp<t_real>(c, -1, 1);
+
+			// uniform azimuth from a point in the unit disc
+			t_real a, b, r2;
+			do
+			{
+				a = t_real(2)*uni(rng) - t_real(1);
+				b = t_real(2)*uni(rng) - t_real(1);
+				r2 = a*a + b*b;
+			}
+			while(r2 > t_real(1) || !(r2 > t_real(0)));
+			const t_real sn = std::sqrt((t_real(1) - c*c) / r2);
+
+			// orthonormal vectors perpendicular to the axis
+			t_real u[3], v[3];
+			if(std::abs(axis[0]) < t_real(0.9))
+				{ u[0] = 0; u[1] = axis[2]; u[2] = -axis[1]; }
+			else
+				{ u[0] = -axis[2]; u[1] = 0; u[2] = axis[0]; }
+			const t_real ulen = std::sqrt(u[0]*u[0] + u[1]*u[1] + u[2]*u[2]);
+			for(std::size_t i=0; i<3; ++i)
+				u[i] /= ulen;
+			v[0] = axis[1]*u[2] - axis[2]*u[1];
+			v[1] = axis[2]*u[0] - axis[0]*u[2];
+			v[2] = axis[0]*u[1] - axis[1]*u[0];
+
+			for(std::size_t i=0; i<3; ++i)
+				snew[i] = site.len * (c*axis[i] + sn*(a*u[i] + b*v[i]));
+
+			// the exchange and zeeman parts are sampled exactly, only the anisotropy needs an acceptance step
+			if(!site.bAniso)
+			{
+				std::copy(snew, snew+3, s);
+				return true;
+			}
+
+			dE = quadratic(snew, site.A) - quadratic(s, site.A);
+		}
+		else
+		{
+			// gaussian trial move around the current direction
+			std::normal_distribution<t_real> gauss(0, step);
+			t_real len = 0;
+			for(std::size_t i=0; i<3; ++i)
+			{
+				snew[i] = s[i]/site.len + gauss(rng);
+				len += snew[i]*snew[i];
+			}
+			len = std::sqrt(len);
+			if(!(len > t_real(0)))
+				return false;
+			for(std::size_t i=0; i<3; ++i)
+				snew[i] *= site.len / len;
+
+			for(std::size_t i=0; i<3; ++i)
+				dE += (snew[i] - s[i]) * H[i];
+			if(site.bAniso)
+				dE += quadratic(snew, site.A) - quadratic(s, site.A);
+		}
+
+		bool bAccept = dE <= t_real(0);
+		if(!bAccept && !bZeroT)
+			bAccept = uni(rng) < std::exp(-beta*dE);
+
+		if(bAccept)
+			std::copy(snew, snew+3, s);
+		return bAccept;
+	}
+
+	/**
+	 * energies of the spins [iStart, iEnd), each bond is counted half
+	 */
+	t_real CalcEnergy(const t_real* spins, std::size_t iStart, std::size_t iEnd) const
+	{
+		t_real E = 0;
+
+		for(std::size_t iSpin=iStart; iSpin<iEnd; ++iSpin)
+		{
+			const Site& site = GetSpinSite(iSpin);
+			const t_real* s = spins + iSpin*3;
+
+			t_real H[3];
+			GetLocalField(spins, iSpin, H);
+
+			// undo the zeeman term in H before halving the exchange
+			for(std::size_t i=0; i<3; ++i)
+				E += s[i] * (t_real(0.5)*(H[i] + m_field[i]) - m_field[i]);
+			if(site.bAniso)
+				E += quadratic(s, site.A);
+		}
+
+		return E;
+	}
+
+	/**
+	 * total energies and magnetisations of all replicas
+	 */
+	void CalcReplicaObservables(std::vector<t_real>& Es, std::vector<std::array<t_real, 3>>& Ms) const
+	{
+		const std::size_t numSpins = GetNumSpins();
+		const std::size_t numChunks = (numSpins + m_iChunkSize - 1) / m_iChunkSize;
+		const std::size_t numReplicas = m_replicas.size();
+
+		std::vector<std::array<t_real, 4>> parts(numReplicas * numChunks);
+
+		m::run_parallel(numReplicas * numChunks, [&](std::size_t iTask)
+		{
+			const std::size_t iReplica = iTask / numChunks;
+			const std::size_t iStart = (iTask % numChunks) * m_iChunkSize;
+			const std::size_t iEnd = std::min(iStart + m_iChunkSize, numSpins);
+			const t_real* spins = m_replicas[iReplica].spins.data();
+
+			auto& part = parts[iTask];
+			part = {{ CalcEnergy(spins, iStart, iEnd), 0, 0, 0 }};
+			for(std::size_t iSpin=iStart; iSpin<iEnd; ++iSpin)
+				for(std::size_t i=0; i<3; ++i)
+					part[1+i] += spins[iSpin*3 + i];
+		}, m_iNumThreads);
+
+		Es.assign(numReplicas, t_real(0));
+		Ms.assign(numReplicas, std::array<t_real, 3>{{ 0, 0, 0 }});
+		for(std::size_t iTask=0; iTask<parts.size(); ++iTask)
+		{
+			const std::size_t iReplica = iTask / numChunks;
+			Es[iReplica] += parts[iTask][0];
+			for(std::size_t i=0; i<3; ++i)
+				Ms[iReplica][i] += parts[iTask][1+i];
+		}
+	}
+
+public:
+	MagMC() = default;
+	~MagMC() = default;
+
+	void SetNumThreads(unsigned int iNumThreads) { m_iNumThreads = iNumThreads; }
+	void SetChunkSize(std::size_t iChunkSize) { m_iChunkSize = std::max<std::size_t>(iChunkSize, 1); }
+	void SetSeed(unsigned int iSeed) { m_iSeed = iSeed; }
+	void SetUpdate(Update update) { m_update = update; }
+	void SetStepSize(t_real step) { m_stepInit = step; std::fill(m_steps.begin(), m_steps.end(), step); }
+	void SetField(const t_real* h) { std::copy(h, h+3, m_field); }
+	void SetSupercell(std::size_t L1, std::size_t L2, std::size_t L3)
+	{
+		m_dims = {{ std::max<std::size_t>(L1, 1), std::max<std::size_t>(L2, 1), std::max<std::size_t>(L3, 1) }};
+	}
+
+	/**
+	 * temperatures of the replicas, in the energy units of the couplings
+	 */
+	void SetTemperatures(const std::vector<t_real>& temps)
+	{
+		m_temps = temps;
+		std::sort(m_temps.begin(), m_temps.end());
+	}
+
+	const std::array<std::size_t, 3>& GetSupercell() const { return m_dims; }
+	std::size_t GetNumCells() const { return m_dims[0]*m_dims[1]*m_dims[2]; }
+	std::size_t GetNumSites() const { return m_sites.size(); }
+	std::size_t GetNumSpins() const { return GetNumCells()*m_sites.size(); }
+	std::size_t GetNumCouplings() const { return m_couplings.size(); }
+	std::size_t GetNumColours() const { return m_colOffs.size() ? m_colOffs.size() - 1 : 0; }
+	std::size_t GetNumBonds() const { return m_nbSpins.size() / 2; }
+	const std::vector<t_real>& GetTemperatures() const { return m_temps; }
+	const t_real* GetSitePosition(std::size_t iSite) const { return m_sites[iSite].pos; }
+
+	/**
+	 * adds a site at the position pos (rlu) with the spin length and initial direction of the moment
+	 * returns the index of the new site
+	 */
+	std::size_t AddSite(const t_real* pos, const t_real* moment)
+	{
+		Site site;
+		std::copy(pos, pos+3, site.pos);
+		site.len = std::sqrt(moment[0]*moment[0] + moment[1]*moment[1] + moment[2]*moment[2]);
+		for(std::size_t i=0; i<3; ++i)
+			site.dir[i] = site.len > t_real(0) ? moment[i]/site.len : t_real(i == 2);
+		if(!(site.len > t_real(0)))
+			site.len = 1;
+
+		m_sites.emplace_back(std::move(site));
+		return m_sites.size() - 1;
+	}
+
+	/**
+	 * single-ion anisotropy E = S^T A S with the row-major matrix A
+	 */
+	void SetAnisotropy(std::size_t iSite, const t_real* A)
+	{
+		std::copy(A, A+9, m_sites[iSite].A);
+		m_sites[iSite].bAniso = std::any_of(A, A+9, [](t_real a) -> bool { return a != t_real(0); });
+	}
+
+	/**
+	 * adds a coupling between site1 in the origin cell and site2 in the cell at dist
+	 * with the row-major exchange matrix J, each bond has to be given only once
+	 */
+	void AddCoupling(std::size_t site1, std::size_t site2, const long* dist, const t_real* J)
+	{
+		Coupling coupling;
+		coupling.site1 = site1;
+		coupling.site2 = site2;
+		std::copy(dist, dist+3, coupling.dist);
+		std::copy(J, J+9, coupling.J);
+
+		m_couplings.emplace_back(std::move(coupling));
+	}
+
+	/**
+	 * adds an isotropic coupling with an optional dzyaloshinskii-moriya vector
+	 * H = J S_1*S_2 + D*(S_1 x S_2)
+	 */
+	void AddCoupling(std::size_t site1, std::size_t site2, const long* dist,
+		t_real J, const t_real* dmi = nullptr)
+	{
+		t_real matJ[9] = { J, 0, 0,  0, J, 0,  0, 0, J };
+		if(dmi)
+		{
+			matJ[1] += dmi[2]; matJ[2] -= dmi[1];
+			matJ[3] -= dmi[2]; matJ[5] += dmi[0];
+			matJ[6] += dmi[1]; matJ[7] -= dmi[0];
+		}
+
+		AddCoupling(site1, site2, dist, matJ);
+	}
+
+
+	/**
+	 * builds the neighbour list, the colouring and the replicas
+	 */
+	bool Build()
+	{
+		const std::size_t numSites = m_sites.size();
+		const std::size_t numCells = GetNumCells();
+		const std::size_t numSpins = GetNumSpins();
+
+		if(numSites == 0 || m_temps.size() == 0)
+		{
+			std::cerr << "Error: no sites or temperatures defined." << std::endl;
+			return false;
+		}
+
+		if(numSpins >= std::size_t(std::numeric_limits<std::uint32_t>::max()))
+		{
+			std::cerr << "Error: too many spins." << std::endl;
+			return false;
+		}
+
+		for(const Coupling& coupling : m_couplings)
+		{
+			if(coupling.site1 >= numSites || coupling.site2 >= numSites)
+			{
+				std::cerr << "Error: invalid site index in coupling." << std::endl;
+				return false;
+			}
+		}
+
+		// matrices J (index 2*c) and J^T (2*c + 1) of all couplings
+		m_mats.resize(m_couplings.size()*2*9);
+		for(std::size_t iCoupling=0; iCoupling<m_couplings.size(); ++iCoupling)
+		{
+			const t_real* J = m_couplings[iCoupling].J;
+			t_real* mat = m_mats.data() + iCoupling*2*9;
+			for(std::size_t i=0; i<3; ++i)
+			{
+				for(std::size_t j=0; j<3; ++j)
+				{
+					mat[i*3 + j] = J[i*3 + j];
+					mat[9 + i*3 + j] = J[j*3 + i];
+				}
+			}
+		}
+
+		// bonds per site in the unit cell
+		std::vector<std::vector<std::tuple<std::size_t, long, long, long, std::uint32_t>>> siteBonds(numSites);
+		for(std::size_t iCoupling=0; iCoupling<m_couplings.size(); ++iCoupling)
+		{
+			const Coupling& coupling = m_couplings[iCoupling];
+			siteBonds[coupling.site1].emplace_back(coupling.site2,
+				coupling.dist[0], coupling.dist[1], coupling.dist[2], std::uint32_t(iCoupling*2));
+			siteBonds[coupling.site2].emplace_back(coupling.site1,
+				-coupling.dist[0], -coupling.dist[1], -coupling.dist[2], std::uint32_t(iCoupling*2 + 1));
+		}
+
+		// neighbour list
+		m_nbOffs.assign(numSpins + 1, 0);
+		for(std::size_t iSpin=0; iSpin<numSpins; ++iSpin)
+			m_nbOffs[iSpin+1] = m_nbOffs[iSpin] + siteBonds[iSpin % numSites].size();
+		m_nbSpins.resize(m_nbOffs[numSpins]);
+		m_nbMats.resize(m_nbOffs[numSpins]);
+
+		for(std::size_t iCell=0; iCell<numCells; ++iCell)
+		{
+			for(std::size_t iSite=0; iSite<numSites; ++iSite)
+			{
+				const std::size_t iSpin = GetSpinIndex(iCell, iSite);
+				std::size_t iNb = m_nbOffs[iSpin];
+
+				for(const auto& [site2, d0, d1, d2, iMat] : siteBonds[iSite])
+				{
+					const long dist[3] = { d0, d1, d2 };
+					const std::size_t iSpin2 = GetSpinIndex(ShiftCell(iCell, dist), site2);
+					if(iSpin2 == iSpin)
+					{
+						std::cerr << "Error: a bond connects a spin with itself, the supercell is too small." << std::endl;
+						return false;
+					}
+
+					m_nbSpins[iNb] = std::uint32_t(iSpin2);
+					m_nbMats[iNb] = iMat;
+					++iNb;
+				}
+			}
+		}
+
+		// greedy colouring
+		std::vector<std::size_t> colours(numSpins, 0), usedBy;
+		std::size_t numColours = 1;
+		for(std::size_t iSpin=0; iSpin<numSpins; ++iSpin)
+		{
+			usedBy.resize(m_nbOffs[iSpin+1] - m_nbOffs[iSpin] + 1, numSpins);
+			for(std::size_t iNb=m_nbOffs[iSpin]; iNb<m_nbOffs[iSpin+1]; ++iNb)
+			{
+				const std::size_t iSpin2 = m_nbSpins[iNb];
+				if(iSpin2 < iSpin && colours[iSpin2] < usedBy.size())
+					usedBy[colours[iSpin2]] = iSpin;
+			}
+
+			std::size_t iColour = 0;
+			while(usedBy[iColour] == iSpin)
+				++iColour;
+			colours[iSpin] = iColour;
+			numColours = std::max(numColours, iColour + 1);
+		}
+
+		m_colOffs.assign(numColours + 1, 0);
+		for(std::size_t iSpin=0; iSpin<numSpins; ++iSpin)
+			++m_colOffs[colours[iSpin] + 1];
+		for(std::size_t iColour=0; iColour<numColours; ++iColour)
+			m_colOffs[iColour+1] += m_colOffs[iColour];
+
+		m_colSpins.resize(numSpins);
+		std::vector<std::size_t> fill(m_colOffs.begin(), m_colOffs.end()-1);
+		for(std::size_t iSpin=0; iSpin<numSpins; ++iSpin)
+			m_colSpins[fill[colours[iSpin]]++] = std::uint32_t(iSpin);
+
+		m_chunkOffs.assign(numColours + 1, 0);
+		for(std::size_t iColour=0; iColour<numColours; ++iColour)
+		{
+			const std::size_t num = m_colOffs[iColour+1] - m_colOffs[iColour];
+			m_chunkOffs[iColour+1] = m_chunkOffs[iColour] + (num + m_iChunkSize - 1) / m_iChunkSize;
+		}
+
+		// replicas, one per temperature
+		m_rng.seed(m_iSeed);
+		m_replicas.resize(m_temps.size());
+		m_replicaAtTemp.resize(m_temps.size());
+		for(std::size_t iReplica=0; iReplica<m_replicas.size(); ++iReplica)
+		{
+			Replica& replica = m_replicas[iReplica];
+			replica.iTemp = iReplica;
+			m_replicaAtTemp[iReplica] = iReplica;
+
+			replica.spins.resize(numSpins*3);
+			for(std::size_t iSpin=0; iSpin<numSpins; ++iSpin)
+			{
+				const Site& site = m_sites[iSpin % numSites];
+				for(std::size_t i=0; i<3; ++i)
+					replica.spins[iSpin*3 + i] = site.len * site.dir[i];
+			}
+
+			replica.rngs.clear();
+			replica.rngs.reserve(m_chunkOffs[numColours]);
+			for(std::size_t iChunk=0; iChunk<m_chunkOffs[numColours]; ++iChunk)
+			{
+				std::seed_seq seed{ m_iSeed, unsigned(iReplica), unsigned(iChunk) };
+				replica.rngs.emplace_back(seed);
+			}
+		}
+
+		m_steps.assign(m_temps.size(), m_stepInit);
+		ResetStatistics();
+		return true;
+	}
+
+
+	/**
+	 * random initial directions for all replicas
+	 */
+	void Randomise()
+	{
+		std::normal_distribution<t_real> gauss(0, 1);
+
+		for(Replica& replica : m_replicas)
+		{
+			for(std::size_t iSpin=0; iSpin<GetNumSpins(); ++iSpin)
+			{
+				t_real* s = replica.spins.data() + iSpin*3;
+				t_real len = 0;
+				do
+				{
+					for(std::size_t i=0; i<3; ++i)
+						s[i] = gauss(m_rng);
+					len = std::sqrt(s[0]*s[0] + s[1]*s[1] + s[2]*s[2]);
+				}
+				while(!(len > t_real(1e-6)));
+
+				const t_real scale = GetSpinSite(iSpin).len / len;
+				for(std::size_t i=0; i<3; ++i)
+					s[i] *= scale;
+			}
+		}
+	}
+
+
+	/**
+	 * updates the spins of a chunk of one colour, returns the number of accepted moves
+	 */
+	std::size_t SweepChunk(Replica& replica, std::size_t iColour, std::size_t iChunk) const
+	{
+		const std::size_t iStart = m_colOffs[iColour] + iChunk*m_iChunkSize;
+		const std::size_t iEnd = std::min(iStart + m_iChunkSize, m_colOffs[iColour+1]);
+		const t_real T = m_temps[replica.iTemp];
+		const t_real step = m_steps[replica.iTemp];
+		t_rng& rng = replica.rngs[m_chunkOffs[iColour] + iChunk];
+
+		std::size_t num = 0;
+		for(std::size_t idx=iStart; idx<iEnd; ++idx)
+			num += UpdateSpin(replica.spins.data(), m_colSpins[idx], T, step, rng);
+		return num;
+	}
+
+
+	/**
+	 * monte carlo sweeps of all replicas, the colours are updated one after another.
+	 * with at least as many replicas as threads, every thread sweeps whole replicas,
+	 * otherwise the chunks of each colour are distributed over the threads.
+	 */
+	void Sweep(std::size_t numSweeps = 1)
+	{
+		const std::size_t numReplicas = m_replicas.size();
+		const std::size_t numColours = GetNumColours();
+		std::vector<std::size_t> accepted(numReplicas, 0);
+
+		if(numReplicas >= m::get_num_threads(m_iNumThreads))
+		{
+			m::run_parallel(numReplicas, [&, numSweeps, numColours](std::size_t iReplica)
+			{
+				for(std::size_t iSweep=0; iSweep<numSweeps; ++iSweep)
+					for(std::size_t iColour=0; iColour<numColours; ++iColour)
+						for(std::size_t iChunk=0; iChunk<m_chunkOffs[iColour+1]-m_chunkOffs[iColour]; ++iChunk)
+							accepted[iReplica] += SweepChunk(m_replicas[iReplica], iColour, iChunk);
+			}, m_iNumThreads);
+		}
+		else
+		{
+			std::vector<std::size_t> acceptedChunks(numReplicas * m_chunkOffs.back(), 0);
+
+			for(std::size_t iSweep=0; iSweep<numSweeps; ++iSweep)
+			{
+				for(std::size_t iColour=0; iColour<numColours; ++iColour)
+				{
+					const std::size_t numChunks = m_chunkOffs[iColour+1] - m_chunkOffs[iColour];
+
+					m::run_parallel(numReplicas * numChunks, [&, iColour, numChunks](std::size_t iTask)
+					{
+						const std::size_t iReplica = iTask / numChunks;
+						const std::size_t iChunk = iTask % numChunks;
+						acceptedChunks[iReplica*m_chunkOffs.back() + m_chunkOffs[iColour] + iChunk]
+							+= SweepChunk(m_replicas[iReplica], iColour, iChunk);
+					}, m_iNumThreads);
+				}
+			}
+
+			for(std::size_t iReplica=0; iReplica<numReplicas; ++iReplica)
+				for(std::size_t iChunk=0; iChunk<m_chunkOffs.back(); ++iChunk)
+					accepted[iReplica] += acceptedChunks[iReplica*m_chunkOffs.back() + iChunk];
+		}
+
+		for(std::size_t iReplica=0; iReplica<numReplicas; ++iReplica)
+		{
+			const std::size_t iTemp = m_replicas[iReplica].iTemp;
+			m_tried[iTemp] += numSweeps * GetNumSpins();
+			m_accepted[iTemp] += accepted[iReplica];
+		}
+	}
+
+
+	/**
+	 * parallel tempering: tries to exchange the replicas at neighbouring temperatures,
+	 * alternating between even and odd pairs, returns the number of accepted exchanges
+	 */
+	std::size_t Exchange()
+	{
+		if(m_temps.size() < 2)
+			return 0;
+
+		std::vector<t_real> Es;
+		std::vector<std::array<t_real, 3>> Ms;
+		CalcReplicaObservables(Es, Ms);
+
+		std::uniform_real_distribution<t_real> uni(0, 1);
+		std::size_t numAccepted = 0;
+
+		for(std::size_t iTemp=(m_iNumExchanges % 2); iTemp+1<m_temps.size(); iTemp+=2)
+		{
+			const std::size_t iRep1 = m_replicaAtTemp[iTemp];
+			const std::size_t iRep2 = m_replicaAtTemp[iTemp+1];
+
+			// beta of a zero temperature is treated as very large
+			auto get_beta = [](t_real T) -> t_real
+			{
+				return T > t_real(0) ? t_real(1)/T : std::numeric_limits<t_real>::max();
+			};
+			const t_real arg = (get_beta(m_temps[iTemp]) - get_beta(m_temps[iTemp+1])) * (Es[iRep1] - Es[iRep2]);
+
+			++m_swapsTried[iTemp];
+			if(arg >= t_real(0) || uni(m_rng) < std::exp(arg))
+			{
+				std::swap(m_replicaAtTemp[iTemp], m_replicaAtTemp[iTemp+1]);
+				m_replicas[iRep1].iTemp = iTemp+1;
+				m_replicas[iRep2].iTemp = iTemp;
+				++m_swapsAccepted[iTemp];
+				++numAccepted;
+			}
+		}
+
+		++m_iNumExchanges;
+		return numAccepted;
+	}
+
+
+	/**
+	 * adapts the metropolis step sizes towards an acceptance rate of 50%
+	 * using the statistics since the last reset
+	 */
+	void AdaptStepSizes()
+	{
+		for(std::size_t iTemp=0; iTemp<m_temps.size(); ++iTemp)
+		{
+			if(m_tried[iTemp] == 0)
+				continue;
+			const t_real acc = t_real(m_accepted[iTemp]) / t_real(m_tried[iTemp]);
+			m_steps[iTemp] = std::clamp<t_real>(m_steps[iTemp] * t_real(2)*std::max<t_real>(acc, t_real(0.05)),
+				t_real(1e-3), t_real(2));
+		}
+	}
+
+
+	/**
+	 * accumulates the energies and magnetisations of all temperatures
+	 */
+	void Measure()
+	{
+		std::vector<t_real> Es;
+		std::vector<std::array<t_real, 3>> Ms;
+		CalcReplicaObservables(Es, Ms);
+
+		for(std::size_t iTemp=0; iTemp<m_temps.size(); ++iTemp)
+		{
+			const std::size_t iReplica = m_replicaAtTemp[iTemp];
+			const t_real M2 = Ms[iReplica][0]*Ms[iReplica][0] + Ms[iReplica][1]*Ms[iReplica][1] + Ms[iReplica][2]*Ms[iReplica][2];
+
+			m_sums[iTemp][0] += Es[iReplica];
+			m_sums[iTemp][1] += Es[iReplica]*Es[iReplica];
+			m_sums[iTemp][2] += std::sqrt(M2);
+			m_sums[iTemp][3] += M2;
+		}
+
+		++m_numMeasurements;
+	}
+
+
+	void ResetStatistics()
+	{
+		m_tried.assign(m_temps.size(), 0);
+		m_accepted.assign(m_temps.size(), 0);
+		m_swapsTried.assign(m_temps.size(), 0);
+		m_swapsAccepted.assign(m_temps.size(), 0);
+		m_sums.assign(m_temps.size(), std::array<t_real, 4>{{ 0, 0, 0, 0 }});
+		m_numMeasurements = 0;
+	}
+
+
+	/**
+	 * averages per spin at the given temperature
+	 * returns [energy, specific heat, |magnetisation|, susceptibility]
+	 */
+	std::tuple<t_real, t_real, t_real, t_real> GetObservables(std::size_t iTemp) const
+	{
+		if(m_numMeasurements == 0)
+			return std::make_tuple(0, 0, 0, 0);
+
+		const t_real N = t_real(GetNumSpins());
+		const t_real num = t_real(m_numMeasurements);
+		const t_real T = m_temps[iTemp];
+		const auto& sums = m_sums[iTemp];
+
+		const t_real E = sums[0] / num, E2 = sums[1] / num;
+		const t_real M = sums[2] / num, M2 = sums[3] / num;
+
+		t_real C = 0, chi = 0;
+		if(T > t_real(0))
+		{
+			C = std::max<t_real>(E2 - E*E, 0) / (T*T) / N;
+			chi = std::max<t_real>(M2 - M*M, 0) / T / N;
+		}
+
+		return std::make_tuple(E/N, C, M/N, chi);
+	}
+
+	t_real GetAcceptance(std::size_t iTemp) const
+	{
+		return m_tried[iTemp] ? t_real(m_accepted[iTemp]) / t_real(m_tried[iTemp]) : t_real(0);
+	}
+
+	/**
+	 * acceptance rate of the exchanges between the temperatures iTemp and iTemp+1
+	 */
+	t_real GetSwapAcceptance(std::size_t iTemp) const
+	{
+		return m_swapsTried[iTemp] ? t_real(m_swapsAccepted[iTemp]) / t_real(m_swapsTried[iTemp]) : t_real(0);
+	}
+
+	t_real GetStepSize(std::size_t iTemp) const { return m_steps[iTemp]; }
+
+	/**
+	 * total energy of the configuration at the given temperature
+	 */
+	t_real GetEnergy(std::size_t iTemp) const
+	{
+		return CalcEnergy(m_replicas[m_replicaAtTemp[iTemp]].spins.data(), 0, GetNumSpins());
+	}
+
+	/**
+	 * spin of a site in a cell of the configuration at the given temperature
+	 */
+	const t_real* GetSpin(std::size_t iTemp, std::size_t iCell, std::size_t iSite) const
+	{
+		return m_replicas[m_replicaAtTemp[iTemp]].spins.data() + GetSpinIndex(iCell, iSite)*3;
+	}
+
+	t_real* GetSpin(std::size_t iTemp, std::size_t iCell, std::size_t iSite)
+	{
+		return m_replicas[m_replicaAtTemp[iTemp]].spins.data() + GetSpinIndex(iCell, iSite)*3;
+	}
+
+	/**
+	 * size of the neighbour list, colouring and replica states in bytes
+	 */
+	std::size_t GetMemoryUsage() const
+	{
+		std::size_t mem = m_nbOffs.size()*sizeof(std::size_t)
+			+ (m_nbSpins.size() + m_nbMats.size() + m_colSpins.size())*sizeof(std::uint32_t)
+			+ m_mats.size()*sizeof(t_real);
+
+		for(const Replica& replica : m_replicas)
+			mem += replica.spins.size()*sizeof(t_real) + replica.rngs.size()*sizeof(t_rng);
+
+		return mem;
+	}
+};
+// ----------------------------------------------------------------------------
+
+
+#endif
@@ -0,0 +1,286 @@
+/**
+ * powder diffraction profiles
+ * @author Tobias Weber
+ * @date Nov-2018
+ * @license see 'LICENSE.EUPL' file
+ *
+ * References:
+ *  - G. Caglioti, A. Paoletti, F. P. Ricci, Nucl. Instrum. 3, 223 (1958),
+ *    https://doi.org/10.1016/0369-643X(58)90029-X
+ *  - P. Thompson, D. E. Cox, J. B. Hastings, J. Appl. Cryst. 20, 79 (1987),
+ *    https://doi.org/10.1107/S0021889887087090
+ */
+
+#ifndef __MAG_POWDER_H__
+#define __MAG_POWDER_H__
+
+#include <vector>
+#include <tuple>
+#include <algorithm>
+#include <cmath>
+
+#include "parallel.h"
+
+
+// ----------------------------------------------------------------------------
+/**
+ * a powder peak on the profile axis
+ */
+template<class t_real = double>
+struct PowderPeak
+{
+	// peak position (2theta in deg or |Q| in 1/A)
+	t_real pos = 0;
+
+	// integrated intensity, including multiplicity and lorentz-polarisation factor
+	t_real area = 0;
+
+	// full width at half maximum (axis units)
+	t_real fwhm = 0;
+
+	// support window [lo, hi] of the truncated peak
+	t_real lo = 0, hi = 0;
+};
+
+
+/**
+ * powder pattern with pseudo-voigt peak shapes on a 2theta or |Q| grid
+ *
+ * each peak is only evaluated within its support window of +-cutoff*fwhm. the peaks
+ * are sorted by the start of their windows, so that the peaks overlapping a chunk of
+ * grid points are found with a binary search on the running maximum of the window ends.
+ * the chunks are evaluated in parallel.
+ */
+template<class t_real = double>
+class PowderProfile
+{
+private:
+	// wavelength (A) for a 2theta axis, 0: |Q| axis
+	t_real m_lambda = 0;
+	bool m_bXRay = false;
+
+	// caglioti widths: fwhm^2 = U*t^2 + V*t + W, t = tan(theta) or |Q|
+	t_real m_U = 0, m_V = 0, m_W = 0.01;
+
+	// lorentzian fraction of the pseudo-voigt
+	t_real m_eta = 0;
+
+	// half width of the support window in units of the fwhm
+	t_real m_cutoff = 10;
+
+	unsigned int m_iNumThreads = 0;
+
+	// grid points per parallel chunk
+	std::size_t m_iChunkSize = 1 << 14;
+
+	// peaks, sorted by window start on demand
+	mutable std::vector<PowderPeak<t_real>> m_peaks;
+
+	// running maximum of the window ends
+	mutable std::vector<t_real> m_maxHi;
+	mutable bool m_bSorted = true;
+
+protected:
+	static constexpr t_real s_pi = t_real(3.14159265358979323846);
+
+	// exp(-4 ln(2) x^2) < 1e-15 for |x| > 3.5
+	static constexpr t_real s_cutoffG = t_real(3.5);
+
+	void Sort() const
+	{
+		if(m_bSorted)
+			return;
+
+		std::stable_sort(m_peaks.begin(), m_peaks.end(),
+			[](const PowderPeak<t_real>& peak1, const PowderPeak<t_real>& peak2) -> bool
+			{
+				return peak1.lo < peak2.lo;
+			});
+
+		m_maxHi.resize(m_peaks.size());
+		for(std::size_t i=0; i<m_peaks.size(); ++i)
+			m_maxHi[i] = i ? std::max(m_maxHi[i-1], m_peaks[i].hi) : m_peaks[i].hi;
+
+		m_bSorted = true;
+	}
+
+	/**
+	 * adds a peak to the grid points in [xs, xs+N)
+	 */
+	void AddPeak(const PowderPeak<t_real>& peak, const t_real* xs, t_real* ys, std::size_t N) const
+	{
+		const t_real pos = peak.pos;
+		const t_real* xBegin = std::lower_bound(xs, xs+N, peak.lo);
+		const t_real* xEnd = std::upper_bound(xBegin, xs+N, peak.hi);
+		const std::size_t i0 = xBegin - xs, i1 = xEnd - xs;
+
+		// gaussian, its tails are below the double precision beyond s_cutoffG
+		if(m_eta != t_real(1))
+		{
+			const t_real cutoffG = std::min(m_cutoff, s_cutoffG) * peak.fwhm;
+			const std::size_t iG0 = std::lower_bound(xBegin, xEnd, pos - cutoffG) - xs;
+			const std::size_t iG1 = std::upper_bound(xs + iG0, xEnd, pos + cutoffG) - xs;
+
+			const t_real ln2 = std::log(t_real(2));
+			const t_real kG = -4*ln2 / (peak.fwhm*peak.fwhm);
+			const t_real aG = (1-m_eta) * peak.area * std::sqrt(4*ln2/s_pi) / peak.fwhm;
+
+			for(std::size_t i=iG0; i<iG1; ++i)
+			{
+				const t_real d = xs[i] - pos;
+				ys[i] += aG * std::exp(kG*d*d);
+			}
+		}
+
+		// lorentzian
+		if(m_eta != t_real(0))
+		{
+			const t_real kL = 4 / (peak.fwhm*peak.fwhm);
+			const t_real aL = m_eta * peak.area * 2 / (s_pi * peak.fwhm);
+
+			for(std::size_t i=i0; i<i1; ++i)
+			{
+				const t_real d = xs[i] - pos;
+				ys[i] += aL / (1 + kL*d*d);
+			}
+		}
+	}
+
+public:
+	PowderProfile() = default;
+	~PowderProfile() = default;
+
+	/**
+	 * wavelength in A for a 2theta axis in deg, 0 for a |Q| axis in 1/A
+	 */
+	void SetWavelength(t_real lambda) { m_lambda = lambda; }
+	void SetXRay(bool bXRay) { m_bXRay = bXRay; }
+	void SetWidths(t_real U, t_real V, t_real W) { m_U = U; m_V = V; m_W = W; }
+	void SetEta(t_real eta) { m_eta = eta; }
+	void SetCutoff(t_real cutoff) { m_cutoff = cutoff; }
+	void SetNumThreads(unsigned int iNumThreads) { m_iNumThreads = iNumThreads; }
+	void SetChunkSize(std::size_t iChunkSize) { m_iChunkSize = std::max<std::size_t>(iChunkSize, 1); }
+
+	bool Is2Theta() const { return m_lambda > t_real(0); }
+
+	void Clear()
+	{
+		m_peaks.clear();
+		m_maxHi.clear();
+		m_bSorted = true;
+	}
+
+	const std::vector<PowderPeak<t_real>>& GetPeaks() const { Sort(); return m_peaks; }
+
+	/**
+	 * lorentz-polarisation factor
+	 * 2theta axis: (1 + cos^2(2theta))/2 / (sin^2(theta) cos(theta)), polarisation only for x-rays
+	 * |Q| axis: 1/Q^2
+	 */
+	t_real GetLorentzPolarisation(t_real Q) const
+	{
+		if(!Is2Theta())
+			return t_real(1) / (Q*Q);
+
+		const t_real sth = Q*m_lambda / (4*s_pi);
+		const t_real cth = std::sqrt(1 - sth*sth);
+		const t_real c2th = 1 - 2*sth*sth;
+
+		t_real LP = t_real(1) / (sth*sth*cth);
+		if(m_bXRay)
+			LP *= (1 + c2th*c2th) / 2;
+		return LP;
+	}
+
+	/**
+	 * adds a powder line at |Q| with the structure factor |F|^2 and the multiplicity mult,
+	 * returns false if the line is not accessible
+	 */
+	bool AddLine(t_real Q, t_real F2, t_real mult = 1)
+	{
+		if(Q <= t_real(0))
+			return false;
+
+		PowderPeak<t_real> peak;
+		t_real t = Q;
+
+		if(Is2Theta())
+		{
+			const t_real sth = Q*m_lambda / (4*s_pi);
+			if(sth >= t_real(1))
+				return false;
+
+			const t_real th = std::asin(sth);
+			peak.pos = 2*th / s_pi * 180;
+			t = std::tan(th);
+		}
+		else
+		{
+			peak.pos = Q;
+		}
+
+		const t_real fwhm2 = m_U*t*t + m_V*t + m_W;
+		if(fwhm2 <= t_real(0))
+			return false;
+
+		peak.fwhm = std::sqrt(fwhm2);
+		peak.area = mult * F2 * GetLorentzPolarisation(Q);
+		peak.lo = peak.pos - m_cutoff*peak.fwhm;
+		peak.hi = peak.pos + m_cutoff*peak.fwhm;
+
+		m_peaks.emplace_back(std::move(peak));
+		m_bSorted = false;
+		return true;
+	}
+
+	/**
+	 * evaluates the profile at the ascending grid points xs
+	 */
+	void Calc(const t_real* xs, t_real* ys, std::size_t N) const
+	{
+		Sort();
+		std::fill(ys, ys+N, t_real(0));
+
+		const std::size_t iNumChunks = (N + m_iChunkSize - 1) / m_iChunkSize;
+		m::run_parallel(iNumChunks, [this, xs, ys, N](std::size_t iChunk)
+		{
+			const std::size_t iBegin = iChunk*m_iChunkSize;
+			const std::size_t iLen = std::min(m_iChunkSize, N - iBegin);
+			const t_real xMin = xs[iBegin], xMax = xs[iBegin + iLen - 1];
+
+			// first peak whose window can reach the chunk
+			std::size_t iPeak = std::lower_bound(m_maxHi.begin(), m_maxHi.end(), xMin) - m_maxHi.begin();
+
+			for(; iPeak<m_peaks.size() && m_peaks[iPeak].lo <= xMax; ++iPeak)
+			{
+				if(m_peaks[iPeak].hi < xMin)
+					continue;
+				AddPeak(m_peaks[iPeak], xs + iBegin, ys + iBegin, iLen);
+			}
+		}, m_iNumThreads);
+	}
+
+	/**
+	 * evaluates the profile on the grid xMin, xMin+step, ..., xMax
+	 * returns [xs, ys]
+	 */
+	std::tuple<std::vector<t_real>, std::vector<t_real>> Calc(t_real xMin, t_real xMax, t_real step) const
+	{
+		std::vector<t_real> xs, ys;
+		if(step <= t_real(0) || xMax < xMin)
+			return std::make_tuple(xs, ys);
+
+		const std::size_t N = std::size_t(std::floor((xMax - xMin) / step + t_real(1e-6))) + 1;
+		xs.resize(N);
+		ys.resize(N);
+		for(std::size_t i=0; i<N; ++i)
+			xs[i] = xMin + t_real(i)*step;
+
+		Calc(xs.data(), ys.data(), N);
+		return std::make_tuple(xs, ys);
+	}
+};
+// ----------------------------------------------------------------------------
+
+
+#endif
@@ -0,0 +1,698 @@
+/**
+ * least-squares refinement of magnetic moments against measured intensities
+ * @author Tobias Weber
+ * @date Nov-2018
+ * @license see 'LICENSE.EUPL' file
+ *
+ * References:
+ *  - D. W. Marquardt, J. Soc. Indust. Appl. Math. 11, 431 (1963),
+ *    https://doi.org/10.1137/0111030
+ */
+
+#ifndef __MAG_REFINE_H__
+#define __MAG_REFINE_H__
+
+#include <vector>
+#include <string>
+#include <tuple>
+#include <memory>
+#include <complex>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "math_algos.h"
+#include "magsg.h"
+#include "magwyc.h"
+#include "parallel.h"
+
+
+// ----------------------------------------------------------------------------
+/**
+ * refines the moment components of magnetic atoms and a scale factor against
+ * observed intensities I_obs(Q) = scale * |F_M,perp(Q)|^2 using levenberg-marquardt
+ *
+ * the moments are given along the normalised crystal axes. if a space group is set, each atom
+ * is expanded into its orbit and its moment is restricted to the free directions of the magnetic
+ * rotation (WycPositions::m_rotMag) of its wyckoff site. F_M is linear in the free moment
+ * parameters p: F_M,perp(Q) = D(Q) p, the design matrices D(Q) are calculated once in parallel
+ * over the reflections. each iteration then calculates F_M,perp, the intensities and their
+ * analytic derivatives in one pass over the reflections, also in parallel.
+ */
+template<class t_mat, class t_vec>
+requires m::is_mat<t_mat> && m::is_vec<t_vec>
+class MagRefine
+{
+public:
+	using t_real = typename t_vec::value_type;
+	using t_cplx = std::complex<t_real>;
+
+private:
+	/**
+	 * an independent magnetic atom
+	 */
+	struct t_atom
+	{
+		t_vec pos, mom;
+		std::string site;
+
+		// free moment directions (3 x numParams), moment = basis * params
+		t_mat basis;
+		std::size_t iParam = 0, numParams = 0;
+		std::size_t numOrbit = 0;
+	};
+
+	struct t_refl
+	{
+		t_real hkl[3];
+		t_real Iobs = 0, sigma = 1;
+		t_real Icalc = 0;
+	};
+
+	std::vector<t_atom> m_atoms;
+
+	// atoms of all orbits: positions (3 each) and moment maps (3 x 3 each, row-major),
+	// the moment of an orbit atom is its map times the parameters of its independent atom
+	std::vector<t_real> m_orbitPos, m_orbitMap;
+	std::vector<std::size_t> m_orbitAtom;
+
+	std::vector<t_refl> m_refls;
+
+	// design matrices, 3 x numParams for each reflection, row-major
+	std::vector<t_cplx> m_design;
+	bool m_bDesignValid = false;
+
+	// B matrix and the normalised real-space basis
+	t_mat m_B = m::unit<t_mat>(3);
+	t_mat m_Anorm = m::unit<t_mat>(3);
+
+	std::unique_ptr<WycLookup<t_mat, t_vec>> m_wyc;
+	const Spacegroup<t_mat, t_vec>* m_sg = nullptr;
+	bool m_bBNS = true;
+
+	// parameters: scale followed by the moment parameters
+	std::vector<t_real> m_params{ t_real(1) };
+	std::vector<t_real> m_errors{ t_real(0) };
+	std::vector<bool> m_fixed{ false };
+	bool m_bErrorsValid = false;
+
+	unsigned int m_iNumThreads = 0;
+	unsigned int m_iMaxIter = 100;
+	t_real m_tol = 1e-8;
+
+protected:
+	static constexpr t_real s_pi = t_real(3.14159265358979323846);
+
+	std::size_t GetNumMomentParams() const { return m_params.size() - 1; }
+
+	/**
+	 * calculates the design matrices of all reflections
+	 */
+	void CalcDesign()
+	{
+		const std::size_t numParams = GetNumMomentParams();
+		const std::size_t numOrbit = m_orbitAtom.size();
+		m_design.resize(m_refls.size() * 3 * numParams);
+
+		m::run_parallel(m_refls.size(), [this, numParams, numOrbit](std::size_t iRefl)
+		{
+			const t_refl& refl = m_refls[iRefl];
+			t_cplx* D = m_design.data() + iRefl*3*numParams;
+			std::fill(D, D + 3*numParams, t_cplx(0));
+
+			// structure factor in the crystal basis: sum_j exp(-2pi i Q*R_j) * map_j
+			for(std::size_t iOrbit=0; iOrbit<numOrbit; ++iOrbit)
+			{
+				const t_real* R = m_orbitPos.data() + iOrbit*3;
+				const t_real* G = m_orbitMap.data() + iOrbit*9;
+				const t_atom& atom = m_atoms[m_orbitAtom[iOrbit]];
+
+				const t_real phase = -2*s_pi * (refl.hkl[0]*R[0] + refl.hkl[1]*R[1] + refl.hkl[2]*R[2]);
+				const t_cplx ph(std::cos(phase), std::sin(phase));
+
+				for(std::size_t i=0; i<3; ++i)
+					for(std::size_t j=0; j<atom.numParams; ++j)
+						D[i*numParams + atom.iParam + j] += ph * G[i*3 + j];
+			}
+
+			// cartesian components perpendicular to Q
+			t_real Q[3];
+			t_real Q2 = 0;
+			for(std::size_t i=0; i<3; ++i)
+			{
+				Q[i] = m_B(i,0)*refl.hkl[0] + m_B(i,1)*refl.hkl[1] + m_B(i,2)*refl.hkl[2];
+				Q2 += Q[i]*Q[i];
+			}
+
+			// (1 - Q Q^T / Q^2) * A_norm
+			t_real PA[3][3];
+			for(std::size_t i=0; i<3; ++i)
+			{
+				for(std::size_t k=0; k<3; ++k)
+				{
+					PA[i][k] = m_Anorm(i,k);
+					for(std::size_t l=0; Q2 > t_real(0) && l<3; ++l)
+						PA[i][k] -= Q[i]*Q[l] / Q2 * m_Anorm(l,k);
+				}
+			}
+
+			for(std::size_t iParam=0; iParam<numParams; ++iParam)
+			{
+				t_cplx col[3] = { 0, 0, 0 };
+				for(std::size_t i=0; i<3; ++i)
+					for(std::size_t k=0; k<3; ++k)
+						col[i] += PA[i][k] * D[k*numParams + iParam];
+
+				for(std::size_t i=0; i<3; ++i)
+					D[i*numParams + iParam] = col[i];
+			}
+		}, m_iNumThreads);
+
+		m_bDesignValid = true;
+	}
+
+	/**
+	 * calculates chi^2 and optionally the normal equations J^T W J and J^T W (I_obs - I_calc)
+	 */
+	t_real Evaluate(const std::vector<t_real>& params, bool bStoreCalc,
+		std::vector<t_real>* JtJ = nullptr, std::vector<t_real>* Jtr = nullptr)
+	{
+		const std::size_t N = params.size();
+		const std::size_t numParams = N - 1;
+		const std::size_t numChunks = std::min<std::size_t>(m_refls.size(), 256);
+
+		// partial sums of each chunk, reduced in order to be independent of the threads
+		std::vector<t_real> chi2s(numChunks, t_real(0));
+		std::vector<t_real> JtJs, Jtrs;
+		if(JtJ)
+		{
+			JtJs.resize(numChunks * N*N, t_real(0));
+			Jtrs.resize(numChunks * N, t_real(0));
+		}
+
+		m::run_parallel(numChunks, [&](std::size_t iChunk)
+		{
+			const std::size_t iBegin = iChunk * m_refls.size() / numChunks;
+			const std::size_t iEnd = (iChunk+1) * m_refls.size() / numChunks;
+
+			std::vector<t_real> J(N);
+			t_real* chunkJtJ = JtJ ? JtJs.data() + iChunk*N*N : nullptr;
+			t_real* chunkJtr = JtJ ? Jtrs.data() + iChunk*N : nullptr;
+
+			for(std::size_t iRefl=iBegin; iRefl<iEnd; ++iRefl)
+			{
+				t_refl& refl = m_refls[iRefl];
+				const t_cplx* D = m_design.data() + iRefl*3*numParams;
+
+				// F_perp = D * p
+				t_cplx F[3] = { 0, 0, 0 };
+				for(std::size_t i=0; i<3; ++i)
+					for(std::size_t j=0; j<numParams; ++j)
+						F[i] += D[i*numParams + j] * params[1+j];
+
+				const t_real F2 = std::norm(F[0]) + std::norm(F[1]) + std::norm(F[2]);
+				const t_real Icalc = params[0] * F2;
+				const t_real w = t_real(1) / (refl.sigma*refl.sigma);
+				const t_real res = refl.Iobs - Icalc;
+
+				chi2s[iChunk] += w * res*res;
+				if(bStoreCalc)
+					refl.Icalc = Icalc;
+				if(!JtJ)
+					continue;
+
+				// dI/dscale = |F_perp|^2, dI/dp_j = 2 * scale * Re(F_perp^* D_j)
+				J[0] = F2;
+				for(std::size_t j=0; j<numParams; ++j)
+				{
+					t_real dF2 = 0;
+					for(std::size_t i=0; i<3; ++i)
+						dF2 += (std::conj(F[i]) * D[i*numParams + j]).real();
+					J[1+j] = 2 * params[0] * dF2;
+				}
+
+				for(std::size_t i=0; i<N; ++i)
+				{
+					chunkJtr[i] += w * J[i] * res;
+					for(std::size_t j=0; j<=i; ++j)
+						chunkJtJ[i*N + j] += w * J[i] * J[j];
+				}
+			}
+		}, m_iNumThreads);
+
+		t_real chi2 = 0;
+		for(t_real val : chi2s)
+			chi2 += val;
+
+		if(JtJ)
+		{
+			JtJ->assign(N*N, t_real(0));
+			Jtr->assign(N, t_real(0));
+
+			for(std::size_t iChunk=0; iChunk<numChunks; ++iChunk)
+			{
+				for(std::size_t i=0; i<N; ++i)
+				{
+					(*Jtr)[i] += Jtrs[iChunk*N + i];
+					for(std::size_t j=0; j<=i; ++j)
+						(*JtJ)[i*N + j] += JtJs[iChunk*N*N + i*N + j];
+				}
+			}
+
+			for(std::size_t i=0; i<N; ++i)
+				for(std::size_t j=0; j<i; ++j)
+					(*JtJ)[j*N + i] = (*JtJ)[i*N + j];
+		}
+
+		return chi2;
+	}
+
+	/**
+	 * matrix of the free parameters from the normal equations, fixed parameters are removed
+	 */
+	t_mat GetFreeMatrix(const std::vector<t_real>& JtJ, const std::vector<std::size_t>& freeIdx,
+		t_real lambda) const
+	{
+		const std::size_t N = m_params.size();
+		const std::size_t numFree = freeIdx.size();
+
+		t_mat mat = m::zero<t_mat>(numFree, numFree);
+		for(std::size_t i=0; i<numFree; ++i)
+		{
+			for(std::size_t j=0; j<numFree; ++j)
+				mat(i,j) = JtJ[freeIdx[i]*N + freeIdx[j]];
+
+			// marquardt's scaling of the diagonal
+			t_real diag = mat(i,i);
+			if(diag <= t_real(0))
+				diag = t_real(1);
+			mat(i,i) += lambda * diag;
+		}
+
+		return mat;
+	}
+
+	/**
+	 * solves L L^T x = b
+	 */
+	static std::vector<t_real> SolveChol(const t_mat& L, const std::vector<t_real>& b)
+	{
+		const std::size_t N = b.size();
+		std::vector<t_real> x = b;
+
+		for(std::size_t i=0; i<N; ++i)
+		{
+			for(std::size_t k=0; k<i; ++k)
+				x[i] -= L(i,k) * x[k];
+			x[i] /= L(i,i);
+		}
+
+		for(std::size_t _i=0; _i<N; ++_i)
+		{
+			const std::size_t i = N-1 - _i;
+			for(std::size_t k=i+1; k<N; ++k)
+				x[i] -= L(k,i) * x[k];
+			x[i] /= L(i,i);
+		}
+
+		return x;
+	}
+
+public:
+	MagRefine() = default;
+	~MagRefine() = default;
+
+	void SetNumThreads(unsigned int iNumThreads) { m_iNumThreads = iNumThreads; }
+	void SetMaxIterations(unsigned int iMaxIter) { m_iMaxIter = iMaxIter; }
+	void SetTolerance(t_real tol) { m_tol = tol; }
+
+	/**
+	 * lattice constants (A) and angles (rad)
+	 */
+	void SetLattice(t_real a, t_real b, t_real c, t_real alpha, t_real beta, t_real gamma)
+	{
+		m_B = m::B_matrix<t_mat>(a, b, c, alpha, beta, gamma);
+
+		// A = 2pi * B^(-T), columns normalised
+		auto [Binv, bOk] = m::inv<t_mat>(m_B);
+		if(bOk)
+		{
+			t_mat A = m::trans<t_mat>(Binv);
+			for(std::size_t j=0; j<3; ++j)
+			{
+				const t_real len = std::sqrt(A(0,j)*A(0,j) + A(1,j)*A(1,j) + A(2,j)*A(2,j));
+				for(std::size_t i=0; i<3; ++i)
+					m_Anorm(i,j) = A(i,j) / len;
+			}
+		}
+
+		m_bDesignValid = false;
+	}
+
+	/**
+	 * space group to expand the atoms and constrain the moments, nullptr: no symmetry
+	 */
+	bool SetSpacegroup(const Spacegroup<t_mat, t_vec>* sg, bool bBNS = true)
+	{
+		m_sg = sg;
+		m_bBNS = bBNS;
+		m_wyc.reset();
+
+		if(sg)
+		{
+			m_wyc = std::make_unique<WycLookup<t_mat, t_vec>>();
+			if(!m_wyc->Create(*sg, bBNS))
+			{
+				m_wyc.reset();
+				m_sg = nullptr;
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	/**
+	 * adds an independent magnetic atom with its starting moment
+	 * returns [wyckoff site, number of free moment parameters, ok],
+	 * ok is false if the moment had to be projected onto the allowed directions
+	 */
+	std::tuple<std::string, std::size_t, bool> AddAtom(const t_vec& pos, const t_vec& mom)
+	{
+		t_atom atom;
+		atom.pos = pos;
+		atom.basis = m::unit<t_mat>(3);
+
+		std::vector<t_vec> orbit{ pos };
+		std::vector<t_mat> maps{ m::unit<t_mat>(3) };
+
+		if(m_wyc)
+		{
+			// allowed moment directions: non-zero columns of the magnetic rotation of the site
+			auto [site, bFound] = m_wyc->Find(pos);
+			const auto* wycs = m_sg->GetWycPositions(m_bBNS);
+			if(bFound && wycs)
+			{
+				const t_mat rotMag = (*wycs)[site.iSite].GetRotationsMag()[site.iEntry];
+				atom.site = std::to_string(site.mult) + site.letter;
+
+				std::vector<std::size_t> cols;
+				for(std::size_t j=0; j<3; ++j)
+					if(std::abs(rotMag(0,j)) + std::abs(rotMag(1,j)) + std::abs(rotMag(2,j)) > t_real(1e-6))
+						cols.push_back(j);
+
+				atom.basis = m::zero<t_mat>(3, cols.size());
+				for(std::size_t i=0; i<3; ++i)
+					for(std::size_t j=0; j<cols.size(); ++j)
+						atom.basis(i,j) = rotMag(i, cols[j]);
+			}
+
+			// orbit and linear moment maps from the images of the unit moments
+			const std::vector<t_vec> poss{ pos, pos, pos };
+			const std::vector<t_vec> units{ m::create<t_vec>({1,0,0}),
+				m::create<t_vec>({0,1,0}), m::create<t_vec>({0,0,1}) };
+			const auto orbits = m_wyc->GetOrbits(poss, &units);
+
+			orbit = std::get<0>(orbits[0]);
+			maps.resize(orbit.size());
+			for(std::size_t iOrbit=0; iOrbit<orbit.size(); ++iOrbit)
+			{
+				maps[iOrbit] = m::zero<t_mat>(3, 3);
+				for(std::size_t j=0; j<3; ++j)
+					for(std::size_t i=0; i<3; ++i)
+						maps[iOrbit](i,j) = std::get<1>(orbits[j])[iOrbit][i];
+			}
+		}
+
+		atom.numParams = atom.basis.size2();
+		atom.iParam = GetNumMomentParams();
+		atom.numOrbit = orbit.size();
+
+		// starting parameters: least-squares solution of basis * params = mom
+		bool bMomOk = true;
+		std::vector<t_real> params(atom.numParams, t_real(0));
+		if(atom.numParams)
+		{
+			t_mat BtB = m::zero<t_mat>(atom.numParams, atom.numParams);
+			std::vector<t_real> Btm(atom.numParams, t_real(0));
+			for(std::size_t i=0; i<atom.numParams; ++i)
+			{
+				for(std::size_t k=0; k<3; ++k)
+					Btm[i] += atom.basis(k,i) * mom[k];
+				for(std::size_t j=0; j<atom.numParams; ++j)
+					for(std::size_t k=0; k<3; ++k)
+						BtB(i,j) += atom.basis(k,i) * atom.basis(k,j);
+			}
+
+			auto [L, bOk] = m::chol<t_mat>(BtB);
+			if(bOk)
+				params = SolveChol(L, Btm);
+		}
+
+		atom.mom = m::zero<t_vec>(3);
+		for(std::size_t i=0; i<3; ++i)
+		{
+			for(std::size_t j=0; j<atom.numParams; ++j)
+				atom.mom[i] += atom.basis(i,j) * params[j];
+			if(std::abs(atom.mom[i] - mom[i]) > t_real(1e-6))
+				bMomOk = false;
+		}
+
+		for(std::size_t iOrbit=0; iOrbit<orbit.size(); ++iOrbit)
+		{
+			for(std::size_t i=0; i<3; ++i)
+				m_orbitPos.push_back(orbit[iOrbit][i]);
+
+			// map * basis, padded to 3 columns
+			for(std::size_t i=0; i<3; ++i)
+			{
+				for(std::size_t j=0; j<3; ++j)
+				{
+					t_real elem = 0;
+					if(j < atom.numParams)
+					{
+						for(std::size_t k=0; k<3; ++k)
+							elem += maps[iOrbit](i,k) * atom.basis(k,j);
+					}
+					m_orbitMap.push_back(elem);
+				}
+			}
+
+			m_orbitAtom.push_back(m_atoms.size());
+		}
+
+		m_params.insert(m_params.end(), params.begin(), params.end());
+		m_errors.resize(m_params.size(), t_real(0));
+		m_fixed.resize(m_params.size(), false);
+
+		std::tuple<std::string, std::size_t, bool> ret{atom.site, atom.numParams, bMomOk};
+		m_atoms.emplace_back(std::move(atom));
+		m_bDesignValid = false;
+
+		return ret;
+	}
+
+	/**
+	 * adds an observed reflection at Q = hkl (rlu)
+	 */
+	void AddReflection(const t_vec& hkl, t_real Iobs, t_real sigma = 1)
+	{
+		t_refl refl;
+		for(std::size_t i=0; i<3; ++i)
+			refl.hkl[i] = hkl[i];
+		refl.Iobs = Iobs;
+		refl.sigma = sigma > t_real(0) ? sigma : t_real(1);
+
+		m_refls.push_back(refl);
+		m_bDesignValid = false;
+	}
+
+	std::size_t GetNumAtoms() const { return m_atoms.size(); }
+	std::size_t GetNumReflections() const { return m_refls.size(); }
+	std::size_t GetNumParams() const { return m_params.size(); }
+
+	/**
+	 * parameter 0 is the scale factor, then the moment parameters of the atoms follow
+	 */
+	void SetParamFixed(std::size_t iParam, bool bFixed) { m_fixed[iParam] = bFixed; }
+	t_real GetParam(std::size_t iParam) const { return m_params[iParam]; }
+	std::size_t GetAtomParamIndex(std::size_t iAtom) const { return 1 + m_atoms[iAtom].iParam; }
+	std::size_t GetAtomNumParams(std::size_t iAtom) const { return m_atoms[iAtom].numParams; }
+	std::size_t GetAtomOrbitSize(std::size_t iAtom) const { return m_atoms[iAtom].numOrbit; }
+
+	void SetScale(t_real scale) { m_params[0] = scale; }
+	t_real GetScale() const { return m_params[0]; }
+	t_real GetScaleError() const { return m_errors[0]; }
+
+	/**
+	 * false if the covariance matrix of the last refinement was singular
+	 */
+	bool HasErrors() const { return m_bErrorsValid; }
+
+	/**
+	 * moment of an independent atom and its error
+	 * returns [moment, error]
+	 */
+	std::tuple<t_vec, t_vec> GetMoment(std::size_t iAtom) const
+	{
+		const t_atom& atom = m_atoms[iAtom];
+		t_vec mom = m::zero<t_vec>(3), err = m::zero<t_vec>(3);
+
+		for(std::size_t i=0; i<3; ++i)
+		{
+			for(std::size_t j=0; j<atom.numParams; ++j)
+			{
+				mom[i] += atom.basis(i,j) * m_params[1 + atom.iParam + j];
+				err[i] += std::pow(atom.basis(i,j) * m_errors[1 + atom.iParam + j], 2);
+			}
+			err[i] = std::sqrt(err[i]);
+		}
+
+		return std::make_tuple(mom, err);
+	}
+
+	/**
+	 * returns [hkl, I_obs, sigma, I_calc] of a reflection
+	 */
+	std::tuple<t_vec, t_real, t_real, t_real> GetReflection(std::size_t iRefl) const
+	{
+		const t_refl& refl = m_refls[iRefl];
+		return std::make_tuple(m::create<t_vec>({ refl.hkl[0], refl.hkl[1], refl.hkl[2] }),
+			refl.Iobs, refl.sigma, refl.Icalc);
+	}
+
+	/**
+	 * calculates the intensities with the current parameters, returns chi^2
+	 */
+	t_real Calc()
+	{
+		if(!m_bDesignValid)
+			CalcDesign();
+		return Evaluate(m_params, true);
+	}
+
+	/**
+	 * starting scale from a linear least-squares fit with the current moments
+	 */
+	void FitScale()
+	{
+		if(!m_bDesignValid)
+			CalcDesign();
+
+		std::vector<t_real> params = m_params;
+		params[0] = 1;
+		Evaluate(params, true);
+
+		t_real num = 0, denom = 0;
+		for(const t_refl& refl : m_refls)
+		{
+			const t_real w = t_real(1) / (refl.sigma*refl.sigma);
+			num += w * refl.Iobs * refl.Icalc;
+			denom += w * refl.Icalc * refl.Icalc;
+		}
+
+		if(denom > t_real(0))
+			m_params[0] = num / denom;
+	}
+
+	/**
+	 * levenberg-marquardt refinement of the free parameters
+	 * returns [chi^2, reduced chi^2, iterations, converged]
+	 */
+	std::tuple<t_real, t_real, unsigned int, bool> Refine()
+	{
+		if(!m_bDesignValid)
+			CalcDesign();
+
+		const std::size_t N = m_params.size();
+		std::vector<std::size_t> freeIdx;
+		for(std::size_t i=0; i<N; ++i)
+			if(!m_fixed[i])
+				freeIdx.push_back(i);
+
+		std::vector<t_real> JtJ, Jtr;
+		t_real chi2 = Evaluate(m_params, false, &JtJ, &Jtr);
+		t_real lambda = t_real(1e-3);
+		unsigned int iIter = 0;
+		bool bConverged = freeIdx.empty();
+
+		for(; iIter<m_iMaxIter && !bConverged; ++iIter)
+		{
+			std::vector<t_real> b(freeIdx.size());
+			for(std::size_t i=0; i<freeIdx.size(); ++i)
+				b[i] = Jtr[freeIdx[i]];
+
+			// increase the damping until the step decreases chi^2
+			bool bAccepted = false;
+			while(!bAccepted && lambda < t_real(1e12))
+			{
+				auto [L, bOk] = m::chol<t_mat>(GetFreeMatrix(JtJ, freeIdx, lambda));
+				if(!bOk)
+				{
+					lambda *= 10;
+					continue;
+				}
+
+				const std::vector<t_real> delta = SolveChol(L, b);
+				std::vector<t_real> params = m_params;
+				for(std::size_t i=0; i<freeIdx.size(); ++i)
+					params[freeIdx[i]] += delta[i];
+
+				const t_real chi2New = Evaluate(params, false);
+				if(chi2New <= chi2)
+				{
+					bConverged = (chi2 - chi2New) <= m_tol * chi2;
+					m_params = params;
+					chi2 = Evaluate(m_params, false, &JtJ, &Jtr);
+					lambda = std::max(lambda / 10, t_real(1e-12));
+					bAccepted = true;
+				}
+				else
+				{
+					lambda *= 10;
+				}
+			}
+
+			if(!bAccepted)
+			{
+				// no further decrease possible
+				bConverged = true;
+				break;
+			}
+		}
+
+		// errors from the covariance matrix, scaled by the reduced chi^2
+		const std::size_t dof = m_refls.size() > freeIdx.size() ? m_refls.size() - freeIdx.size() : 1;
+		const t_real chi2red = chi2 / t_real(dof);
+
+		std::fill(m_errors.begin(), m_errors.end(), t_real(0));
+		m_bErrorsValid = true;
+		if(freeIdx.size())
+		{
+			auto [L, bOk] = m::chol<t_mat>(GetFreeMatrix(JtJ, freeIdx, 0));
+			if(!bOk)
+			{
+				std::cerr << "Warning: singular covariance matrix, "
+					<< "the parameters are correlated and have no errors." << std::endl;
+				m_bErrorsValid = false;
+			}
+			else
+			{
+				for(std::size_t i=0; i<freeIdx.size(); ++i)
+				{
+					std::vector<t_real> e(freeIdx.size(), t_real(0));
+					e[i] = 1;
+					const std::vector<t_real> col = SolveChol(L, e);
+					m_errors[freeIdx[i]] = std::sqrt(std::abs(col[i]) * chi2red);
+				}
+			}
+		}
+
+		Evaluate(m_params, true);
+		return std::make_tuple(chi2, chi2red, iIter, bConverged);
+	}
+};
+// ----------------------------------------------------------------------------
+
+
+#endif
@@ -0,0 +1,369 @@
+/**
+ * incremental magnetic structure factors for reverse monte carlo
+ * @author Tobias Weber
+ * @date Nov-2018
+ * @license see 'LICENSE.EUPL' file
+ *
+ * References:
+ *  - J. A. M. Paddison and A. L. Goodwin, Phys. Rev. Lett. 108, 017204 (2012),
+ *    https://doi.org/10.1103/PhysRevLett.108.017204
+ */
+
+#ifndef __MAG_RMC_H__
+#define __MAG_RMC_H__
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <cmath>
+
+#include "parallel.h"
+
+
+// ----------------------------------------------------------------------------
+/**
+ * magnetic structure factors F(Q) = sum_j M_j exp(-2pi i Q*R_j) on a fixed set of Q points,
+ * updated in O(N_Q) when a single moment is rotated or an atom is moved
+ *
+ * the sign convention follows m::structure_factor. the structure factors are stored as
+ * structures of arrays, the phase factors of all atoms can be cached (N_atoms * N_Q complex
+ * numbers), otherwise they are recalculated for each move. a move is first written to a trial
+ * buffer, accepting it swaps the buffers, rejecting it leaves the current state untouched.
+ * after a given number of accepted moves the sums are recalculated to bound the drift.
+ */
+template<class t_real = double>
+class MagRmcStructFact
+{
+private:
+	std::size_t m_numQ = 0, m_numAtoms = 0;
+
+	// Q points (rlu) and the unit vectors along Q for the perpendicular projection
+	std::vector<t_real> m_Q, m_Qdir;
+
+	// positions (rlu) and moments, 3 elements per atom
+	std::vector<t_real> m_pos, m_mom;
+
+	// cached phase factors, N_Q elements per atom
+	bool m_bCachePhases = true;
+	std::vector<t_real> m_phRe, m_phIm;
+
+	// current and trial structure factors, real and imaginary parts of the
+	// x, y, z components, N_Q elements each
+	std::vector<t_real> m_F, m_Ftrial;
+
+	// pending move
+	bool m_bPending = false;
+	std::size_t m_iAtomPending = 0;
+	t_real m_posPending[3], m_momPending[3];
+	std::vector<t_real> m_phTrialRe, m_phTrialIm;
+
+	std::size_t m_iResyncInterval = 10000, m_iNumAccepted = 0;
+	unsigned int m_iNumThreads = 0;
+
+protected:
+	static constexpr t_real s_pi = t_real(3.14159265358979323846);
+
+	/**
+	 * phase factors exp(-2pi i Q*R) of a position for the Q points [iBegin, iEnd)
+	 */
+	void CalcPhases(const t_real* pos, t_real* __restrict__ re, t_real* __restrict__ im,
+		std::size_t iBegin, std::size_t iEnd) const
+	{
+		const t_real* Q = m_Q.data();
+		for(std::size_t iQ=iBegin; iQ<iEnd; ++iQ)
+		{
+			const t_real phase = -2*s_pi * (Q[iQ*3 + 0]*pos[0] + Q[iQ*3 + 1]*pos[1] + Q[iQ*3 + 2]*pos[2]);
+			re[iQ] = std::cos(phase);
+			im[iQ] = std::sin(phase);
+		}
+	}
+
+	/**
+	 * F' = F + M1 * exp(-2pi i Q*R1) + M2 * exp(-2pi i Q*R2) in one pass, the second term is optional
+	 */
+	void UpdateF(const t_real* __restrict__ F, t_real* __restrict__ Fnew,
+		const t_real* mom1, const t_real* __restrict__ re1, const t_real* __restrict__ im1,
+		const t_real* mom2 = nullptr, const t_real* __restrict__ re2 = nullptr,
+		const t_real* __restrict__ im2 = nullptr) const
+	{
+		const std::size_t N = m_numQ;
+
+		for(std::size_t i=0; i<6; ++i)
+		{
+			const std::size_t iComp = i/2;
+			const t_real* __restrict__ ph1 = (i % 2 == 0) ? re1 : im1;
+			const t_real* __restrict__ src = F + i*N;
+			t_real* __restrict__ dst = Fnew + i*N;
+			const t_real m1 = mom1[iComp];
+
+			if(mom2)
+			{
+				const t_real* __restrict__ ph2 = (i % 2 == 0) ? re2 : im2;
+				const t_real m2 = mom2[iComp];
+				for(std::size_t iQ=0; iQ<N; ++iQ)
+					dst[iQ] = src[iQ] + m1*ph1[iQ] + m2*ph2[iQ];
+			}
+			else
+			{
+				for(std::size_t iQ=0; iQ<N; ++iQ)
+					dst[iQ] = src[iQ] + m1*ph1[iQ];
+			}
+		}
+	}
+
+	void Reserve()
+	{
+		m_F.assign(6*m_numQ, t_real(0));
+		m_Ftrial.assign(6*m_numQ, t_real(0));
+		m_phTrialRe.resize(m_numQ);
+		m_phTrialIm.resize(m_numQ);
+
+		if(m_bCachePhases)
+		{
+			m_phRe.resize(m_numAtoms*m_numQ);
+			m_phIm.resize(m_numAtoms*m_numQ);
+		}
+		else
+		{
+			m_phRe.clear();
+			m_phIm.clear();
+		}
+	}
+
+public:
+	MagRmcStructFact() = default;
+	~MagRmcStructFact() = default;
+
+	void SetNumThreads(unsigned int iNumThreads) { m_iNumThreads = iNumThreads; }
+
+	/**
+	 * number of accepted moves after which the structure factors are recalculated, 0: never
+	 */
+	void SetResyncInterval(std::size_t iInterval) { m_iResyncInterval = iInterval; }
+
+	/**
+	 * cache the phase factors of all atoms, has to be set before Init()
+	 */
+	void SetCachePhases(bool bCache) { m_bCachePhases = bCache; }
+
+	std::size_t GetNumQ() const { return m_numQ; }
+	std::size_t GetNumAtoms() const { return m_numAtoms; }
+	std::size_t GetNumAccepted() const { return m_iNumAccepted; }
+	bool IsPending() const { return m_bPending; }
+
+	const t_real* GetPosition(std::size_t iAtom) const { return m_pos.data() + iAtom*3; }
+	const t_real* GetMoment(std::size_t iAtom) const { return m_mom.data() + iAtom*3; }
+
+	/**
+	 * sets the Q points (rlu, 3 elements each), their cartesian directions for the projection
+	 * perpendicular to Q (3 elements each, nullptr: no projection), and the atoms
+	 */
+	void Init(std::size_t numQ, const t_real* Q, const t_real* Qcart,
+		std::size_t numAtoms, const t_real* pos, const t_real* mom)
+	{
+		m_numQ = numQ;
+		m_numAtoms = numAtoms;
+		m_Q.assign(Q, Q + 3*numQ);
+		m_pos.assign(pos, pos + 3*numAtoms);
+		m_mom.assign(mom, mom + 3*numAtoms);
+
+		m_Qdir.clear();
+		if(Qcart)
+		{
+			m_Qdir.resize(3*numQ);
+			for(std::size_t iQ=0; iQ<numQ; ++iQ)
+			{
+				const t_real* q = Qcart + iQ*3;
+				const t_real len = std::sqrt(q[0]*q[0] + q[1]*q[1] + q[2]*q[2]);
+				for(std::size_t i=0; i<3; ++i)
+					m_Qdir[iQ*3 + i] = len > t_real(0) ? q[i]/len : t_real(0);
+			}
+		}
+
+		Reserve();
+		Resync();
+	}
+
+	/**
+	 * recalculates all structure factors (and cached phases), parallel over blocks of Q points,
+	 * a pending move is discarded
+	 * returns the maximum deviation of the previous sums
+	 */
+	t_real Resync()
+	{
+		const std::size_t iBlockSize = 256;
+		const std::size_t numBlocks = (m_numQ + iBlockSize - 1) / iBlockSize;
+		const std::size_t N = m_numQ;
+
+		std::vector<t_real> F(6*N, t_real(0));
+
+		m::run_parallel(numBlocks, [this, &F, N, iBlockSize](std::size_t iBlock)
+		{
+			const std::size_t iBegin = iBlock*iBlockSize;
+			const std::size_t iEnd = std::min(iBegin + iBlockSize, N);
+			std::vector<t_real> re, im;
+			if(!m_bCachePhases)
+			{
+				re.resize(N);
+				im.resize(N);
+			}
+
+			for(std::size_t iAtom=0; iAtom<m_numAtoms; ++iAtom)
+			{
+				t_real* phRe = m_bCachePhases ? m_phRe.data() + iAtom*N : re.data();
+				t_real* phIm = m_bCachePhases ? m_phIm.data() + iAtom*N : im.data();
+				CalcPhases(m_pos.data() + iAtom*3, phRe, phIm, iBegin, iEnd);
+
+				const t_real* mom = m_mom.data() + iAtom*3;
+				for(std::size_t i=0; i<3; ++i)
+				{
+					t_real* Fre = F.data() + (2*i)*N;
+					t_real* Fim = F.data() + (2*i + 1)*N;
+					for(std::size_t iQ=iBegin; iQ<iEnd; ++iQ)
+					{
+						Fre[iQ] += mom[i] * phRe[iQ];
+						Fim[iQ] += mom[i] * phIm[iQ];
+					}
+				}
+			}
+		}, m_iNumThreads);
+
+		t_real maxDev = 0;
+		for(std::size_t i=0; i<F.size(); ++i)
+			maxDev = std::max(maxDev, std::abs(F[i] - m_F[i]));
+
+		m_F = std::move(F);
+		m_bPending = false;
+		return maxDev;
+	}
+
+	/**
+	 * proposes a new moment and position for an atom, the trial structure factors are
+	 * calculated in O(N_Q), pos == nullptr keeps the position
+	 */
+	void Propose(std::size_t iAtom, const t_real* mom, const t_real* pos = nullptr)
+	{
+		const std::size_t N = m_numQ;
+		const t_real* oldMom = m_mom.data() + iAtom*3;
+		const t_real* oldPos = m_pos.data() + iAtom*3;
+
+		m_bPending = true;
+		m_iAtomPending = iAtom;
+		for(std::size_t i=0; i<3; ++i)
+		{
+			m_momPending[i] = mom[i];
+			m_posPending[i] = pos ? pos[i] : oldPos[i];
+		}
+
+		// phases at the old position
+		const t_real *phRe = nullptr, *phIm = nullptr;
+		std::vector<t_real> oldRe, oldIm;
+		if(m_bCachePhases)
+		{
+			phRe = m_phRe.data() + iAtom*N;
+			phIm = m_phIm.data() + iAtom*N;
+		}
+		else
+		{
+			oldRe.resize(N);
+			oldIm.resize(N);
+			CalcPhases(oldPos, oldRe.data(), oldIm.data(), 0, N);
+			phRe = oldRe.data();
+			phIm = oldIm.data();
+		}
+
+		if(!pos)
+		{
+			// rotated moment: F' = F + (M' - M) exp(-2pi i Q*R)
+			const t_real dMom[3] = { mom[0] - oldMom[0], mom[1] - oldMom[1], mom[2] - oldMom[2] };
+			UpdateF(m_F.data(), m_Ftrial.data(), dMom, phRe, phIm);
+			std::copy(phRe, phRe + N, m_phTrialRe.begin());
+			std::copy(phIm, phIm + N, m_phTrialIm.begin());
+		}
+		else
+		{
+			// moved atom: F' = F - M exp(-2pi i Q*R) + M' exp(-2pi i Q*R')
+			const t_real negMom[3] = { -oldMom[0], -oldMom[1], -oldMom[2] };
+			CalcPhases(pos, m_phTrialRe.data(), m_phTrialIm.data(), 0, N);
+			UpdateF(m_F.data(), m_Ftrial.data(), negMom, phRe, phIm,
+				mom, m_phTrialRe.data(), m_phTrialIm.data());
+		}
+	}
+
+
+	/**
+	 * accepts the pending move, resyncs if the interval is reached
+	 */
+	void Accept()
+	{
+		if(!m_bPending)
+			return;
+
+		const std::size_t iAtom = m_iAtomPending;
+		for(std::size_t i=0; i<3; ++i)
+		{
+			m_mom[iAtom*3 + i] = m_momPending[i];
+			m_pos[iAtom*3 + i] = m_posPending[i];
+		}
+
+		if(m_bCachePhases)
+		{
+			std::copy(m_phTrialRe.begin(), m_phTrialRe.end(), m_phRe.begin() + iAtom*m_numQ);
+			std::copy(m_phTrialIm.begin(), m_phTrialIm.end(), m_phIm.begin() + iAtom*m_numQ);
+		}
+
+		std::swap(m_F, m_Ftrial);
+		m_bPending = false;
+
+		++m_iNumAccepted;
+		if(m_iResyncInterval && m_iNumAccepted % m_iResyncInterval == 0)
+			Resync();
+	}
+
+	/**
+	 * rejects the pending move, the current state was not modified
+	 */
+	void Reject()
+	{
+		m_bPending = false;
+	}
+
+	/**
+	 * structure factor component (0: x, 1: y, 2: z) at a Q point
+	 * returns [real part, imaginary part]
+	 */
+	std::pair<t_real, t_real> GetF(std::size_t iQ, std::size_t iComp, bool bTrial = false) const
+	{
+		const std::vector<t_real>& F = bTrial ? m_Ftrial : m_F;
+		return std::make_pair(F[(2*iComp)*m_numQ + iQ], F[(2*iComp + 1)*m_numQ + iQ]);
+	}
+
+	/**
+	 * intensities |F_perp(Q)|^2 (or |F(Q)|^2 without Q directions) of the current or trial state
+	 */
+	void GetIntensities(t_real* __restrict__ I, bool bTrial = false) const
+	{
+		const std::size_t N = m_numQ;
+		const t_real* F = bTrial ? m_Ftrial.data() : m_F.data();
+		const t_real *xr = F, *xi = F + N, *yr = F + 2*N, *yi = F + 3*N, *zr = F + 4*N, *zi = F + 5*N;
+
+		for(std::size_t iQ=0; iQ<N; ++iQ)
+			I[iQ] = xr[iQ]*xr[iQ] + xi[iQ]*xi[iQ] + yr[iQ]*yr[iQ] + yi[iQ]*yi[iQ] + zr[iQ]*zr[iQ] + zi[iQ]*zi[iQ];
+
+		if(m_Qdir.size())
+		{
+			// |F_perp|^2 = |F|^2 - |q*F|^2
+			const t_real* q = m_Qdir.data();
+			for(std::size_t iQ=0; iQ<N; ++iQ)
+			{
+				const t_real pr = q[iQ*3 + 0]*xr[iQ] + q[iQ*3 + 1]*yr[iQ] + q[iQ*3 + 2]*zr[iQ];
+				const t_real pi = q[iQ*3 + 0]*xi[iQ] + q[iQ*3 + 1]*yi[iQ] + q[iQ*3 + 2]*zi[iQ];
+				I[iQ] -= pr*pr + pi*pi;
+			}
+		}
+	}
+};
+// ----------------------------------------------------------------------------
+
+
+#endif
@@ -10,7 +10,15 @@
 
 #include <string>
 #include <vector>
+#include <array>
 #include <memory>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <unordered_map>
+#include <numeric>
+#include <sstream>
+#include <cstdint>
 #include <iostream>
 
 #include "math_concepts.h"
@@ -36,6 +44,1129 @@ class Spacegroups;
 
 
 
+// ----------------------------------------------------------------------------
+/**
+ * interned table of the rotational parts of the symmetry operations
+ *
+ * the first entries are the point group operations of the cubic (48) and
+ * hexagonal (24) systems, which are closed under multiplication within each
+ * system, so their products, inverses and determinants are precomputed.
+ * further matrices (e.g. the coefficients of wyckoff positions) are appended on demand.
+ *
+ * the table is shared by all space groups, which only store indices into it.
+ */
+template<class t_mat>
+requires m::is_mat<t_mat>
+class SymOpTable
+{
+public:
+	using t_idx = std::uint16_t;
+	using t_real = typename t_mat::value_type;
+
+	// an operator index can carry the time inversion in its highest bit
+	static constexpr t_idx s_timeInvBit = 0x8000;
+	static constexpr t_idx s_idxMask = 0x7fff;
+	static constexpr t_idx s_invalid = 0x7fff;
+
+	// the storage is never re-allocated, so matrices can be read while others are added
+	static constexpr std::size_t s_maxOps = 4096;
+
+
+private:
+	using t_imat = std::array<int, 9>;
+
+	std::vector<t_mat> m_mats;
+	std::vector<std::int8_t> m_dets;
+	std::vector<t_idx> m_invs;
+	std::atomic<std::size_t> m_numMats{0};
+
+	// products of the point group operations
+	std::size_t m_numPointOps = 0;
+	std::vector<t_idx> m_prods;
+
+	// lookup of matrices with small integer elements
+	std::unordered_map<std::uint64_t, t_idx> m_keys;
+	mutable std::mutex m_mtx;
+
+
+protected:
+	static t_imat mult(const t_imat& a, const t_imat& b)
+	{
+		t_imat c{};
+		for(int i=0; i<3; ++i)
+			for(int j=0; j<3; ++j)
+				for(int k=0; k<3; ++k)
+					c[i*3 + j] += a[i*3 + k] * b[k*3 + j];
+		return c;
+	}
+
+
+	/**
+	 * packs a matrix with integer elements in [-8, 7] into a key
+	 */
+	static bool get_key(const t_mat& mat, std::uint64_t& key)
+	{
+		if(mat.size1() != 3 || mat.size2() != 3)
+			return false;
+
+		key = 0;
+		for(std::size_t i=0; i<3; ++i)
+		{
+			for(std::size_t j=0; j<3; ++j)
+			{
+				const t_real rounded = std::round(mat(i,j));
+				if(std::abs(mat(i,j) - rounded) > t_real(1e-6) || rounded < t_real(-8) || rounded > t_real(7))
+					return false;
+
+				key |= std::uint64_t(int(rounded) + 8) << (4*(i*3 + j));
+			}
+		}
+
+		return true;
+	}
+
+
+	/**
+	 * appends a matrix, mutex has to be locked
+	 */
+	t_idx add_matrix(const t_mat& mat)
+	{
+		const std::size_t idx = m_numMats.load();
+		if(idx >= s_maxOps)
+		{
+			std::cerr << "Symmetry operator table is full." << std::endl;
+			return s_invalid;
+		}
+
+		t_real det = 0;
+		if(mat.size1() == 3 && mat.size2() == 3)
+		{
+			det = mat(0,0)*(mat(1,1)*mat(2,2) - mat(1,2)*mat(2,1))
+				- mat(0,1)*(mat(1,0)*mat(2,2) - mat(1,2)*mat(2,0))
+				+ mat(0,2)*(mat(1,0)*mat(2,1) - mat(1,1)*mat(2,0));
+		}
+
+		m_mats.push_back(mat);
+		m_dets.push_back(std::int8_t(std::round(det)));
+		m_invs.push_back(s_invalid);
+
+		std::uint64_t key = 0;
+		if(get_key(mat, key))
+			m_keys.emplace(key, t_idx(idx));
+
+		m_numMats.store(idx + 1);
+		return t_idx(idx);
+	}
+
+
+	/**
+	 * searches a matrix, mutex has to be locked
+	 */
+	t_idx find_matrix(const t_mat& mat) const
+	{
+		std::uint64_t key = 0;
+		if(get_key(mat, key))
+		{
+			auto iter = m_keys.find(key);
+			return iter == m_keys.end() ? s_invalid : iter->second;
+		}
+
+		// matrices with non-integer elements
+		for(std::size_t idx=0; idx<m_numMats.load(); ++idx)
+		{
+			if(m::equals<t_mat>(m_mats[idx], mat, t_real(1e-6)))
+				return t_idx(idx);
+		}
+
+		return s_invalid;
+	}
+
+
+	SymOpTable()
+	{
+		m_mats.reserve(s_maxOps);
+		m_dets.reserve(s_maxOps);
+		m_invs.reserve(s_maxOps);
+
+		std::vector<t_imat> ops;
+		auto add_op = [&ops](const t_imat& op) -> bool
+		{
+			if(std::find(ops.begin(), ops.end(), op) != ops.end())
+				return false;
+			ops.push_back(op);
+			return true;
+		};
+
+		// cubic system: all signed permutation matrices, starting with the identity
+		const int perms[6][3] = { {0,1,2}, {0,2,1}, {1,0,2}, {1,2,0}, {2,0,1}, {2,1,0} };
+		for(const auto& perm : perms)
+		{
+			for(int signs=0; signs<8; ++signs)
+			{
+				t_imat op{};
+				for(int i=0; i<3; ++i)
+					op[i*3 + perm[i]] = ((signs >> i) & 1) ? -1 : 1;
+				add_op(op);
+			}
+		}
+
+		// hexagonal system: closure of the 6-fold axis, the 2-fold axis along [110] and the inversion
+		std::vector<t_imat> hexops =
+		{
+			t_imat{ 1,0,0,  0,1,0,  0,0,1 },
+			t_imat{ 1,-1,0,  1,0,0,  0,0,1 },
+			t_imat{ 0,1,0,  1,0,0,  0,0,-1 },
+			t_imat{ -1,0,0,  0,-1,0,  0,0,-1 },
+		};
+		for(bool bAdded=true; bAdded;)
+		{
+			bAdded = false;
+			for(std::size_t i=0; i<hexops.size(); ++i)
+			{
+				for(std::size_t j=0; j<hexops.size(); ++j)
+				{
+					t_imat prod = mult(hexops[i], hexops[j]);
+					if(std::find(hexops.begin(), hexops.end(), prod) == hexops.end())
+					{
+						hexops.push_back(prod);
+						bAdded = true;
+					}
+				}
+			}
+		}
+		for(const t_imat& op : hexops)
+			add_op(op);
+
+		// point group operations at the start of the table
+		for(const t_imat& op : ops)
+		{
+			t_mat mat = m::zero<t_mat>(3, 3);
+			for(std::size_t i=0; i<3; ++i)
+				for(std::size_t j=0; j<3; ++j)
+					mat(i,j) = t_real(op[i*3 + j]);
+			add_matrix(mat);
+		}
+		m_numPointOps = ops.size();
+
+		// products and inverses, only defined within the cubic or hexagonal system
+		m_prods.resize(m_numPointOps * m_numPointOps, s_invalid);
+		for(std::size_t i=0; i<m_numPointOps; ++i)
+		{
+			for(std::size_t j=0; j<m_numPointOps; ++j)
+			{
+				auto iter = std::find(ops.begin(), ops.end(), mult(ops[i], ops[j]));
+				if(iter == ops.end())
+					continue;
+
+				const t_idx prod = t_idx(iter - ops.begin());
+				m_prods[i*m_numPointOps + j] = prod;
+				if(prod == 0)
+					m_invs[i] = t_idx(j);
+			}
+		}
+	}
+
+
+public:
+	SymOpTable(const SymOpTable&) = delete;
+	SymOpTable& operator=(const SymOpTable&) = delete;
+
+	/**
+	 * the table shared by all space groups
+	 */
+	static SymOpTable<t_mat>& GetTable()
+	{
+		static SymOpTable<t_mat> table;
+		return table;
+	}
+
+
+	/**
+	 * gets the index of a matrix, adding it to the table if needed
+	 */
+	t_idx Intern(const t_mat& mat)
+	{
+		std::lock_guard<std::mutex> lock(m_mtx);
+
+		t_idx idx = find_matrix(mat);
+		if(idx == s_invalid)
+			idx = add_matrix(mat);
+		return idx;
+	}
+
+	/**
+	 * gets the index of a matrix, s_invalid if it is not in the table
+	 */
+	t_idx Find(const t_mat& mat) const
+	{
+		std::lock_guard<std::mutex> lock(m_mtx);
+		return find_matrix(mat);
+	}
+
+	std::size_t GetNumMatrices() const { return m_numMats.load(); }
+	std::size_t GetNumPointOps() const { return m_numPointOps; }
+	bool IsPointOp(t_idx idx) const { return (idx & s_idxMask) < m_numPointOps; }
+
+	const t_mat& GetMatrix(t_idx idx) const { return m_mats[idx & s_idxMask]; }
+	int GetDeterminant(t_idx idx) const { return m_dets[idx & s_idxMask]; }
+
+	/**
+	 * index of the inverse of a point group operation
+	 */
+	t_idx GetInverse(t_idx idx) const { return m_invs[idx & s_idxMask]; }
+
+	/**
+	 * index of the product of two point group operations, s_invalid if undefined
+	 */
+	t_idx GetProduct(t_idx idx1, t_idx idx2) const
+	{
+		idx1 &= s_idxMask;
+		idx2 &= s_idxMask;
+		if(idx1 >= m_numPointOps || idx2 >= m_numPointOps)
+			return s_invalid;
+		return m_prods[idx1*m_numPointOps + idx2];
+	}
+
+	static t_idx GetRotIndex(t_idx op) { return op & s_idxMask; }
+	static bool IsTimeInverted(t_idx op) { return (op & s_timeInvBit) != 0; }
+	static t_idx MakeOp(t_idx idx, bool bTimeInv) { return (idx & s_idxMask) | (bTimeInv ? s_timeInvBit : 0); }
+};
+
+
+/**
+ * view of the interned matrices of a list of operator indices, used like a vector of matrices
+ */
+template<class t_mat>
+class SymOpMatrices
+{
+private:
+	const std::vector<typename SymOpTable<t_mat>::t_idx>* m_ops = nullptr;
+
+public:
+	SymOpMatrices(const std::vector<typename SymOpTable<t_mat>::t_idx>* ops) : m_ops{ops} {}
+
+	std::size_t size() const { return m_ops->size(); }
+
+	const t_mat& operator[](std::size_t i) const
+	{ return SymOpTable<t_mat>::GetTable().GetMatrix((*m_ops)[i]); }
+};
+
+
+/**
+ * view of the time inversions (+1 or -1) of a list of operator indices
+ */
+template<class t_mat>
+class SymOpInversions
+{
+private:
+	const std::vector<typename SymOpTable<t_mat>::t_idx>* m_ops = nullptr;
+
+public:
+	SymOpInversions(const std::vector<typename SymOpTable<t_mat>::t_idx>* ops) : m_ops{ops} {}
+
+	std::size_t size() const { return m_ops->size(); }
+
+	typename t_mat::value_type operator[](std::size_t i) const
+	{
+		using t_real = typename t_mat::value_type;
+		return SymOpTable<t_mat>::IsTimeInverted((*m_ops)[i]) ? t_real(-1) : t_real(1);
+	}
+};
+// ----------------------------------------------------------------------------
+
+
+
+
+// ----------------------------------------------------------------------------
+/**
+ * exact representation of a symmetry operation {R|t} with time reversal:
+ * integer rotation matrix and translation in units of 1/s_denom
+ * (the common denominator of all crystallographic translations: 1/2, 1/3, 1/4, 1/6, 1/8, 1/12)
+ */
+struct SymOpExact
+{
+	static constexpr int s_denom = 24;
+
+	// row-major rotation matrix
+	std::array<std::int8_t, 9> rot{{ 1,0,0, 0,1,0, 0,0,1 }};
+
+	// translation numerators
+	std::array<std::int16_t, 3> trans{{ 0, 0, 0 }};
+
+	bool timeinv = false;
+
+
+	constexpr int det() const
+	{
+		return rot[0]*(rot[4]*rot[8] - rot[5]*rot[7])
+			- rot[1]*(rot[3]*rot[8] - rot[5]*rot[6])
+			+ rot[2]*(rot[3]*rot[7] - rot[4]*rot[6]);
+	}
+
+
+	/**
+	 * this * op: {R1|t1}{R2|t2} = {R1 R2 | R1 t2 + t1}
+	 */
+	constexpr SymOpExact compose(const SymOpExact& op) const
+	{
+		SymOpExact res;
+
+		for(int i=0; i<3; ++i)
+		{
+			int t = trans[i];
+			for(int j=0; j<3; ++j)
+			{
+				int elem = 0;
+				for(int k=0; k<3; ++k)
+					elem += rot[i*3 + k] * op.rot[k*3 + j];
+				res.rot[i*3 + j] = std::int8_t(elem);
+
+				t += rot[i*3 + j] * op.trans[j];
+			}
+			res.trans[i] = std::int16_t(t);
+		}
+
+		res.timeinv = (timeinv != op.timeinv);
+		return res;
+	}
+
+
+	/**
+	 * {R|t}^(-1) = {R^(-1) | -R^(-1) t}, valid for det(R) = +-1
+	 */
+	constexpr SymOpExact inverse() const
+	{
+		SymOpExact res;
+		const int d = det();
+
+		// adjugate divided by the determinant
+		for(int i=0; i<3; ++i)
+		{
+			for(int j=0; j<3; ++j)
+			{
+				const int r1 = (j+1)%3, r2 = (j+2)%3;
+				const int c1 = (i+1)%3, c2 = (i+2)%3;
+				const int cofac = rot[r1*3 + c1]*rot[r2*3 + c2] - rot[r1*3 + c2]*rot[r2*3 + c1];
+				res.rot[i*3 + j] = std::int8_t(cofac * d);
+			}
+		}
+
+		for(int i=0; i<3; ++i)
+		{
+			int t = 0;
+			for(int j=0; j<3; ++j)
+				t -= res.rot[i*3 + j] * trans[j];
+			res.trans[i] = std::int16_t(t);
+		}
+
+		res.timeinv = timeinv;
+		return res;
+	}
+
+
+	/**
+	 * translation reduced into the unit cell [0, 1)
+	 */
+	constexpr SymOpExact normalised() const
+	{
+		SymOpExact res = *this;
+		for(int i=0; i<3; ++i)
+			res.trans[i] = std::int16_t(((trans[i] % s_denom) + s_denom) % s_denom);
+		return res;
+	}
+
+
+	constexpr bool operator==(const SymOpExact& op) const
+	{
+		for(int i=0; i<9; ++i)
+			if(rot[i] != op.rot[i])
+				return false;
+		for(int i=0; i<3; ++i)
+			if(trans[i] != op.trans[i])
+				return false;
+		return timeinv == op.timeinv;
+	}
+
+	constexpr bool operator!=(const SymOpExact& op) const { return !operator==(op); }
+
+
+	/**
+	 * unique key of the operation modulo primitive lattice translations,
+	 * rotation elements have to be in [-8, 7]
+	 */
+	constexpr std::uint64_t key() const
+	{
+		const SymOpExact op = normalised();
+		std::uint64_t k = 0;
+
+		for(int i=0; i<9; ++i)
+			k |= std::uint64_t((op.rot[i] + 8) & 0xf) << (4*i);
+		for(int i=0; i<3; ++i)
+			k |= std::uint64_t(op.trans[i] & 0x1f) << (36 + 5*i);
+		k |= std::uint64_t(op.timeinv ? 1 : 0) << 51;
+
+		return k;
+	}
+
+
+	/**
+	 * converts from the floating point representation
+	 * returns false if the elements are not integers or multiples of 1/s_denom
+	 */
+	template<class t_mat, class t_vec>
+	bool from_float(const t_mat& matRot, const t_vec& vecTrans, bool bTimeInv,
+		typename t_vec::value_type eps = 1e-6)
+	{
+		using t_real = typename t_vec::value_type;
+
+		for(std::size_t i=0; i<3; ++i)
+		{
+			for(std::size_t j=0; j<3; ++j)
+			{
+				const t_real elem = std::round(matRot(i,j));
+				if(std::abs(elem - matRot(i,j)) > eps)
+					return false;
+				rot[i*3 + j] = std::int8_t(elem);
+			}
+
+			const t_real t = vecTrans[i] * t_real(s_denom);
+			const t_real num = std::round(t);
+			if(std::abs(num - t) > eps*t_real(s_denom))
+				return false;
+			trans[i] = std::int16_t(num);
+		}
+
+		timeinv = bTimeInv;
+		return true;
+	}
+
+
+	/**
+	 * floating point view of the rotation
+	 */
+	template<class t_mat>
+	t_mat get_rot() const
+	{
+		using t_real = typename t_mat::value_type;
+
+		t_mat mat = m::zero<t_mat>(3, 3);
+		for(std::size_t i=0; i<3; ++i)
+			for(std::size_t j=0; j<3; ++j)
+				mat(i,j) = t_real(rot[i*3 + j]);
+		return mat;
+	}
+
+
+	/**
+	 * floating point view of the translation
+	 */
+	template<class t_vec>
+	t_vec get_trans() const
+	{
+		using t_real = typename t_vec::value_type;
+
+		t_vec vec = m::zero<t_vec>(3);
+		for(std::size_t i=0; i<3; ++i)
+			vec[i] = t_real(trans[i]) / t_real(s_denom);
+		return vec;
+	}
+
+
+	/**
+	 * appends one row of an affine map in coordinate triplet notation, e.g. "-x+y+1/2",
+	 * the translation is given in units of 1/denom
+	 */
+	static void append_xyz(std::string& str, const int* row, int trans, int denom,
+		const char* const* vars = nullptr)
+	{
+		static const char* const xyz[] = { "x", "y", "z" };
+		if(!vars)
+			vars = xyz;
+
+		const std::size_t iStart = str.length();
+
+		for(int j=0; j<3; ++j)
+		{
+			const int coeff = row[j];
+			if(coeff == 0)
+				continue;
+
+			if(coeff < 0)
+				str += '-';
+			else if(str.length() > iStart)
+				str += '+';
+
+			if(coeff != 1 && coeff != -1)
+				str += std::to_string(coeff < 0 ? -coeff : coeff);
+			str += vars[j];
+		}
+
+		if(trans != 0)
+		{
+			const int div = std::gcd(trans, denom);
+			const int num = trans / div, den = denom / div;
+
+			if(num < 0)
+				str += '-';
+			else if(str.length() > iStart)
+				str += '+';
+
+			str += std::to_string(num < 0 ? -num : num);
+			if(den != 1)
+			{
+				str += '/';
+				str += std::to_string(den);
+			}
+		}
+
+		if(str.length() == iStart)
+			str += '0';
+	}
+
+
+	/**
+	 * coordinate triplet (seitz) notation, e.g. "x,-y,z+1/2,-1" with the time inversion as last entry
+	 */
+	std::string to_xyz(bool bWithTimeInv = true) const
+	{
+		std::string str;
+		str.reserve(32);
+
+		for(int i=0; i<3; ++i)
+		{
+			const int row[3] = { rot[i*3 + 0], rot[i*3 + 1], rot[i*3 + 2] };
+			if(i > 0)
+				str += ',';
+			append_xyz(str, row, trans[i], s_denom);
+		}
+
+		if(bWithTimeInv)
+			str += timeinv ? ",-1" : ",+1";
+
+		return str;
+	}
+};
+
+
+/**
+ * coordinate triplet notation of an affine map given in floating point,
+ * falls back to decimal numbers if the elements are not small rationals
+ */
+template<class t_mat, class t_vec>
+std::string get_xyz(const t_mat& rot, const t_vec& trans, const char* const* vars = nullptr)
+{
+	using t_real = typename t_vec::value_type;
+
+	SymOpExact op;
+	const bool bExact = op.from_float<t_mat, t_vec>(rot, trans, false);
+
+	std::string str;
+	for(std::size_t i=0; i<3; ++i)
+	{
+		if(i > 0)
+			str += ',';
+
+		if(bExact)
+		{
+			const int row[3] = { op.rot[i*3 + 0], op.rot[i*3 + 1], op.rot[i*3 + 2] };
+			SymOpExact::append_xyz(str, row, op.trans[i], SymOpExact::s_denom, vars);
+		}
+		else
+		{
+			static const char* const xyz[] = { "x", "y", "z" };
+			std::ostringstream ostr;
+			for(std::size_t j=0; j<3; ++j)
+			{
+				if(rot(i,j) != t_real(0))
+					ostr << std::showpos << rot(i,j) << (vars ? vars[j] : xyz[j]);
+			}
+			if(trans[i] != t_real(0))
+				ostr << std::showpos << trans[i];
+			str += ostr.str();
+		}
+	}
+
+	return str;
+}
+
+
+// consistency checks of the exact operations
+namespace {
+	constexpr SymOpExact g_opScrew{ {{ 0,-1,0, 1,0,0, 0,0,1 }}, {{ 0, 0, 6 }}, true };
+	static_assert(g_opScrew.compose(g_opScrew.inverse()) == SymOpExact{}, "Invalid symmetry operator inverse.");
+	static_assert(g_opScrew.compose(g_opScrew).compose(g_opScrew).compose(g_opScrew).normalised() == SymOpExact{},
+		"Invalid symmetry operator composition.");
+}
+// ----------------------------------------------------------------------------
+
+
+
+
+// ----------------------------------------------------------------------------
+/**
+ * lattice of pure translations in units of 1/SymOpExact::s_denom
+ *
+ * the basis is kept in (upper triangular) hermite normal form,
+ * which gives a unique representative of a translation modulo the lattice.
+ */
+class SymOpLattice
+{
+public:
+	using t_trans = std::array<int, 3>;
+
+private:
+	// basis vectors as rows
+	std::array<t_trans, 3> m_hnf{{ {{ SymOpExact::s_denom, 0, 0 }},
+		{{ 0, SymOpExact::s_denom, 0 }}, {{ 0, 0, SymOpExact::s_denom }} }};
+
+public:
+	SymOpLattice() = default;
+	~SymOpLattice() = default;
+
+	/**
+	 * sets the lattice from a (possibly redundant) set of generating vectors
+	 * returns false if the vectors are not multiples of 1/s_denom or do not span three dimensions
+	 */
+	template<class t_vec>
+	bool SetVectors(const std::vector<t_vec>& vecs, typename t_vec::value_type eps = 1e-6)
+	{
+		using t_real = typename t_vec::value_type;
+
+		std::vector<t_trans> rows;
+		for(const t_vec& vec : vecs)
+		{
+			t_trans row{{ 0, 0, 0 }};
+			for(std::size_t i=0; i<3; ++i)
+			{
+				const t_real t = vec[i] * t_real(SymOpExact::s_denom);
+				const t_real num = std::round(t);
+				if(std::abs(num - t) > eps*t_real(SymOpExact::s_denom))
+					return false;
+				row[i] = int(num);
+			}
+			rows.push_back(row);
+		}
+
+		// column-wise euclidean elimination
+		std::size_t iPivot = 0;
+		for(std::size_t iCol=0; iCol<3; ++iCol)
+		{
+			while(true)
+			{
+				// find the row with the smallest non-zero element in this column
+				std::size_t iMin = rows.size();
+				for(std::size_t iRow=iPivot; iRow<rows.size(); ++iRow)
+				{
+					if(rows[iRow][iCol] == 0)
+						continue;
+					if(iMin == rows.size() || std::abs(rows[iRow][iCol]) < std::abs(rows[iMin][iCol]))
+						iMin = iRow;
+				}
+				if(iMin == rows.size())
+					return false;
+				std::swap(rows[iPivot], rows[iMin]);
+
+				bool bDone = true;
+				for(std::size_t iRow=iPivot+1; iRow<rows.size(); ++iRow)
+				{
+					const int fac = rows[iRow][iCol] / rows[iPivot][iCol];
+					for(std::size_t i=iCol; i<3; ++i)
+						rows[iRow][i] -= fac * rows[iPivot][i];
+					if(rows[iRow][iCol] != 0)
+						bDone = false;
+				}
+
+				if(bDone)
+					break;
+			}
+
+			if(rows[iPivot][iCol] < 0)
+				for(std::size_t i=iCol; i<3; ++i)
+					rows[iPivot][i] = -rows[iPivot][i];
+			++iPivot;
+		}
+
+		for(std::size_t iRow=0; iRow<3; ++iRow)
+			m_hnf[iRow] = rows[iRow];
+
+		// reduce the elements above the diagonal
+		for(int iRow=1; iRow>=0; --iRow)
+		{
+			for(std::size_t iCol=std::size_t(iRow)+1; iCol<3; ++iCol)
+			{
+				const int d = m_hnf[iCol][iCol];
+				const int fac = (m_hnf[iRow][iCol] >= 0 ? m_hnf[iRow][iCol] : m_hnf[iRow][iCol] - d + 1) / d;
+				for(std::size_t i=iCol; i<3; ++i)
+					m_hnf[iRow][i] -= fac * m_hnf[iCol][i];
+			}
+		}
+
+		return true;
+	}
+
+	/**
+	 * unique representative of a translation modulo the lattice, with 0 <= t[i] < hnf[i][i]
+	 */
+	t_trans Reduce(const t_trans& trans) const
+	{
+		t_trans t = trans;
+		for(std::size_t i=0; i<3; ++i)
+		{
+			const int d = m_hnf[i][i];
+			const int fac = (t[i] >= 0 ? t[i] : t[i] - d + 1) / d;
+			for(std::size_t j=i; j<3; ++j)
+				t[j] -= fac * m_hnf[i][j];
+		}
+		return t;
+	}
+
+	/**
+	 * does the lattice contain the translation?
+	 */
+	bool Contains(const t_trans& trans) const
+	{
+		const t_trans t = Reduce(trans);
+		return t[0] == 0 && t[1] == 0 && t[2] == 0;
+	}
+
+	/**
+	 * does the lattice map onto itself under the rotation?
+	 */
+	bool IsInvariant(const SymOpExact& op) const
+	{
+		for(const t_trans& row : m_hnf)
+		{
+			t_trans t{{ 0, 0, 0 }};
+			for(std::size_t i=0; i<3; ++i)
+				for(std::size_t j=0; j<3; ++j)
+					t[i] += op.rot[i*3 + j] * row[j];
+			if(!Contains(t))
+				return false;
+		}
+		return true;
+	}
+
+	const std::array<t_trans, 3>& GetBasis() const { return m_hnf; }
+};
+// ----------------------------------------------------------------------------
+
+
+
+
+// ----------------------------------------------------------------------------
+/**
+ * group of the symmetry operations modulo lattice translations:
+ * multiplication (cayley) table, inverses, conjugacy classes and coset decompositions
+ */
+class SymGroupTable
+{
+public:
+	using t_idx = std::uint16_t;
+	static constexpr t_idx s_invalid = 0xffff;
+
+private:
+	// operations with translations reduced modulo the lattice
+	std::vector<SymOpExact> m_ops;
+	SymOpLattice m_latt;
+
+	// lookup of the operations by their reduced key
+	std::unordered_map<std::uint64_t, t_idx> m_lookup;
+
+	// m_mult[i*N + j] = index of ops[i] * ops[j]
+	std::vector<t_idx> m_mult;
+	std::vector<t_idx> m_inv;
+	t_idx m_identity = s_invalid;
+
+	// conjugacy classes and the class index of each operation
+	std::vector<std::vector<t_idx>> m_classes;
+	std::vector<t_idx> m_classOfOp;
+
+protected:
+	/**
+	 * key of an operation with its translation reduced modulo the lattice
+	 * returns [key, ok]
+	 */
+	std::tuple<std::uint64_t, bool> GetKey(const SymOpExact& op) const
+	{
+		const SymOpLattice::t_trans t = m_latt.Reduce({{ op.trans[0], op.trans[1], op.trans[2] }});
+
+		std::uint64_t key = 0;
+		for(int i=0; i<9; ++i)
+		{
+			if(op.rot[i] < -8 || op.rot[i] > 7)
+				return std::make_tuple(key, false);
+			key |= std::uint64_t((op.rot[i] + 8) & 0xf) << (4*i);
+		}
+		for(int i=0; i<3; ++i)
+		{
+			if(t[i] >= 0x200)
+				return std::make_tuple(key, false);
+			key |= std::uint64_t(t[i]) << (36 + 9*i);
+		}
+		key |= std::uint64_t(op.timeinv ? 1 : 0) << 63;
+
+		return std::make_tuple(key, true);
+	}
+
+	/**
+	 * the operation with its translation reduced modulo the lattice
+	 */
+	SymOpExact Reduce(const SymOpExact& op) const
+	{
+		SymOpExact res = op;
+		const SymOpLattice::t_trans t = m_latt.Reduce({{ op.trans[0], op.trans[1], op.trans[2] }});
+		for(int i=0; i<3; ++i)
+			res.trans[i] = std::int16_t(t[i]);
+		return res;
+	}
+
+public:
+	SymGroupTable() = default;
+	~SymGroupTable() = default;
+
+	/**
+	 * builds the tables, fails if the operations do not form a group modulo the lattice
+	 */
+	bool Create(const std::vector<SymOpExact>& ops, const SymOpLattice& latt)
+	{
+		m_latt = latt;
+		m_ops.clear();
+		m_lookup.clear();
+
+		for(const SymOpExact& op : ops)
+		{
+			if(m_ops.size() >= s_invalid)
+				return false;
+
+			auto [key, ok] = GetKey(op);
+			if(!ok)
+				return false;
+
+			// skip operations which are equivalent modulo the lattice
+			if(m_lookup.find(key) != m_lookup.end())
+				continue;
+
+			m_lookup.emplace(key, t_idx(m_ops.size()));
+			m_ops.push_back(Reduce(op));
+		}
+
+		const std::size_t N = m_ops.size();
+		m_identity = Find(SymOpExact{});
+		if(m_identity == s_invalid)
+			return false;
+
+		// multiplication table
+		m_mult.resize(N*N);
+		for(std::size_t i=0; i<N; ++i)
+		{
+			for(std::size_t j=0; j<N; ++j)
+			{
+				const t_idx idx = Find(m_ops[i].compose(m_ops[j]));
+				if(idx == s_invalid)
+					return false;
+				m_mult[i*N + j] = idx;
+			}
+		}
+
+		// inverses from the rows of the table
+		m_inv.assign(N, s_invalid);
+		for(std::size_t i=0; i<N; ++i)
+		{
+			for(std::size_t j=0; j<N; ++j)
+			{
+				if(m_mult[i*N + j] == m_identity)
+				{
+					m_inv[i] = t_idx(j);
+					break;
+				}
+			}
+			if(m_inv[i] == s_invalid)
+				return false;
+		}
+
+		// conjugacy classes { h g h^(-1) }
+		m_classes.clear();
+		m_classOfOp.assign(N, s_invalid);
+		for(std::size_t g=0; g<N; ++g)
+		{
+			if(m_classOfOp[g] != s_invalid)
+				continue;
+
+			const t_idx iClass = t_idx(m_classes.size());
+			std::vector<t_idx> cls;
+			for(std::size_t h=0; h<N; ++h)
+			{
+				const t_idx conj = m_mult[m_mult[h*N + g]*N + m_inv[h]];
+				if(m_classOfOp[conj] == s_invalid)
+				{
+					m_classOfOp[conj] = iClass;
+					cls.push_back(conj);
+				}
+			}
+
+			std::sort(cls.begin(), cls.end());
+			m_classes.emplace_back(std::move(cls));
+		}
+
+		return true;
+	}
+
+	/**
+	 * index of an operation (modulo the lattice), s_invalid if it is not in the group
+	 */
+	t_idx Find(const SymOpExact& op) const
+	{
+		auto [key, ok] = GetKey(op);
+		if(!ok)
+			return s_invalid;
+
+		auto iter = m_lookup.find(key);
+		if(iter == m_lookup.end())
+			return s_invalid;
+		return iter->second;
+	}
+
+	std::size_t GetOrder() const { return m_ops.size(); }
+	const std::vector<SymOpExact>& GetOps() const { return m_ops; }
+	const SymOpLattice& GetLattice() const { return m_latt; }
+
+	t_idx GetIdentity() const { return m_identity; }
+	t_idx GetProduct(t_idx i, t_idx j) const { return m_mult[std::size_t(i)*m_ops.size() + j]; }
+	t_idx GetInverse(t_idx i) const { return m_inv[i]; }
+	const std::vector<t_idx>& GetMultiplicationTable() const { return m_mult; }
+
+	const std::vector<std::vector<t_idx>>& GetConjugacyClasses() const { return m_classes; }
+	t_idx GetClass(t_idx i) const { return m_classOfOp[i]; }
+
+	/**
+	 * order of an element: smallest n with g^n = 1 (modulo the lattice)
+	 */
+	std::size_t GetElementOrder(t_idx i) const
+	{
+		std::size_t n = 1;
+		for(t_idx g = i; g != m_identity; g = GetProduct(g, i))
+			++n;
+		return n;
+	}
+
+	/**
+	 * indices of the operations without time inversion
+	 */
+	std::vector<t_idx> GetUnitarySubgroup() const
+	{
+		std::vector<t_idx> sub;
+		for(std::size_t i=0; i<m_ops.size(); ++i)
+			if(!m_ops[i].timeinv)
+				sub.push_back(t_idx(i));
+		return sub;
+	}
+
+	/**
+	 * indices of the given operations in this group
+	 * returns [indices, ok], ok is false if an operation is not in the group
+	 */
+	std::tuple<std::vector<t_idx>, bool> FindOps(const std::vector<SymOpExact>& ops,
+		bool bIgnoreTimeInv = false) const
+	{
+		std::vector<t_idx> indices;
+		bool bOk = true;
+
+		for(SymOpExact op : ops)
+		{
+			if(bIgnoreTimeInv)
+				op.timeinv = false;
+
+			const t_idx idx = Find(op);
+			if(idx == s_invalid)
+				bOk = false;
+			else if(std::find(indices.begin(), indices.end(), idx) == indices.end())
+				indices.push_back(idx);
+		}
+
+		std::sort(indices.begin(), indices.end());
+		return std::make_tuple(indices, bOk);
+	}
+
+	/**
+	 * are the operations closed under multiplication?
+	 */
+	bool IsSubgroup(const std::vector<t_idx>& sub) const
+	{
+		std::vector<bool> inSub(m_ops.size(), false);
+		for(t_idx i : sub)
+			inSub[i] = true;
+		if(sub.size() == 0 || !inSub[m_identity])
+			return false;
+
+		for(t_idx i : sub)
+			for(t_idx j : sub)
+				if(!inSub[GetProduct(i, j)])
+					return false;
+		return true;
+	}
+
+	/**
+	 * decomposition of the group into left (g H) or right (H g) cosets of the subgroup H
+	 * returns [cosets, coset index of each operation, ok]; the first coset is H itself
+	 */
+	std::tuple<std::vector<std::vector<t_idx>>, std::vector<t_idx>, bool>
+	GetCosets(const std::vector<t_idx>& sub, bool bLeft = true) const
+	{
+		std::vector<std::vector<t_idx>> cosets;
+		std::vector<t_idx> cosetOfOp(m_ops.size(), s_invalid);
+
+		if(!IsSubgroup(sub))
+			return std::make_tuple(cosets, cosetOfOp, false);
+
+		// start with the identity, so that H is the first coset
+		std::vector<t_idx> reps{ m_identity };
+		for(std::size_t g=0; g<m_ops.size(); ++g)
+			reps.push_back(t_idx(g));
+
+		for(t_idx g : reps)
+		{
+			if(cosetOfOp[g] != s_invalid)
+				continue;
+
+			const t_idx iCoset = t_idx(cosets.size());
+			std::vector<t_idx> coset;
+			for(t_idx h : sub)
+			{
+				const t_idx elem = bLeft ? GetProduct(g, h) : GetProduct(h, g);
+				cosetOfOp[elem] = iCoset;
+				coset.push_back(elem);
+			}
+
+			cosets.emplace_back(std::move(coset));
+		}
+
+		return std::make_tuple(cosets, cosetOfOp, true);
+	}
+
+	/**
+	 * is the subgroup normal, i.e. are its left and right cosets identical?
+	 */
+	bool IsNormalSubgroup(const std::vector<t_idx>& sub) const
+	{
+		if(!IsSubgroup(sub))
+			return false;
+
+		std::vector<bool> inSub(m_ops.size(), false);
+		for(t_idx i : sub)
+			inSub[i] = true;
+
+		for(std::size_t g=0; g<m_ops.size(); ++g)
+			for(t_idx h : sub)
+				if(!inSub[GetProduct(GetProduct(t_idx(g), h), m_inv[g])])
+					return false;
+		return true;
+	}
+};
+// ----------------------------------------------------------------------------
+
+
+
+
 // ----------------------------------------------------------------------------
 /**
  * Symmetry operations
@@ -46,23 +1177,242 @@ class Symmetry
 {
 	friend class Spacegroups<t_mat, t_vec>;
 
+public:
+	using t_idx = typename SymOpTable<t_mat>::t_idx;
+
 private:
-	// rotations
-	std::vector<t_mat> m_rot;
+	// rotations as indices into the operator table, with time inversion bits
+	std::vector<t_idx> m_ops;
 
 	// translations
 	std::vector<t_vec> m_trans;
 
-	// time inversions
-	std::vector<typename t_mat::value_type> m_inv;
+	// exact operations
+	std::vector<SymOpExact> m_exact;
+
+protected:
+	/**
+	 * sets the operations from their exact representation,
+	 * returns false if the rotations do not fit into the operator table
+	 */
+	bool SetExactOps(std::vector<SymOpExact>&& ops)
+	{
+		auto& optab = SymOpTable<t_mat>::GetTable();
+
+		m_ops.clear();
+		m_trans.clear();
+		m_ops.reserve(ops.size());
+		m_trans.reserve(ops.size());
+
+		for(const SymOpExact& op : ops)
+		{
+			const t_idx idx = optab.Intern(op.get_rot<t_mat>());
+			if(idx == SymOpTable<t_mat>::s_invalid)
+			{
+				m_ops.clear();
+				m_trans.clear();
+				m_exact.clear();
+				return false;
+			}
+
+			m_ops.push_back(SymOpTable<t_mat>::MakeOp(idx, op.timeinv));
+			m_trans.emplace_back(op.get_trans<t_vec>());
+		}
+
+		m_exact = std::move(ops);
+		return true;
+	}
+
+	/**
+	 * calculates the exact operations from the floating point ones
+	 */
+	bool CalcExactOps()
+	{
+		m_exact.clear();
+		m_exact.reserve(m_ops.size());
+
+		const auto rots = GetRotations();
+		const auto invs = GetInversions();
+
+		for(std::size_t iOp=0; iOp<m_ops.size(); ++iOp)
+		{
+			SymOpExact op;
+			if(!op.from_float<t_mat, t_vec>(rots[iOp], m_trans[iOp], invs[iOp] < 0))
+			{
+				m_exact.clear();
+				return false;
+			}
+
+			m_exact.push_back(op);
+		}
+
+		return true;
+	}
 
 public:
 	Symmetry() = default;
 	~Symmetry() = default;
 
-	const std::vector<t_mat>& GetRotations() const { return m_rot; }
+	SymOpMatrices<t_mat> GetRotations() const { return SymOpMatrices<t_mat>(&m_ops); }
 	const std::vector<t_vec>& GetTranslations() const { return m_trans; }
-	const std::vector<typename t_mat::value_type>& GetInversions() const { return m_inv; }
+	SymOpInversions<t_mat> GetInversions() const { return SymOpInversions<t_mat>(&m_ops); }
+
+	const std::vector<t_idx>& GetOperatorIndices() const { return m_ops; }
+
+	// exact operations, empty if the operations could not be represented exactly
+	const std::vector<SymOpExact>& GetExactOps() const { return m_exact; }
+};
+// ----------------------------------------------------------------------------
+
+
+
+
+// ----------------------------------------------------------------------------
+/**
+ * symmetry operations in a flat layout to apply them to many atoms at once
+ *
+ * positions and moments are passed as structures of arrays, all images are
+ * written in one pass into preallocated output arrays without temporaries,
+ * the inner loops over the atoms have no branches and are vectorised at -O3.
+ */
+template<class t_real = double>
+class SymOpsBatch
+{
+private:
+	// rotation matrices, row-major, 9 elements per operation
+	std::vector<t_real> m_rot;
+
+	// translations, 3 elements per operation
+	std::vector<t_real> m_trans;
+
+	// moment factor det(R) * (time inversion ? -1 : 1)
+	std::vector<t_real> m_momFac;
+
+	std::size_t m_numOps = 0;
+
+public:
+	/**
+	 * x - floor(x) for |x| < 2^31, without library calls and comparisons to allow vectorisation:
+	 * the first truncation gives a value in (-1, 1), the shifted second one a value in [0, 1),
+	 * tiny negative values round to 0
+	 */
+	static t_real Wrap(t_real x)
+	{
+		x -= t_real(static_cast<std::int32_t>(x));
+		x += t_real(1);
+		x -= t_real(static_cast<std::int32_t>(x));
+		return x;
+	}
+
+	SymOpsBatch() = default;
+	~SymOpsBatch() = default;
+
+	std::size_t GetNumOps() const { return m_numOps; }
+
+	/**
+	 * sets the operations of a space group, optionally combined with all centring vectors
+	 */
+	template<class t_mat, class t_vec, class t_centring = t_vec>
+	void SetOperations(const Symmetry<t_mat, t_vec>& sym, const std::vector<t_centring>* centring = nullptr)
+	{
+		const auto rots = sym.GetRotations();
+		const auto invs = sym.GetInversions();
+		const auto& transs = sym.GetTranslations();
+		const auto& optab = SymOpTable<t_mat>::GetTable();
+
+		const std::size_t numCentring = centring ? centring->size() : 1;
+		m_numOps = rots.size() * numCentring;
+		m_rot.resize(m_numOps * 9);
+		m_trans.resize(m_numOps * 3);
+		m_momFac.resize(m_numOps);
+
+		std::size_t iOut = 0;
+		for(std::size_t iOp=0; iOp<rots.size(); ++iOp)
+		{
+			const t_mat& rot = rots[iOp];
+			const t_real det = t_real(optab.GetDeterminant(sym.GetOperatorIndices()[iOp]));
+
+			for(std::size_t iCentring=0; iCentring<numCentring; ++iCentring, ++iOut)
+			{
+				for(std::size_t i=0; i<3; ++i)
+				{
+					for(std::size_t j=0; j<3; ++j)
+						m_rot[iOut*9 + i*3 + j] = t_real(rot(i,j));
+
+					m_trans[iOut*3 + i] = t_real(transs[iOp][i]);
+					if(centring)
+						m_trans[iOut*3 + i] += t_real((*centring)[iCentring][i]);
+				}
+
+				m_momFac[iOut] = det * t_real(invs[iOp]);
+			}
+		}
+	}
+
+	/**
+	 * applies all operations to N atoms
+	 * the image of atom i under operation op is written to index op*N + i of the output arrays,
+	 * which have to hold GetNumOps()*N elements; the moment arrays may be nullptr
+	 */
+	void Apply(std::size_t N,
+		const t_real* __restrict__ x, const t_real* __restrict__ y, const t_real* __restrict__ z,
+		t_real* __restrict__ outx, t_real* __restrict__ outy, t_real* __restrict__ outz,
+		const t_real* __restrict__ mx = nullptr, const t_real* __restrict__ my = nullptr,
+		const t_real* __restrict__ mz = nullptr,
+		t_real* __restrict__ outmx = nullptr, t_real* __restrict__ outmy = nullptr,
+		t_real* __restrict__ outmz = nullptr,
+		bool bWrap = true) const
+	{
+		const bool bMoments = mx && my && mz && outmx && outmy && outmz;
+
+		for(std::size_t iOp=0; iOp<m_numOps; ++iOp)
+		{
+			const t_real* R = m_rot.data() + iOp*9;
+			const t_real r00 = R[0], r01 = R[1], r02 = R[2];
+			const t_real r10 = R[3], r11 = R[4], r12 = R[5];
+			const t_real r20 = R[6], r21 = R[7], r22 = R[8];
+			const t_real tx = m_trans[iOp*3 + 0], ty = m_trans[iOp*3 + 1], tz = m_trans[iOp*3 + 2];
+
+			t_real* __restrict__ ox = outx + iOp*N;
+			t_real* __restrict__ oy = outy + iOp*N;
+			t_real* __restrict__ oz = outz + iOp*N;
+
+			if(bWrap)
+			{
+				for(std::size_t i=0; i<N; ++i)
+				{
+					ox[i] = Wrap(r00*x[i] + r01*y[i] + r02*z[i] + tx);
+					oy[i] = Wrap(r10*x[i] + r11*y[i] + r12*z[i] + ty);
+					oz[i] = Wrap(r20*x[i] + r21*y[i] + r22*z[i] + tz);
+				}
+			}
+			else
+			{
+				for(std::size_t i=0; i<N; ++i)
+				{
+					ox[i] = r00*x[i] + r01*y[i] + r02*z[i] + tx;
+					oy[i] = r10*x[i] + r11*y[i] + r12*z[i] + ty;
+					oz[i] = r20*x[i] + r21*y[i] + r22*z[i] + tz;
+				}
+			}
+
+			if(bMoments)
+			{
+				// axial vectors: det(R) * R * M, inverted by time reversal
+				const t_real f = m_momFac[iOp];
+				t_real* __restrict__ omx = outmx + iOp*N;
+				t_real* __restrict__ omy = outmy + iOp*N;
+				t_real* __restrict__ omz = outmz + iOp*N;
+
+				for(std::size_t i=0; i<N; ++i)
+				{
+					omx[i] = f * (r00*mx[i] + r01*my[i] + r02*mz[i]);
+					omy[i] = f * (r10*mx[i] + r11*my[i] + r12*mz[i]);
+					omz[i] = f * (r20*mx[i] + r21*my[i] + r22*mz[i]);
+				}
+			}
+		}
+	}
 };
 // ----------------------------------------------------------------------------
 
@@ -85,8 +1435,12 @@ private:
 	// multiplicity
 	int m_mult = 0;
 
-	// structural & magnetic rotations
-	std::vector<t_mat> m_rot, m_rotMag;
+public:
+	using t_idx = typename SymOpTable<t_mat>::t_idx;
+
+private:
+	// structural & magnetic rotations as indices into the operator table
+	std::vector<t_idx> m_rot, m_rotMag;
 
 	// translations
 	std::vector<t_vec> m_trans;
@@ -99,9 +1453,12 @@ public:
 	int GetMultiplicity() const { return m_mult; }
 	std::string GetName() const { return std::to_string(m_mult) + m_letter; }
 
-	const std::vector<t_mat>& GetRotations() const { return m_rot; }
-	const std::vector<t_mat>& GetRotationsMag() const { return m_rotMag; }
+	SymOpMatrices<t_mat> GetRotations() const { return SymOpMatrices<t_mat>(&m_rot); }
+	SymOpMatrices<t_mat> GetRotationsMag() const { return SymOpMatrices<t_mat>(&m_rotMag); }
 	const std::vector<t_vec>& GetTranslations() const { return m_trans; }
+
+	const std::vector<t_idx>& GetRotationIndices() const { return m_rot; }
+	const std::vector<t_idx>& GetRotationMagIndices() const { return m_rotMag; }
 };
 // ----------------------------------------------------------------------------
 
@@ -135,9 +1492,69 @@ private:
 	std::shared_ptr<std::vector<WycPositions<t_mat, t_vec>>> m_wycBNS;
 	std::shared_ptr<std::vector<WycPositions<t_mat, t_vec>>> m_wycOG;
 
-	// BNS to OG trafo
-	t_mat m_rotBNS2OG;
-	t_vec m_transBNS2OG;
+	// BNS to OG trafo, identity if not given in the database
+	t_mat m_rotBNS2OG = m::unit<t_mat>(3,3);
+	t_vec m_transBNS2OG = m::zero<t_vec>(3);
+
+	// lazily created group tables of the magnetic and the structural (time inversion ignored) group
+	mutable std::shared_ptr<std::mutex> m_mtxTables = std::make_shared<std::mutex>();
+	mutable std::shared_ptr<SymGroupTable> m_tabBNS, m_tabOG;
+	mutable std::shared_ptr<SymGroupTable> m_tabStructBNS, m_tabStructOG;
+
+protected:
+	/**
+	 * creates the group table modulo the lattice translations,
+	 * returns an empty table if the operations do not form a group
+	 */
+	std::shared_ptr<SymGroupTable> CreateGroupTable(bool bBNS, bool bStruct) const
+	{
+		auto tab = std::make_shared<SymGroupTable>();
+
+		const Symmetry<t_mat, t_vec>* sym = GetSymmetries(bBNS);
+		const std::vector<t_vec>* latt = GetLattice(bBNS);
+		if(!sym || sym->GetExactOps().size() == 0)
+			return tab;
+
+		SymOpLattice lattExact;
+		if(latt && !lattExact.SetVectors(*latt))
+		{
+			std::cerr << "Space group " << m_nrBNS << " has an invalid lattice." << std::endl;
+			return tab;
+		}
+
+		std::vector<SymOpExact> ops = sym->GetExactOps();
+		if(bStruct)
+		{
+			for(SymOpExact& op : ops)
+				op.timeinv = false;
+		}
+
+		if(!tab->Create(ops, lattExact))
+		{
+			std::cerr << "Operations of space group " << m_nrBNS << " do not form a group." << std::endl;
+			return std::make_shared<SymGroupTable>();
+		}
+
+		return tab;
+	}
+
+	const SymGroupTable* GetOrCreateGroupTable(bool bBNS, bool bStruct) const
+	{
+		std::lock_guard<std::mutex> lock(*m_mtxTables);
+
+		auto& tab = bStruct ? (bBNS ? m_tabStructBNS : m_tabStructOG) : (bBNS ? m_tabBNS : m_tabOG);
+		if(!tab)
+		{
+			// OG identical to BNS?
+			const auto& tabBNS = bStruct ? m_tabStructBNS : m_tabBNS;
+			if(!bBNS && tabBNS && m_symOG == m_symBNS && m_latticeOG == m_latticeBNS)
+				tab = tabBNS;
+			else
+				tab = CreateGroupTable(bBNS, bStruct);
+		}
+
+		return tab->GetOrder() ? tab.get() : nullptr;
+	}
 
 public:
 	Spacegroup() = default;
@@ -161,6 +1578,18 @@ public:
 
 	const std::vector<WycPositions<t_mat, t_vec>>* GetWycPositions(bool bBNS=true) const
 	{ return bBNS ? m_wycBNS.get() : m_wycOG.get(); }
+
+	// BNS to OG trafo, only set if the table defines one
+	const t_mat& GetRotBNS2OG() const { return m_rotBNS2OG; }
+	const t_vec& GetTransBNS2OG() const { return m_transBNS2OG; }
+
+	// group table of the magnetic space group, nullptr if it cannot be created
+	const SymGroupTable* GetGroupTable(bool bBNS=true) const
+	{ return GetOrCreateGroupTable(bBNS, false); }
+
+	// group table of the structural space group, i.e. ignoring time inversion
+	const SymGroupTable* GetStructGroupTable(bool bBNS=true) const
+	{ return GetOrCreateGroupTable(bBNS, true); }
 };
 // ----------------------------------------------------------------------------
 
@@ -175,6 +1604,14 @@ template<class t_mat, class t_vec>
 requires m::is_mat<t_mat> && m::is_vec<t_vec>
 class Spacegroups
 {
+public:
+	/**
+	 * receives a loaded group, its index and the total number of groups,
+	 * returns false to stop loading
+	 */
+	using t_loadfunc = std::function<bool(Spacegroup<t_mat, t_vec>&& sg,
+		std::size_t iGroup, std::size_t iNumGroups)>;
+
 private:
 	std::vector<Spacegroup<t_mat, t_vec>> m_sgs;
 
@@ -182,11 +1619,18 @@ public:
 	Spacegroups() = default;
 	~Spacegroups() = default;
 
-	bool Load(const std::string& strFile);
+	/**
+	 * loads the database, the groups are stored or, if given, passed on to the load function
+	 */
+	bool Load(const std::string& strFile, const t_loadfunc& funcLoaded = nullptr);
 
 	const std::vector<Spacegroup<t_mat, t_vec>>* GetSpacegroups() const
 	{ return &m_sgs; }
 
+	// groups added within the reserved size keep their addresses
+	void Reserve(std::size_t iNumGroups) { m_sgs.reserve(iNumGroups); }
+	void Add(Spacegroup<t_mat, t_vec>&& sg) { m_sgs.emplace_back(std::move(sg)); }
+
 	const Spacegroup<t_mat, t_vec>* GetSpacegroupByNumber(int iStruc, int iMag) const
 	{
 		auto iter = std::find_if(m_sgs.begin(), m_sgs.end(),
@@ -210,9 +1654,14 @@ public:
 
 
 template<class t_mat, class t_vec>
-bool Spacegroups<t_mat, t_vec>::Load(const std::string& strFile)
+bool Spacegroups<t_mat, t_vec>::Load(const std::string& strFile, const t_loadfunc& funcLoaded)
 {
 	using t_real = typename t_mat::value_type;
+	using t_optab = SymOpTable<t_mat>;
+	using t_idx = typename t_optab::t_idx;
+
+	// interned rotation matrices
+	t_optab& optab = t_optab::GetTable();
 
 	// load xml database
 	ptree::ptree prop;
@@ -237,6 +1686,9 @@ bool Spacegroups<t_mat, t_vec>::Load(const std::string& strFile)
 	}
 
 
+	const std::size_t iNumGroups = groups->size();
+	std::size_t iGroup = 0;
+
 	for(const auto& group : *groups)
 	{
 		// --------------------------------------------------------------------
@@ -368,12 +1820,13 @@ bool Spacegroups<t_mat, t_vec>::Load(const std::string& strFile)
 
 		// --------------------------------------------------------------------
 		// iterate symmetry trafos
-		auto load_ops = [&get_vec, &get_mat](const decltype(opsBNS)& ops)
-		-> std::tuple<std::vector<t_mat>, std::vector<t_vec>, std::vector<t_real>>
+		auto load_ops = [&get_vec, &get_mat, &optab, &sg](const decltype(opsBNS)& ops,
+			Symmetry<t_mat, t_vec>& sym) -> bool
 		{
-			std::vector<t_mat> rotations;
+			std::vector<SymOpExact> exactops;
+			std::vector<t_idx> rotations;
 			std::vector<t_vec> translations;
-			std::vector<t_real> inversions;
+			bool bExact = true;
 
 			for(std::size_t iOp=1; true; ++iOp)
 			{
@@ -397,23 +1850,48 @@ bool Spacegroups<t_mat, t_vec>::Load(const std::string& strFile)
 				t_vec trans = opTrans ? get_vec(*opTrans) : m::zero<t_vec>(3);
 				trans /= div;
 
-				rotations.emplace_back(std::move(rot));
+				// exact operation
+				SymOpExact op;
+				if(bExact && op.from_float<t_mat, t_vec>(rot, trans, inv < t_real(0)))
+					exactops.push_back(op);
+				else
+					bExact = false;
+
+				const t_idx idxRot = optab.Intern(rot);
+				if(idxRot == t_optab::s_invalid)
+					return false;
+
+				rotations.push_back(t_optab::MakeOp(idxRot, inv < t_real(0)));
 				translations.emplace_back(std::move(trans));
-				inversions.push_back(inv);
 			}
 
-			return std::make_tuple(std::move(rotations), std::move(translations), std::move(inversions));
+			if(bExact)
+			{
+				// the floating point operations are a view of the exact ones
+				return sym.SetExactOps(std::move(exactops));
+			}
+			else
+			{
+				std::cerr << "Space group " << sg.m_nrBNS << " has inexact operations." << std::endl;
+				sym.m_ops = std::move(rotations);
+				sym.m_trans = std::move(translations);
+			}
+
+			return true;
 		};
 
+		// all rotations have to fit into the operator table
+		bool bOpsOk = true;
+
 		if(opsBNS)
 		{
 			sg.m_symBNS = std::make_shared<Symmetry<t_mat, t_vec>>();
-			std::tie(sg.m_symBNS->m_rot, sg.m_symBNS->m_trans, sg.m_symBNS->m_inv) = std::move(load_ops(opsBNS));
+			bOpsOk = load_ops(opsBNS, *sg.m_symBNS) && bOpsOk;
 		}
 		if(opsOG)
 		{
 			sg.m_symOG = std::make_shared<Symmetry<t_mat, t_vec>>();
-			std::tie(sg.m_symOG->m_rot, sg.m_symOG->m_trans, sg.m_symOG->m_inv) = std::move(load_ops(opsOG));
+			bOpsOk = load_ops(opsOG, *sg.m_symOG) && bOpsOk;
 		}
 		else
 		{
@@ -422,11 +1900,13 @@ bool Spacegroups<t_mat, t_vec>::Load(const std::string& strFile)
 				// if neither OG nor BNS to OG trafo are defined, OG is identical to BNS
 				sg.m_symOG = sg.m_symBNS;
 			}
-			else
+			else if(sg.m_symBNS)
 			{
 				// calculate OG from BNS using trafo
 				sg.m_symOG = std::make_shared<Symmetry<t_mat, t_vec>>(*sg.m_symBNS);
 				calc_bns2og(sg.m_rotBNS2OG, sg.m_transBNS2OG, &sg.m_symOG->m_trans);
+				if(!sg.m_symOG->CalcExactOps())
+					std::cerr << "Space group " << sg.m_nrBNS << " has inexact OG operations." << std::endl;
 
 				//std::cout << "bns2og trafo for sg " << sg.GetNumber() << std::endl;
 			}
@@ -481,7 +1961,7 @@ bool Spacegroups<t_mat, t_vec>::Load(const std::string& strFile)
 				// if neither OG nor BNS to OG trafo are defined, OG is identical to BNS
 				sg.m_latticeOG = sg.m_latticeBNS;
 			}
-			else
+			else if(sg.m_latticeBNS)
 			{
 				// calculate OG from BNS using trafo
 				sg.m_latticeOG = std::make_shared<std::vector<t_vec>>(*sg.m_latticeBNS);
@@ -493,7 +1973,7 @@ bool Spacegroups<t_mat, t_vec>::Load(const std::string& strFile)
 
 		// --------------------------------------------------------------------
 		// iterate wyckoff positions
-		auto load_wyc = [&get_vec, &get_mat](const decltype(wycBNS)& wycs)
+		auto load_wyc = [&get_vec, &get_mat, &optab, &bOpsOk](const decltype(wycBNS)& wycs)
 		-> std::vector<WycPositions<t_mat, t_vec>>
 		{
 			std::vector<WycPositions<t_mat, t_vec>> vecWyc;
@@ -530,12 +2010,18 @@ bool Spacegroups<t_mat, t_vec>::Load(const std::string& strFile)
 
 					t_real div = opdiv ? *opdiv : t_real(1);
 					t_mat rot = opRot ? get_mat(*opRot) : m::unit<t_mat>(3,3);
-					t_mat rotMag = opRotMag ? get_mat(*opRotMag) : rot;
+					t_idx idxRot = optab.Intern(rot);
+					t_idx idxRotMag = opRotMag ? optab.Intern(get_mat(*opRotMag)) : idxRot;
+					if(idxRot == t_optab::s_invalid || idxRotMag == t_optab::s_invalid)
+					{
+						bOpsOk = false;
+						return vecWyc;
+					}
 					t_vec trans = opTrans ? get_vec(*opTrans) : m::zero<t_vec>(3);
 					trans /= div;
 
-					wycpos.m_rot.emplace_back(std::move(rot));
-					wycpos.m_rotMag.emplace_back(std::move(rotMag));
+					wycpos.m_rot.push_back(idxRot);
+					wycpos.m_rotMag.push_back(idxRotMag);
 					wycpos.m_trans.emplace_back(std::move(trans));
 				}
 
@@ -563,7 +2049,7 @@ bool Spacegroups<t_mat, t_vec>::Load(const std::string& strFile)
 				// if neither OG nor BNS to OG trafo are defined, OG is identical to BNS
 				sg.m_wycOG = sg.m_wycBNS;
 			}
-			else
+			else if(sg.m_wycBNS)
 			{
 				// calculate OG from BNS using trafo
 				sg.m_wycOG = std::make_shared<std::vector<WycPositions<t_mat, t_vec>>>(*sg.m_wycBNS);
@@ -575,7 +2061,24 @@ bool Spacegroups<t_mat, t_vec>::Load(const std::string& strFile)
 		// --------------------------------------------------------------------
 
 
-		m_sgs.emplace_back(std::move(sg));
+		if(!bOpsOk)
+		{
+			std::cerr << "Error: the symmetry operators of space group " << sg.m_nrBNS
+				<< " do not fit into the operator table." << std::endl;
+			return false;
+		}
+
+		if(funcLoaded)
+		{
+			if(!funcLoaded(std::move(sg), iGroup, iNumGroups))
+				return false;
+		}
+		else
+		{
+			m_sgs.emplace_back(std::move(sg));
+		}
+
+		++iGroup;
 	}
 
 
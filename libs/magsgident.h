@@ -0,0 +1,820 @@
+/**
+ * identification of the magnetic space group of a moment configuration
+ * @author Tobias Weber
+ * @date Nov-2018
+ * @license see 'LICENSE.EUPL' file
+ *
+ * The configuration is first reduced to its magnetic cell, i.e. the smallest
+ * (diagonal) multiple of the crystal cell under which it is periodic. Its own
+ * symmetry operations are then found by testing all point group operations of
+ * the operator table, with and without time inversion, using a spatial grid
+ * hash and early rejection. Finally the database groups are pruned by their
+ * structural and magnetic point operations and the remaining candidates are
+ * matched in parallel by solving for the origin shift.
+ */
+
+#ifndef __MAG_SG_IDENT_H__
+#define __MAG_SG_IDENT_H__
+
+#include <vector>
+#include <array>
+#include <tuple>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "magsg.h"
+#include "parallel.h"
+
+
+// ----------------------------------------------------------------------------
+/**
+ * an atom of the configuration
+ */
+template<class t_real>
+struct MagSgIdentSite
+{
+	std::array<t_real, 3> pos{{ 0, 0, 0 }};
+
+	// moment components along the lattice vectors
+	std::array<t_real, 3> mom{{ 0, 0, 0 }};
+
+	// atom type, only atoms of the same type can be mapped onto each other
+	int species = 0;
+};
+
+
+/**
+ * periodic spatial grid hash of the atom positions
+ */
+template<class t_real>
+class MagSgIdentGrid
+{
+public:
+	using t_pos = std::array<t_real, 3>;
+	static constexpr std::size_t s_npos = std::size_t(-1);
+
+private:
+	const std::vector<MagSgIdentSite<t_real>>* m_sites = nullptr;
+	t_pos m_box{{ 1, 1, 1 }};
+	std::array<int, 3> m_bins{{ 1, 1, 1 }};
+	t_real m_eps = 1e-3;
+
+	// atom indices sorted by bins, m_binStart has one entry more than there are bins
+	std::vector<std::size_t> m_binStart;
+	std::vector<std::size_t> m_atoms;
+
+protected:
+	int GetBin(t_real x, std::size_t iDim) const
+	{
+		int bin = int(std::floor(x / m_box[iDim] * t_real(m_bins[iDim])));
+		return ((bin % m_bins[iDim]) + m_bins[iDim]) % m_bins[iDim];
+	}
+
+	std::size_t GetBinIndex(int x, int y, int z) const
+	{
+		return (std::size_t(x)*std::size_t(m_bins[1]) + std::size_t(y))*std::size_t(m_bins[2]) + std::size_t(z);
+	}
+
+public:
+	MagSgIdentGrid() = default;
+	~MagSgIdentGrid() = default;
+
+	/**
+	 * wraps a coordinate into [0, box)
+	 */
+	static t_real Wrap(t_real x, t_real box)
+	{
+		x = std::fmod(x, box);
+		if(x < t_real(0))
+			x += box;
+		if(x >= box)
+			x -= box;
+		return x;
+	}
+
+	/**
+	 * sorts the atoms into bins of about one atom each
+	 */
+	void Create(const std::vector<MagSgIdentSite<t_real>>* sites, const t_pos& box, t_real eps)
+	{
+		m_sites = sites;
+		m_box = box;
+		m_eps = eps;
+
+		const t_real vol = box[0]*box[1]*box[2];
+		const t_real binLen = std::cbrt(vol / t_real(std::max<std::size_t>(sites->size(), 1)));
+		for(std::size_t i=0; i<3; ++i)
+			m_bins[i] = std::clamp(int(box[i] / binLen), 1, 256);
+
+		const std::size_t numBins = std::size_t(m_bins[0]) * std::size_t(m_bins[1]) * std::size_t(m_bins[2]);
+		std::vector<std::size_t> binOfAtom(sites->size());
+		m_binStart.assign(numBins + 1, 0);
+
+		for(std::size_t iAtom=0; iAtom<sites->size(); ++iAtom)
+		{
+			const t_pos& pos = (*sites)[iAtom].pos;
+			binOfAtom[iAtom] = GetBinIndex(GetBin(pos[0], 0), GetBin(pos[1], 1), GetBin(pos[2], 2));
+			++m_binStart[binOfAtom[iAtom] + 1];
+		}
+
+		for(std::size_t iBin=0; iBin<numBins; ++iBin)
+			m_binStart[iBin + 1] += m_binStart[iBin];
+
+		std::vector<std::size_t> fill(m_binStart.begin(), m_binStart.end()-1);
+		m_atoms.resize(sites->size());
+		for(std::size_t iAtom=0; iAtom<sites->size(); ++iAtom)
+			m_atoms[fill[binOfAtom[iAtom]]++] = iAtom;
+	}
+
+	/**
+	 * index of the atom at the given position (modulo the box), s_npos if there is none
+	 */
+	std::size_t Find(const t_pos& pos) const
+	{
+		int lo[3], hi[3];
+		for(std::size_t i=0; i<3; ++i)
+		{
+			// only look into the neighbouring bins if the position is near a bin border
+			const t_real x = Wrap(pos[i], m_box[i]);
+			const t_real binLen = m_box[i] / t_real(m_bins[i]);
+			const int bin = std::min(int(x / binLen), m_bins[i]-1);
+			lo[i] = (x - t_real(bin)*binLen < m_eps) ? bin-1 : bin;
+			hi[i] = (t_real(bin+1)*binLen - x < m_eps) ? bin+1 : bin;
+			if(hi[i] - lo[i] + 1 > m_bins[i])
+				hi[i] = lo[i] + m_bins[i] - 1;
+		}
+
+		for(int x=lo[0]; x<=hi[0]; ++x)
+		for(int y=lo[1]; y<=hi[1]; ++y)
+		for(int z=lo[2]; z<=hi[2]; ++z)
+		{
+			const std::size_t iBin = GetBinIndex(
+				(x + m_bins[0]) % m_bins[0], (y + m_bins[1]) % m_bins[1], (z + m_bins[2]) % m_bins[2]);
+
+			for(std::size_t idx=m_binStart[iBin]; idx<m_binStart[iBin+1]; ++idx)
+			{
+				const std::size_t iAtom = m_atoms[idx];
+				const t_pos& pos2 = (*m_sites)[iAtom].pos;
+
+				bool bSame = true;
+				for(std::size_t i=0; i<3; ++i)
+				{
+					t_real diff = pos[i] - pos2[i];
+					diff -= m_box[i] * std::round(diff / m_box[i]);
+					if(std::abs(diff) > m_eps)
+					{
+						bSame = false;
+						break;
+					}
+				}
+
+				if(bSame)
+					return iAtom;
+			}
+		}
+
+		return s_npos;
+	}
+};
+
+
+/**
+ * an identified magnetic space group
+ */
+template<class t_mat, class t_vec>
+struct MagSgIdentMatch
+{
+	const Spacegroup<t_mat, t_vec>* sg = nullptr;
+
+	// setting transformation: the magnetic cell in multiples of the crystal cell
+	// and the position of the group's origin in the magnetic cell of the configuration
+	std::array<int, 3> cell{{ 1, 1, 1 }};
+	t_vec origin;
+
+	// number of symmetry operations per magnetic cell, including centring
+	std::size_t order = 0;
+};
+// ----------------------------------------------------------------------------
+
+
+
+
+// ----------------------------------------------------------------------------
+/**
+ * magnetic space group identification
+ */
+template<class t_mat, class t_vec>
+requires m::is_mat<t_mat> && m::is_vec<t_vec>
+class MagSgIdentifier
+{
+public:
+	using t_real = typename t_vec::value_type;
+	using t_site = MagSgIdentSite<t_real>;
+	using t_pos = typename MagSgIdentGrid<t_real>::t_pos;
+	using t_match = MagSgIdentMatch<t_mat, t_vec>;
+	using t_optab = SymOpTable<t_mat>;
+	using t_imat = std::array<int, 9>;
+
+private:
+	// input configuration
+	std::vector<t_site> m_sites;
+	t_real m_epsPos = 1e-3, m_epsMom = 1e-3;
+	unsigned int m_iNumThreads = 0;
+
+	// configuration reduced to the magnetic cell
+	std::array<int, 3> m_cell{{ 1, 1, 1 }};
+	std::vector<t_site> m_cellSites;
+	MagSgIdentGrid<t_real> m_grid;
+
+	// point operations of the operator table
+	std::vector<t_imat> m_rots;
+	std::vector<int> m_dets;
+
+	// translations of the configuration's symmetry operations for each point operation (index 2*op + time inversion)
+	std::vector<std::vector<t_pos>> m_symTrans;
+	std::uint64_t m_maskStruct = 0;
+	std::uint64_t m_maskMag[2] = { 0, 0 };
+
+protected:
+	/**
+	 * does the operation {R|t} (with optional time inversion) map the atoms onto each other?
+	 */
+	static bool IsInvariant(const std::vector<t_site>& sites, const MagSgIdentGrid<t_real>& grid,
+		const t_imat& rot, int det, bool bTimeInv, const t_pos& trans, t_real epsMom)
+	{
+		const t_real momSign = t_real(bTimeInv ? -det : det);
+
+		for(const t_site& site : sites)
+		{
+			t_pos pos, mom;
+			for(std::size_t i=0; i<3; ++i)
+			{
+				pos[i] = trans[i];
+				mom[i] = 0;
+				for(std::size_t j=0; j<3; ++j)
+				{
+					pos[i] += t_real(rot[i*3 + j]) * site.pos[j];
+					mom[i] += t_real(rot[i*3 + j]) * site.mom[j];
+				}
+				mom[i] *= momSign;
+			}
+
+			// early rejection at the first atom which is not mapped
+			const std::size_t iAtom = grid.Find(pos);
+			if(iAtom == MagSgIdentGrid<t_real>::s_npos)
+				return false;
+
+			const t_site& site2 = sites[iAtom];
+			if(site2.species != site.species)
+				return false;
+			for(std::size_t i=0; i<3; ++i)
+				if(std::abs(site2.mom[i] - mom[i]) > epsMom)
+					return false;
+		}
+
+		return true;
+	}
+
+	/**
+	 * is the moment non-zero?
+	 */
+	bool IsMagnetic(const t_site& site) const
+	{
+		return std::abs(site.mom[0]) > m_epsMom || std::abs(site.mom[1]) > m_epsMom || std::abs(site.mom[2]) > m_epsMom;
+	}
+
+	/**
+	 * reduces the configuration to its magnetic cell
+	 */
+	void ReduceCell()
+	{
+		// periodic box of the configuration in crystal cells
+		t_pos box{{ 1, 1, 1 }};
+		for(const t_site& site : m_sites)
+			for(std::size_t i=0; i<3; ++i)
+				box[i] = std::max(box[i], std::ceil(site.pos[i] - m_epsPos));
+
+		std::vector<t_site> sites = m_sites;
+		for(t_site& site : sites)
+			for(std::size_t i=0; i<3; ++i)
+				site.pos[i] = MagSgIdentGrid<t_real>::Wrap(site.pos[i], box[i]);
+
+		MagSgIdentGrid<t_real> grid;
+		grid.Create(&sites, box, m_epsPos);
+
+		// smallest pure lattice translation along each axis which leaves the configuration invariant
+		const t_imat ident{{ 1,0,0, 0,1,0, 0,0,1 }};
+		for(std::size_t iDim=0; iDim<3; ++iDim)
+		{
+			const int iBox = int(box[iDim]);
+			m_cell[iDim] = iBox;
+
+			for(int iCell=1; iCell<iBox; ++iCell)
+			{
+				if(iBox % iCell != 0)
+					continue;
+
+				t_pos trans{{ 0, 0, 0 }};
+				trans[iDim] = t_real(iCell);
+				if(IsInvariant(sites, grid, ident, 1, false, trans, m_epsMom))
+				{
+					m_cell[iDim] = iCell;
+					break;
+				}
+			}
+		}
+
+		// keep the atoms of the first magnetic cell and transform them to its basis
+		m_cellSites.clear();
+		for(t_site site : sites)
+		{
+			bool bInCell = true;
+			for(std::size_t i=0; i<3; ++i)
+			{
+				if(MagSgIdentGrid<t_real>::Wrap(site.pos[i] + m_epsPos, box[i]) >= t_real(m_cell[i]))
+					bInCell = false;
+			}
+			if(!bInCell)
+				continue;
+
+			for(std::size_t i=0; i<3; ++i)
+			{
+				site.pos[i] = MagSgIdentGrid<t_real>::Wrap(site.pos[i] / t_real(m_cell[i]), 1);
+				site.mom[i] /= t_real(m_cell[i]);
+			}
+			m_cellSites.emplace_back(std::move(site));
+		}
+
+		m_grid.Create(&m_cellSites, t_pos{{ 1, 1, 1 }}, m_epsPos);
+	}
+
+	/**
+	 * finds the symmetry operations of the configuration in its magnetic cell
+	 */
+	void FindSymmetries()
+	{
+		const auto& optab = t_optab::GetTable();
+		const std::size_t numOps = std::min<std::size_t>(optab.GetNumPointOps(), 64);
+
+		m_rots.resize(numOps);
+		m_dets.resize(numOps);
+		for(std::size_t iOp=0; iOp<numOps; ++iOp)
+		{
+			const t_mat& rot = optab.GetMatrix(typename t_optab::t_idx(iOp));
+			for(std::size_t i=0; i<3; ++i)
+				for(std::size_t j=0; j<3; ++j)
+					m_rots[iOp][i*3 + j] = int(std::round(rot(i,j)));
+			m_dets[iOp] = optab.GetDeterminant(typename t_optab::t_idx(iOp));
+		}
+
+		m_symTrans.clear();
+		m_symTrans.resize(numOps*2);
+		m_maskStruct = 0;
+		m_maskMag[0] = m_maskMag[1] = 0;
+		if(m_cellSites.size() == 0)
+			return;
+
+		// reference atom from the smallest class of equivalent atoms
+		std::size_t iRef = 0, iRefCount = m_cellSites.size() + 1;
+		for(std::size_t iAtom=0; iAtom<m_cellSites.size(); ++iAtom)
+		{
+			std::size_t iCount = 0;
+			for(const t_site& site : m_cellSites)
+			{
+				if(site.species == m_cellSites[iAtom].species && IsMagnetic(site) == IsMagnetic(m_cellSites[iAtom]))
+					++iCount;
+			}
+
+			if(iCount < iRefCount)
+			{
+				iRef = iAtom;
+				iRefCount = iCount;
+			}
+		}
+		const t_site& siteRef = m_cellSites[iRef];
+
+		// each point operation, with and without time inversion, is a candidate
+		m::run_parallel(numOps*2, [this, &siteRef](std::size_t iCand)
+		{
+			const std::size_t iOp = iCand / 2;
+			const bool bTimeInv = (iCand % 2) != 0;
+			const t_imat& rot = m_rots[iOp];
+
+			// the reference atom has to be mapped onto an atom of its class
+			for(const t_site& site : m_cellSites)
+			{
+				if(site.species != siteRef.species || IsMagnetic(site) != IsMagnetic(siteRef))
+					continue;
+
+				t_pos trans;
+				for(std::size_t i=0; i<3; ++i)
+				{
+					trans[i] = site.pos[i];
+					for(std::size_t j=0; j<3; ++j)
+						trans[i] -= t_real(rot[i*3 + j]) * siteRef.pos[j];
+					trans[i] = MagSgIdentGrid<t_real>::Wrap(trans[i], 1);
+				}
+
+				if(IsInvariant(m_cellSites, m_grid, rot, m_dets[iOp], bTimeInv, trans, m_epsMom))
+					m_symTrans[iCand].push_back(trans);
+			}
+		}, m_iNumThreads);
+
+		for(std::size_t iOp=0; iOp<numOps; ++iOp)
+		{
+			for(std::size_t iTimeInv=0; iTimeInv<2; ++iTimeInv)
+			{
+				if(m_symTrans[iOp*2 + iTimeInv].size() == 0)
+					continue;
+
+				m_maskStruct |= std::uint64_t(1) << iOp;
+				m_maskMag[iTimeInv] |= std::uint64_t(1) << iOp;
+			}
+		}
+	}
+
+	/**
+	 * is the translation (modulo the cell) one of the configuration's translations for the operation?
+	 */
+	bool HasTranslation(std::size_t iCand, const t_pos& trans) const
+	{
+		for(const t_pos& trans2 : m_symTrans[iCand])
+		{
+			bool bSame = true;
+			for(std::size_t i=0; i<3; ++i)
+			{
+				t_real diff = trans[i] - trans2[i];
+				diff -= std::round(diff);
+				if(std::abs(diff) > m_epsPos)
+				{
+					bSame = false;
+					break;
+				}
+			}
+
+			if(bSame)
+				return true;
+		}
+
+		return false;
+	}
+
+	/**
+	 * tries to match a database group to the configuration's symmetries by solving for the origin shift
+	 * returns [match, ok]
+	 */
+	std::tuple<t_match, bool> MatchGroup(const Spacegroup<t_mat, t_vec>& sg) const
+	{
+		t_match match;
+		match.sg = &sg;
+		match.cell = m_cell;
+		match.origin = m::zero<t_vec>(3);
+
+		const Symmetry<t_mat, t_vec>* sym = sg.GetSymmetries(true);
+		const auto& opidx = sym->GetOperatorIndices();
+		const auto& transs = sym->GetTranslations();
+
+		// all centring vectors of the group have to be pure translations of the configuration
+		std::size_t iNumCentring = 1;
+		if(const std::vector<t_vec>* latt = sg.GetLattice(true); latt)
+		{
+			for(const t_vec& vec : *latt)
+			{
+				if(!HasTranslation(GetIdentityCandidate(), t_pos{{ vec[0], vec[1], vec[2] }}))
+					return std::make_tuple(match, false);
+			}
+
+			SymOpLattice lattExact;
+			if(lattExact.SetVectors(*latt))
+			{
+				const auto& basis = lattExact.GetBasis();
+				const int vol = basis[0][0] * basis[1][1] * basis[2][2];
+				const int cellVol = SymOpExact::s_denom * SymOpExact::s_denom * SymOpExact::s_denom;
+				if(vol > 0 && vol <= cellVol)
+					iNumCentring = std::size_t(cellVol / vol);
+			}
+		}
+
+		// equations (1-R) p = t_config - t_group (mod 1) for the origin shift p
+		struct t_row
+		{
+			std::array<int, 3> a;
+			std::size_t iOp;
+			std::size_t iComp;
+		};
+		std::vector<t_row> rows;
+		std::vector<std::array<int, 3>> vecs;
+
+		// rank of integer row vectors
+		auto rank = [](const std::vector<std::array<int, 3>>& vecs) -> int
+		{
+			int iRank = 0;
+			for(const auto& a : vecs)
+				if(a[0] || a[1] || a[2])
+					iRank = 1;
+
+			for(std::size_t i=0; i<vecs.size(); ++i)
+			{
+				for(std::size_t j=i+1; j<vecs.size(); ++j)
+				{
+					const auto& a = vecs[i];
+					const auto& b = vecs[j];
+					if(a[1]*b[2] - a[2]*b[1] || a[2]*b[0] - a[0]*b[2] || a[0]*b[1] - a[1]*b[0])
+						iRank = 2;
+
+					for(std::size_t k=j+1; k<vecs.size(); ++k)
+					{
+						const auto& c = vecs[k];
+						if(a[0]*(b[1]*c[2] - b[2]*c[1]) - a[1]*(b[0]*c[2] - b[2]*c[0])
+							+ a[2]*(b[0]*c[1] - b[1]*c[0]))
+							return 3;
+					}
+				}
+			}
+
+			return iRank;
+		};
+
+		for(std::size_t iOp=0; iOp<opidx.size() && vecs.size()<3; ++iOp)
+		{
+			const t_imat& rot = m_rots[t_optab::GetRotIndex(opidx[iOp])];
+
+			for(std::size_t iComp=0; iComp<3 && vecs.size()<3; ++iComp)
+			{
+				std::array<int, 3> a;
+				for(std::size_t j=0; j<3; ++j)
+					a[j] = (iComp==j ? 1 : 0) - rot[iComp*3 + j];
+
+				vecs.push_back(a);
+				if(rank(vecs) == int(vecs.size()))
+					rows.push_back(t_row{ a, iOp, iComp });
+				else
+					vecs.pop_back();
+			}
+		}
+
+		// distinct operations used by the equations
+		std::vector<std::size_t> eqOps;
+		for(const t_row& row : rows)
+			if(std::find(eqOps.begin(), eqOps.end(), row.iOp) == eqOps.end())
+				eqOps.push_back(row.iOp);
+
+		// complete the system with p_i = 0 for the undetermined (polar) directions
+		std::vector<std::array<int, 3>> completion;
+		for(std::size_t iDim=0; iDim<3 && vecs.size()<3; ++iDim)
+		{
+			std::array<int, 3> a{{ 0, 0, 0 }};
+			a[iDim] = 1;
+
+			vecs.push_back(a);
+			if(rank(vecs) == int(vecs.size()))
+				completion.push_back(a);
+			else
+				vecs.pop_back();
+		}
+
+		// verifies an origin shift
+		auto check_origin = [this, &opidx, &transs](const t_pos& p) -> bool
+		{
+			for(std::size_t iOp=0; iOp<opidx.size(); ++iOp)
+			{
+				const std::size_t iRot = t_optab::GetRotIndex(opidx[iOp]);
+				const t_imat& rot = m_rots[iRot];
+
+				// t_config = t_group + (1-R) p
+				t_pos trans;
+				for(std::size_t i=0; i<3; ++i)
+				{
+					trans[i] = transs[iOp][i] + p[i];
+					for(std::size_t j=0; j<3; ++j)
+						trans[i] -= t_real(rot[i*3 + j]) * p[j];
+				}
+
+				if(!HasTranslation(iRot*2 + (t_optab::IsTimeInverted(opidx[iOp]) ? 1 : 0), trans))
+					return false;
+			}
+			return true;
+		};
+
+		// iterate over the choices of the configuration's translations for the equation operations
+		std::vector<std::size_t> choice(eqOps.size(), 0);
+		while(true)
+		{
+			// right-hand sides without the integer parts
+			std::vector<t_real> rhs;
+			std::vector<int> nMin, nMax;
+			for(const t_row& row : rows)
+			{
+				const std::size_t iChoice = std::find(eqOps.begin(), eqOps.end(), row.iOp) - eqOps.begin();
+				const std::size_t iCand = t_optab::GetRotIndex(opidx[row.iOp])*2
+					+ (t_optab::IsTimeInverted(opidx[row.iOp]) ? 1 : 0);
+				const t_real delta = m_symTrans[iCand][choice[iChoice]][row.iComp] - transs[row.iOp][row.iComp];
+				rhs.push_back(delta);
+
+				// range of a.p for p in [0, 1)
+				int lo = 0, hi = 0;
+				for(int a : row.a)
+					(a < 0 ? lo : hi) += a;
+				nMin.push_back(int(std::floor(t_real(lo) - delta)) - 1);
+				nMax.push_back(int(std::ceil(t_real(hi) - delta)) + 1);
+			}
+
+			// iterate the integer parts
+			std::vector<int> n = nMin;
+			while(true)
+			{
+				t_real A[3][3], b[3];
+				std::size_t iRow = 0;
+				for(; iRow<rows.size(); ++iRow)
+				{
+					for(std::size_t j=0; j<3; ++j)
+						A[iRow][j] = t_real(rows[iRow].a[j]);
+					b[iRow] = rhs[iRow] + t_real(n[iRow]);
+				}
+				for(const auto& c : completion)
+				{
+					for(std::size_t j=0; j<3; ++j)
+						A[iRow][j] = t_real(c[j]);
+					b[iRow] = 0;
+					++iRow;
+				}
+
+				// cramer's rule
+				auto det3 = [](const t_real M[3][3]) -> t_real
+				{
+					return M[0][0]*(M[1][1]*M[2][2] - M[1][2]*M[2][1])
+						- M[0][1]*(M[1][0]*M[2][2] - M[1][2]*M[2][0])
+						+ M[0][2]*(M[1][0]*M[2][1] - M[1][1]*M[2][0]);
+				};
+
+				const t_real det = det3(A);
+				t_pos p{{ 0, 0, 0 }};
+				for(std::size_t iCol=0; iCol<3; ++iCol)
+				{
+					t_real Ai[3][3];
+					for(std::size_t i=0; i<3; ++i)
+						for(std::size_t j=0; j<3; ++j)
+							Ai[i][j] = (j == iCol) ? b[i] : A[i][j];
+					p[iCol] = MagSgIdentGrid<t_real>::Wrap(det3(Ai) / det, 1);
+				}
+
+				if(check_origin(p))
+				{
+					match.origin = m::create<t_vec>({ p[0], p[1], p[2] });
+					match.order = opidx.size() * iNumCentring;
+					return std::make_tuple(match, true);
+				}
+
+				// next integer parts
+				std::size_t iDigit = 0;
+				for(; iDigit<n.size(); ++iDigit)
+				{
+					if(++n[iDigit] <= nMax[iDigit])
+						break;
+					n[iDigit] = nMin[iDigit];
+				}
+				if(iDigit == n.size())
+					break;
+			}
+
+			// next choice of translations
+			std::size_t iDigit = 0;
+			for(; iDigit<choice.size(); ++iDigit)
+			{
+				const std::size_t iOp = eqOps[iDigit];
+				const std::size_t iCand = t_optab::GetRotIndex(opidx[iOp])*2
+					+ (t_optab::IsTimeInverted(opidx[iOp]) ? 1 : 0);
+				if(++choice[iDigit] < m_symTrans[iCand].size())
+					break;
+				choice[iDigit] = 0;
+			}
+			if(iDigit == choice.size())
+				break;
+		}
+
+		return std::make_tuple(match, false);
+	}
+
+	/**
+	 * candidate index of the identity operation without time inversion
+	 */
+	std::size_t GetIdentityCandidate() const
+	{
+		for(std::size_t iOp=0; iOp<m_rots.size(); ++iOp)
+			if(m_rots[iOp] == t_imat{{ 1,0,0, 0,1,0, 0,0,1 }})
+				return iOp*2;
+		return 0;
+	}
+
+public:
+	MagSgIdentifier() = default;
+	~MagSgIdentifier() = default;
+
+	/**
+	 * adds an atom, the position is given in fractional coordinates of the crystal cell
+	 * and the moment in components along the crystal lattice vectors
+	 */
+	void AddSite(const t_vec& pos, const t_vec& mom, int species = 0)
+	{
+		t_site site;
+		for(std::size_t i=0; i<3; ++i)
+		{
+			site.pos[i] = pos[i];
+			site.mom[i] = mom[i];
+		}
+		site.species = species;
+
+		m_sites.emplace_back(std::move(site));
+	}
+
+	void ClearSites() { m_sites.clear(); }
+	const std::vector<t_site>& GetSites() const { return m_sites; }
+
+	void SetTolerances(t_real epsPos, t_real epsMom) { m_epsPos = epsPos; m_epsMom = epsMom; }
+	void SetNumThreads(unsigned int iNumThreads) { m_iNumThreads = iNumThreads; }
+
+	// magnetic cell and atoms of the configuration after Identify
+	const std::array<int, 3>& GetMagneticCell() const { return m_cell; }
+	const std::vector<t_site>& GetCellSites() const { return m_cellSites; }
+
+	/**
+	 * number of the configuration's symmetry operations per magnetic cell
+	 */
+	std::size_t GetNumSymmetries() const
+	{
+		std::size_t iNum = 0;
+		for(const auto& trans : m_symTrans)
+			iNum += trans.size();
+		return iNum;
+	}
+
+	/**
+	 * finds all database groups (in the BNS setting) which leave the configuration invariant
+	 * returns the matches, sorted by decreasing order, i.e. the highest-symmetry group first
+	 */
+	std::vector<t_match> Identify(const Spacegroups<t_mat, t_vec>& sgs)
+	{
+		std::vector<t_match> matches;
+
+		ReduceCell();
+		FindSymmetries();
+
+		// prune by the structural and then by the magnetic point operations
+		std::vector<const Spacegroup<t_mat, t_vec>*> candidates;
+		for(const auto& sg : *sgs.GetSpacegroups())
+		{
+			const Symmetry<t_mat, t_vec>* sym = sg.GetSymmetries(true);
+			if(!sym)
+				continue;
+
+			std::uint64_t maskStruct = 0;
+			std::uint64_t maskMag[2] = { 0, 0 };
+			bool bPointOps = true;
+			for(auto op : sym->GetOperatorIndices())
+			{
+				const std::size_t iRot = t_optab::GetRotIndex(op);
+				if(iRot >= m_rots.size())
+				{
+					bPointOps = false;
+					break;
+				}
+
+				maskStruct |= std::uint64_t(1) << iRot;
+				maskMag[t_optab::IsTimeInverted(op) ? 1 : 0] |= std::uint64_t(1) << iRot;
+			}
+
+			if(!bPointOps || (maskStruct & ~m_maskStruct))
+				continue;
+			if((maskMag[0] & ~m_maskMag[0]) || (maskMag[1] & ~m_maskMag[1]))
+				continue;
+
+			candidates.push_back(&sg);
+		}
+
+		// match the remaining candidates
+		std::vector<t_match> results(candidates.size());
+		std::vector<char> oks(candidates.size(), 0);
+		m::run_parallel(candidates.size(), [this, &candidates, &results, &oks](std::size_t iCand)
+		{
+			auto [match, ok] = MatchGroup(*candidates[iCand]);
+			results[iCand] = std::move(match);
+			oks[iCand] = ok ? 1 : 0;
+		}, m_iNumThreads);
+
+		for(std::size_t iCand=0; iCand<candidates.size(); ++iCand)
+			if(oks[iCand])
+				matches.emplace_back(std::move(results[iCand]));
+
+		std::stable_sort(matches.begin(), matches.end(), [](const t_match& m1, const t_match& m2) -> bool
+		{
+			return m1.order > m2.order;
+		});
+
+		return matches;
+	}
+};
+// ----------------------------------------------------------------------------
+
+
+#endif
@@ -0,0 +1,363 @@
+/**
+ * search index over magnetic space groups
+ * @author Tobias Weber
+ * @date Nov-2018
+ * @license see 'LICENSE.EUPL' file
+ */
+
+#ifndef __MAG_SG_SEARCH_H__
+#define __MAG_SG_SEARCH_H__
+
+#include <vector>
+#include <array>
+#include <string>
+#include <set>
+#include <unordered_map>
+#include <algorithm>
+#include <iterator>
+#include <cstdint>
+#include <cctype>
+#include <cmath>
+
+#include "magsg.h"
+
+
+// ----------------------------------------------------------------------------
+/**
+ * derived properties of a space group
+ */
+template<class t_mat, class t_vec>
+requires m::is_mat<t_mat> && m::is_vec<t_vec>
+struct MagSgProperties
+{
+	using t_real = typename t_mat::value_type;
+
+	std::string crystalsys;
+	bool centrosymmetric = false;
+
+	// 1: no time inversion, 2: grey group, 3: black-white, 4: black-white with anti-translations
+	int type = 1;
+
+
+	/**
+	 * determines the properties from the BNS operations
+	 * the crystal system follows from the orders of the proper rotations det(R)*R,
+	 * which are given by their traces and do not depend on the basis
+	 */
+	static MagSgProperties<t_mat, t_vec> Get(const Spacegroup<t_mat, t_vec>& sg)
+	{
+		MagSgProperties<t_mat, t_vec> props;
+
+		const auto* sym = sg.GetSymmetries(true);
+		if(!sym)
+			return props;
+
+		const auto rots = sym->GetRotations();
+		const auto invs = sym->GetInversions();
+		const auto& transs = sym->GetTranslations();
+
+		std::set<std::array<int, 9>> proper2, proper3;
+		bool bHas4 = false, bHas6 = false;
+		bool bGrey = false, bAntiTrans = false, bTimeInv = false;
+
+		for(std::size_t iOp=0; iOp<rots.size(); ++iOp)
+		{
+			const t_mat& rot = rots[iOp];
+
+			std::array<int, 9> irot;
+			for(std::size_t i=0; i<3; ++i)
+				for(std::size_t j=0; j<3; ++j)
+					irot[i*3 + j] = int(std::round(rot(i,j)));
+
+			const int det =
+				irot[0]*(irot[4]*irot[8] - irot[5]*irot[7])
+				- irot[1]*(irot[3]*irot[8] - irot[5]*irot[6])
+				+ irot[2]*(irot[3]*irot[7] - irot[4]*irot[6]);
+			int trace = irot[0] + irot[4] + irot[8];
+
+			if(det < 0)
+			{
+				for(int& elem : irot)
+					elem = -elem;
+				trace = -trace;
+			}
+
+			// inversion
+			if(det < 0 && trace == 3)
+				props.centrosymmetric = true;
+
+			// orders of the proper rotations: trace = 1 + 2*cos(2*pi/n)
+			switch(trace)
+			{
+				case -1: proper2.insert(irot); break;
+				case 0: proper3.insert(irot); break;
+				case 1: bHas4 = true; break;
+				case 2: bHas6 = true; break;
+			}
+
+			// time inversion
+			if(invs[iOp] < t_real(0))
+			{
+				bTimeInv = true;
+
+				if(det > 0 && trace == 3)
+				{
+					bool bZeroTrans = true;
+					for(std::size_t i=0; i<3; ++i)
+					{
+						if(std::abs(transs[iOp][i] - std::round(transs[iOp][i])) > t_real(1e-6))
+							bZeroTrans = false;
+					}
+
+					if(bZeroTrans)
+						bGrey = true;
+					else
+						bAntiTrans = true;
+				}
+			}
+		}
+
+		if(proper3.size() >= 8)
+			props.crystalsys = "cubic";
+		else if(bHas6)
+			props.crystalsys = "hexagonal";
+		else if(proper3.size())
+			props.crystalsys = "trigonal";
+		else if(bHas4)
+			props.crystalsys = "tetragonal";
+		else if(proper2.size() >= 3)
+			props.crystalsys = "orthorhombic";
+		else if(proper2.size())
+			props.crystalsys = "monoclinic";
+		else
+			props.crystalsys = "triclinic";
+
+		if(bGrey)
+			props.type = 2;
+		else if(bAntiTrans)
+			props.type = 4;
+		else if(bTimeInv)
+			props.type = 3;
+
+		return props;
+	}
+};
+// ----------------------------------------------------------------------------
+
+
+
+
+// ----------------------------------------------------------------------------
+/**
+ * n-gram index over the numbers, symbols and properties of space groups
+ *
+ * the searchable fields of each group are normalised and all their 1-, 2- and 3-grams
+ * are indexed; a query token is looked up via its own n-gram (short tokens) or by
+ * intersecting the lists of its trigrams and verifying the candidates (long tokens).
+ * groups can be added incrementally, their indices are the order of addition.
+ */
+template<class t_mat, class t_vec>
+requires m::is_mat<t_mat> && m::is_vec<t_vec>
+class MagSgSearch
+{
+public:
+	using t_idx = std::uint32_t;
+
+	// separates the fields of a group, n-grams never span it
+	static constexpr char s_sep = '|';
+
+private:
+	// normalised searchable text of each group
+	std::vector<std::string> m_docs;
+
+	// sorted group indices for each n-gram
+	std::unordered_map<std::uint32_t, std::vector<t_idx>> m_grams;
+
+protected:
+	static std::uint32_t GetKey(const char* str, std::size_t len)
+	{
+		std::uint32_t key = 0;
+		for(std::size_t i=0; i<len; ++i)
+			key |= std::uint32_t(static_cast<unsigned char>(str[i])) << (8*i);
+		return key;
+	}
+
+	static const std::vector<t_idx>* GetEmpty()
+	{
+		static const std::vector<t_idx> empty;
+		return &empty;
+	}
+
+	const std::vector<t_idx>* GetGram(const char* str, std::size_t len) const
+	{
+		auto iter = m_grams.find(GetKey(str, len));
+		return iter == m_grams.end() ? GetEmpty() : &iter->second;
+	}
+
+	/**
+	 * groups containing a normalised token
+	 */
+	std::vector<t_idx> FindToken(const std::string& tok) const
+	{
+		if(tok.length() <= 3)
+			return *GetGram(tok.data(), tok.length());
+
+		// trigram lists, shortest first
+		std::vector<const std::vector<t_idx>*> lists;
+		for(std::size_t i=0; i+3<=tok.length(); ++i)
+			lists.push_back(GetGram(tok.data() + i, 3));
+		std::sort(lists.begin(), lists.end(),
+			[](const auto* list1, const auto* list2) -> bool { return list1->size() < list2->size(); });
+
+		std::vector<t_idx> result = *lists[0], isect;
+		for(std::size_t iList=1; iList<lists.size() && result.size(); ++iList)
+		{
+			isect.clear();
+			std::set_intersection(result.begin(), result.end(),
+				lists[iList]->begin(), lists[iList]->end(), std::back_inserter(isect));
+			std::swap(result, isect);
+		}
+
+		// the trigrams can occur at different positions
+		result.erase(std::remove_if(result.begin(), result.end(),
+			[this, &tok](t_idx idx) -> bool { return m_docs[idx].find(tok) == std::string::npos; }),
+			result.end());
+
+		return result;
+	}
+
+public:
+	MagSgSearch() = default;
+	~MagSgSearch() = default;
+
+	/**
+	 * lower case without white space and separators
+	 */
+	static std::string Normalise(const std::string& str)
+	{
+		std::string norm;
+		norm.reserve(str.length());
+
+		for(char c : str)
+		{
+			if(std::isspace(static_cast<unsigned char>(c)) || c == s_sep)
+				continue;
+			norm.push_back(char(std::tolower(static_cast<unsigned char>(c))));
+		}
+
+		return norm;
+	}
+
+	/**
+	 * searchable fields of a group
+	 */
+	static std::vector<std::string> GetFields(const Spacegroup<t_mat, t_vec>& sg)
+	{
+		const auto props = MagSgProperties<t_mat, t_vec>::Get(sg);
+
+		std::vector<std::string> fields =
+		{
+			sg.GetNumber(true), sg.GetNumber(false),
+			sg.GetName(true), sg.GetName(false),
+			props.crystalsys,
+			props.centrosymmetric ? "centrosymmetric" : "acentric",
+			"type" + std::to_string(props.type),
+		};
+
+		if(props.type == 2)
+			fields.push_back("grey");
+
+		return fields;
+	}
+
+	void Clear()
+	{
+		m_docs.clear();
+		m_grams.clear();
+	}
+
+	std::size_t GetSize() const { return m_docs.size(); }
+
+	/**
+	 * indexes a group, returns its index
+	 */
+	t_idx Add(const Spacegroup<t_mat, t_vec>& sg)
+	{
+		const t_idx idx = t_idx(m_docs.size());
+
+		std::string doc;
+		for(const std::string& field : GetFields(sg))
+		{
+			const std::string norm = Normalise(field);
+			if(norm == "")
+				continue;
+
+			for(std::size_t len=1; len<=3; ++len)
+			{
+				for(std::size_t i=0; i+len<=norm.length(); ++i)
+				{
+					auto& list = m_grams[GetKey(norm.data() + i, len)];
+					if(list.empty() || list.back() != idx)
+						list.push_back(idx);
+				}
+			}
+
+			doc += s_sep;
+			doc += norm;
+		}
+
+		m_docs.emplace_back(std::move(doc));
+		return idx;
+	}
+
+	/**
+	 * indices of the groups matching all white-space separated tokens of the query
+	 */
+	std::vector<t_idx> Find(const std::string& query) const
+	{
+		std::vector<std::string> toks;
+		boost::split(toks, query, [](char c) -> bool { return std::isspace(static_cast<unsigned char>(c)); },
+			boost::token_compress_on);
+
+		std::vector<t_idx> result, isect;
+		bool bFirst = true;
+
+		for(const std::string& rawtok : toks)
+		{
+			const std::string tok = Normalise(rawtok);
+			if(tok == "")
+				continue;
+
+			if(bFirst)
+			{
+				result = FindToken(tok);
+				bFirst = false;
+			}
+			else
+			{
+				const std::vector<t_idx> found = FindToken(tok);
+				isect.clear();
+				std::set_intersection(result.begin(), result.end(),
+					found.begin(), found.end(), std::back_inserter(isect));
+				std::swap(result, isect);
+			}
+
+			if(result.size() == 0)
+				break;
+		}
+
+		// empty query matches everything
+		if(bFirst)
+		{
+			result.resize(m_docs.size());
+			for(std::size_t i=0; i<result.size(); ++i)
+				result[i] = t_idx(i);
+		}
+
+		return result;
+	}
+};
+// ----------------------------------------------------------------------------
+
+
+#endif
@@ -0,0 +1,509 @@
+/**
+ * wyckoff site lookup and orbit generation
+ * @author Tobias Weber
+ * @date Nov-2018
+ * @license see 'LICENSE.EUPL' file
+ */
+
+#ifndef __MAG_WYC_H__
+#define __MAG_WYC_H__
+
+#include <vector>
+#include <array>
+#include <string>
+#include <tuple>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "magsg.h"
+#include "parallel.h"
+
+
+// ----------------------------------------------------------------------------
+/**
+ * result of a wyckoff site lookup
+ */
+template<class t_vec>
+struct WycSiteMatch
+{
+	// index into the space group's wyckoff positions, -1 if no site was found
+	int iSite = -1;
+	std::string letter;
+	int mult = 0;
+
+	// orbit entry of the site which matched the position
+	std::size_t iEntry = 0;
+
+	// free parameters (x, y, z) of the entry in [0, 1), parameters not occurring in the entry are zero
+	t_vec params;
+	int numFree = 0;
+};
+
+
+/**
+ * lookup of the wyckoff sites of a space group and generation of orbits
+ */
+template<class t_mat, class t_vec>
+requires m::is_mat<t_mat> && m::is_vec<t_vec>
+class WycLookup
+{
+public:
+	using t_real = typename t_vec::value_type;
+	using t_match = WycSiteMatch<t_vec>;
+	using t_pos = std::array<t_real, 3>;
+	using t_imat = std::array<int, 9>;
+
+private:
+	/**
+	 * affine form R*(x,y,z) + t of an orbit entry
+	 */
+	struct t_entry
+	{
+		t_imat rot;
+		t_pos trans;
+
+		// least-squares inverse of rot, restricted to its non-zero columns
+		std::array<t_real, 9> pinv;
+
+		// range of the integer shifts for each component
+		std::array<int, 3> nMin, nMax;
+	};
+
+	struct t_site
+	{
+		int iSite = -1;
+		std::string letter;
+		int mult = 0;
+		int numFree = 0;
+		std::vector<t_entry> entries;
+	};
+
+	// sites sorted by increasing multiplicity
+	std::vector<t_site> m_sites;
+
+	// centring translations modulo the unit cell, including zero
+	std::vector<t_pos> m_centring;
+
+	// group operations combined with the centring translations
+	SymOpsBatch<t_real> m_ops;
+
+	t_real m_eps = 1e-4;
+	unsigned int m_iNumThreads = 0;
+
+protected:
+	static t_real Wrap(t_real x) { return SymOpsBatch<t_real>::Wrap(x); }
+
+	/**
+	 * are two positions equal modulo the unit cell?
+	 */
+	bool IsSamePos(const t_pos& pos1, const t_pos& pos2) const
+	{
+		for(std::size_t i=0; i<3; ++i)
+		{
+			t_real diff = pos1[i] - pos2[i];
+			diff -= std::round(diff);
+			if(std::abs(diff) > m_eps)
+				return false;
+		}
+		return true;
+	}
+
+	static t_imat ToIntMat(const t_mat& mat)
+	{
+		t_imat imat;
+		for(std::size_t i=0; i<3; ++i)
+			for(std::size_t j=0; j<3; ++j)
+				imat[i*3 + j] = int(std::round(mat(i,j)));
+		return imat;
+	}
+
+	/**
+	 * precalculates the solution of R*v = d for an orbit entry
+	 * returns the number of free parameters
+	 */
+	static int CreateEntry(t_entry& entry)
+	{
+		const t_imat& R = entry.rot;
+
+		// the free parameters are the non-zero columns
+		std::vector<std::size_t> cols;
+		for(std::size_t j=0; j<3; ++j)
+			if(R[0*3 + j] || R[1*3 + j] || R[2*3 + j])
+				cols.push_back(j);
+
+		entry.pinv.fill(0);
+		const std::size_t N = cols.size();
+		if(N > 0)
+		{
+			// normal equations A^T A v = A^T d with A = R[:, cols]
+			t_real AtA[3][3] = {{ 0, 0, 0 }, { 0, 0, 0 }, { 0, 0, 0 }};
+			for(std::size_t i=0; i<N; ++i)
+				for(std::size_t j=0; j<N; ++j)
+					for(std::size_t k=0; k<3; ++k)
+						AtA[i][j] += t_real(R[k*3 + cols[i]] * R[k*3 + cols[j]]);
+
+			// inverse via the adjugate, AtA is at most 3x3
+			t_real AtAinv[3][3] = {{ 0, 0, 0 }, { 0, 0, 0 }, { 0, 0, 0 }};
+			t_real det = 0;
+			if(N == 1)
+			{
+				det = AtA[0][0];
+				AtAinv[0][0] = 1;
+			}
+			else if(N == 2)
+			{
+				det = AtA[0][0]*AtA[1][1] - AtA[0][1]*AtA[1][0];
+				AtAinv[0][0] = AtA[1][1]; AtAinv[0][1] = -AtA[0][1];
+				AtAinv[1][0] = -AtA[1][0]; AtAinv[1][1] = AtA[0][0];
+			}
+			else
+			{
+				for(std::size_t i=0; i<3; ++i)
+				{
+					for(std::size_t j=0; j<3; ++j)
+					{
+						const std::size_t r1 = (j+1)%3, r2 = (j+2)%3;
+						const std::size_t c1 = (i+1)%3, c2 = (i+2)%3;
+						AtAinv[i][j] = AtA[r1][c1]*AtA[r2][c2] - AtA[r1][c2]*AtA[r2][c1];
+					}
+				}
+				det = AtA[0][0]*AtAinv[0][0] + AtA[0][1]*AtAinv[1][0] + AtA[0][2]*AtAinv[2][0];
+			}
+
+			if(std::abs(det) < std::numeric_limits<t_real>::epsilon())
+				return -1;
+
+			for(std::size_t i=0; i<N; ++i)
+				for(std::size_t k=0; k<3; ++k)
+					for(std::size_t j=0; j<N; ++j)
+						entry.pinv[cols[i]*3 + k] += AtAinv[i][j] / det * t_real(R[k*3 + cols[j]]);
+		}
+
+		// with the parameters in [0, 1) and the position difference in [0, 1),
+		// the integer shifts are bounded by the row sums
+		for(std::size_t i=0; i<3; ++i)
+		{
+			int lo = 0, hi = 0;
+			for(std::size_t j=0; j<3; ++j)
+				(R[i*3 + j] < 0 ? lo : hi) += R[i*3 + j];
+			entry.nMin[i] = lo - 1;
+			entry.nMax[i] = hi;
+		}
+
+		return int(N);
+	}
+
+	/**
+	 * tries to solve R*v + t = pos (mod lattice) for the free parameters v
+	 */
+	bool SolveEntry(const t_entry& entry, const t_pos& pos, t_pos& params) const
+	{
+		for(const t_pos& centring : m_centring)
+		{
+			t_pos d;
+			for(std::size_t i=0; i<3; ++i)
+				d[i] = Wrap(pos[i] - entry.trans[i] - centring[i] + m_eps) - m_eps;
+
+			for(int n0=entry.nMin[0]; n0<=entry.nMax[0]; ++n0)
+			for(int n1=entry.nMin[1]; n1<=entry.nMax[1]; ++n1)
+			for(int n2=entry.nMin[2]; n2<=entry.nMax[2]; ++n2)
+			{
+				const t_pos b{{ d[0] + t_real(n0), d[1] + t_real(n1), d[2] + t_real(n2) }};
+
+				t_pos v;
+				for(std::size_t i=0; i<3; ++i)
+					v[i] = entry.pinv[i*3 + 0]*b[0] + entry.pinv[i*3 + 1]*b[1] + entry.pinv[i*3 + 2]*b[2];
+
+				// residual
+				bool bSolved = true;
+				for(std::size_t i=0; i<3; ++i)
+				{
+					const t_real res = t_real(entry.rot[i*3 + 0])*v[0] + t_real(entry.rot[i*3 + 1])*v[1]
+						+ t_real(entry.rot[i*3 + 2])*v[2] - b[i];
+					if(std::abs(res) > m_eps)
+					{
+						bSolved = false;
+						break;
+					}
+				}
+
+				if(bSolved)
+				{
+					// integer shifts of the parameters only shift the position by lattice vectors
+					for(std::size_t i=0; i<3; ++i)
+						params[i] = Wrap(v[i] + m_eps) - m_eps;
+					return true;
+				}
+			}
+		}
+
+		return false;
+	}
+
+public:
+	WycLookup() = default;
+	~WycLookup() = default;
+
+	void SetEpsilon(t_real eps) { m_eps = eps; }
+	void SetNumThreads(unsigned int iNumThreads) { m_iNumThreads = iNumThreads; }
+
+	/**
+	 * prepares the lookup for a space group in the given setting
+	 */
+	bool Create(const Spacegroup<t_mat, t_vec>& sg, bool bBNS = true)
+	{
+		m_sites.clear();
+		m_centring.clear();
+		m_ops = SymOpsBatch<t_real>{};
+
+		const auto* sym = sg.GetSymmetries(bBNS);
+		const auto* wycs = sg.GetWycPositions(bBNS);
+		const auto* latt = sg.GetLattice(bBNS);
+		if(!sym)
+			return false;
+
+		// centring vectors, closed under addition modulo the unit cell
+		m_centring.push_back(t_pos{{ 0, 0, 0 }});
+		if(latt)
+		{
+			for(const t_vec& vec : *latt)
+			{
+				const t_pos c{{ Wrap(vec[0]), Wrap(vec[1]), Wrap(vec[2]) }};
+				if(std::find_if(m_centring.begin(), m_centring.end(),
+					[this, &c](const t_pos& c2) -> bool { return IsSamePos(c, c2); }) == m_centring.end())
+					m_centring.push_back(c);
+			}
+
+			for(std::size_t i=0; i<m_centring.size(); ++i)
+			{
+				for(std::size_t j=0; j<m_centring.size(); ++j)
+				{
+					const t_pos c{{ Wrap(m_centring[i][0] + m_centring[j][0]),
+						Wrap(m_centring[i][1] + m_centring[j][1]),
+						Wrap(m_centring[i][2] + m_centring[j][2]) }};
+					if(std::find_if(m_centring.begin(), m_centring.end(),
+						[this, &c](const t_pos& c2) -> bool { return IsSamePos(c, c2); }) == m_centring.end())
+						m_centring.push_back(c);
+				}
+			}
+		}
+
+		// group operations
+		m_ops.SetOperations(*sym, &m_centring);
+
+		// wyckoff sites
+		for(std::size_t iSite=0; wycs && iSite<wycs->size(); ++iSite)
+		{
+			const auto& wyc = (*wycs)[iSite];
+
+			t_site site;
+			site.iSite = int(iSite);
+			site.letter = wyc.GetLetter();
+			site.mult = wyc.GetMultiplicity();
+
+			const auto wycrots = wyc.GetRotations();
+			const auto& wyctranss = wyc.GetTranslations();
+			for(std::size_t iEntry=0; iEntry<wycrots.size(); ++iEntry)
+			{
+				t_entry entry;
+				entry.rot = ToIntMat(wycrots[iEntry]);
+				entry.trans = t_pos{{ wyctranss[iEntry][0], wyctranss[iEntry][1], wyctranss[iEntry][2] }};
+
+				site.numFree = CreateEntry(entry);
+				if(site.numFree < 0)
+				{
+					std::cerr << "Invalid Wyckoff position " << site.letter
+						<< " in space group " << sg.GetNumber(bBNS) << "." << std::endl;
+					return false;
+				}
+
+				site.entries.emplace_back(std::move(entry));
+			}
+
+			m_sites.emplace_back(std::move(site));
+		}
+
+		// the most special sites first
+		std::stable_sort(m_sites.begin(), m_sites.end(), [](const t_site& site1, const t_site& site2) -> bool
+		{
+			return site1.mult < site2.mult;
+		});
+
+		return true;
+	}
+
+	/**
+	 * finds the most special wyckoff site of a position
+	 * returns [site, ok]
+	 */
+	std::tuple<t_match, bool> Find(const t_vec& vecPos) const
+	{
+		t_match match;
+		match.params = m::zero<t_vec>(3);
+
+		const t_pos pos{{ vecPos[0], vecPos[1], vecPos[2] }};
+		for(const t_site& site : m_sites)
+		{
+			for(std::size_t iEntry=0; iEntry<site.entries.size(); ++iEntry)
+			{
+				t_pos params;
+				if(!SolveEntry(site.entries[iEntry], pos, params))
+					continue;
+
+				match.iSite = site.iSite;
+				match.letter = site.letter;
+				match.mult = site.mult;
+				match.iEntry = iEntry;
+				match.numFree = site.numFree;
+				for(std::size_t i=0; i<3; ++i)
+					match.params[i] = params[i];
+
+				return std::make_tuple(match, true);
+			}
+		}
+
+		return std::make_tuple(match, false);
+	}
+
+	/**
+	 * finds the wyckoff sites of many positions in parallel
+	 */
+	std::vector<t_match> Find(const std::vector<t_vec>& positions) const
+	{
+		std::vector<t_match> matches(positions.size());
+
+		m::run_parallel(positions.size(), [this, &positions, &matches](std::size_t iPos)
+		{
+			matches[iPos] = std::get<0>(Find(positions[iPos]));
+		}, m_iNumThreads);
+
+		return matches;
+	}
+
+	/**
+	 * generates the orbit of a position and its moment, deduplicated modulo the lattice
+	 * returns [positions in [0, 1), moments, ok], ok is false if the moment is incompatible with the site symmetry
+	 */
+	std::tuple<std::vector<t_vec>, std::vector<t_vec>, bool>
+	GetOrbit(const t_vec& vecPos, const t_vec* vecMom = nullptr) const
+	{
+		const std::size_t numOps = m_ops.GetNumOps();
+		std::vector<t_real> images(numOps * 6);
+
+		const t_real pos[3] = { vecPos[0], vecPos[1], vecPos[2] };
+		t_real mom[3] = { 0, 0, 0 };
+		if(vecMom)
+			for(std::size_t i=0; i<3; ++i)
+				mom[i] = (*vecMom)[i];
+
+		t_real* out = images.data();
+		m_ops.Apply(1, &pos[0], &pos[1], &pos[2],
+			out, out + numOps, out + 2*numOps,
+			&mom[0], &mom[1], &mom[2],
+			out + 3*numOps, out + 4*numOps, out + 5*numOps);
+
+		return CollectOrbit(out, 1, 0);
+	}
+
+	/**
+	 * generates the orbits of many positions (and optionally moments) in parallel
+	 * the atoms are transformed in blocks by the batched symmetry operations
+	 */
+	std::vector<std::tuple<std::vector<t_vec>, std::vector<t_vec>, bool>>
+	GetOrbits(const std::vector<t_vec>& positions, const std::vector<t_vec>* moments = nullptr) const
+	{
+		const std::size_t iBlockSize = 1024;
+		const std::size_t numOps = m_ops.GetNumOps();
+		const std::size_t numBlocks = (positions.size() + iBlockSize - 1) / iBlockSize;
+
+		std::vector<std::tuple<std::vector<t_vec>, std::vector<t_vec>, bool>> orbits(positions.size());
+
+		m::run_parallel(numBlocks, [this, &positions, moments, &orbits, numOps, iBlockSize](std::size_t iBlock)
+		{
+			const std::size_t iStart = iBlock * iBlockSize;
+			const std::size_t N = std::min(iBlockSize, positions.size() - iStart);
+
+			// input: x, y, z, mx, my, mz; output: the same for all images
+			std::vector<t_real> in(N * 6, t_real(0));
+			std::vector<t_real> images(N * numOps * 6);
+
+			for(std::size_t iAtom=0; iAtom<N; ++iAtom)
+			{
+				for(std::size_t i=0; i<3; ++i)
+				{
+					in[i*N + iAtom] = positions[iStart + iAtom][i];
+					if(moments)
+						in[(3+i)*N + iAtom] = (*moments)[iStart + iAtom][i];
+				}
+			}
+
+			const std::size_t numImages = N * numOps;
+			t_real* out = images.data();
+			m_ops.Apply(N, in.data(), in.data() + N, in.data() + 2*N,
+				out, out + numImages, out + 2*numImages,
+				in.data() + 3*N, in.data() + 4*N, in.data() + 5*N,
+				out + 3*numImages, out + 4*numImages, out + 5*numImages);
+
+			for(std::size_t iAtom=0; iAtom<N; ++iAtom)
+				orbits[iStart + iAtom] = CollectOrbit(out, N, iAtom);
+		}, m_iNumThreads);
+
+		return orbits;
+	}
+
+protected:
+	/**
+	 * deduplicates the images of one atom from the output of SymOpsBatch::Apply
+	 * for N atoms, the components are stored in blocks of N*GetNumOps() elements
+	 */
+	std::tuple<std::vector<t_vec>, std::vector<t_vec>, bool>
+	CollectOrbit(const t_real* images, std::size_t N, std::size_t iAtom) const
+	{
+		const std::size_t numOps = m_ops.GetNumOps();
+		const std::size_t numImages = N * numOps;
+
+		std::vector<t_pos> orbit, moments;
+		bool bOk = true;
+
+		for(std::size_t iOp=0; iOp<numOps; ++iOp)
+		{
+			t_pos pos, mom;
+			for(std::size_t i=0; i<3; ++i)
+			{
+				pos[i] = images[i*numImages + iOp*N + iAtom];
+				mom[i] = images[(3+i)*numImages + iOp*N + iAtom];
+			}
+
+			auto iter = std::find_if(orbit.begin(), orbit.end(),
+				[this, &pos](const t_pos& pos2) -> bool { return IsSamePos(pos, pos2); });
+
+			if(iter == orbit.end())
+			{
+				orbit.push_back(pos);
+				moments.push_back(mom);
+			}
+			else
+			{
+				// the site symmetry has to leave the moment invariant
+				const t_pos& mom2 = moments[iter - orbit.begin()];
+				for(std::size_t i=0; i<3; ++i)
+					if(std::abs(mom2[i] - mom[i]) > m_eps)
+						bOk = false;
+			}
+		}
+
+		std::vector<t_vec> vecOrbit, vecMoments;
+		for(std::size_t i=0; i<orbit.size(); ++i)
+		{
+			vecOrbit.emplace_back(m::create<t_vec>({ orbit[i][0], orbit[i][1], orbit[i][2] }));
+			vecMoments.emplace_back(m::create<t_vec>({ moments[i][0], moments[i][1], moments[i][2] }));
+		}
+
+		return std::make_tuple(vecOrbit, vecMoments, bOk);
+	}
+};
+// ----------------------------------------------------------------------------
+
+
+#endif
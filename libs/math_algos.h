@@ -742,6 +742,152 @@ requires is_mat<t_mat> && is_vec<t_vec>
 }
 
 
+/**
+ * QR decomposition of a matrix using householder reflections, without heap allocations
+ *  - R: input matrix (rows x cols), overwritten by R
+ *  - Q: receives the (rows x rows) orthogonal matrix, has to be allocated by the caller
+ *  - work: workspace with at least 'rows' elements
+ * in contrast to qr(), the diagonal of R can have negative elements
+ */
+template<class t_mat, class t_vec>
+bool qr_inplace(t_mat& R, t_mat& Q, t_vec& work)
+requires is_mat<t_mat> && is_basic_vec<t_vec>
+{
+	using T = typename t_mat::value_type;
+	const std::size_t rows = R.size1();
+	const std::size_t cols = R.size2();
+
+	if(Q.size1() != rows || Q.size2() != rows || work.size() < rows)
+		return false;
+
+	for(std::size_t i=0; i<rows; ++i)
+		for(std::size_t j=0; j<rows; ++j)
+			Q(i,j) = (i==j ? T(1) : T(0));
+
+	const std::size_t N = std::min(rows > 0 ? rows-1 : 0, cols);
+	for(std::size_t k=0; k<N; ++k)
+	{
+		T xnorm = T(0);
+		for(std::size_t i=k; i<rows; ++i)
+			xnorm += R(i,k)*R(i,k);
+		xnorm = std::sqrt(xnorm);
+		if(xnorm == T(0))
+			continue;
+
+		// mirror the column onto alpha*e_k, sign chosen to avoid cancellation
+		const T alpha = R(k,k) > T(0) ? -xnorm : xnorm;
+
+		T vnorm2 = T(0);
+		for(std::size_t i=k; i<rows; ++i)
+		{
+			work[i] = R(i,k);
+			if(i == k)
+				work[i] -= alpha;
+			vnorm2 += work[i]*work[i];
+		}
+		if(vnorm2 == T(0))
+			continue;
+
+		// R := H R
+		R(k,k) = alpha;
+		for(std::size_t i=k+1; i<rows; ++i)
+			R(i,k) = T(0);
+
+		for(std::size_t j=k+1; j<cols; ++j)
+		{
+			T s = T(0);
+			for(std::size_t i=k; i<rows; ++i)
+				s += work[i]*R(i,j);
+			s *= T(2) / vnorm2;
+
+			for(std::size_t i=k; i<rows; ++i)
+				R(i,j) -= s*work[i];
+		}
+
+		// Q := Q H
+		for(std::size_t row=0; row<rows; ++row)
+		{
+			T s = T(0);
+			for(std::size_t i=k; i<rows; ++i)
+				s += Q(row,i)*work[i];
+			s *= T(2) / vnorm2;
+
+			for(std::size_t i=k; i<rows; ++i)
+				Q(row,i) -= s*work[i];
+		}
+	}
+
+	return true;
+}
+
+
+/**
+ * thin QR decomposition using modified gram-schmidt, without heap allocations
+ *  - Q: input matrix (rows x cols), its columns are overwritten by the orthonormal basis
+ *  - R: receives the (cols x cols) upper triangular matrix, has to be allocated by the caller
+ * returns false for wrong sizes or linearly dependent columns, which are set to zero in Q,
+ * a column counts as dependent if its remaining norm is below eps*rows times its original norm
+ */
+template<class t_mat>
+bool qr_mgs_inplace(t_mat& Q, t_mat& R,
+	typename t_mat::value_type eps = std::numeric_limits<typename t_mat::value_type>::epsilon())
+requires is_mat<t_mat>
+{
+	using T = typename t_mat::value_type;
+	const std::size_t rows = Q.size1();
+	const std::size_t cols = Q.size2();
+
+	if(R.size1() != cols || R.size2() != cols)
+		return false;
+
+	bool bIndependent = true;
+	for(std::size_t k=0; k<cols; ++k)
+	{
+		for(std::size_t j=0; j<k; ++j)
+			R(k,j) = T(0);
+
+		T len = T(0);
+		for(std::size_t i=0; i<rows; ++i)
+			len += Q(i,k)*Q(i,k);
+		len = std::sqrt(len);
+		R(k,k) = len;
+
+		// the original column norm follows from the already removed projections
+		T lenOrig = len*len;
+		for(std::size_t j=0; j<k; ++j)
+			lenOrig += R(j,k)*R(j,k);
+		lenOrig = std::sqrt(lenOrig);
+
+		if(equals<T>(len, T(0), eps*T(rows)*lenOrig))
+		{
+			bIndependent = false;
+			for(std::size_t i=0; i<rows; ++i)
+				Q(i,k) = T(0);
+			for(std::size_t j=k+1; j<cols; ++j)
+				R(k,j) = T(0);
+			continue;
+		}
+
+		for(std::size_t i=0; i<rows; ++i)
+			Q(i,k) /= len;
+
+		// remove the new basis vector from the remaining columns
+		for(std::size_t j=k+1; j<cols; ++j)
+		{
+			T proj = T(0);
+			for(std::size_t i=0; i<rows; ++i)
+				proj += Q(i,k)*Q(i,j);
+			R(k,j) = proj;
+
+			for(std::size_t i=0; i<rows; ++i)
+				Q(i,j) -= proj*Q(i,k);
+		}
+	}
+
+	return bIndependent;
+}
+
+
 /**
  * project vector vec onto plane through the origin and perpendicular to vector vecNorm
  * (e.g. used to calculate magnetic interaction vector M_perp)
@@ -818,6 +964,65 @@ requires is_vec<t_vec>
 
 
 
+/**
+ * orthonormalise a system of vectors in place (modified gram-schmidt algo)
+ * the projections are removed from the running vector, which is numerically more stable
+ * returns false for linearly dependent vectors, which are set to zero,
+ * a vector counts as dependent if its remaining norm is below eps*dim times its original norm
+ */
+template<class t_vec, template<class...> class t_cont = std::vector>
+bool orthonorm_sys_inplace(t_cont<t_vec>& sys,
+	typename t_vec::value_type eps = std::numeric_limits<typename t_vec::value_type>::epsilon())
+requires is_basic_vec<t_vec>
+{
+	using T = typename t_vec::value_type;
+	bool bIndependent = true;
+
+	for(auto iter = sys.begin(); iter != sys.end(); ++iter)
+	{
+		t_vec& vec = *iter;
+
+		T lenOrig = T(0);
+		for(std::size_t i=0; i<vec.size(); ++i)
+			lenOrig += vec[i]*vec[i];
+		lenOrig = std::sqrt(lenOrig);
+
+		// subtract projections to the previous basis vectors
+		for(auto iterPrev = sys.begin(); iterPrev != iter; ++iterPrev)
+		{
+			const t_vec& vecPrev = *iterPrev;
+
+			T proj = T(0);
+			for(std::size_t i=0; i<vec.size(); ++i)
+				proj += vecPrev[i]*vec[i];
+			for(std::size_t i=0; i<vec.size(); ++i)
+				vec[i] -= proj*vecPrev[i];
+		}
+
+		// normalise
+		T len = T(0);
+		for(std::size_t i=0; i<vec.size(); ++i)
+			len += vec[i]*vec[i];
+		len = std::sqrt(len);
+
+		if(equals<T>(len, T(0), eps*T(vec.size())*lenOrig))
+		{
+			// zero the dependent vector, so that it does not enter the later projections
+			bIndependent = false;
+			for(std::size_t i=0; i<vec.size(); ++i)
+				vec[i] = T(0);
+			continue;
+		}
+
+		for(std::size_t i=0; i<vec.size(); ++i)
+			vec[i] /= len;
+	}
+
+	return bIndependent;
+}
+
+
+
 /**
  * linearise a matrix to a vector container
  */
@@ -1147,6 +1352,33 @@ requires is_vec<ty> || is_mat<ty>
 }
 
 
+/**
+ * bounding sphere of a point cloud
+ * (centre at the average position, not necessarily minimal)
+ * returns [centre, radius]
+ */
+template<class t_vec, template<class...> class t_cont = std::vector>
+std::tuple<t_vec, typename t_vec::value_type> bounding_sphere(const t_cont<t_vec>& verts)
+requires is_vec<t_vec>
+{
+	using T = typename t_vec::value_type;
+
+	if(verts.size() == 0)
+		return std::make_tuple(t_vec(), T(0));
+
+	const t_vec centre = avg<t_vec, t_cont>(verts);
+
+	T rad2 = T(0);
+	for(const t_vec& vert : verts)
+	{
+		const t_vec diff = vert - centre;
+		rad2 = std::max(rad2, inner<t_vec>(diff, diff));
+	}
+
+	return std::make_tuple(centre, std::sqrt(rad2));
+}
+
+
 /**
  * intersection of a polygon and a line
  * returns [position of intersection, intersects?, line parameter lambda]
@@ -2579,6 +2811,62 @@ requires is_mat<t_mat>
 	});
 }
 
+
+/**
+ * extracts the six clipping planes of the view frustum from the combined
+ * projection and model-view matrix, P*M (Gribb-Hartmann method)
+ * returns planes as homogeneous vectors [n, d] with <n|x> + d >= 0 inside the frustum
+ * order: left, right, bottom, top, near, far
+ */
+template<class t_mat, class t_vec, template<class...> class t_cont = std::vector>
+t_cont<t_vec> hom_frustum_planes(const t_mat& matProjModelView, bool bIsNormalised = true)
+requires is_vec<t_vec> && is_mat<t_mat>
+{
+	t_cont<t_vec> planes;
+
+	// clip condition: -w <= x_i <= w  =>  w +- x_i >= 0
+	for(std::size_t i=0; i<3; ++i)
+	{
+		for(int sgn : {1, -1})
+		{
+			t_vec plane = zero<t_vec>(4);
+			for(std::size_t j=0; j<4; ++j)
+				plane[j] = matProjModelView(3,j) + sgn*matProjModelView(i,j);
+
+			if(bIsNormalised)
+			{
+				const auto len = std::sqrt(plane[0]*plane[0] + plane[1]*plane[1] + plane[2]*plane[2]);
+				plane /= len;
+			}
+
+			planes.emplace_back(std::move(plane));
+		}
+	}
+
+	return planes;
+}
+
+
+/**
+ * is a sphere (partially) inside the frustum defined by the given normalised planes?
+ */
+template<class t_vec, class t_planes = std::vector<t_vec>>
+bool hom_sphere_in_frustum(const t_planes& planes,
+	const t_vec& sphereOrg, typename t_vec::value_type sphereRad)
+requires is_basic_vec<t_vec>
+{
+	for(const auto& plane : planes)
+	{
+		const auto dist = plane[0]*sphereOrg[0] + plane[1]*sphereOrg[1] + plane[2]*sphereOrg[2] + plane[3];
+
+		// completely on the outer side of this plane?
+		if(dist < -sphereRad)
+			return false;
+	}
+
+	return true;
+}
+
 // ----------------------------------------------------------------------------
 
 
@@ -2964,6 +3252,640 @@ requires is_mat<t_mat> && is_vec<t_vec>
 }
 
 
+// ----------------------------------------------------------------------------
+// decompositions
+// ----------------------------------------------------------------------------
+
+/**
+ * cholesky decomposition of a hermitian, positive-definite matrix
+ * mat = L L^H with lower triangular L
+ * returns [L, ok]
+ */
+template<class t_mat>
+std::tuple<t_mat, bool> chol(const t_mat& mat)
+requires is_mat<t_mat>
+{
+	using T = typename t_mat::value_type;
+	const std::size_t N = mat.size1();
+
+	if(N != mat.size2())
+		return std::make_tuple(t_mat(), false);
+
+	t_mat L = zero<t_mat>(N, N);
+
+	for(std::size_t j=0; j<N; ++j)
+	{
+		// diagonal element
+		T diag = mat(j,j);
+		for(std::size_t k=0; k<j; ++k)
+		{
+			if constexpr(is_complex<T>)
+				diag -= L(j,k) * std::conj(L(j,k));
+			else
+				diag -= L(j,k) * L(j,k);
+		}
+
+		// fail if matrix is not positive-definite
+		if(std::real(diag) <= 0)
+			return std::make_tuple(L, false);
+		L(j,j) = std::sqrt(std::real(diag));
+
+		// elements below the diagonal
+		for(std::size_t i=j+1; i<N; ++i)
+		{
+			T elem = mat(i,j);
+			for(std::size_t k=0; k<j; ++k)
+			{
+				if constexpr(is_complex<T>)
+					elem -= L(i,k) * std::conj(L(j,k));
+				else
+					elem -= L(i,k) * L(j,k);
+			}
+
+			L(i,j) = elem / L(j,j);
+		}
+	}
+
+	return std::make_tuple(L, true);
+}
+
+
+/**
+ * inverse of a lower (or upper) triangular matrix by substitution
+ * returns [inverse, ok]
+ */
+template<class t_mat>
+std::tuple<t_mat, bool> inv_triangular(const t_mat& mat, bool bLower = true)
+requires is_mat<t_mat>
+{
+	using T = typename t_mat::value_type;
+	const std::size_t N = mat.size1();
+
+	if(N != mat.size2())
+		return std::make_tuple(t_mat(), false);
+
+	t_mat matInv = zero<t_mat>(N, N);
+
+	for(std::size_t i=0; i<N; ++i)
+	{
+		if(equals<T>(mat(i,i), T(0)))
+			return std::make_tuple(t_mat(), false);
+		matInv(i,i) = T(1) / mat(i,i);
+	}
+
+	// off-diagonal elements, column by column
+	for(std::size_t j=0; j<N; ++j)
+	{
+		if(bLower)
+		{
+			for(std::size_t i=j+1; i<N; ++i)
+			{
+				T sum = T(0);
+				for(std::size_t k=j; k<i; ++k)
+					sum += mat(i,k) * matInv(k,j);
+				matInv(i,j) = -sum / mat(i,i);
+			}
+		}
+		else
+		{
+			for(std::size_t i=j; i-- > 0;)
+			{
+				T sum = T(0);
+				for(std::size_t k=i+1; k<=j; ++k)
+					sum += mat(i,k) * matInv(k,j);
+				matInv(i,j) = -sum / mat(i,i);
+			}
+		}
+	}
+
+	return std::make_tuple(matInv, true);
+}
+
+
+/**
+ * eigenvalues and -vectors of a real symmetric or complex hermitian matrix
+ * using cyclic jacobi rotations, see e.g.:
+ *	https://en.wikipedia.org/wiki/Jacobi_eigenvalue_algorithm
+ *
+ * in the complex case, the phase of the pivot element is first rotated away,
+ * the remaining real rotation then zeroes it.
+ *
+ * returns [eigenvalues (ascending), eigenvectors, converged]
+ */
+template<class t_mat, class t_vec,
+	class t_real = decltype(std::abs(typename t_mat::value_type{}))>
+std::tuple<std::vector<t_real>, std::vector<t_vec>, bool>
+eigenvec_herm_jacobi(const t_mat& mat, t_real eps = std::numeric_limits<t_real>::epsilon(),
+	std::size_t iMaxSweeps = 64)
+requires is_mat<t_mat> && is_basic_vec<t_vec>
+{
+	using T = typename t_mat::value_type;
+	const std::size_t N = mat.size1();
+
+	if(N != mat.size2())
+		return std::make_tuple(std::vector<t_real>{}, std::vector<t_vec>{}, false);
+
+	auto conj_elem = [](const T& t) -> T
+	{
+		if constexpr(is_complex<T>)
+			return std::conj(t);
+		else
+			return t;
+	};
+
+	t_mat A = mat;
+	t_mat V = unit<t_mat>(N);
+	bool bConverged = false;
+
+	for(std::size_t iSweep=0; iSweep<iMaxSweeps; ++iSweep)
+	{
+		// squared norms of the diagonal and the upper off-diagonal elements
+		t_real diag = 0, offdiag = 0;
+		for(std::size_t i=0; i<N; ++i)
+		{
+			diag += std::norm(A(i,i));
+			for(std::size_t j=i+1; j<N; ++j)
+				offdiag += std::norm(A(i,j));
+		}
+
+		if(offdiag <= eps*eps*diag || offdiag == t_real(0))
+		{
+			bConverged = true;
+			break;
+		}
+
+		// elements below rounding precision of the whole matrix are set to zero
+		const t_real thresh = eps * std::sqrt(diag + t_real(2)*offdiag);
+
+		for(std::size_t p=0; p<N; ++p)
+		{
+			for(std::size_t q=p+1; q<N; ++q)
+			{
+				const t_real absPQ = std::abs(A(p,q));
+				if(absPQ == t_real(0))
+					continue;
+
+				if(absPQ <= thresh)
+				{
+					A(p,q) = A(q,p) = T(0);
+					continue;
+				}
+
+				const t_real app = std::real(A(p,p));
+				const t_real aqq = std::real(A(q,q));
+
+				// rotation G = diag(1, phase^*) * [[c, s], [-s, c]]
+				const T phase = A(p,q) / absPQ;
+				const t_real theta = (aqq - app) / (t_real(2)*absPQ);
+				const t_real t = (theta >= t_real(0) ? t_real(1) : t_real(-1)) /
+					(std::abs(theta) + std::sqrt(theta*theta + t_real(1)));
+				const t_real c = t_real(1) / std::sqrt(t*t + t_real(1));
+				const t_real s = t*c;
+
+				const T Gpp = c, Gpq = s;
+				const T Gqp = -s*conj_elem(phase), Gqq = c*conj_elem(phase);
+
+				// A := A G, V := V G
+				for(std::size_t k=0; k<N; ++k)
+				{
+					const T akp = A(k,p), akq = A(k,q);
+					A(k,p) = akp*Gpp + akq*Gqp;
+					A(k,q) = akp*Gpq + akq*Gqq;
+
+					const T vkp = V(k,p), vkq = V(k,q);
+					V(k,p) = vkp*Gpp + vkq*Gqp;
+					V(k,q) = vkp*Gpq + vkq*Gqq;
+				}
+
+				// A := G^H A
+				for(std::size_t k=0; k<N; ++k)
+				{
+					const T apk = A(p,k), aqk = A(q,k);
+					A(p,k) = conj_elem(Gpp)*apk + conj_elem(Gqp)*aqk;
+					A(q,k) = conj_elem(Gpq)*apk + conj_elem(Gqq)*aqk;
+				}
+
+				A(p,q) = A(q,p) = T(0);
+				A(p,p) = std::real(A(p,p));
+				A(q,q) = std::real(A(q,q));
+			}
+		}
+	}
+
+	// sort eigenvalues in ascending order
+	std::vector<std::size_t> perm(N);
+	std::iota(perm.begin(), perm.end(), 0);
+	std::stable_sort(perm.begin(), perm.end(), [&A](std::size_t i, std::size_t j) -> bool
+	{
+		return std::real(A(i,i)) < std::real(A(j,j));
+	});
+
+	std::vector<t_real> evals;
+	std::vector<t_vec> evecs;
+	evals.reserve(N);
+	evecs.reserve(N);
+
+	for(std::size_t i : perm)
+	{
+		evals.push_back(std::real(A(i,i)));
+		evecs.emplace_back(col<t_mat, t_vec>(V, i));
+	}
+
+	return std::make_tuple(evals, evecs, bConverged);
+}
+
+
+/**
+ * work arrays for the hermitian eigensolver,
+ * can be re-used for several matrices to avoid re-allocations
+ */
+template<class t_mat, class t_real = decltype(std::abs(typename t_mat::value_type{}))>
+struct eigen_herm_workspace
+{
+	using T = typename t_mat::value_type;
+
+	t_mat A, Z;
+	std::vector<t_real> d, e;
+	std::vector<T> v, p;
+
+	// allocated sizes of A and Z, the default-constructed matrices have none
+	std::size_t NA = 0, NZ = 0;
+
+	void resize(std::size_t N, bool bVecs)
+	{
+		if constexpr(is_dyn_mat<t_mat>)
+		{
+			if(NA != N)
+			{
+				A = t_mat(N, N);
+				NA = N;
+			}
+			if(bVecs && NZ != N)
+			{
+				Z = t_mat(N, N);
+				NZ = N;
+			}
+		}
+
+		d.resize(N);
+		e.resize(N);
+		v.resize(N);
+		p.resize(N);
+	}
+};
+
+
+/**
+ * eigenvalues (and -vectors) of a real symmetric or complex hermitian matrix:
+ *  1) householder reduction to a hermitian tridiagonal matrix,
+ *  2) unitary diagonal transformation to make the off-diagonal elements real,
+ *  3) implicit QL iteration with wilkinson shifts on the real tridiagonal matrix,
+ * see e.g.: https://en.wikipedia.org/wiki/Householder_transformation#Tridiagonalization
+ *
+ * results (unsorted) are in ws.d and the columns of ws.Z
+ */
+template<class t_mat, class t_real = decltype(std::abs(typename t_mat::value_type{}))>
+bool eigen_herm_tridiag(const t_mat& mat, eigen_herm_workspace<t_mat, t_real>& ws,
+	bool bVecs = true, t_real eps = std::numeric_limits<t_real>::epsilon())
+requires is_mat<t_mat>
+{
+	using T = typename t_mat::value_type;
+	const std::size_t N = mat.size1();
+
+	if(N != mat.size2())
+		return false;
+	if(N == 0)
+		return true;
+
+	auto conj_elem = [](const T& t) -> T
+	{
+		if constexpr(is_complex<T>)
+			return std::conj(t);
+		else
+			return t;
+	};
+
+	ws.resize(N, bVecs);
+	t_mat& A = ws.A;
+	t_mat& Z = ws.Z;
+	auto& d = ws.d;
+	auto& e = ws.e;
+	auto& v = ws.v;
+	auto& p = ws.p;
+
+	for(std::size_t i=0; i<N; ++i)
+	{
+		for(std::size_t j=0; j<N; ++j)
+		{
+			A(i,j) = mat(i,j);
+			if(bVecs)
+				Z(i,j) = (i==j ? T(1) : T(0));
+		}
+	}
+
+	// ------------------------------------------------------------------------
+	// householder tridiagonalisation: A := H A H with H = 1 - 2 |v><v|
+	for(std::size_t k=0; k+2<N; ++k)
+	{
+		const std::size_t L = N-k-1;
+
+		t_real xnorm = 0;
+		for(std::size_t i=0; i<L; ++i)
+			xnorm += std::norm(A(k+1+i, k));
+		xnorm = std::sqrt(xnorm);
+		if(xnorm == t_real(0))
+			continue;
+
+		const t_real absx0 = std::abs(A(k+1, k));
+		const T phase0 = (absx0 == t_real(0)) ? T(1) : A(k+1, k)/absx0;
+		const T alpha = -phase0 * xnorm;
+
+		t_real vnorm = 0;
+		for(std::size_t i=0; i<L; ++i)
+		{
+			v[i] = A(k+1+i, k);
+			if(i == 0)
+				v[i] -= alpha;
+			vnorm += std::norm(v[i]);
+		}
+		vnorm = std::sqrt(vnorm);
+		if(vnorm == t_real(0))
+			continue;
+		for(std::size_t i=0; i<L; ++i)
+			v[i] /= vnorm;
+
+		// p = A v, K = <v|p>, w = p - K v
+		T K = T(0);
+		for(std::size_t i=0; i<L; ++i)
+		{
+			p[i] = T(0);
+			for(std::size_t j=0; j<L; ++j)
+				p[i] += A(k+1+i, k+1+j) * v[j];
+			K += conj_elem(v[i]) * p[i];
+		}
+		for(std::size_t i=0; i<L; ++i)
+			p[i] -= K * v[i];
+
+		// trailing block: A := A - 2 (|v><w| + |w><v|)
+		for(std::size_t i=0; i<L; ++i)
+			for(std::size_t j=0; j<L; ++j)
+				A(k+1+i, k+1+j) -= T(2) * (v[i]*conj_elem(p[j]) + p[i]*conj_elem(v[j]));
+
+		for(std::size_t i=0; i<L; ++i)
+			A(k+1+i, k) = A(k, k+1+i) = T(0);
+		A(k+1, k) = alpha;
+		A(k, k+1) = conj_elem(alpha);
+
+		// Z := Z H
+		if(bVecs)
+		{
+			for(std::size_t row=0; row<N; ++row)
+			{
+				T sum = T(0);
+				for(std::size_t j=0; j<L; ++j)
+					sum += Z(row, k+1+j) * v[j];
+				for(std::size_t j=0; j<L; ++j)
+					Z(row, k+1+j) -= T(2) * sum * conj_elem(v[j]);
+			}
+		}
+	}
+	// ------------------------------------------------------------------------
+
+	// ------------------------------------------------------------------------
+	// real tridiagonal matrix: phases of the off-diagonal elements go into Z
+	T phase = T(1);
+	for(std::size_t i=0; i<N; ++i)
+	{
+		d[i] = std::real(A(i,i));
+		e[i] = t_real(0);
+
+		if(i+1 < N)
+		{
+			e[i] = std::abs(A(i+1, i));
+
+			if(e[i] != t_real(0))
+				phase *= A(i+1, i) / e[i];
+			if(bVecs)
+			{
+				for(std::size_t row=0; row<N; ++row)
+					Z(row, i+1) *= phase;
+			}
+		}
+	}
+	// ------------------------------------------------------------------------
+
+	// ------------------------------------------------------------------------
+	// implicit QL iteration
+	const std::size_t iMaxIter = 32*N;
+	for(std::size_t l=0; l<N; ++l)
+	{
+		std::size_t iIter = 0;
+		while(true)
+		{
+			// find small sub-diagonal element
+			std::size_t m = l;
+			for(; m+1<N; ++m)
+			{
+				const t_real dd = std::abs(d[m]) + std::abs(d[m+1]);
+				if(std::abs(e[m]) <= eps*dd)
+					break;
+			}
+			if(m == l)
+				break;
+			if(++iIter > iMaxIter)
+				return false;
+
+			// wilkinson shift
+			t_real g = (d[l+1] - d[l]) / (t_real(2)*e[l]);
+			t_real r = std::hypot(g, t_real(1));
+			g = d[m] - d[l] + e[l] / (g + (g >= t_real(0) ? r : -r));
+
+			t_real s = 1, c = 1, pp = 0;
+			bool bDeflated = false;
+
+			for(std::size_t i=m; i-- > l;)
+			{
+				t_real f = s*e[i];
+				const t_real b = c*e[i];
+				r = std::hypot(f, g);
+				e[i+1] = r;
+
+				if(r == t_real(0))
+				{
+					d[i+1] -= pp;
+					e[m] = t_real(0);
+					bDeflated = true;
+					break;
+				}
+
+				s = f/r;
+				c = g/r;
+				g = d[i+1] - pp;
+				r = (d[i] - g)*s + t_real(2)*c*b;
+				pp = s*r;
+				d[i+1] = g + pp;
+				g = c*r - b;
+
+				// Z := Z G
+				if(bVecs)
+				{
+					for(std::size_t row=0; row<N; ++row)
+					{
+						const T z1 = Z(row, i+1);
+						const T z0 = Z(row, i);
+						Z(row, i+1) = s*z0 + c*z1;
+						Z(row, i) = c*z0 - s*z1;
+					}
+				}
+			}
+
+			if(bDeflated)
+				continue;
+
+			d[l] -= pp;
+			e[l] = g;
+			e[m] = t_real(0);
+		}
+	}
+	// ------------------------------------------------------------------------
+
+	return true;
+}
+
+
+/**
+ * eigenvalues and -vectors of a real symmetric or complex hermitian matrix
+ * (faster than the jacobi method from about 6x6 matrices on)
+ * returns [eigenvalues (ascending), eigenvectors, ok]
+ */
+template<class t_mat, class t_vec,
+	class t_real = decltype(std::abs(typename t_mat::value_type{}))>
+std::tuple<std::vector<t_real>, std::vector<t_vec>, bool>
+eigenvec_herm(const t_mat& mat, eigen_herm_workspace<t_mat, t_real>& ws,
+	t_real eps = std::numeric_limits<t_real>::epsilon())
+requires is_mat<t_mat> && is_basic_vec<t_vec>
+{
+	const std::size_t N = mat.size1();
+
+	std::vector<t_real> evals;
+	std::vector<t_vec> evecs;
+	if(!eigen_herm_tridiag<t_mat, t_real>(mat, ws, true, eps))
+		return std::make_tuple(evals, evecs, false);
+
+	// sort eigenvalues in ascending order
+	std::vector<std::size_t> perm(N);
+	std::iota(perm.begin(), perm.end(), 0);
+	std::stable_sort(perm.begin(), perm.end(), [&ws](std::size_t i, std::size_t j) -> bool
+	{
+		return ws.d[i] < ws.d[j];
+	});
+
+	evals.reserve(N);
+	evecs.reserve(N);
+	for(std::size_t i : perm)
+	{
+		evals.push_back(ws.d[i]);
+		evecs.emplace_back(col<t_mat, t_vec>(ws.Z, i));
+	}
+
+	return std::make_tuple(evals, evecs, true);
+}
+
+
+/**
+ * eigenvalues and -vectors of a real symmetric or complex hermitian matrix
+ * returns [eigenvalues (ascending), eigenvectors, ok]
+ */
+template<class t_mat, class t_vec,
+	class t_real = decltype(std::abs(typename t_mat::value_type{}))>
+std::tuple<std::vector<t_real>, std::vector<t_vec>, bool>
+eigenvec_herm(const t_mat& mat, t_real eps = std::numeric_limits<t_real>::epsilon())
+requires is_mat<t_mat> && is_basic_vec<t_vec>
+{
+	eigen_herm_workspace<t_mat, t_real> ws;
+	return eigenvec_herm<t_mat, t_vec, t_real>(mat, ws, eps);
+}
+
+
+/**
+ * eigenvalues of a real symmetric or complex hermitian matrix
+ * returns [eigenvalues (ascending), ok]
+ */
+template<class t_mat, class t_real = decltype(std::abs(typename t_mat::value_type{}))>
+std::tuple<std::vector<t_real>, bool>
+eigenval_herm(const t_mat& mat, eigen_herm_workspace<t_mat, t_real>& ws,
+	t_real eps = std::numeric_limits<t_real>::epsilon())
+requires is_mat<t_mat>
+{
+	if(!eigen_herm_tridiag<t_mat, t_real>(mat, ws, false, eps))
+		return std::make_tuple(std::vector<t_real>{}, false);
+
+	std::vector<t_real> evals = ws.d;
+	std::sort(evals.begin(), evals.end());
+	return std::make_tuple(evals, true);
+}
+
+
+/**
+ * eigenvalues of a real symmetric or complex hermitian matrix
+ * returns [eigenvalues (ascending), ok]
+ */
+template<class t_mat, class t_real = decltype(std::abs(typename t_mat::value_type{}))>
+std::tuple<std::vector<t_real>, bool>
+eigenval_herm(const t_mat& mat, t_real eps = std::numeric_limits<t_real>::epsilon())
+requires is_mat<t_mat>
+{
+	eigen_herm_workspace<t_mat, t_real> ws;
+	return eigenval_herm<t_mat, t_real>(mat, ws, eps);
+}
+
+
+/**
+ * eigenvalues and -vectors of many hermitian matrices, sharing one workspace
+ * returns a list of [eigenvalues (ascending), eigenvectors, ok]
+ */
+template<class t_mat, class t_vec,
+	template<class...> class t_cont = std::vector,
+	class t_real = decltype(std::abs(typename t_mat::value_type{}))>
+std::vector<std::tuple<std::vector<t_real>, std::vector<t_vec>, bool>>
+eigenvec_herm_batch(const t_cont<t_mat>& mats, t_real eps = std::numeric_limits<t_real>::epsilon())
+requires is_mat<t_mat> && is_basic_vec<t_vec>
+{
+	eigen_herm_workspace<t_mat, t_real> ws;
+
+	std::vector<std::tuple<std::vector<t_real>, std::vector<t_vec>, bool>> results;
+	results.reserve(mats.size());
+
+	for(const t_mat& mat : mats)
+		results.emplace_back(eigenvec_herm<t_mat, t_vec, t_real>(mat, ws, eps));
+
+	return results;
+}
+
+
+/**
+ * eigenvalues of many hermitian matrices, sharing one workspace
+ * returns a list of [eigenvalues (ascending), ok]
+ */
+template<class t_mat,
+	template<class...> class t_cont = std::vector,
+	class t_real = decltype(std::abs(typename t_mat::value_type{}))>
+std::vector<std::tuple<std::vector<t_real>, bool>>
+eigenval_herm_batch(const t_cont<t_mat>& mats, t_real eps = std::numeric_limits<t_real>::epsilon())
+requires is_mat<t_mat>
+{
+	eigen_herm_workspace<t_mat, t_real> ws;
+
+	std::vector<std::tuple<std::vector<t_real>, bool>> results;
+	results.reserve(mats.size());
+
+	for(const t_mat& mat : mats)
+		results.emplace_back(eigenval_herm<t_mat, t_real>(mat, ws, eps));
+
+	return results;
+}
+
+
 // ----------------------------------------------------------------------------
 }
 #endif
@@ -0,0 +1,473 @@
+/**
+ * self-contained fast fourier transforms
+ * @author Tobias Weber
+ * @date Nov-2018
+ * @license see 'LICENSE.EUPL' file
+ *
+ * References:
+ *  - M. Borgerding, kiss_fft, https://github.com/mborgerding/kissfft
+ *  - W. H. Press et al., Numerical Recipes, 3rd ed., sec. 12.3 (2007)
+ */
+
+#ifndef __MATH_FFT_H__
+#define __MATH_FFT_H__
+
+#include <complex>
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <cmath>
+
+#include "parallel.h"
+
+
+namespace m {
+
+// ----------------------------------------------------------------------------
+/**
+ * complex fft of a fixed length
+ * mixed-radix decimation in time with radix-4 and radix-2 butterflies
+ * and a generic butterfly for the remaining factors
+ *
+ * forward: X[k] = sum_n x[n] exp(-2pi i kn/N), inverse: with exp(+2pi i kn/N),
+ * both are unnormalised
+ */
+template<class t_real = double>
+class FFT
+{
+public:
+	using t_cplx = std::complex<t_real>;
+
+private:
+	std::size_t m_N = 0;
+	bool m_bInverse = false;
+
+	// radix p and remaining length m for each stage
+	std::vector<std::size_t> m_factors;
+
+	// exp(-+2pi i k/N)
+	std::vector<t_cplx> m_twiddles;
+
+protected:
+	void Butterfly2(t_cplx* out, std::size_t fstride, std::size_t m) const
+	{
+		const t_cplx* tw = m_twiddles.data();
+
+		for(std::size_t k=0; k<m; ++k)
+		{
+			const t_cplx t = out[m + k] * tw[k*fstride];
+			out[m + k] = out[k] - t;
+			out[k] += t;
+		}
+	}
+
+	void Butterfly4(t_cplx* out, std::size_t fstride, std::size_t m) const
+	{
+		const t_cplx* tw = m_twiddles.data();
+
+		for(std::size_t k=0; k<m; ++k)
+		{
+			const t_cplx s0 = out[k + m] * tw[k*fstride];
+			const t_cplx s1 = out[k + 2*m] * tw[2*k*fstride];
+			const t_cplx s2 = out[k + 3*m] * tw[3*k*fstride];
+
+			const t_cplx s5 = out[k] - s1;
+			out[k] += s1;
+			const t_cplx s3 = s0 + s2;
+			const t_cplx s4 = s0 - s2;
+
+			out[k + 2*m] = out[k] - s3;
+			out[k] += s3;
+
+			// s4 multiplied by -i (forward) or i (inverse)
+			const t_cplx s4i = m_bInverse ? t_cplx(-s4.imag(), s4.real()) : t_cplx(s4.imag(), -s4.real());
+			out[k + m] = s5 + s4i;
+			out[k + 3*m] = s5 - s4i;
+		}
+	}
+
+	void ButterflyGeneric(t_cplx* out, std::size_t fstride, std::size_t m, std::size_t p) const
+	{
+		const t_cplx* tw = m_twiddles.data();
+		std::vector<t_cplx> scratch(p);
+
+		for(std::size_t u=0; u<m; ++u)
+		{
+			for(std::size_t q=0, k=u; q<p; ++q, k+=m)
+				scratch[q] = out[k];
+
+			for(std::size_t q1=0, k=u; q1<p; ++q1, k+=m)
+			{
+				std::size_t iTw = 0;
+				out[k] = scratch[0];
+
+				for(std::size_t q=1; q<p; ++q)
+				{
+					iTw += fstride * k;
+					if(iTw >= m_N)
+						iTw %= m_N;
+					out[k] += scratch[q] * tw[iTw];
+				}
+			}
+		}
+	}
+
+	void Work(t_cplx* out, const t_cplx* in, std::size_t fstride, std::size_t instride,
+		const std::size_t* factors) const
+	{
+		const std::size_t p = factors[0], m = factors[1];
+		t_cplx* const outBegin = out;
+		t_cplx* const outEnd = out + p*m;
+
+		if(m == 1)
+		{
+			for(; out != outEnd; ++out, in += fstride*instride)
+				*out = *in;
+		}
+		else
+		{
+			for(; out != outEnd; out += m, in += fstride*instride)
+				Work(out, in, fstride*p, instride, factors + 2);
+		}
+
+		switch(p)
+		{
+			case 2: Butterfly2(outBegin, fstride, m); break;
+			case 4: Butterfly4(outBegin, fstride, m); break;
+			default: ButterflyGeneric(outBegin, fstride, m, p); break;
+		}
+	}
+
+public:
+	FFT(std::size_t N = 1, bool bInverse = false) { Init(N, bInverse); }
+	~FFT() = default;
+
+	void Init(std::size_t N, bool bInverse)
+	{
+		m_N = std::max<std::size_t>(N, 1);
+		m_bInverse = bInverse;
+
+		m_twiddles.resize(m_N);
+		const t_real sign = bInverse ? t_real(1) : t_real(-1);
+		for(std::size_t k=0; k<m_N; ++k)
+			m_twiddles[k] = std::polar(t_real(1), sign * t_real(2)*t_real(M_PI) * t_real(k) / t_real(m_N));
+
+		// radix 4 first, then 2, 3, 5, ...
+		m_factors.clear();
+		std::size_t n = m_N, p = 4;
+		const std::size_t pMax = std::size_t(std::sqrt(t_real(m_N)));
+		do
+		{
+			while(n % p)
+			{
+				switch(p)
+				{
+					case 4: p = 2; break;
+					case 2: p = 3; break;
+					default: p += 2; break;
+				}
+				if(p > pMax)
+					p = n;
+			}
+
+			n /= p;
+			m_factors.push_back(p);
+			m_factors.push_back(n);
+		}
+		while(n > 1);
+	}
+
+	std::size_t GetSize() const { return m_N; }
+	bool IsInverse() const { return m_bInverse; }
+
+	/**
+	 * out-of-place transform, the input is read with a stride
+	 */
+	void Transform(const t_cplx* in, t_cplx* out, std::size_t iStride = 1) const
+	{
+		if(m_N == 1)
+			*out = *in;
+		else
+			Work(out, in, 1, iStride, m_factors.data());
+	}
+
+	/**
+	 * smallest length >= N with only the factors 2, 3 and 5
+	 */
+	static std::size_t GetNiceSize(std::size_t N)
+	{
+		for(std::size_t n=std::max<std::size_t>(N, 1); true; ++n)
+		{
+			std::size_t rest = n;
+			for(std::size_t p : { 2, 3, 5 })
+				while(rest % p == 0)
+					rest /= p;
+			if(rest == 1)
+				return n;
+		}
+	}
+};
+// ----------------------------------------------------------------------------
+
+
+
+
+// ----------------------------------------------------------------------------
+/**
+ * fft of real data, the spectrum is given by its N/2+1 non-redundant elements
+ * even lengths use a complex transform of length N/2, odd lengths one of length N
+ */
+template<class t_real = double>
+class FFTReal
+{
+public:
+	using t_cplx = std::complex<t_real>;
+
+private:
+	std::size_t m_N = 0;
+	bool m_bInverse = false;
+
+	FFT<t_real> m_fft;
+
+	// exp(-+2pi i k/N) for the split of the half-length spectrum
+	std::vector<t_cplx> m_twiddles;
+
+public:
+	FFTReal(std::size_t N = 2, bool bInverse = false) { Init(N, bInverse); }
+	~FFTReal() = default;
+
+	void Init(std::size_t N, bool bInverse)
+	{
+		m_N = std::max<std::size_t>(N, 1);
+		m_bInverse = bInverse;
+
+		if(m_N % 2 == 0)
+		{
+			const std::size_t M = m_N / 2;
+			m_fft.Init(M, bInverse);
+
+			m_twiddles.resize(M);
+			const t_real sign = bInverse ? t_real(1) : t_real(-1);
+			for(std::size_t k=0; k<M; ++k)
+				m_twiddles[k] = std::polar(t_real(1), sign * t_real(2)*t_real(M_PI) * t_real(k) / t_real(m_N));
+		}
+		else
+		{
+			m_fft.Init(m_N, bInverse);
+			m_twiddles.clear();
+		}
+	}
+
+	std::size_t GetSize() const { return m_N; }
+	std::size_t GetSpectrumSize() const { return m_N/2 + 1; }
+
+	/**
+	 * size of the work buffer needed by the transforms
+	 */
+	std::size_t GetWorkSize() const { return m_N % 2 == 0 ? m_N : 2*m_N; }
+
+	/**
+	 * forward transform of N real values into N/2+1 complex values
+	 */
+	void Forward(const t_real* in, t_cplx* out, t_cplx* work) const
+	{
+		if(m_N % 2)
+		{
+			t_cplx *buf = work, *spec = work + m_N;
+			for(std::size_t n=0; n<m_N; ++n)
+				buf[n] = t_cplx(in[n], 0);
+			m_fft.Transform(buf, spec);
+			std::copy(spec, spec + GetSpectrumSize(), out);
+			return;
+		}
+
+		// pack the even and odd values into one complex sequence
+		const std::size_t M = m_N / 2;
+		t_cplx *z = work, *Z = work + M;
+		for(std::size_t n=0; n<M; ++n)
+			z[n] = t_cplx(in[2*n], in[2*n + 1]);
+		m_fft.Transform(z, Z);
+
+		for(std::size_t k=0; k<=M; ++k)
+		{
+			const t_cplx Zk = Z[k % M];
+			const t_cplx ZMk = std::conj(Z[(M - k) % M]);
+
+			const t_cplx even = t_real(0.5) * (Zk + ZMk);
+			const t_cplx odd = t_cplx(0, t_real(-0.5)) * (Zk - ZMk);
+			const t_cplx tw = k < M ? m_twiddles[k] : t_cplx(-1, 0);
+			out[k] = even + tw*odd;
+		}
+	}
+
+	/**
+	 * inverse transform of N/2+1 complex values of a hermitian spectrum into N real values
+	 */
+	void Inverse(const t_cplx* in, t_real* out, t_cplx* work) const
+	{
+		if(m_N % 2)
+		{
+			t_cplx *buf = work, *res = work + m_N;
+			for(std::size_t k=0; k<m_N; ++k)
+				buf[k] = k < GetSpectrumSize() ? in[k] : std::conj(in[m_N - k]);
+			m_fft.Transform(buf, res);
+			for(std::size_t n=0; n<m_N; ++n)
+				out[n] = res[n].real();
+			return;
+		}
+
+		// even and odd output values as real and imaginary parts of a half-length transform
+		const std::size_t M = m_N / 2;
+		t_cplx *Z = work, *z = work + M;
+		for(std::size_t k=0; k<M; ++k)
+		{
+			const t_cplx Xk = in[k];
+			const t_cplx XMk = std::conj(in[M - k]);
+
+			const t_cplx even = Xk + XMk;
+			const t_cplx odd = (Xk - XMk) * m_twiddles[k];
+			Z[k] = even + t_cplx(0, 1)*odd;
+		}
+		m_fft.Transform(Z, z);
+
+		for(std::size_t n=0; n<M; ++n)
+		{
+			out[2*n] = z[n].real();
+			out[2*n + 1] = z[n].imag();
+		}
+	}
+};
+// ----------------------------------------------------------------------------
+
+
+
+
+// ----------------------------------------------------------------------------
+/**
+ * 3d fft of real data on a grid [N1][N2][N3] with the last index running fastest,
+ * the spectrum is stored as [N1][N2][N3/2+1]; the lines are transformed in parallel over planes
+ */
+template<class t_real = double>
+class FFT3Real
+{
+public:
+	using t_cplx = std::complex<t_real>;
+
+private:
+	std::array<std::size_t, 3> m_dims{{ 1, 1, 1 }};
+	unsigned int m_iNumThreads = 0;
+
+	FFT<t_real> m_fft1[2], m_fft2[2];
+	FFTReal<t_real> m_fft3[2];
+
+protected:
+	/**
+	 * complex transforms along the first two axes of the spectrum
+	 */
+	void TransformComplexAxes(t_cplx* spec, bool bInverse) const
+	{
+		const std::size_t N1 = m_dims[0], N2 = m_dims[1], N3h = m_dims[2]/2 + 1;
+		const FFT<t_real>& fft1 = m_fft1[bInverse];
+		const FFT<t_real>& fft2 = m_fft2[bInverse];
+
+		// second axis, one plane per first index
+		run_parallel(N1, [spec, N2, N3h, &fft2](std::size_t i1)
+		{
+			std::vector<t_cplx> in(N2), out(N2);
+			t_cplx* plane = spec + i1*N2*N3h;
+
+			for(std::size_t i3=0; i3<N3h; ++i3)
+			{
+				for(std::size_t i2=0; i2<N2; ++i2)
+					in[i2] = plane[i2*N3h + i3];
+				fft2.Transform(in.data(), out.data());
+				for(std::size_t i2=0; i2<N2; ++i2)
+					plane[i2*N3h + i3] = out[i2];
+			}
+		}, m_iNumThreads);
+
+		// first axis, one plane per second index
+		run_parallel(N2, [spec, N1, N2, N3h, &fft1](std::size_t i2)
+		{
+			std::vector<t_cplx> in(N1), out(N1);
+
+			for(std::size_t i3=0; i3<N3h; ++i3)
+			{
+				for(std::size_t i1=0; i1<N1; ++i1)
+					in[i1] = spec[(i1*N2 + i2)*N3h + i3];
+				fft1.Transform(in.data(), out.data());
+				for(std::size_t i1=0; i1<N1; ++i1)
+					spec[(i1*N2 + i2)*N3h + i3] = out[i1];
+			}
+		}, m_iNumThreads);
+	}
+
+public:
+	FFT3Real(std::size_t N1 = 1, std::size_t N2 = 1, std::size_t N3 = 2) { Init(N1, N2, N3); }
+	~FFT3Real() = default;
+
+	void Init(std::size_t N1, std::size_t N2, std::size_t N3)
+	{
+		m_dims = {{ std::max<std::size_t>(N1, 1), std::max<std::size_t>(N2, 1), std::max<std::size_t>(N3, 1) }};
+
+		for(int iInv=0; iInv<2; ++iInv)
+		{
+			m_fft1[iInv].Init(m_dims[0], iInv != 0);
+			m_fft2[iInv].Init(m_dims[1], iInv != 0);
+			m_fft3[iInv].Init(m_dims[2], iInv != 0);
+		}
+	}
+
+	void SetNumThreads(unsigned int iNumThreads) { m_iNumThreads = iNumThreads; }
+
+	const std::array<std::size_t, 3>& GetDims() const { return m_dims; }
+	std::size_t GetSize() const { return m_dims[0]*m_dims[1]*m_dims[2]; }
+	std::size_t GetSpectrumSize() const { return m_dims[0]*m_dims[1]*(m_dims[2]/2 + 1); }
+
+	/**
+	 * forward transform of the real grid into the half spectrum
+	 */
+	void Forward(const t_real* in, t_cplx* spec) const
+	{
+		const std::size_t N1 = m_dims[0], N2 = m_dims[1], N3 = m_dims[2], N3h = N3/2 + 1;
+		const FFTReal<t_real>& fft3 = m_fft3[0];
+
+		run_parallel(N1, [in, spec, N2, N3, N3h, &fft3](std::size_t i1)
+		{
+			std::vector<t_cplx> work(fft3.GetWorkSize());
+			for(std::size_t i2=0; i2<N2; ++i2)
+			{
+				const std::size_t iLine = i1*N2 + i2;
+				fft3.Forward(in + iLine*N3, spec + iLine*N3h, work.data());
+			}
+		}, m_iNumThreads);
+
+		TransformComplexAxes(spec, false);
+	}
+
+	/**
+	 * inverse transform of a hermitian half spectrum into the real grid, the spectrum is overwritten
+	 */
+	void Inverse(t_cplx* spec, t_real* out) const
+	{
+		const std::size_t N1 = m_dims[0], N2 = m_dims[1], N3 = m_dims[2], N3h = N3/2 + 1;
+		const FFTReal<t_real>& fft3 = m_fft3[1];
+
+		TransformComplexAxes(spec, true);
+
+		run_parallel(N1, [spec, out, N2, N3, N3h, &fft3](std::size_t i1)
+		{
+			std::vector<t_cplx> work(fft3.GetWorkSize());
+			for(std::size_t i2=0; i2<N2; ++i2)
+			{
+				const std::size_t iLine = i1*N2 + i2;
+				fft3.Inverse(spec + iLine*N3h, out + iLine*N3, work.data());
+			}
+		}, m_iNumThreads);
+	}
+};
+// ----------------------------------------------------------------------------
+
+}
+
+#endif
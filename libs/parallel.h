@@ -0,0 +1,60 @@
+/**
+ * helpers to distribute work over threads
+ * @author Tobias Weber
+ * @date Nov-2018
+ * @license see 'LICENSE.EUPL' file
+ */
+
+#ifndef __PARALLEL_H__
+#define __PARALLEL_H__
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <cstddef>
+
+
+namespace m {
+
+/**
+ * number of threads to use, 0 selects the number of hardware threads
+ */
+inline unsigned int get_num_threads(unsigned int iNumThreads = 0)
+{
+	if(iNumThreads == 0)
+		iNumThreads = std::max<unsigned int>(1, std::thread::hardware_concurrency());
+	return iNumThreads;
+}
+
+
+/**
+ * calls func(idx) for idx in [0, num) using the given number of threads (0: hardware threads),
+ * the indices are handed out one by one, the calling thread also takes part
+ */
+template<class t_func>
+void run_parallel(std::size_t num, t_func func, unsigned int iNumThreads = 0)
+{
+	iNumThreads = get_num_threads(iNumThreads);
+	iNumThreads = std::min<std::size_t>(iNumThreads, std::max<std::size_t>(num, 1));
+
+	std::atomic<std::size_t> iNext{0};
+	auto worker = [&iNext, num, &func]()
+	{
+		for(std::size_t idx = iNext++; idx < num; idx = iNext++)
+			func(idx);
+	};
+
+	std::vector<std::thread> threads;
+	threads.reserve(iNumThreads - 1);
+	for(unsigned int iThread=1; iThread<iNumThreads; ++iThread)
+		threads.emplace_back(worker);
+	worker();
+
+	for(auto& thread : threads)
+		thread.join();
+}
+
+}
+
+#endif
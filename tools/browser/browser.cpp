@@ -7,8 +7,12 @@
 
 #include "browser.h"
 #include <sstream>
+#include <vector>
 
+#include <QtCore/QItemSelectionModel>
 #include <QtWidgets/QMenuBar>
+#include <QtWidgets/QInputDialog>
+#include <QtWidgets/QMessageBox>
 
 
 // ----------------------------------------------------------------------------
@@ -22,6 +26,14 @@ SgBrowserDlg::SgBrowserDlg(QWidget* pParent, QSettings *pSett)
 	this->setupUi(this);
 	auto *pLayout = this->layout();
 
+	m_pModel = new SgTreeModel(this);
+	m_pTree->setModel(m_pModel);
+
+	m_pProgress = new QProgressBar(this);
+	m_pProgress->setRange(0, 0);
+	m_pProgress->setFormat("Loading space groups: %v / %m");
+	pLayout->addWidget(m_pProgress);
+
 	// menu
 	auto *pMenuBar = new QMenuBar(this);
 	auto *pMenuOptions = new QMenu("Options", pMenuBar);
@@ -31,6 +43,9 @@ SgBrowserDlg::SgBrowserDlg(QWidget* pParent, QSettings *pSett)
 	pShowBNS->setChecked(true);
 	pMenuOptions->addAction(pShowBNS);
 
+	auto *pFindWyc = new QAction("Find Wyckoff Site...", pMenuOptions);
+	pMenuOptions->addAction(pFindWyc);
+
 	pMenuBar->addMenu(pMenuOptions);
 	pLayout->setMenuBar(pMenuBar);
 	// ------------------------------------------------------------------------
@@ -48,85 +63,157 @@ SgBrowserDlg::SgBrowserDlg(QWidget* pParent, QSettings *pSett)
 	// ------------------------------------------------------------------------
 
 
-	// load data
-	SetupSpaceGroups();
-
-
 	// ------------------------------------------------------------------------
 	// connections
-	connect(m_pTree, &QTreeWidget::currentItemChanged, this, &SgBrowserDlg::SpaceGroupSelected);
+	connect(m_pTree->selectionModel(), &QItemSelectionModel::currentChanged, this,
+		[this](const QModelIndex& idx, const QModelIndex&) { SpaceGroupSelected(idx); });
 	connect(pShowBNS, &QAction::toggled, this, &SgBrowserDlg::SwitchToBNS);
+	connect(pFindWyc, &QAction::triggered, this, &SgBrowserDlg::FindWycSite);
+	connect(m_pFilter, &QLineEdit::textChanged, this, &SgBrowserDlg::FilterChanged);
 	// ------------------------------------------------------------------------
+
+
+	// load data
+	SetupSpaceGroups();
+}
+
+
+SgBrowserDlg::~SgBrowserDlg()
+{
+	StopLoading();
 }
 
 
 // ----------------------------------------------------------------------------
 /**
- * load space group list
+ * load space group list in a worker thread, the groups are passed to the ui thread in chunks
  */
 void SgBrowserDlg::SetupSpaceGroups()
 {
-	std::cerr << "Loading space groups ... ";
-	m_sgs.Load("../magsg.info");
-	std::cerr << "Done." << std::endl;
+	m_pModel->SetSpacegroups(&m_sgs);
 
-	const auto *pSgs = m_sgs.GetSpacegroups();
-	if(pSgs)
+	m_threadLoad = std::thread([this]()
 	{
-		for(const auto& sg : *pSgs)
-			SetupSpaceGroup(sg);
-	}
+		using t_sgvec = std::vector<Spacegroup<t_mat_sg, t_vec_sg>>;
+		constexpr std::size_t iChunkSize = 64;
+
+		auto chunk = std::make_shared<t_sgvec>();
+		std::size_t iNumLoaded = 0, iNumGroups = 0;
+
+		auto send_chunk = [this, &chunk, &iNumLoaded, &iNumGroups]()
+		{
+			QMetaObject::invokeMethod(this, [this, chunk, iNumLoaded, iNumGroups]()
+			{
+				SpaceGroupsLoaded(chunk, iNumLoaded, iNumGroups);
+			}, Qt::QueuedConnection);
+
+			chunk = std::make_shared<t_sgvec>();
+		};
+
+		Spacegroups<t_mat_sg, t_vec_sg> loader;
+		bool bOk = loader.Load("../magsg.info",
+			[this, &chunk, &iNumLoaded, &iNumGroups, &send_chunk]
+			(Spacegroup<t_mat_sg, t_vec_sg>&& sg, std::size_t iGroup, std::size_t iTotal) -> bool
+			{
+				chunk->emplace_back(std::move(sg));
+				iNumLoaded = iGroup + 1;
+				iNumGroups = iTotal;
+
+				if(chunk->size() >= iChunkSize)
+					send_chunk();
+
+				return !m_bStopLoading.load();
+			});
+
+		if(chunk->size())
+			send_chunk();
+
+		QMetaObject::invokeMethod(this, [this, bOk]() { LoadingFinished(bOk); }, Qt::QueuedConnection);
+	});
 }
 
 
 /**
- * add space group to tree widget
+ * cancels loading and waits for the worker thread
  */
-void SgBrowserDlg::SetupSpaceGroup(const Spacegroup<t_mat_sg, t_vec_sg>& sg)
+void SgBrowserDlg::StopLoading()
 {
-	int iNrStruct = sg.GetStructNumber();
-	int iNrMag = sg.GetMagNumber();
+	m_bStopLoading.store(true);
+	if(m_threadLoad.joinable())
+		m_threadLoad.join();
+}
 
-	//std::cout << iNrStruct << std::endl;
 
-	// find top-level item with given structural sg number
-	auto get_topsg = [](QTreeWidget *pTree, int iStructNr) -> QTreeWidgetItem*
+/**
+ * a chunk of space groups has been loaded
+ */
+void SgBrowserDlg::SpaceGroupsLoaded(std::shared_ptr<std::vector<Spacegroup<t_mat_sg, t_vec_sg>>> sgs,
+	std::size_t iNumLoaded, std::size_t iNumGroups)
+{
+	// the groups keep their addresses as long as they fit into the reserved space
+	if(m_sgs.GetSpacegroups()->size() == 0)
 	{
-		for(int item=0; item<pTree->topLevelItemCount(); ++item)
-		{
-			QTreeWidgetItem *pItem = pTree->topLevelItem(item);
-			if(!pItem) continue;
+		m_sgs.Reserve(iNumGroups);
+		std::cerr << "Space group file parsed after "
+			<< std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_timeStart).count()
+			<< " ms." << std::endl;
+	}
 
-			if(pItem->data(0, Qt::UserRole) == iStructNr)
-				return pItem;
-		}
+	for(auto& sg : *sgs)
+	{
+		m_search.Add(sg);
+		m_sgs.Add(std::move(sg));
+	}
+
+	if(m_pModel->IsFiltered())
+	{
+		// also show the new groups which match the current filter
+		auto matches = m_search.Find(m_pFilter->text().toStdString());
+		m_pModel->AddSpacegroups(&matches);
+	}
+	else
+	{
+		m_pModel->AddSpacegroups();
+	}
 
-		return nullptr;
-	};
+	m_pProgress->setRange(0, int(iNumGroups));
+	m_pProgress->setValue(int(iNumLoaded));
+}
 
 
-	// find existing top-level structural space group or insert new one
-	auto *pTopItem = get_topsg(m_pTree, iNrStruct);
-	if(!pTopItem)
-	{
-		QString structname = ("(" + std::to_string(iNrStruct) + ") " + sg.GetName()).c_str();
+void SgBrowserDlg::LoadingFinished(bool bOk)
+{
+	if(m_threadLoad.joinable())
+		m_threadLoad.join();
 
-		pTopItem = new QTreeWidgetItem();
-		pTopItem->setText(0, structname);
-		pTopItem->setData(0, Qt::UserRole, iNrStruct);
-		pTopItem->setData(0, Qt::UserRole+1, iNrMag);
-		m_pTree->addTopLevelItem(pTopItem);
-	}
+	m_pProgress->hide();
 
+	if(!bOk)
+		std::cerr << "Loading space groups failed or was cancelled." << std::endl;
+	std::cerr << m_sgs.GetSpacegroups()->size() << " space groups loaded after "
+		<< std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_timeStart).count()
+		<< " ms." << std::endl;
+}
+/**
+ * filter text changed, only the groups matching all tokens are shown
+ */
+void SgBrowserDlg::FilterChanged(const QString& strFilter)
+{
+	const std::string filter = strFilter.trimmed().toStdString();
 
-	// create magnetic group and add it as sub-item for the corresponding structural group
-	QString magname = ("(" + sg.GetNumber() + ") " + sg.GetName()).c_str();
+	if(filter == "")
+	{
+		m_pModel->SetFilter(nullptr);
+	}
+	else
+	{
+		auto matches = m_search.Find(filter);
+		m_pModel->SetFilter(&matches);
 
-	auto *pSubItem = new QTreeWidgetItem();
-	pSubItem->setText(0, magname);
-	pSubItem->setData(0, Qt::UserRole, iNrStruct);
-	pSubItem->setData(0, Qt::UserRole+1, iNrMag);
-	pTopItem->addChild(pSubItem);
+		// show the magnetic groups of small result sets
+		if(matches.size() <= 64)
+			m_pTree->expandAll();
+	}
 }
 // ----------------------------------------------------------------------------
 
@@ -137,133 +224,165 @@ void SgBrowserDlg::SetupSpaceGroup(const Spacegroup<t_mat_sg, t_vec_sg>& sg)
 void SgBrowserDlg::SwitchToBNS(bool bBNS)
 {
 	m_showBNS = bBNS;
-	SpaceGroupSelected(m_pTree->currentItem());
+	SpaceGroupSelected(m_pTree->currentIndex());
 }
 
 
 /**
  * space group selected
  */
-void SgBrowserDlg::SpaceGroupSelected(QTreeWidgetItem *pItem)
+void SgBrowserDlg::SpaceGroupSelected(const QModelIndex& idx)
 {
-	if(!pItem) return;
-
 	// clean up
 	m_pSymOps->clear();
 	m_pWyc->clear();
+	m_pCurSg = nullptr;
 
-	int iNrStruct = pItem->data(0, Qt::UserRole).toInt();
-	int iNrMag = pItem->data(0, Qt::UserRole+1).toInt();
-
-	const auto* pSg = m_sgs.GetSpacegroupByNumber(iNrStruct, iNrMag);
+	const auto* pSg = m_pModel->GetSpacegroup(idx);
 	if(!pSg) return;
+	m_pCurSg = pSg;
 
+	const SgView& view = GetView(*pSg, m_showBNS);
 
-	// print a symmetry operator
-	auto print_sym = [](const t_mat_sg& mat, const t_vec_sg& vec, t_real_sg inv) -> std::string
+	// symmetry operators
+	m_pSymOps->addItems(view.ops);
+
+	// wyckoff positions
+	QList<QTreeWidgetItem*> wycItems;
+	for(const auto& [name, entries] : view.wycs)
 	{
-		std::ostringstream ostr;
+		auto *pWycItem = new QTreeWidgetItem();
+		pWycItem->setText(0, name);
 
-		for(std::size_t i=0; i<mat.size1(); ++i)
+		for(const QString& entry : entries)
 		{
-			// rotation matrix
-			ostr << "( ";
-			for(std::size_t j=0; j<mat.size2(); ++j)
-				ostr << std::setw(ostr.precision()*1.5) << std::right << mat(i,j);
-			ostr << " )";
-
-			// translation vector
-			ostr << std::setw(ostr.precision()*2) << std::right << "( ";
-			ostr << std::setw(ostr.precision()*1.5) << std::right << vec[i]; 
-			ostr << " )";
-
-			// time inversion
-			if(i==mat.size1()/2)
-			{
-				ostr << std::setw(ostr.precision()*2) << std::right << "t = ";
-				ostr << inv;
-			}
-
-			if(i < mat.size1()-1)
-				ostr << "\n";
+			auto *pSubItem = new QTreeWidgetItem();
+			pSubItem->setText(0, entry);
+			pWycItem->addChild(pSubItem);
 		}
 
-		return ostr.str();
-	};
-
+		wycItems.push_back(pWycItem);
+	}
 
-	// print a wyckoff position
-	auto print_wyc = [](const t_mat_sg& mat, const t_mat_sg& matRot,  const t_vec_sg& vec) -> std::string
-	{
-		std::ostringstream ostr;
+	m_pWyc->addTopLevelItems(wycItems);
+	m_pWyc->expandAll();
+}
 
-		for(std::size_t i=0; i<mat.size1(); ++i)
-		{
-			// rotation matrices
-			ostr << "( ";
-			for(std::size_t j=0; j<mat.size2(); ++j)
-				ostr << std::setw(ostr.precision()*1.5) << std::right << mat(i,j);
-
-			ostr  << " | ";
-			for(std::size_t j=0; j<matRot.size2(); ++j)
-				ostr << std::setw(ostr.precision()*1.5) << std::right << matRot(i,j);
-			ostr << " )";
-
-			// translation vector
-			ostr << std::setw(ostr.precision()*2) << std::right << "( ";
-			ostr << std::setw(ostr.precision()*1.5) << std::right << vec[i]; 
-			ostr << " )";
-
-			if(i < mat.size1()-1)
-				ostr << "\n";
-		}
 
-		return ostr.str();
-	};
+/**
+ * formatted operators and wyckoff positions of a space group in the given setting
+ */
+const SgView& SgBrowserDlg::GetView(const Spacegroup<t_mat_sg, t_vec_sg>& sg, bool bBNS)
+{
+	const std::uintptr_t key = (reinterpret_cast<std::uintptr_t>(&sg) << 1) | (bBNS ? 1 : 0);
+	if(const SgView* view = m_cacheViews.Get(key); view)
+		return *view;
 
+	SgView view;
 
-	// iterate over symmetries
-	const auto *symms = pSg->GetSymmetries(m_showBNS);
+	// symmetry operators in coordinate triplet notation with time inversion
+	const auto *symms = sg.GetSymmetries(bBNS);
 	if(symms)
 	{
-		for(std::size_t iOp=0; iOp<symms->GetRotations().size(); ++iOp)
+		const auto& exactops = symms->GetExactOps();
+		const auto rots = symms->GetRotations();
+		const auto invs = symms->GetInversions();
+		const auto& transs = symms->GetTranslations();
+
+		for(std::size_t iOp=0; iOp<rots.size(); ++iOp)
 		{
-			const auto& rot = symms->GetRotations()[iOp];
-			const auto& trans = symms->GetTranslations()[iOp];
-			const auto inv = symms->GetInversions()[iOp];
+			std::string op;
+			if(exactops.size() == rots.size())
+			{
+				op = exactops[iOp].to_xyz();
+			}
+			else
+			{
+				op = get_xyz(rots[iOp], transs[iOp]);
+				op += invs[iOp] < 0 ? ",-1" : ",+1";
+			}
 
-			auto *pOpItem = new QListWidgetItem();
-			pOpItem->setText(print_sym(rot, trans, inv).c_str());
-			m_pSymOps->addItem(pOpItem);
+			view.ops.push_back(op.c_str());
 		}
 	}
 
-
-	// iterate over wyckoff positions
-	const auto *wycs = pSg->GetWycPositions(m_showBNS);
+	// wyckoff positions with the constraints on the moments
+	const auto *wycs = sg.GetWycPositions(bBNS);
 	if(wycs)
 	{
+		static const char* const momvars[] = { "mx", "my", "mz" };
+		const t_vec_sg zero = m::zero<t_vec_sg>(3);
+
 		for(const auto &wyc : *wycs)
 		{
-			auto *pWycItem = new QTreeWidgetItem();
-			pWycItem->setText(0, wyc.GetName().c_str());
-
-			// iterate over trafos
+			QStringList entries;
 			for(std::size_t iOp=0; iOp<wyc.GetRotations().size(); ++iOp)
 			{
-				const auto& rot = wyc.GetRotations()[iOp];
-				const auto& rotMag = wyc.GetRotationsMag()[iOp];
-				const auto& trans = wyc.GetTranslations()[iOp];
+				std::string entry = get_xyz(wyc.GetRotations()[iOp], wyc.GetTranslations()[iOp]);
+				entry += " | ";
+				entry += get_xyz(wyc.GetRotationsMag()[iOp], zero, momvars);
 
-				auto *pSubItem = new QTreeWidgetItem();
-				pSubItem->setText(0, print_wyc(rot, rotMag, trans).c_str());
-				pWycItem->addChild(pSubItem);
+				entries.push_back(entry.c_str());
 			}
 
-			m_pWyc->addTopLevelItem(pWycItem);
-			pWycItem->setExpanded(true);
+			view.wycs.emplace_back(wyc.GetName().c_str(), std::move(entries));
 		}
 	}
+
+	return m_cacheViews.Put(key, std::move(view));
+}
+
+
+/**
+ * look up the wyckoff site and orbit of a position in the selected space group
+ */
+void SgBrowserDlg::FindWycSite()
+{
+	if(!m_pCurSg)
+	{
+		QMessageBox::warning(this, "Wyckoff Site", "No space group selected.");
+		return;
+	}
+
+	bool bOk = false;
+	QString strPos = QInputDialog::getText(this, "Wyckoff Site", "Position (x y z):",
+		QLineEdit::Normal, "0 0 0", &bOk);
+	if(!bOk)
+		return;
+
+	t_vec_sg pos = m::zero<t_vec_sg>(3);
+	std::istringstream istrPos(strPos.toStdString());
+	for(std::size_t i=0; i<3; ++i)
+		istrPos >> pos[i];
+
+	WycLookup<t_mat_sg, t_vec_sg> wyc;
+	if(!wyc.Create(*m_pCurSg, m_showBNS))
+	{
+		QMessageBox::critical(this, "Wyckoff Site", "Invalid Wyckoff positions.");
+		return;
+	}
+
+	auto [site, bFound] = wyc.Find(pos);
+	auto [orbit, moments, bMomOk] = wyc.GetOrbit(pos);
+
+	std::ostringstream ostr;
+	if(bFound)
+	{
+		ostr << "Wyckoff site: " << site.mult << site.letter << "\n";
+		ostr << "Free parameters: " << site.numFree
+			<< " (x = " << site.params[0] << ", y = " << site.params[1]
+			<< ", z = " << site.params[2] << ")\n";
+	}
+	else
+	{
+		ostr << "No Wyckoff site found.\n";
+	}
+
+	ostr << "\nOrbit (" << orbit.size() << " positions):\n";
+	for(const auto& vec : orbit)
+		ostr << "(" << vec[0] << ", " << vec[1] << ", " << vec[2] << ")\n";
+
+	QMessageBox::information(this, "Wyckoff Site", ostr.str().c_str());
 }
 
 
@@ -279,8 +398,24 @@ void SgBrowserDlg::hideEvent(QHideEvent *pEvt)
 }
 
 
+void SgBrowserDlg::paintEvent(QPaintEvent *pEvt)
+{
+	if(!m_bPainted)
+	{
+		m_bPainted = true;
+		std::cerr << "First paint after "
+			<< std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_timeStart).count()
+			<< " ms." << std::endl;
+	}
+
+	QDialog::paintEvent(pEvt);
+}
+
+
 void SgBrowserDlg::closeEvent(QCloseEvent *pEvt)
 {
+	StopLoading();
+
 	if(m_pSettings)
 	{
 		m_pSettings->setValue("sgbrowser/geo", this->saveGeometry());
@@ -10,20 +10,35 @@
 
 
 #include <QtCore/QSettings>
-#include <QtGui/QGenericMatrix>
+#include <QtCore/QStringList>
 #include <QtWidgets/QDialog>
 #include <QtWidgets/QTreeWidgetItem>
 #include <QtWidgets/QListWidgetItem>
+#include <QtWidgets/QProgressBar>
 
-#include "libs/magsg.h"
-#include "libs/math_conts.h"
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+#include "sgmodel.h"
+#include "lrucache.h"
+#include "libs/magwyc.h"
+#include "libs/magsgsearch.h"
 
 #include "ui_browser.h"
 
 
-using t_real_sg = double;
-using t_vec_sg = m::qvec_adapter<int, 3, t_real_sg, QGenericMatrix>;
-using t_mat_sg = m::qmat_adapter<int, 3, 3, t_real_sg, QGenericMatrix>;
+/**
+ * formatted operators and wyckoff positions of a space group
+ */
+struct SgView
+{
+	QStringList ops;
+	std::vector<std::pair<QString, QStringList>> wycs;
+};
 
 
 class SgBrowserDlg : public QDialog, Ui::SgBrowserDlg
@@ -31,25 +46,47 @@ class SgBrowserDlg : public QDialog, Ui::SgBrowserDlg
 private:
 	QSettings *m_pSettings = nullptr;
 	Spacegroups<t_mat_sg, t_vec_sg> m_sgs;
+	SgTreeModel *m_pModel = nullptr;
+	MagSgSearch<t_mat_sg, t_vec_sg> m_search;
+
+	// formatted views, keyed by space group and setting
+	LRUCache<std::uintptr_t, SgView> m_cacheViews{256};
 	bool m_showBNS = true;
+	const Spacegroup<t_mat_sg, t_vec_sg>* m_pCurSg = nullptr;
+
+	// background loading
+	std::thread m_threadLoad;
+	std::atomic<bool> m_bStopLoading{false};
+	QProgressBar *m_pProgress = nullptr;
+
+	// startup timing
+	std::chrono::steady_clock::time_point m_timeStart = std::chrono::steady_clock::now();
+	bool m_bPainted = false;
 
 private:
-	void SetupSpaceGroup(const Spacegroup<t_mat_sg, t_vec_sg>& sg);
 	void SetupSpaceGroups();
+	void StopLoading();
+	const SgView& GetView(const Spacegroup<t_mat_sg, t_vec_sg>& sg, bool bBNS);
 
 protected:
 	virtual void showEvent(QShowEvent *pEvt) override;
 	virtual void hideEvent(QHideEvent *pEvt) override;
 	virtual void closeEvent(QCloseEvent *pEvt) override;
+	virtual void paintEvent(QPaintEvent *pEvt) override;
 
 	// slots
-	void SpaceGroupSelected(QTreeWidgetItem *pItem);
+	void SpaceGroupsLoaded(std::shared_ptr<std::vector<Spacegroup<t_mat_sg, t_vec_sg>>> sgs,
+		std::size_t iNumLoaded, std::size_t iNumGroups);
+	void LoadingFinished(bool bOk);
+	void FilterChanged(const QString& strFilter);
+	void SpaceGroupSelected(const QModelIndex& idx);
 	void SwitchToBNS(bool bBNS);
+	void FindWycSite();
 
 public:
 	using QDialog::QDialog;
 	SgBrowserDlg(QWidget* pParent = nullptr, QSettings* pSett = nullptr);
-	~SgBrowserDlg() = default;
+	virtual ~SgBrowserDlg();
 };
 
 
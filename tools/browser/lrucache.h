@@ -0,0 +1,93 @@
+/**
+ * least-recently-used cache
+ * @author Tobias Weber
+ * @date Nov-2018
+ * @license see 'LICENSE.GPL' file
+ */
+
+#ifndef __LRUCACHE_H__
+#define __LRUCACHE_H__
+
+
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+
+/**
+ * map with a maximum size, the least recently accessed entry is evicted first
+ */
+template<class t_key, class t_val, class t_hash = std::hash<t_key>>
+class LRUCache
+{
+private:
+	using t_list = std::list<std::pair<t_key, t_val>>;
+
+	// entries, most recently used first
+	t_list m_entries;
+	std::unordered_map<t_key, typename t_list::iterator, t_hash> m_map;
+
+	std::size_t m_iCapacity = 64;
+
+public:
+	LRUCache(std::size_t iCapacity = 64) : m_iCapacity{iCapacity} {}
+	~LRUCache() = default;
+
+	std::size_t GetSize() const { return m_entries.size(); }
+
+	void SetCapacity(std::size_t iCapacity)
+	{
+		m_iCapacity = iCapacity;
+		while(m_entries.size() > m_iCapacity)
+		{
+			m_map.erase(m_entries.back().first);
+			m_entries.pop_back();
+		}
+	}
+
+	void Clear()
+	{
+		m_entries.clear();
+		m_map.clear();
+	}
+
+	/**
+	 * gets an entry and marks it as most recently used, nullptr if it is not cached
+	 */
+	const t_val* Get(const t_key& key)
+	{
+		auto iter = m_map.find(key);
+		if(iter == m_map.end())
+			return nullptr;
+
+		m_entries.splice(m_entries.begin(), m_entries, iter->second);
+		return &iter->second->second;
+	}
+
+	/**
+	 * inserts or replaces an entry, evicting the least recently used one if the cache is full
+	 */
+	const t_val& Put(const t_key& key, t_val&& val)
+	{
+		auto iter = m_map.find(key);
+		if(iter != m_map.end())
+		{
+			iter->second->second = std::move(val);
+			m_entries.splice(m_entries.begin(), m_entries, iter->second);
+			return iter->second->second;
+		}
+
+		if(m_entries.size() >= m_iCapacity && m_entries.size())
+		{
+			m_map.erase(m_entries.back().first);
+			m_entries.pop_back();
+		}
+
+		m_entries.emplace_front(key, std::move(val));
+		m_map.emplace(key, m_entries.begin());
+		return m_entries.front().second;
+	}
+};
+
+
+#endif
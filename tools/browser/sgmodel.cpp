@@ -0,0 +1,246 @@
+/**
+ * space group tree model
+ * @author Tobias Weber
+ * @date Nov-2018
+ * @license see 'LICENSE.GPL' file
+ */
+
+#include "sgmodel.h"
+
+#include <string>
+
+
+// ----------------------------------------------------------------------------
+
+
+/**
+ * builds the structural -> magnetic group index in one pass
+ */
+void SgTreeModel::BuildIndex()
+{
+	m_structs.clear();
+	m_rows.clear();
+	m_iNumIndexed = 0;
+
+	const auto *sgs = m_pSgs ? m_pSgs->GetSpacegroups() : nullptr;
+	if(!sgs)
+		return;
+
+	for(; m_iNumIndexed<sgs->size(); ++m_iNumIndexed)
+	{
+		if(!IsAccepted(m_iNumIndexed))
+			continue;
+
+		const int iNrStruct = (*sgs)[m_iNumIndexed].GetStructNumber();
+
+		auto iter = m_rows.find(iNrStruct);
+		if(iter == m_rows.end())
+		{
+			iter = m_rows.emplace(iNrStruct, m_structs.size()).first;
+			m_structs.emplace_back(t_structsg{ iNrStruct, {} });
+		}
+
+		m_structs[iter->second].mags.push_back(m_iNumIndexed);
+	}
+}
+
+
+void SgTreeModel::SetAccepted(const std::vector<std::uint32_t>* matches)
+{
+	m_bFiltered = (matches != nullptr);
+	m_accept.clear();
+
+	if(matches)
+	{
+		const std::size_t iNumSgs = m_pSgs ? m_pSgs->GetSpacegroups()->size() : 0;
+		m_accept.resize(iNumSgs, false);
+
+		for(std::uint32_t idx : *matches)
+		{
+			if(idx < iNumSgs)
+				m_accept[idx] = true;
+		}
+	}
+}
+
+
+void SgTreeModel::SetSpacegroups(const t_sgs *pSgs)
+{
+	beginResetModel();
+
+	m_pSgs = pSgs;
+	m_bFiltered = false;
+	m_accept.clear();
+	BuildIndex();
+
+	endResetModel();
+}
+
+
+void SgTreeModel::SetFilter(const std::vector<std::uint32_t>* matches)
+{
+	beginResetModel();
+
+	SetAccepted(matches);
+	BuildIndex();
+
+	endResetModel();
+}
+
+
+/**
+ * the groups are ordered by structural number, so consecutive groups
+ * with the same structural group are inserted at once
+ */
+void SgTreeModel::AddSpacegroups(const std::vector<std::uint32_t>* matches)
+{
+	const auto *sgs = m_pSgs ? m_pSgs->GetSpacegroups() : nullptr;
+	if(!sgs)
+		return;
+
+	// the already shown rows are kept
+	if(m_bFiltered && matches)
+		SetAccepted(matches);
+
+	while(m_iNumIndexed < sgs->size())
+	{
+		if(!IsAccepted(m_iNumIndexed))
+		{
+			++m_iNumIndexed;
+			continue;
+		}
+
+		const int iNrStruct = (*sgs)[m_iNumIndexed].GetStructNumber();
+
+		// range of new groups with this structural group
+		std::size_t iEnd = m_iNumIndexed + 1;
+		while(iEnd < sgs->size() && IsAccepted(iEnd) && (*sgs)[iEnd].GetStructNumber() == iNrStruct)
+			++iEnd;
+
+		auto iter = m_rows.find(iNrStruct);
+		if(iter == m_rows.end())
+		{
+			// new top-level row including its magnetic groups
+			const int iRow = int(m_structs.size());
+			beginInsertRows(QModelIndex(), iRow, iRow);
+
+			m_rows.emplace(iNrStruct, m_structs.size());
+			m_structs.emplace_back(t_structsg{ iNrStruct, {} });
+			for(; m_iNumIndexed<iEnd; ++m_iNumIndexed)
+				m_structs.back().mags.push_back(m_iNumIndexed);
+
+			endInsertRows();
+		}
+		else
+		{
+			// magnetic groups of an existing structural group
+			auto& mags = m_structs[iter->second].mags;
+			const int iFirst = int(mags.size());
+			beginInsertRows(createIndex(int(iter->second), 0, quintptr(0)),
+				iFirst, iFirst + int(iEnd - m_iNumIndexed) - 1);
+
+			for(; m_iNumIndexed<iEnd; ++m_iNumIndexed)
+				mags.push_back(m_iNumIndexed);
+
+			endInsertRows();
+		}
+	}
+}
+
+
+/**
+ * top-level rows have the internal id 0, magnetic rows the row of their structural group + 1
+ */
+QModelIndex SgTreeModel::index(int iRow, int iCol, const QModelIndex& parent) const
+{
+	if(iRow < 0 || iCol != 0)
+		return QModelIndex();
+
+	if(!parent.isValid())
+	{
+		if(std::size_t(iRow) >= m_structs.size())
+			return QModelIndex();
+		return createIndex(iRow, iCol, quintptr(0));
+	}
+
+	// only two levels
+	if(parent.internalId() != 0 || std::size_t(parent.row()) >= m_structs.size())
+		return QModelIndex();
+	if(std::size_t(iRow) >= m_structs[parent.row()].mags.size())
+		return QModelIndex();
+
+	return createIndex(iRow, iCol, quintptr(parent.row()) + 1);
+}
+
+
+QModelIndex SgTreeModel::parent(const QModelIndex& idx) const
+{
+	if(!idx.isValid() || idx.internalId() == 0)
+		return QModelIndex();
+
+	return createIndex(int(idx.internalId() - 1), 0, quintptr(0));
+}
+
+
+int SgTreeModel::rowCount(const QModelIndex& parent) const
+{
+	if(!parent.isValid())
+		return int(m_structs.size());
+	if(parent.internalId() != 0 || parent.column() != 0)
+		return 0;
+
+	return int(m_structs[parent.row()].mags.size());
+}
+
+
+int SgTreeModel::columnCount(const QModelIndex&) const
+{
+	return 1;
+}
+
+
+const SgTreeModel::t_sg* SgTreeModel::GetSpacegroup(const QModelIndex& idx) const
+{
+	if(!idx.isValid() || !m_pSgs)
+		return nullptr;
+
+	std::size_t iStruct = idx.internalId() == 0 ? std::size_t(idx.row()) : std::size_t(idx.internalId() - 1);
+	std::size_t iMag = idx.internalId() == 0 ? 0 : std::size_t(idx.row());
+	if(iStruct >= m_structs.size() || iMag >= m_structs[iStruct].mags.size())
+		return nullptr;
+
+	return &(*m_pSgs->GetSpacegroups())[m_structs[iStruct].mags[iMag]];
+}
+
+
+/**
+ * the item texts are only created for the visible rows
+ */
+QVariant SgTreeModel::data(const QModelIndex& idx, int iRole) const
+{
+	const t_sg *pSg = GetSpacegroup(idx);
+	if(!pSg)
+		return QVariant();
+
+	switch(iRole)
+	{
+		case Qt::DisplayRole:
+		{
+			std::string name;
+			if(idx.internalId() == 0)
+				name = "(" + std::to_string(pSg->GetStructNumber()) + ") " + pSg->GetName();
+			else
+				name = "(" + pSg->GetNumber() + ") " + pSg->GetName();
+			return QString(name.c_str());
+		}
+		case Qt::UserRole:
+			return pSg->GetStructNumber();
+		case Qt::UserRole+1:
+			return pSg->GetMagNumber();
+	}
+
+	return QVariant();
+}
+
+
+// ----------------------------------------------------------------------------
@@ -0,0 +1,91 @@
+/**
+ * space group tree model
+ * @author Tobias Weber
+ * @date Nov-2018
+ * @license see 'LICENSE.GPL' file
+ */
+
+#ifndef __SGMODEL_H__
+#define __SGMODEL_H__
+
+
+#include <QtCore/QAbstractItemModel>
+#include <QtGui/QGenericMatrix>
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+#include "libs/magsg.h"
+#include "libs/math_conts.h"
+
+
+using t_real_sg = double;
+using t_vec_sg = m::qvec_adapter<int, 3, t_real_sg, QGenericMatrix>;
+using t_mat_sg = m::qmat_adapter<int, 3, 3, t_real_sg, QGenericMatrix>;
+
+
+/**
+ * structural space groups as top-level rows with their magnetic groups as children,
+ * rows are only created on demand by the view
+ */
+class SgTreeModel : public QAbstractItemModel
+{
+public:
+	using t_sgs = Spacegroups<t_mat_sg, t_vec_sg>;
+	using t_sg = Spacegroup<t_mat_sg, t_vec_sg>;
+
+private:
+	const t_sgs *m_pSgs = nullptr;
+
+	// structural space group with the indices of its magnetic groups
+	struct t_structsg
+	{
+		int iNr = -1;
+		std::vector<std::size_t> mags;
+	};
+
+	std::vector<t_structsg> m_structs;
+
+	// row of a structural group number
+	std::unordered_map<int, std::size_t> m_rows;
+
+	// number of already indexed groups
+	std::size_t m_iNumIndexed = 0;
+
+	// groups passing the filter
+	std::vector<bool> m_accept;
+	bool m_bFiltered = false;
+
+private:
+	void BuildIndex();
+	void SetAccepted(const std::vector<std::uint32_t>* matches);
+	bool IsAccepted(std::size_t iSg) const
+	{ return !m_bFiltered || (iSg < m_accept.size() && m_accept[iSg]); }
+
+public:
+	using QAbstractItemModel::QAbstractItemModel;
+	virtual ~SgTreeModel() = default;
+
+	void SetSpacegroups(const t_sgs *pSgs);
+
+	// inserts the rows of the groups appended to the collection since the last call,
+	// the filter is updated if the matching groups are given
+	void AddSpacegroups(const std::vector<std::uint32_t>* matches = nullptr);
+
+	// only shows the given groups, all groups for nullptr
+	void SetFilter(const std::vector<std::uint32_t>* matches);
+	bool IsFiltered() const { return m_bFiltered; }
+
+	// magnetic group of a row, the first magnetic group for structural rows
+	const t_sg* GetSpacegroup(const QModelIndex& idx) const;
+
+	virtual QModelIndex index(int iRow, int iCol, const QModelIndex& parent = QModelIndex()) const override;
+	virtual QModelIndex parent(const QModelIndex& idx) const override;
+	virtual int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+	virtual int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+	virtual QVariant data(const QModelIndex& idx, int iRole = Qt::DisplayRole) const override;
+};
+
+
+#endif
@@ -10,6 +10,7 @@
  */
 
 #include "glplot.h"
+#include "glplot_labels.h"
 
 #include <QtGui/QOpenGLContext>
 #include <QtGui/QOpenGLFunctions>
@@ -104,10 +105,19 @@ void GlPlot_impl::paintGL()
 	m_pShaders->setUniformValue(m_uniMatrixCam, m_matCam);
 
 	// render triangle geometry
+	std::size_t iNumCulled = 0;
+	const t_frustum frustum = GetFrustumPlanes();
 	for(auto& obj : m_objs)
 	{
 		if(!obj.m_visible) continue;
 
+		// skip objects outside the view frustum
+		if(!IsObjectInFrustum(frustum, obj))
+		{
+			++iNumCulled;
+			continue;
+		}
+
 		// main vertex array object
 		pGl->glBindVertexArray(obj.m_vertexarr);
 
@@ -135,8 +145,13 @@ void GlPlot_impl::paintGL()
 
 		LOGGLERR(pGl);
 	}
+	m_iNumCulledObjs = iNumCulled;
 
 	pGl->glDisable(GL_DEPTH_TEST);
+
+	// render object labels
+	if(m_pLabels)
+		m_pLabels->Draw(pGl, m_objs, m_matPerspective, m_matCam, m_iScreenDims[0], m_iScreenDims[1]);
 }
 
 
@@ -10,6 +10,7 @@
  */
 
 #include "glplot_common.h"
+#include "glplot_labels.h"
 
 #include <QtCore/QMutex>
 #include <iostream>
@@ -190,6 +191,8 @@ GlPlotObj GlPlot_impl_base::CreateTriangleObject(const std::vector<t_vec3_gl>& v
 
 	obj.m_vertices = std::move(verts);
 	obj.m_triangles = std::move(triagverts);
+	std::tie(obj.m_boundingSpherePos, obj.m_boundingSphereRad) = m::bounding_sphere<t_vec3_gl>(obj.m_triangles);
+	UpdateBoundingSphere(obj);
 	LOGGLERR(pGl)
 
 	return obj;
@@ -258,6 +261,8 @@ GlPlotObj GlPlot_impl_base::CreateLineObject(const std::vector<t_vec3_gl>& verts
 
 
 	obj.m_vertices = std::move(verts);
+	std::tie(obj.m_boundingSpherePos, obj.m_boundingSphereRad) = m::bounding_sphere<t_vec3_gl>(obj.m_vertices);
+	UpdateBoundingSphere(obj);
 	LOGGLERR(pGl)
 
 	return obj;
@@ -265,22 +270,67 @@ GlPlotObj GlPlot_impl_base::CreateLineObject(const std::vector<t_vec3_gl>& verts
 
 
 
+/**
+ * transform the object's bounding sphere into world coordinates
+ */
+void GlPlot_impl_base::UpdateBoundingSphere(GlPlotObj& obj)
+{
+	const t_vec3_gl& pos = obj.m_boundingSpherePos;
+	t_vec_gl posWorld = obj.m_mat * m::create<t_vec_gl>({pos[0], pos[1], pos[2], 1.});
+	obj.m_boundingSpherePosWorld = m::create<t_vec3_gl>({posWorld[0], posWorld[1], posWorld[2]});
+
+	// scale radius by the largest axis scaling of the object matrix
+	t_real_gl scale = 0.;
+	for(int col=0; col<3; ++col)
+	{
+		t_real_gl len = std::sqrt(obj.m_mat(0,col)*obj.m_mat(0,col) +
+			obj.m_mat(1,col)*obj.m_mat(1,col) + obj.m_mat(2,col)*obj.m_mat(2,col));
+		scale = std::max(scale, len);
+	}
+	obj.m_boundingSphereRadWorld = obj.m_boundingSphereRad * scale;
+}
+
+
+/**
+ * copy of the current view frustum planes
+ */
+GlPlot_impl_base::t_frustum GlPlot_impl_base::GetFrustumPlanes() const
+{
+	QMutexLocker locker(&m_mutexFrustum);
+	return m_frustumPlanes;
+}
+
+
+/**
+ * is the object's bounding sphere inside the view frustum?
+ */
+bool GlPlot_impl_base::IsObjectInFrustum(const t_frustum& planes, const GlPlotObj& obj)
+{
+	return m::hom_sphere_in_frustum<t_vec3_gl, t_frustum>(planes,
+		obj.m_boundingSpherePosWorld, obj.m_boundingSphereRadWorld);
+}
+
+
 void GlPlot_impl_base::SetObjectMatrix(std::size_t idx, const t_mat_gl& mat)
 {
 	if(idx >= m_objs.size()) return;
 	m_objs[idx].m_mat = mat;
+	UpdateBoundingSphere(m_objs[idx]);
+	if(m_pLabels) m_pLabels->SetObjectDirty(idx);
 }
 
 void GlPlot_impl_base::SetObjectLabel(std::size_t idx, const std::string& label)
 {
 	if(idx >= m_objs.size()) return;
 	m_objs[idx].m_label = label;
+	if(m_pLabels) m_pLabels->SetObjectDirty(idx);
 }
 
 void GlPlot_impl_base::SetObjectVisible(std::size_t idx, bool visible)
 {
 	if(idx >= m_objs.size()) return;
 	m_objs[idx].m_visible = visible;
+	if(m_pLabels) m_pLabels->SetObjectDirty(idx);
 }
 
 
@@ -294,6 +344,7 @@ std::size_t GlPlot_impl_base::AddSphere(t_real_gl rad, t_real_gl x, t_real_gl y,
 
 	auto obj = CreateTriangleObject(std::get<0>(solid), triagverts, norms, m::create<t_vec_gl>({r,g,b,a}), true);
 	obj.m_mat = m::hom_translation<t_mat_gl>(x, y, z);
+	UpdateBoundingSphere(obj);
 	m_objs.emplace_back(std::move(obj));
 
 	return m_objs.size()-1;		// object handle
@@ -309,6 +360,7 @@ std::size_t GlPlot_impl_base::AddCylinder(t_real_gl rad, t_real_gl h,
 
 	auto obj = CreateTriangleObject(std::get<0>(solid), triagverts, norms, m::create<t_vec_gl>({r,g,b,a}), false);
 	obj.m_mat = m::hom_translation<t_mat_gl>(x, y, z);
+	UpdateBoundingSphere(obj);
 	m_objs.emplace_back(std::move(obj));
 
 	return m_objs.size()-1;		// object handle
@@ -324,6 +376,7 @@ std::size_t GlPlot_impl_base::AddCone(t_real_gl rad, t_real_gl h,
 
 	auto obj = CreateTriangleObject(std::get<0>(solid), triagverts, norms, m::create<t_vec_gl>({r,g,b,a}), false);
 	obj.m_mat = m::hom_translation<t_mat_gl>(x, y, z);
+	UpdateBoundingSphere(obj);
 	m_objs.emplace_back(std::move(obj));
 
 	return m_objs.size()-1;		// object handle
@@ -339,6 +392,7 @@ std::size_t GlPlot_impl_base::AddArrow(t_real_gl rad, t_real_gl h,
 
 	auto obj = CreateTriangleObject(std::get<0>(solid), triagverts, norms, m::create<t_vec_gl>({r,g,b,a}), false);
 	obj.m_mat = GetArrowMatrix(m::create<t_vec_gl>({1,0,0}), 1., m::create<t_vec_gl>({x,y,z}), m::create<t_vec_gl>({0,0,1}));
+	UpdateBoundingSphere(obj);
 	obj.m_labelPos = m::create<t_vec3_gl>({0., 0., 0.75});
 	m_objs.emplace_back(std::move(obj));
 
@@ -474,6 +528,13 @@ void main()
 	LOGGLERR(pGl);
 
 
+	// object labels
+	m_pLabels = std::make_shared<GlPlotLabels>();
+	if(!m_pLabels->Init(pGl, this))
+		m_pLabels.reset();
+	LOGGLERR(pGl);
+
+
 	// 3d objects
 	{
 		AddCoordinateCross(-2.5, 2.5);
@@ -525,6 +586,7 @@ void GlPlot_impl_base::resizeGL()
 
 	m_matPerspective = m::hom_perspective<t_mat_gl>(0.01, 100., m::pi<t_real_gl>*0.5, t_real_gl(h)/t_real_gl(w));
 	std::tie(m_matPerspective_inv, std::ignore) = m::inv<t_mat_gl>(m_matPerspective);
+	UpdateFrustum();
 
 
 	// bind shaders
@@ -551,6 +613,7 @@ void GlPlot_impl_base::UpdateCam()
 	m_matCam *= m_matCamRot;
 	m_matCam *= matZoom;
 	std::tie(m_matCam_inv, std::ignore) = m::inv<t_mat_gl>(m_matCam);
+	UpdateFrustum();
 
 	m_bPickerNeedsUpdate = true;
 	QMetaObject::invokeMethod((QOpenGLWidget*)m_pPlot,
@@ -559,6 +622,20 @@ void GlPlot_impl_base::UpdateCam()
 }
 
 
+/**
+ * get the view frustum planes in world coordinates
+ */
+void GlPlot_impl_base::UpdateFrustum()
+{
+	t_mat_gl matProjCam = m_matPerspective * m_matCam;
+	auto planes = m::hom_frustum_planes<t_mat_gl, t_vec_gl>(matProjCam);
+
+	QMutexLocker locker(&m_mutexFrustum);
+	for(std::size_t i=0; i<m_frustumPlanes.size() && i<planes.size(); ++i)
+		m_frustumPlanes[i] = planes[i];
+}
+
+
 void GlPlot_impl_base::UpdatePicker()
 {
 	if(!m_bInitialised) return;
@@ -607,6 +684,7 @@ void GlPlot_impl_base::UpdatePicker()
 	bool hasInters = false;
 	t_vec_gl vecClosestInters = m::create<t_vec_gl>({0,0,0,0});
 	std::size_t objInters = 0xffffffff;
+	const t_frustum frustum = GetFrustumPlanes();
 
 	for(std::size_t curObj=0; curObj<m_objs.size(); ++curObj)
 	{
@@ -614,6 +692,9 @@ void GlPlot_impl_base::UpdatePicker()
 
 		if(obj.m_type != GlPlotObjType::TRIANGLES || !obj.m_visible)
 			continue;
+		// objects outside the view cannot be picked
+		if(!IsObjectInFrustum(frustum, obj))
+			continue;
 
 		//obj.m_pickerInters.clear();
 
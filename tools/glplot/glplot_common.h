@@ -16,6 +16,7 @@
 #define _GL_USE_TIMER 0
 
 #include <QtCore/QTimer>
+#include <QtCore/QMutex>
 #include <QtWidgets/QDialog>
 #include <QtGui/QMouseEvent>
 
@@ -28,6 +29,7 @@
 #include <QtGui/QVector3D>
 
 #include <memory>
+#include <array>
 #include <chrono>
 #include <atomic>
 #include "../../libs/math_algos.h"
@@ -73,6 +75,7 @@ using t_mat_gl = m::qmatNN_adapter<int, 4, 4, t_real_gl, QMatrix4x4>;
 class GlPlot_impl_base;
 class GlPlot_impl;
 class GlPlot;
+class GlPlotLabels;
 
 
 enum class GlPlotObjType
@@ -86,6 +89,7 @@ struct GlPlotObj
 {
 	friend class GlPlot_impl_base;
 	friend class GlPlot_impl;
+	friend class GlPlotLabels;
 
 private:
 	GlPlotObjType m_type = GlPlotObjType::TRIANGLES;
@@ -100,6 +104,12 @@ private:
 
 	t_mat_gl m_mat = m::unit<t_mat_gl>();
 
+	// bounding sphere in object and in world coordinates
+	t_vec3_gl m_boundingSpherePos = m::create<t_vec3_gl>({0., 0., 0.});
+	t_real_gl m_boundingSphereRad = 0.;
+	t_vec3_gl m_boundingSpherePosWorld = m::create<t_vec3_gl>({0., 0., 0.});
+	t_real_gl m_boundingSphereRadWorld = 0.;
+
 	bool m_visible = true;		// object shown?
 	//std::vector<t_vec3_gl> m_pickerInters;		// intersections with mouse picker?
 
@@ -119,6 +129,7 @@ protected:
 	GlPlot *m_pPlot = nullptr;
 	std::string m_strGlDescr;
 	std::shared_ptr<QOpenGLShaderProgram> m_pShaders;
+	std::shared_ptr<GlPlotLabels> m_pLabels;
 
 	GLint m_attrVertex = -1;
 	GLint m_attrVertexNormal = -1;
@@ -146,6 +157,15 @@ protected:
 	std::atomic<int> m_iScreenDims[2] = { 800, 600 };
 	t_real_gl m_pickerSphereRadius = 1;
 
+	// view frustum planes, updated with the camera and read by the render thread,
+	// zero planes (before the first update) do not cull anything
+	using t_frustum = std::array<t_vec_gl, 6>;
+	mutable QMutex m_mutexFrustum;
+	t_frustum m_frustumPlanes;
+
+	// number of objects culled in the last frame
+	std::atomic<std::size_t> m_iNumCulledObjs = 0;
+
 	std::vector<GlPlotObj> m_objs;
 
 	QPointF m_posMouse;
@@ -161,6 +181,11 @@ protected:
 
 	void UpdateCam();
 	void UpdatePicker();
+	void UpdateFrustum();
+
+	static void UpdateBoundingSphere(GlPlotObj& obj);
+	t_frustum GetFrustumPlanes() const;
+	static bool IsObjectInFrustum(const t_frustum& planes, const GlPlotObj& obj);
 
 	void tick(const std::chrono::milliseconds& ms);
 
@@ -169,6 +194,7 @@ public:
 	virtual ~GlPlot_impl_base();
 
 	const std::string& GetGlDescr() const { return m_strGlDescr; }
+	std::size_t GetNumCulledObjects() const { return m_iNumCulledObjs; }
 
 	QPointF GlToScreenCoords(const t_vec_gl& vec, bool *pVisible=nullptr);
 	static t_mat_gl GetArrowMatrix(const t_vec_gl& vecTo, t_real_gl scale,
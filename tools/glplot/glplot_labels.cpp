@@ -0,0 +1,430 @@
+/**
+ * GL plotter object labels
+ * @author Tobias Weber
+ * @date Nov-2018
+ * @license: see 'LICENSE.GPL' file
+ */
+
+#include "glplot_labels.h"
+
+#include <QtGui/QPainter>
+#include <QtGui/QFontMetrics>
+#include <QtGui/QVector2D>
+
+#include <iostream>
+#include <boost/scope_exit.hpp>
+#include <boost/algorithm/string/replace.hpp>
+namespace algo = boost::algorithm;
+
+
+// ----------------------------------------------------------------------------
+bool GlPlotLabels::Init(qgl_funcs* pGl, QObject *pParent, int iAtlasSize)
+{
+	if(!pGl) return false;
+
+	// --------------------------------------------------------------------
+	// shaders
+	// --------------------------------------------------------------------
+	std::string strFragShader = R"RAW(#version ${GLSL_VERSION}
+
+in vec2 fraguv;
+in vec4 fragcolor;
+out vec4 outcolor;
+
+uniform sampler2D atlas;
+
+void main()
+{
+	outcolor = vec4(fragcolor.rgb, fragcolor.a * texture(atlas, fraguv).a);
+})RAW";
+// --------------------------------------------------------------------
+
+
+// --------------------------------------------------------------------
+std::string strVertexShader = R"RAW(#version ${GLSL_VERSION}
+
+in vec3 labelpos;
+in vec2 labeloffs;
+in vec2 labeluv;
+in vec4 labelcolor;
+out vec2 fraguv;
+out vec4 fragcolor;
+
+uniform mat4 proj = mat4(1.);
+uniform mat4 cam = mat4(1.);
+uniform vec2 screen = vec2(800., 600.);
+
+void main()
+{
+	// project label anchor and shift quad corner by its pixel offset
+	vec4 pos = proj * cam * vec4(labelpos, 1.);
+	pos.xy += labeloffs * 2. / screen * pos.w;
+	gl_Position = pos;
+
+	fraguv = labeluv;
+	fragcolor = labelcolor;
+})RAW";
+// --------------------------------------------------------------------
+
+
+	// set glsl version
+	std::string strGlsl = std::to_string(_GL_MAJ_VER*100 + _GL_MIN_VER*10);
+	for(std::string* strSrc : { &strFragShader, &strVertexShader })
+		algo::replace_all(*strSrc, std::string("${GLSL_VERSION}"), strGlsl);
+
+
+	// compile & link shaders
+	m_pShaders = std::make_shared<QOpenGLShaderProgram>(pParent);
+
+	if(!m_pShaders->addShaderFromSourceCode(QOpenGLShader::Fragment, strFragShader.c_str()) ||
+		!m_pShaders->addShaderFromSourceCode(QOpenGLShader::Vertex, strVertexShader.c_str()) ||
+		!m_pShaders->link())
+	{
+		std::cerr << "Cannot create label shaders." << std::endl;
+
+		std::string strLog = m_pShaders->log().toStdString();
+		if(strLog.size())
+			std::cerr << "Shader log: " << strLog << std::endl;
+
+		m_pShaders.reset();
+		return false;
+	}
+
+	m_uniMatrixCam = m_pShaders->uniformLocation("cam");
+	m_uniMatrixProj = m_pShaders->uniformLocation("proj");
+	m_uniScreen = m_pShaders->uniformLocation("screen");
+	m_uniAtlas = m_pShaders->uniformLocation("atlas");
+	m_attrPos = m_pShaders->attributeLocation("labelpos");
+	m_attrOffs = m_pShaders->attributeLocation("labeloffs");
+	m_attrUV = m_pShaders->attributeLocation("labeluv");
+	m_attrColor = m_pShaders->attributeLocation("labelcolor");
+	LOGGLERR(pGl);
+
+
+	// glyph atlas
+	m_atlas = QImage(iAtlasSize, iAtlasSize, QImage::Format_ARGB32_Premultiplied);
+	m_atlas.fill(Qt::transparent);
+	m_atlasX = m_atlasY = m_atlasRowHeight = 0;
+	m_glyphs.clear();
+
+
+	// label vertex array object
+	pGl->glGenVertexArrays(1, &m_vertexarr);
+	m_pvertexbuf = std::make_shared<QOpenGLBuffer>(QOpenGLBuffer::VertexBuffer);
+	m_pvertexbuf->create();
+	m_pvertexbuf->setUsagePattern(QOpenGLBuffer::DynamicDraw);
+	LOGGLERR(pGl);
+
+	m_bNeedsRebuild = true;
+	return true;
+}
+
+
+/**
+ * get a glyph from the atlas, rasterise it if it is not yet available
+ */
+const GlPlotGlyph* GlPlotLabels::GetGlyph(QChar ch, int weight)
+{
+	const std::uint64_t key = (std::uint64_t(ch.unicode()) << 8) | std::uint64_t(weight & 0xff);
+
+	auto iter = m_glyphs.find(key);
+	if(iter != m_glyphs.end())
+		return &iter->second;
+
+	QFont font = m_font;
+	font.setWeight(weight);
+	QFontMetrics metrics(font);
+
+	const int pad = 1;
+	const int adv = metrics.width(ch);
+	const int w = adv + 2*pad;
+	const int h = metrics.ascent() + metrics.descent() + 2*pad;
+
+	// next row in atlas
+	if(m_atlasX + w > m_atlas.width())
+	{
+		m_atlasX = 0;
+		m_atlasY += m_atlasRowHeight;
+		m_atlasRowHeight = 0;
+	}
+
+	if(m_atlasY + h > m_atlas.height())
+	{
+		std::cerr << "Label glyph atlas is full." << std::endl;
+		return nullptr;
+	}
+
+	{	// rasterise glyph
+		QPainter painter(&m_atlas);
+		painter.setRenderHint(QPainter::TextAntialiasing);
+		painter.setFont(font);
+		painter.setPen(Qt::white);
+		painter.drawText(m_atlasX + pad, m_atlasY + pad + metrics.ascent(), QString(ch));
+	}
+
+	const t_real_gl atlasW = t_real_gl(m_atlas.width());
+	const t_real_gl atlasH = t_real_gl(m_atlas.height());
+
+	GlPlotGlyph glyph;
+	glyph.u0 = t_real_gl(m_atlasX) / atlasW;
+	glyph.u1 = t_real_gl(m_atlasX + w) / atlasW;
+	glyph.v0 = t_real_gl(m_atlasY) / atlasH;
+	glyph.v1 = t_real_gl(m_atlasY + h) / atlasH;
+	glyph.x0 = -pad;
+	glyph.x1 = adv + pad;
+	glyph.y0 = metrics.ascent() + pad;
+	glyph.y1 = glyph.y0 - h;
+	glyph.advance = adv;
+
+	m_atlasX += w;
+	m_atlasRowHeight = std::max(m_atlasRowHeight, h);
+	m_atlasDirty = true;
+
+	return &m_glyphs.emplace(key, glyph).first->second;
+}
+
+
+/**
+ * create the quads of an object's label: a medium-weight dark pass
+ * with a normal-weight pass in the object colour on top
+ */
+void GlPlotLabels::CreateLabelVerts(const GlPlotObj& obj, std::vector<t_real_gl>& verts)
+{
+	const QString label = QString::fromStdString(obj.m_label);
+	const t_vec3_gl pos = obj.m_mat * obj.m_labelPos;
+
+	const t_real_gl colDark[] = { 0., 0., 0., 1. };
+	const t_real_gl colObj[] = { obj.m_color[0], obj.m_color[1], obj.m_color[2], obj.m_color[3] };
+
+	for(auto [weight, col] : { std::make_tuple(int(QFont::Medium), colDark),
+		std::make_tuple(int(QFont::Normal), colObj) })
+	{
+		t_real_gl pen = 0.;
+
+		for(const QChar& ch : label)
+		{
+			const GlPlotGlyph* glyph = GetGlyph(ch, weight);
+			if(!glyph) continue;
+
+			// corners: [x, y, u, v]
+			const t_real_gl corners[4][4] =
+			{
+				{ pen + glyph->x0, glyph->y0, glyph->u0, glyph->v0 },
+				{ pen + glyph->x1, glyph->y0, glyph->u1, glyph->v0 },
+				{ pen + glyph->x1, glyph->y1, glyph->u1, glyph->v1 },
+				{ pen + glyph->x0, glyph->y1, glyph->u0, glyph->v1 },
+			};
+
+			for(int corner : { 0, 1, 2,  0, 2, 3 })
+			{
+				verts.insert(verts.end(), { pos[0], pos[1], pos[2] });
+				verts.insert(verts.end(), { corners[corner][0], corners[corner][1] });
+				verts.insert(verts.end(), { corners[corner][2], corners[corner][3] });
+				verts.insert(verts.end(), col, col+4);
+			}
+
+			pen += glyph->advance;
+		}
+	}
+}
+
+
+/**
+ * only update the anchor positions of an object's label vertices
+ */
+void GlPlotLabels::SetLabelPos(const GlPlotObj& obj, const GlPlotLabelEntry& entry)
+{
+	const t_vec3_gl pos = obj.m_mat * obj.m_labelPos;
+
+	for(std::size_t vert=entry.m_firstVert; vert<entry.m_firstVert+entry.m_numVerts; ++vert)
+	{
+		t_real_gl *pVert = m_verts.data() + vert*s_vertSize;
+		pVert[0] = pos[0];
+		pVert[1] = pos[1];
+		pVert[2] = pos[2];
+	}
+}
+
+
+/**
+ * re-create the vertex buffer of all labels
+ */
+void GlPlotLabels::Rebuild(qgl_funcs* pGl, const std::vector<GlPlotObj>& objs)
+{
+	m_bNeedsRebuild = false;
+	{
+		m_mutexDirty.lock();
+		BOOST_SCOPE_EXIT(&m_mutexDirty) { m_mutexDirty.unlock(); } BOOST_SCOPE_EXIT_END
+		m_dirtyObjs.clear();
+	}
+
+	m_verts.clear();
+	m_entries.clear();
+	m_entries.reserve(objs.size());
+
+	for(const auto& obj : objs)
+	{
+		GlPlotLabelEntry entry;
+		entry.m_label = obj.m_label;
+		entry.m_visible = obj.m_visible;
+		entry.m_firstVert = m_verts.size() / s_vertSize;
+
+		if(obj.m_visible && obj.m_label != "")
+			CreateLabelVerts(obj, m_verts);
+
+		entry.m_numVerts = m_verts.size()/s_vertSize - entry.m_firstVert;
+		m_entries.emplace_back(std::move(entry));
+	}
+
+	pGl->glBindVertexArray(m_vertexarr);
+	m_pvertexbuf->bind();
+	BOOST_SCOPE_EXIT(&m_pvertexbuf) { m_pvertexbuf->release(); } BOOST_SCOPE_EXIT_END
+
+	m_pvertexbuf->allocate(m_verts.data(), m_verts.size()*sizeof(t_real_gl));
+	m_numVertsGl = m_verts.size() / s_vertSize;
+
+	const GLsizei stride = s_vertSize * sizeof(t_real_gl);
+	pGl->glVertexAttribPointer(m_attrPos, 3, GL_FLOAT, 0, stride, (void*)(0*sizeof(t_real_gl)));
+	pGl->glVertexAttribPointer(m_attrOffs, 2, GL_FLOAT, 0, stride, (void*)(3*sizeof(t_real_gl)));
+	pGl->glVertexAttribPointer(m_attrUV, 2, GL_FLOAT, 0, stride, (void*)(5*sizeof(t_real_gl)));
+	pGl->glVertexAttribPointer(m_attrColor, 4, GL_FLOAT, 0, stride, (void*)(7*sizeof(t_real_gl)));
+	LOGGLERR(pGl);
+}
+
+
+/**
+ * update the labels of objects which have changed since the last frame
+ */
+void GlPlotLabels::UpdateDirty(qgl_funcs* pGl, const std::vector<GlPlotObj>& objs)
+{
+	std::vector<std::size_t> dirtyObjs;
+	{
+		m_mutexDirty.lock();
+		BOOST_SCOPE_EXIT(&m_mutexDirty) { m_mutexDirty.unlock(); } BOOST_SCOPE_EXIT_END
+		std::swap(dirtyObjs, m_dirtyObjs);
+	}
+
+	if(dirtyObjs.size() == 0)
+		return;
+
+	m_pvertexbuf->bind();
+	BOOST_SCOPE_EXIT(&m_pvertexbuf) { m_pvertexbuf->release(); } BOOST_SCOPE_EXIT_END
+
+	for(std::size_t idx : dirtyObjs)
+	{
+		if(idx >= objs.size() || idx >= m_entries.size())
+			continue;
+
+		const auto& obj = objs[idx];
+		const auto& entry = m_entries[idx];
+
+		// text or visibility changed -> the vertex layout changes
+		if(entry.m_label != obj.m_label || entry.m_visible != obj.m_visible)
+		{
+			m_bNeedsRebuild = true;
+			return;
+		}
+
+		if(entry.m_numVerts == 0)
+			continue;
+
+		// only the position changed
+		SetLabelPos(obj, entry);
+		m_pvertexbuf->write(entry.m_firstVert*s_vertSize*sizeof(t_real_gl),
+			m_verts.data() + entry.m_firstVert*s_vertSize,
+			entry.m_numVerts*s_vertSize*sizeof(t_real_gl));
+	}
+
+	LOGGLERR(pGl);
+}
+
+
+/**
+ * upload the modified glyph atlas
+ */
+void GlPlotLabels::UploadAtlas()
+{
+	if(m_pAtlasTex)
+		m_pAtlasTex->destroy();
+
+	m_pAtlasTex = std::make_shared<QOpenGLTexture>(m_atlas, QOpenGLTexture::DontGenerateMipMaps);
+	m_pAtlasTex->setMinificationFilter(QOpenGLTexture::Linear);
+	m_pAtlasTex->setMagnificationFilter(QOpenGLTexture::Linear);
+	m_pAtlasTex->setWrapMode(QOpenGLTexture::ClampToEdge);
+
+	m_atlasDirty = false;
+}
+
+
+void GlPlotLabels::SetObjectDirty(std::size_t idx)
+{
+	m_mutexDirty.lock();
+	BOOST_SCOPE_EXIT(&m_mutexDirty) { m_mutexDirty.unlock(); } BOOST_SCOPE_EXIT_END
+	m_dirtyObjs.push_back(idx);
+}
+
+
+/**
+ * draw all labels in one batch
+ */
+void GlPlotLabels::Draw(qgl_funcs* pGl, const std::vector<GlPlotObj>& objs,
+	const t_mat_gl& matProj, const t_mat_gl& matCam, int w, int h)
+{
+	if(!pGl || !m_pShaders) return;
+
+	if(!m_bNeedsRebuild && objs.size() != m_entries.size())
+		m_bNeedsRebuild = true;
+	if(!m_bNeedsRebuild)
+		UpdateDirty(pGl, objs);
+	if(m_bNeedsRebuild)
+		Rebuild(pGl, objs);
+
+	if(m_atlasDirty || !m_pAtlasTex)
+		UploadAtlas();
+	if(m_numVertsGl == 0)
+		return;
+
+
+	// bind shaders
+	m_pShaders->bind();
+	BOOST_SCOPE_EXIT(&m_pShaders) { m_pShaders->release(); } BOOST_SCOPE_EXIT_END
+
+	m_pShaders->setUniformValue(m_uniMatrixProj, matProj);
+	m_pShaders->setUniformValue(m_uniMatrixCam, matCam);
+	m_pShaders->setUniformValue(m_uniScreen, QVector2D(w, h));
+	m_pShaders->setUniformValue(m_uniAtlas, 0);
+
+	m_pAtlasTex->bind(0);
+	BOOST_SCOPE_EXIT(&m_pAtlasTex) { m_pAtlasTex->release(0); } BOOST_SCOPE_EXIT_END
+
+	// labels are drawn on top of the geometry
+	pGl->glDisable(GL_DEPTH_TEST);
+	pGl->glDisable(GL_CULL_FACE);
+	pGl->glEnable(GL_BLEND);
+	pGl->glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	BOOST_SCOPE_EXIT(pGl)
+	{
+		pGl->glDisable(GL_BLEND);
+		pGl->glEnable(GL_CULL_FACE);
+	}
+	BOOST_SCOPE_EXIT_END
+
+	pGl->glBindVertexArray(m_vertexarr);
+	pGl->glEnableVertexAttribArray(m_attrPos);
+	pGl->glEnableVertexAttribArray(m_attrOffs);
+	pGl->glEnableVertexAttribArray(m_attrUV);
+	pGl->glEnableVertexAttribArray(m_attrColor);
+	BOOST_SCOPE_EXIT(pGl, &m_attrPos, &m_attrOffs, &m_attrUV, &m_attrColor)
+	{
+		pGl->glDisableVertexAttribArray(m_attrColor);
+		pGl->glDisableVertexAttribArray(m_attrUV);
+		pGl->glDisableVertexAttribArray(m_attrOffs);
+		pGl->glDisableVertexAttribArray(m_attrPos);
+	}
+	BOOST_SCOPE_EXIT_END
+	LOGGLERR(pGl);
+
+	pGl->glDrawArrays(GL_TRIANGLES, 0, m_numVertsGl);
+	LOGGLERR(pGl);
+}
+// ----------------------------------------------------------------------------
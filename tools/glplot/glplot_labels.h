@@ -0,0 +1,111 @@
+/**
+ * GL plotter object labels
+ * @author Tobias Weber
+ * @date Nov-2018
+ * @license: see 'LICENSE.GPL' file
+ *
+ * Labels are rendered from a glyph atlas texture which is filled once per
+ * character, all labels are drawn as a single batch of textured quads.
+ */
+
+#ifndef __GL_PLOTTER_LABELS_H__
+#define __GL_PLOTTER_LABELS_H__
+
+#include <QtGui/QImage>
+#include <QtGui/QFont>
+#include <QtGui/QOpenGLTexture>
+#include <QtCore/QMutex>
+
+#include <unordered_map>
+#include <cstdint>
+
+#include "glplot_common.h"
+
+
+/**
+ * a rasterised glyph in the atlas
+ */
+struct GlPlotGlyph
+{
+	// texture coordinates in the atlas
+	t_real_gl u0 = 0, v0 = 0, u1 = 0, v1 = 0;
+
+	// quad in pixels, relative to pen position and baseline
+	t_real_gl x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+
+	t_real_gl advance = 0;
+};
+
+
+/**
+ * cached vertex range of an object's label
+ */
+struct GlPlotLabelEntry
+{
+	std::string m_label;
+	bool m_visible = false;
+
+	std::size_t m_firstVert = 0;
+	std::size_t m_numVerts = 0;
+};
+
+
+class GlPlotLabels
+{
+private:
+	std::shared_ptr<QOpenGLShaderProgram> m_pShaders;
+	std::shared_ptr<QOpenGLTexture> m_pAtlasTex;
+	std::shared_ptr<QOpenGLBuffer> m_pvertexbuf;
+	GLuint m_vertexarr = 0;
+
+	GLint m_attrPos = -1;
+	GLint m_attrOffs = -1;
+	GLint m_attrUV = -1;
+	GLint m_attrColor = -1;
+	GLint m_uniMatrixProj = -1;
+	GLint m_uniMatrixCam = -1;
+	GLint m_uniScreen = -1;
+	GLint m_uniAtlas = -1;
+
+	// glyph atlas
+	QFont m_font;
+	QImage m_atlas;
+	int m_atlasX = 0, m_atlasY = 0, m_atlasRowHeight = 0;
+	bool m_atlasDirty = false;
+	std::unordered_map<std::uint64_t, GlPlotGlyph> m_glyphs;
+
+	// label vertices: position (3), pixel offset (2), uv (2), rgba (4)
+	static constexpr std::size_t s_vertSize = 11;
+	std::vector<t_real_gl> m_verts;
+	std::vector<GlPlotLabelEntry> m_entries;
+	std::size_t m_numVertsGl = 0;
+
+	// objects whose labels need to be re-positioned
+	QMutex m_mutexDirty;
+	std::vector<std::size_t> m_dirtyObjs;
+	std::atomic<bool> m_bNeedsRebuild = true;
+
+protected:
+	const GlPlotGlyph* GetGlyph(QChar ch, int weight);
+	void CreateLabelVerts(const GlPlotObj& obj, std::vector<t_real_gl>& verts);
+	void SetLabelPos(const GlPlotObj& obj, const GlPlotLabelEntry& entry);
+
+	void Rebuild(qgl_funcs* pGl, const std::vector<GlPlotObj>& objs);
+	void UpdateDirty(qgl_funcs* pGl, const std::vector<GlPlotObj>& objs);
+	void UploadAtlas();
+
+public:
+	GlPlotLabels() = default;
+	~GlPlotLabels() = default;
+
+	bool Init(qgl_funcs* pGl, QObject *pParent = nullptr, int iAtlasSize = 1024);
+
+	void SetObjectDirty(std::size_t idx);
+	void SetAllDirty() { m_bNeedsRebuild = true; }
+
+	void Draw(qgl_funcs* pGl, const std::vector<GlPlotObj>& objs,
+		const t_mat_gl& matProj, const t_mat_gl& matCam, int w, int h);
+};
+
+
+#endif
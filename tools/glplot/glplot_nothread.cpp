@@ -10,6 +10,7 @@
  */
 
 #include "glplot_nothread.h"
+#include "glplot_labels.h"
 
 #include <QtGui/QOpenGLContext>
 #include <QtGui/QOpenGLFunctions>
@@ -74,10 +75,19 @@ void GlPlot_impl::paintGL()
 		m_pShaders->setUniformValue(m_uniMatrixCam, m_matCam);
 
 		// render triangle geometry
+		std::size_t iNumCulled = 0;
+		const t_frustum frustum = GetFrustumPlanes();
 		for(auto& obj : m_objs)
 		{
 			if(!obj.m_visible) continue;
 
+			// skip objects outside the view frustum
+			if(!IsObjectInFrustum(frustum, obj))
+			{
+				++iNumCulled;
+				continue;
+			}
+
 			// main vertex array object
 			pGl->glBindVertexArray(obj.m_vertexarr);
 
@@ -105,8 +115,13 @@ void GlPlot_impl::paintGL()
 
 			LOGGLERR(pGl);
 		}
+		m_iNumCulledObjs = iNumCulled;
 
 		pGl->glDisable(GL_DEPTH_TEST);
+
+		// render object labels
+		if(m_pLabels)
+			m_pLabels->Draw(pGl, m_objs, m_matPerspective, m_matCam, m_iScreenDims[0], m_iScreenDims[1]);
 	}
 
 
@@ -130,37 +145,6 @@ void GlPlot_impl::paintGL()
 		painter.drawText(GlToScreenCoords(m::create<t_vec_gl>({0.,3.,0.,1.})), "y");
 		painter.drawText(GlToScreenCoords(m::create<t_vec_gl>({0.,0.,3.,1.})), "z");
 
-
-		// render object labels
-		for(auto& obj : m_objs)
-		{
-			if(!obj.m_visible) continue;
-
-			if(obj.m_label != "")
-			{
-				t_vec3_gl posLabel3d = obj.m_mat * obj.m_labelPos;
-				auto posLabel2d = GlToScreenCoords(m::create<t_vec_gl>({posLabel3d[0], posLabel3d[1], posLabel3d[2], 1.}));
-
-				QFont fontOrig = painter.font();
-				QPen penOrig = painter.pen();
-				QFont fontLabel = fontOrig;
-				QPen penLabel = penOrig;
-
-				fontLabel.setWeight(QFont::Medium);
-				painter.setFont(fontLabel);
-				painter.drawText(posLabel2d, obj.m_label.c_str());
-
-				fontLabel.setWeight(QFont::Normal);
-				penLabel.setColor(QColor(int(obj.m_color[0]*255.), int(obj.m_color[1]*255.), int(obj.m_color[2]*255.), int(obj.m_color[3]*255.)));
-				painter.setFont(fontLabel);
-				painter.setPen(penLabel);
-				painter.drawText(posLabel2d, obj.m_label.c_str());
-
-				// restore original styles
-				painter.setFont(fontOrig);
-				painter.setPen(penOrig);
-			}
-		}
 	}
 }
 
@@ -0,0 +1,297 @@
+/**
+ * fourier synthesis of the (magnetisation) density from structure factors
+ * @author Tobias Weber
+ * @date Nov-2018
+ * @license: see 'LICENSE.EUPL' file
+ *
+ * g++ -I../../ -o fouriersynth fouriersynth.cpp -std=c++17 -fconcepts -O2 -lpthread
+ *
+ * usage:
+ *	fouriersynth <reflection file> <output grid> [N1 N2 N3] [num threads]
+ *
+ * the reflection file contains the lines
+ *	x a b c alpha beta gamma [powder]     unit cell (A, deg)
+ *	h k l F                               nuclear structure factor
+ *	m h k l Fx Fy Fz                      magnetic structure factor
+ * complex values are given as "(re,im)". the single-crystal output of structurefactor
+ * can be used directly, its nuclear (6 columns) or magnetic (12 columns) reflection lines
+ * are recognised and its "Crystal lattice:" line defines the unit cell. lines whose hkl columns
+ * are not numbers are skipped, invalid structure factors abort the synthesis.
+ * the density is written in the grid format described in libs/magfourier.h.
+ */
+
+#include <boost/algorithm/string.hpp>
+
+#include <iostream>
+#include <fstream>
+#include <memory>
+#include <chrono>
+
+#include "libs/math_algos.h"
+#include "libs/math_conts.h"
+#include "libs/magfourier.h"
+using namespace m;
+using namespace m_ops;
+
+using t_real = double;
+using t_cplx = std::complex<t_real>;
+using t_vec = std::vector<t_real>;
+using t_mat = mat<t_real, std::vector>;
+
+std::string g_ws = " \t";
+
+
+template<class T>
+T from_str(const std::string& str)
+{
+	T t;
+
+	std::istringstream istr(str);
+	istr >> t;
+
+	return t;
+}
+
+
+/**
+ * converts the whole string, returns false if it is no valid number
+ */
+template<class T>
+bool from_str_strict(const std::string& str, T& t)
+{
+	std::istringstream istr(str);
+	istr >> t;
+	if(istr.fail())
+		return false;
+
+	istr >> std::ws;
+	return istr.eof();
+}
+
+
+/**
+ * parses a structurefactor line "Crystal lattice: a = ..., gamma = ..."
+ */
+bool parse_cell(const std::string& line, t_real* latt, t_real* angle)
+{
+	std::vector<std::string> vectoks;
+	boost::split(vectoks, line, boost::is_any_of(" \t,=:"), boost::token_compress_on);
+
+	const char* names[] = { "a", "b", "c", "alpha", "beta", "gamma" };
+	t_real* vals[] = { latt, latt+1, latt+2, angle, angle+1, angle+2 };
+	std::size_t iNumFound = 0;
+
+	for(std::size_t iTok=0; iTok+1<vectoks.size(); ++iTok)
+	{
+		for(std::size_t iName=0; iName<6; ++iName)
+		{
+			if(vectoks[iTok] == names[iName])
+			{
+				*vals[iName] = from_str<t_real>(vectoks[iTok+1]);
+				++iNumFound;
+			}
+		}
+	}
+
+	return iNumFound == 6;
+}
+
+
+bool synth(std::istream& istr, const std::string& strOutFile,
+	const std::array<std::size_t, 3>& dims, unsigned int iNumThreads)
+{
+	t_real latt[3] = {5., 5., 5.};
+	t_real angle[3] = {90., 90., 90.};
+
+	// nuclear (1) or magnetic (3) components, set by the first reflection
+	std::size_t iNumComps = 0;
+	std::unique_ptr<MagFourierSynth<t_real>> fourier;
+	std::size_t linenr = 0, iNumIncomm = 0;
+	bool bOk = true, bNonZero = false;
+
+	while(istr)
+	{
+		std::string line;
+		std::getline(istr, line);
+		++linenr;
+
+		boost::trim_if(line, boost::is_any_of(g_ws));
+		if(line == "")
+			continue;
+
+		if(boost::starts_with(line, "Crystal lattice:"))
+		{
+			if(!parse_cell(line, latt, angle))
+				std::cerr << "Error in line " << linenr << ": invalid lattice." << std::endl;
+			continue;
+		}
+
+		std::vector<std::string> vectoks;
+		boost::split(vectoks, line, boost::is_any_of(g_ws), boost::token_compress_on);
+
+		if(vectoks[0] == "x" && (vectoks.size() == 7 || vectoks.size() == 8))	// unit cell definition
+		{
+			for(int i=0; i<3; ++i)
+			{
+				latt[i] = from_str<t_real>(vectoks[1+i]);
+				angle[i] = from_str<t_real>(vectoks[4+i]);
+			}
+			continue;
+		}
+
+		// column of the first structure factor component
+		bool bMag = (vectoks[0] == "m");
+		const std::size_t iFirst = bMag ? 1 : 0;
+		std::size_t iCol = 0;
+		if(bMag && vectoks.size() == 7)			// m h k l Fx Fy Fz
+			iCol = 4;
+		else if(!bMag && vectoks.size() == 4)		// h k l F
+			iCol = 3;
+		else if(!bMag && vectoks.size() == 6)		// structurefactor, nuclear
+			iCol = 5;
+		else if(!bMag && vectoks.size() == 12)		// structurefactor, magnetic
+			bMag = true, iCol = 6;
+		else
+			continue;
+
+		// skip headers and other text
+		t_real hkl[3];
+		if(!from_str_strict<t_real>(vectoks[iFirst], hkl[0]) ||
+			!from_str_strict<t_real>(vectoks[iFirst+1], hkl[1]) ||
+			!from_str_strict<t_real>(vectoks[iFirst+2], hkl[2]))
+			continue;
+
+		const std::size_t iComps = bMag ? 3 : 1;
+		t_cplx F[3];
+		bool bFOk = true;
+		for(std::size_t i=0; i<iComps; ++i)
+			bFOk = bFOk && from_str_strict<t_cplx>(vectoks[iCol+i], F[i]);
+		if(!bFOk)
+		{
+			std::cerr << "Error in line " << linenr << ": invalid structure factor." << std::endl;
+			bOk = false;
+			continue;
+		}
+
+		if(!fourier)
+		{
+			iNumComps = iComps;
+			fourier = std::make_unique<MagFourierSynth<t_real>>(iNumComps);
+		}
+		else if(iComps != iNumComps)
+		{
+			std::cerr << "Error in line " << linenr << ": mixed nuclear and magnetic reflections." << std::endl;
+			bOk = false;
+			continue;
+		}
+
+		for(std::size_t i=0; i<iComps; ++i)
+			bNonZero = bNonZero || std::norm(F[i]) > t_real(0);
+
+		if(!fourier->AddReflection(hkl, F))
+			++iNumIncomm;
+	}
+
+	if(!bOk)
+		return false;
+	if(!fourier || !fourier->GetNumReflections())
+	{
+		std::cerr << "Error: no commensurate reflections defined." << std::endl;
+		return false;
+	}
+	if(!bNonZero)
+	{
+		std::cerr << "Error: all structure factors are zero." << std::endl;
+		return false;
+	}
+	if(iNumIncomm)
+		std::cerr << "Warning: skipped " << iNumIncomm << " reflection(s) at non-integer hkl." << std::endl;
+
+
+	// real-space basis, A = 2pi * B^(-T)
+	auto crystB = B_matrix<t_mat>(latt[0], latt[1], latt[2],
+		angle[0]/180.*pi<t_real>, angle[1]/180.*pi<t_real>, angle[2]/180.*pi<t_real>);
+	auto [crystBinv, bInvOk] = inv<t_mat>(crystB);
+	if(!bInvOk)
+	{
+		std::cerr << "Error: invalid unit cell." << std::endl;
+		return false;
+	}
+	t_mat crystA = t_real(2)*pi<t_real> * trans<t_mat>(crystBinv);
+	const t_real vol = std::abs(det<t_mat>(crystA));
+
+	fourier->SetDims(dims[0], dims[1], dims[2]);
+	fourier->SetNumThreads(iNumThreads);
+
+	std::cout << "Crystal lattice: a = " << latt[0] << ", b = " << latt[1] << ", c = " << latt[2]
+		<< ", alpha = " << angle[0] << ", beta = " << angle[1] << ", gamma = " << angle[2] << "\n";
+	std::cout << "Unit cell volume: " << vol << " A^3.\n";
+	std::cout << fourier->GetNumReflections() << " " << (iNumComps == 3 ? "magnetic" : "nuclear")
+		<< " reflection(s) defined.\n";
+
+	MagDensityGrid<t_real> grid;
+	for(std::size_t i=0; i<3; ++i)
+		for(std::size_t j=0; j<3; ++j)
+			grid.basis[i*3 + j] = crystA(i,j);
+
+	auto timeStart = std::chrono::steady_clock::now();
+	std::size_t iNumSkipped = fourier->Synthesise(grid, vol);
+	auto timeEnd = std::chrono::steady_clock::now();
+
+	if(iNumSkipped)
+		std::cerr << "Warning: skipped " << iNumSkipped << " reflection(s) beyond the grid resolution." << std::endl;
+
+	std::cout << "Grid: " << grid.dims[0] << " x " << grid.dims[1] << " x " << grid.dims[2]
+		<< ", synthesised in " << std::chrono::duration<t_real>(timeEnd - timeStart).count()*1e3 << " ms.\n";
+
+	const char* compnames[] = { "x", "y", "z" };
+	for(std::size_t iComp=0; iComp<grid.numComps; ++iComp)
+	{
+		auto iterBegin = grid.values.begin() + iComp*grid.GetNumPoints();
+		auto [iterMin, iterMax] = std::minmax_element(iterBegin, iterBegin + grid.GetNumPoints());
+
+		std::cout << "Density";
+		if(grid.numComps > 1)
+			std::cout << " " << compnames[iComp];
+		std::cout << ": min = " << *iterMin << ", max = " << *iterMax << ".\n";
+	}
+
+	if(!grid.Save(strOutFile))
+		return false;
+	std::cout << "Wrote \"" << strOutFile << "\".\n";
+
+	return true;
+}
+
+
+int main(int argc, char** argv)
+{
+	if(argc != 3 && argc != 4 && argc != 6 && argc != 7)
+	{
+		std::cerr << "Usage: " << argv[0] << " <reflection file> <output grid> [N1 N2 N3] [num threads]" << std::endl;
+		return -1;
+	}
+
+	std::array<std::size_t, 3> dims{{ 0, 0, 0 }};
+	unsigned int iNumThreads = 0;
+
+	if(argc >= 6)
+	{
+		for(int i=0; i<3; ++i)
+			dims[i] = from_str<std::size_t>(argv[3+i]);
+	}
+	if(argc == 4 || argc == 7)
+		iNumThreads = from_str<unsigned int>(argv[argc-1]);
+
+	std::ifstream ifstr(argv[1]);
+	if(!ifstr)
+	{
+		std::cerr << "Cannot open \"" << argv[1] << "\"." << std::endl;
+		return -1;
+	}
+
+	if(!synth(ifstr, argv[2], dims, iNumThreads))
+		return -1;
+
+	return 0;
+}
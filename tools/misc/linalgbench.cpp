@@ -0,0 +1,301 @@
+/**
+ * timing of linear algebra algorithms
+ * @author Tobias Weber
+ * @date Nov-2018
+ * @license: see 'LICENSE.EUPL' file
+ *
+ * g++ -O2 -I../../ -o linalgbench linalgbench.cpp -std=c++17 -fconcepts
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <string>
+
+#include "libs/math_algos.h"
+#include "libs/math_conts.h"
+using namespace m;
+using namespace m_ops;
+
+using t_real = double;
+using t_cplx = std::complex<t_real>;
+using t_vec = std::vector<t_real>;
+using t_mat = mat<t_real, std::vector>;
+using t_vec_cplx = std::vector<t_cplx>;
+using t_mat_cplx = mat<t_cplx, std::vector>;
+
+std::mt19937 g_rng{1234};
+
+
+/**
+ * random hermitian matrix
+ */
+template<class t_mat>
+t_mat rand_herm(std::size_t N)
+{
+	using T = typename t_mat::value_type;
+	std::uniform_real_distribution<t_real> dist(-1, 1);
+
+	t_mat mat = zero<t_mat>(N, N);
+	for(std::size_t i=0; i<N; ++i)
+	{
+		for(std::size_t j=0; j<=i; ++j)
+		{
+			if constexpr(is_complex<T>)
+			{
+				T val(dist(g_rng), i==j ? t_real(0) : dist(g_rng));
+				mat(i,j) = val;
+				mat(j,i) = std::conj(val);
+			}
+			else
+			{
+				mat(i,j) = mat(j,i) = dist(g_rng);
+			}
+		}
+	}
+
+	return mat;
+}
+
+
+/**
+ * unshifted QR iteration A_{n+1} = R_n Q_n using m::qr, as reference
+ * returns [eigenvalues (ascending), converged]
+ */
+std::tuple<std::vector<t_real>, bool> eigenval_qr_naive(const t_mat& mat,
+	t_real eps = 1e-12, std::size_t iMaxIter = 2000)
+{
+	const std::size_t N = mat.size1();
+	t_mat A = mat;
+	bool bConverged = false;
+
+	for(std::size_t iIter=0; iIter<iMaxIter; ++iIter)
+	{
+		auto [Q, R] = qr<t_mat, t_vec>(A);
+		A = R * Q;
+
+		t_real offdiag = 0;
+		for(std::size_t i=1; i<N; ++i)
+			offdiag = std::max(offdiag, std::abs(A(i, i-1)));
+		if(offdiag <= eps)
+		{
+			bConverged = true;
+			break;
+		}
+	}
+
+	std::vector<t_real> evals;
+	for(std::size_t i=0; i<N; ++i)
+		evals.push_back(A(i,i));
+	std::sort(evals.begin(), evals.end());
+
+	return std::make_tuple(evals, bConverged);
+}
+
+
+/**
+ * mean run time of a function in microseconds
+ */
+template<class t_func>
+t_real timing(t_func func, std::size_t iNumRuns)
+{
+	auto start = std::chrono::steady_clock::now();
+	for(std::size_t iRun=0; iRun<iNumRuns; ++iRun)
+		func();
+	auto stop = std::chrono::steady_clock::now();
+
+	return std::chrono::duration<t_real, std::micro>(stop - start).count() / t_real(iNumRuns);
+}
+
+
+void bench_eigen()
+{
+	std::cout << "Hermitian eigensolvers, mean time per matrix (us):\n";
+	std::cout
+		<< std::setw(6) << std::right << "N" << " "
+		<< std::setw(14) << std::right << "qr naive" << " "
+		<< std::setw(14) << std::right << "jacobi" << " "
+		<< std::setw(14) << std::right << "tridiag" << " "
+		<< std::setw(14) << std::right << "tridiag (E)" << " "
+		<< std::setw(14) << std::right << "batch cplx" << " "
+		<< std::setw(14) << std::right << "max |dE|" << "\n";
+
+	for(std::size_t N : { 2, 3, 4, 6, 8, 12, 16, 24, 32, 64 })
+	{
+		const std::size_t iNumMats = std::max<std::size_t>(4, 4096 / (N*N));
+
+		std::vector<t_mat> mats;
+		std::vector<t_mat_cplx> mats_cplx;
+		for(std::size_t i=0; i<iNumMats; ++i)
+		{
+			mats.emplace_back(rand_herm<t_mat>(N));
+			mats_cplx.emplace_back(rand_herm<t_mat_cplx>(N));
+		}
+
+		std::size_t idx = 0;
+		auto next = [&idx, iNumMats]() -> std::size_t { return (idx++) % iNumMats; };
+
+		// the reference iteration is too slow for larger matrices
+		const bool bNaive = (N <= 16);
+		t_real tQR = -1;
+		if(bNaive)
+			tQR = timing([&]() { eigenval_qr_naive(mats[next()]); }, std::min<std::size_t>(iNumMats, 8));
+		t_real tJacobi = timing([&]() { eigenvec_herm_jacobi<t_mat, t_vec>(mats[next()]); }, iNumMats);
+		t_real tTridiag = timing([&]() { eigenvec_herm<t_mat, t_vec>(mats[next()]); }, iNumMats);
+		t_real tTridiagE = timing([&]() { eigenval_herm<t_mat>(mats[next()]); }, iNumMats);
+		t_real tBatch = timing([&]() { eigenvec_herm_batch<t_mat_cplx, t_vec_cplx>(mats_cplx); }, 1)
+			/ t_real(iNumMats);
+
+		// compare eigenvalues with the jacobi method, the unshifted qr iteration
+		// does not converge for degenerate eigenvalue magnitudes
+		t_real maxdiff = 0;
+		bool bAllOk = true;
+		for(const t_mat& mat : mats)
+		{
+			auto [evalsJacobi, evecsJacobi, okJacobi] = eigenvec_herm_jacobi<t_mat, t_vec>(mat);
+			auto [evals, evecs, ok] = eigenvec_herm<t_mat, t_vec>(mat);
+			if(!okJacobi || !ok)
+			{
+				bAllOk = false;
+				continue;
+			}
+
+			for(std::size_t i=0; i<N; ++i)
+				maxdiff = std::max(maxdiff, std::abs(evals[i] - evalsJacobi[i]));
+		}
+
+		std::cout
+			<< std::setw(6) << std::right << N << " "
+			<< std::setw(14) << std::right << tQR << " "
+			<< std::setw(14) << std::right << tJacobi << " "
+			<< std::setw(14) << std::right << tTridiag << " "
+			<< std::setw(14) << std::right << tTridiagE << " "
+			<< std::setw(14) << std::right << tBatch << " ";
+		if(bAllOk)
+			std::cout << std::setw(14) << std::right << maxdiff << std::endl;
+		else
+			std::cout << std::setw(14) << std::right << "failed" << std::endl;
+	}
+}
+
+
+/**
+ * random matrix
+ */
+t_mat rand_mat(std::size_t rows, std::size_t cols)
+{
+	std::uniform_real_distribution<t_real> dist(-1, 1);
+
+	t_mat mat = zero<t_mat>(rows, cols);
+	for(std::size_t i=0; i<rows; ++i)
+		for(std::size_t j=0; j<cols; ++j)
+			mat(i,j) = dist(g_rng);
+
+	return mat;
+}
+
+
+/**
+ * max |Q*R - A|
+ */
+t_real qr_error(const t_mat& Q, const t_mat& R, const t_mat& A)
+{
+	t_real err = 0;
+	for(std::size_t i=0; i<A.size1(); ++i)
+	{
+		for(std::size_t j=0; j<A.size2(); ++j)
+		{
+			t_real elem = 0;
+			for(std::size_t k=0; k<R.size1(); ++k)
+				elem += Q(i,k)*R(k,j);
+			err = std::max(err, std::abs(elem - A(i,j)));
+		}
+	}
+
+	return err;
+}
+
+
+void bench_qr()
+{
+	std::cout << "QR decompositions and orthonormalisation, mean time per matrix (us):\n";
+	std::cout
+		<< std::setw(6) << std::right << "N" << " "
+		<< std::setw(14) << std::right << "qr" << " "
+		<< std::setw(14) << std::right << "qr inplace" << " "
+		<< std::setw(14) << std::right << "qr mgs" << " "
+		<< std::setw(14) << std::right << "orthonorm" << " "
+		<< std::setw(14) << std::right << "orth. inplace" << " "
+		<< std::setw(14) << std::right << "err inplace" << " "
+		<< std::setw(14) << std::right << "err mgs" << "\n";
+
+	for(std::size_t N : { 3, 4, 8, 16, 32, 64, 100, 200 })
+	{
+		const std::size_t iNumRuns = std::max<std::size_t>(1, 32768 / (N*N));
+		const t_mat A = rand_mat(N, N);
+
+		std::vector<t_vec> sys;
+		for(std::size_t i=0; i<N; ++i)
+			sys.emplace_back(col<t_mat, t_vec>(A, i));
+
+		// existing algorithms, the full-matrix version only up to moderate sizes
+		t_real tQR = -1;
+		if(N <= 64)
+			tQR = timing([&A]() { qr<t_mat, t_vec>(A); }, std::min<std::size_t>(iNumRuns, 16));
+		t_real tOrtho = timing([&sys]()
+		{
+			orthonorm_sys<t_vec, std::vector, std::vector>(sys);
+		}, iNumRuns);
+
+		// in-place algorithms, all work arrays are allocated beforehand
+		t_mat R = A, Q = zero<t_mat>(N, N);
+		t_vec work = zero<t_vec>(N);
+		t_real tQRInplace = timing([&]()
+		{
+			for(std::size_t i=0; i<N; ++i)
+				for(std::size_t j=0; j<N; ++j)
+					R(i,j) = A(i,j);
+			qr_inplace<t_mat, t_vec>(R, Q, work);
+		}, iNumRuns);
+		const t_real errInplace = qr_error(Q, R, A);
+
+		t_mat Q_mgs = A, R_mgs = zero<t_mat>(N, N);
+		t_real tMGS = timing([&]()
+		{
+			for(std::size_t i=0; i<N; ++i)
+				for(std::size_t j=0; j<N; ++j)
+					Q_mgs(i,j) = A(i,j);
+			qr_mgs_inplace<t_mat>(Q_mgs, R_mgs);
+		}, iNumRuns);
+		const t_real errMGS = qr_error(Q_mgs, R_mgs, A);
+
+		std::vector<t_vec> sys_inplace = sys;
+		t_real tOrthoInplace = timing([&]()
+		{
+			for(std::size_t i=0; i<N; ++i)
+				std::copy(sys[i].begin(), sys[i].end(), sys_inplace[i].begin());
+			orthonorm_sys_inplace<t_vec, std::vector>(sys_inplace);
+		}, iNumRuns);
+
+		std::cout
+			<< std::setw(6) << std::right << N << " "
+			<< std::setw(14) << std::right << tQR << " "
+			<< std::setw(14) << std::right << tQRInplace << " "
+			<< std::setw(14) << std::right << tMGS << " "
+			<< std::setw(14) << std::right << tOrtho << " "
+			<< std::setw(14) << std::right << tOrthoInplace << " "
+			<< std::setw(14) << std::right << errInplace << " "
+			<< std::setw(14) << std::right << errMGS << std::endl;
+	}
+}
+
+
+int main()
+{
+	std::cout.precision(6);
+	bench_eigen();
+	std::cout << std::endl;
+	bench_qr();
+	return 0;
+}
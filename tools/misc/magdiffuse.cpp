@@ -0,0 +1,251 @@
+/**
+ * diffuse magnetic scattering of a supercell spin configuration
+ * @author Tobias Weber
+ * @date Nov-2018
+ * @license: see 'LICENSE.EUPL' file
+ *
+ * g++ -I../../ -o magdiffuse magdiffuse.cpp -std=c++17 -fconcepts -O2 -lpthread
+ *
+ * usage:
+ *	magdiffuse [-t <num threads>] <configuration file> <output grid> [G_h G_k G_l]
+ *
+ * the configuration uses the format of structurefactor: a line "x a b c alpha beta gamma [powder]"
+ * defines the unit cell and the lines "x y z Sx Sy Sz" the spins. the positions are given in units
+ * of the unit cell across the whole supercell, their fractional parts define the sublattices.
+ * an optional line "s L1 L2 L3" sets the supercell size, otherwise it follows from the positions.
+ * S(Q) = |S_perp(Q)|^2 / N is calculated at Q = G + (n1/L1, n2/L2, n3/L3) and written in the grid
+ * format described in libs/magfourier.h, with the reciprocal lattice vectors (1/A) as basis.
+ */
+
+#include <boost/algorithm/string.hpp>
+
+#include <iostream>
+#include <fstream>
+#include <chrono>
+
+#include "libs/math_algos.h"
+#include "libs/math_conts.h"
+#include "libs/magdiffuse.h"
+#include "libs/magfourier.h"
+using namespace m;
+using namespace m_ops;
+
+using t_real = double;
+using t_vec = std::vector<t_real>;
+using t_mat = mat<t_real, std::vector>;
+
+std::string g_ws = " \t";
+const t_real g_eps = 1e-4;
+
+
+template<class T>
+T from_str(const std::string& str)
+{
+	T t;
+
+	std::istringstream istr(str);
+	istr >> t;
+
+	return t;
+}
+
+
+struct Spin
+{
+	long cell[3];
+	std::size_t sub;
+	t_real S[3];
+};
+
+
+int main(int argc, char** argv)
+{
+	std::vector<std::string> args;
+	unsigned int iNumThreads = 0;
+
+	for(int iArg=1; iArg<argc; ++iArg)
+	{
+		std::string arg = argv[iArg];
+		if(arg == "-t" && iArg+1 < argc)
+			iNumThreads = from_str<unsigned int>(argv[++iArg]);
+		else
+			args.push_back(arg);
+	}
+
+	if(args.size() != 2 && args.size() != 5)
+	{
+		std::cerr << "Usage: " << argv[0] << " [-t <num threads>] <configuration file> <output grid> [G_h G_k G_l]" << std::endl;
+		return -1;
+	}
+
+	int G[3] = { 0, 0, 0 };
+	if(args.size() == 5)
+	{
+		for(int i=0; i<3; ++i)
+			G[i] = from_str<int>(args[2+i]);
+	}
+
+	std::ifstream ifstr(args[0]);
+	if(!ifstr)
+	{
+		std::cerr << "Cannot open \"" << args[0] << "\"." << std::endl;
+		return -1;
+	}
+
+
+	// read the configuration
+	auto timeStart = std::chrono::steady_clock::now();
+
+	t_real latt[3] = {5., 5., 5.};
+	t_real angle[3] = {90., 90., 90.};
+	long supercell[3] = { 0, 0, 0 };
+	std::vector<t_vec> basis;
+	std::vector<Spin> spins;
+	std::size_t linenr = 0;
+
+	while(ifstr)
+	{
+		std::string line;
+		std::getline(ifstr, line);
+		++linenr;
+
+		boost::trim_if(line, boost::is_any_of(g_ws));
+		if(line == "")
+			continue;
+
+		std::vector<std::string> vectoks;
+		boost::split(vectoks, line, boost::is_any_of(g_ws), boost::token_compress_on);
+
+		if(vectoks.size() == 6)		// spin
+		{
+			Spin spin;
+			t_vec frac = zero<t_vec>(3);
+			for(int i=0; i<3; ++i)
+			{
+				const t_real pos = from_str<t_real>(vectoks[i]);
+				spin.cell[i] = long(std::floor(pos + g_eps));
+				frac[i] = pos - t_real(spin.cell[i]);
+				spin.S[i] = from_str<t_real>(vectoks[3+i]);
+			}
+
+			auto iter = std::find_if(basis.begin(), basis.end(), [&frac](const t_vec& vec) -> bool
+			{
+				return equals<t_vec>(vec, frac, g_eps);
+			});
+			spin.sub = iter - basis.begin();
+			if(iter == basis.end())
+				basis.push_back(frac);
+
+			spins.push_back(spin);
+		}
+		else if(vectoks.size() == 4 && vectoks[0] == "s")	// supercell size
+		{
+			for(int i=0; i<3; ++i)
+				supercell[i] = from_str<long>(vectoks[1+i]);
+		}
+		else if(vectoks.size() >= 7 && vectoks.size() <= 8 && vectoks[0] == "x")	// unit cell definition
+		{
+			for(int i=0; i<3; ++i)
+			{
+				latt[i] = from_str<t_real>(vectoks[1+i]);
+				angle[i] = from_str<t_real>(vectoks[4+i]);
+			}
+		}
+		else if(vectoks.size() == 4 || vectoks.size() == 3 || vectoks[0] == "g")
+		{
+			// nuclear atoms, propagation vector and space group do not apply
+			continue;
+		}
+		else
+		{
+			std::cerr << "Error in line " << linenr << "." << std::endl;
+			continue;
+		}
+	}
+
+	if(spins.size() == 0)
+	{
+		std::cerr << "Error: no spins defined." << std::endl;
+		return -1;
+	}
+
+	// supercell size and origin from the positions
+	long cellMin[3], cellMax[3];
+	for(int i=0; i<3; ++i)
+	{
+		cellMin[i] = cellMax[i] = spins[0].cell[i];
+		for(const Spin& spin : spins)
+		{
+			cellMin[i] = std::min(cellMin[i], spin.cell[i]);
+			cellMax[i] = std::max(cellMax[i], spin.cell[i]);
+		}
+
+		if(supercell[i] <= 0)
+			supercell[i] = cellMax[i] - cellMin[i] + 1;
+	}
+
+	auto timeRead = std::chrono::steady_clock::now();
+
+
+	// fill the sublattice grids
+	MagDiffuse<t_real> diffuse;
+	diffuse.SetNumThreads(iNumThreads);
+	for(const t_vec& pos : basis)
+		diffuse.AddSublattice(pos.data());
+	diffuse.SetSupercell(supercell[0], supercell[1], supercell[2]);
+
+	auto crystB = B_matrix<t_mat>(latt[0], latt[1], latt[2],
+		angle[0]/180.*pi<t_real>, angle[1]/180.*pi<t_real>, angle[2]/180.*pi<t_real>);
+	t_real B[9];
+	for(std::size_t i=0; i<3; ++i)
+		for(std::size_t j=0; j<3; ++j)
+			B[i*3 + j] = crystB(i,j);
+	diffuse.SetBMatrix(B);
+
+	for(const Spin& spin : spins)
+	{
+		std::size_t idx[3];
+		for(int i=0; i<3; ++i)
+			idx[i] = std::size_t(((spin.cell[i] - cellMin[i]) % supercell[i] + supercell[i]) % supercell[i]);
+		diffuse.SetSpin(idx[0], idx[1], idx[2], spin.sub, spin.S);
+	}
+
+	std::cout << "Crystal lattice: a = " << latt[0] << ", b = " << latt[1] << ", c = " << latt[2]
+		<< ", alpha = " << angle[0] << ", beta = " << angle[1] << ", gamma = " << angle[2] << "\n";
+	std::cout << spins.size() << " spin(s) on " << basis.size() << " sublattice(s), supercell "
+		<< supercell[0] << " x " << supercell[1] << " x " << supercell[2] << ".\n";
+	if(spins.size() != diffuse.GetNumCells() * basis.size())
+		std::cerr << "Warning: the supercell is not completely filled." << std::endl;
+
+
+	// calculate S(Q)
+	MagDensityGrid<t_real> grid;
+	grid.dims = {{ std::size_t(supercell[0]), std::size_t(supercell[1]), std::size_t(supercell[2]) }};
+	grid.numComps = 1;
+	grid.values.resize(grid.GetNumPoints());
+	for(std::size_t i=0; i<9; ++i)
+		grid.basis[i] = B[i];
+
+	auto timeCalcStart = std::chrono::steady_clock::now();
+	diffuse.Calc(G, grid.values.data());
+	auto timeCalcEnd = std::chrono::steady_clock::now();
+
+	auto iterMax = std::max_element(grid.values.begin(), grid.values.end());
+	const std::size_t iMax = iterMax - grid.values.begin();
+	const std::size_t nMax[3] = { iMax / (grid.dims[1]*grid.dims[2]), (iMax / grid.dims[2]) % grid.dims[1], iMax % grid.dims[2] };
+
+	std::cout << "Zone: G = (" << G[0] << ", " << G[1] << ", " << G[2] << ").\n";
+	std::cout << "Maximum: S = " << *iterMax << " at Q = ("
+		<< G[0] + t_real(nMax[0])/t_real(grid.dims[0]) << ", "
+		<< G[1] + t_real(nMax[1])/t_real(grid.dims[1]) << ", "
+		<< G[2] + t_real(nMax[2])/t_real(grid.dims[2]) << ").\n";
+	std::cout << "Reading: " << std::chrono::duration<t_real>(timeRead - timeStart).count()*1e3 << " ms, "
+		<< "calculation: " << std::chrono::duration<t_real>(timeCalcEnd - timeCalcStart).count()*1e3 << " ms, "
+		<< "memory: " << t_real(diffuse.GetMemoryUsage() + grid.values.size()*sizeof(t_real)) / (1024.*1024.) << " MiB.\n";
+
+	if(!grid.Save(args[1]))
+		return -1;
+	std::cout << "Wrote \"" << args[1] << "\".\n";
+
+	return 0;
+}
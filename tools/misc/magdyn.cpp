@@ -0,0 +1,304 @@
+/**
+ * spin-wave dispersion calculation
+ * @author Tobias Weber
+ * @date Nov-2018
+ * @license: see 'LICENSE.EUPL' file
+ *
+ * g++ -O2 -I../../ -o magdyn magdyn.cpp -std=c++17 -fconcepts -lpthread
+ *
+ * input file format (one entry per line):
+ *	x y z Mx My Mz                magnetic site with moment (spin length = |M|)
+ *	x a b c alpha beta gamma      unit cell definition
+ *	J i j dx dy dz J [Dx Dy Dz]   coupling between sites i and j in cell distance d
+ *	q h k l                       vertex of the Q path
+ *	n num                         number of Q points per path segment
+ *
+ * usage:
+ *	magdyn <input file> [num threads]
+ *	magdyn --bench [num threads]
+ */
+
+#include <boost/algorithm/string.hpp>
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <string>
+
+#include "libs/math_algos.h"
+#include "libs/math_conts.h"
+#include "libs/magdyn.h"
+using namespace m;
+using namespace m_ops;
+
+using t_real = double;
+using t_cplx = std::complex<t_real>;
+using t_vec = std::vector<t_real>;
+using t_mat = mat<t_real, std::vector>;
+using t_vec_cplx = std::vector<t_cplx>;
+using t_mat_cplx = mat<t_cplx, std::vector>;
+using t_magdyn = MagDyn<t_mat, t_vec, t_mat_cplx, t_vec_cplx>;
+
+std::string g_ws = " \t";
+
+
+template<class T>
+T from_str(const std::string& str)
+{
+	T t;
+
+	std::istringstream istr(str);
+	istr >> t;
+
+	return t;
+}
+
+
+/**
+ * reads sites, couplings and the Q path
+ */
+bool load(std::istream& istr, t_magdyn& dyn, std::vector<t_vec>& Qverts, std::size_t& numQ)
+{
+	t_real latt[3] = {5., 5., 5.};
+	t_real angle[3] = {90., 90., 90.};
+	std::size_t linenr = 0;
+	bool bOk = true;
+
+	while(istr)
+	{
+		std::string line;
+		std::getline(istr, line);
+		++linenr;
+
+		boost::trim_if(line, boost::is_any_of(g_ws));
+		if(line == "" || line[0] == '#')
+			continue;
+
+		std::vector<std::string> vectoks;
+		boost::split(vectoks, line, boost::is_any_of(g_ws), boost::token_compress_on);
+
+		if(vectoks[0] == "x" && (vectoks.size() == 7 || vectoks.size() == 8))	// unit cell definition
+		{
+			for(int i=0; i<3; ++i)
+			{
+				latt[i] = from_str<t_real>(vectoks[1+i]);
+				angle[i] = from_str<t_real>(vectoks[4+i]);
+			}
+		}
+		else if(vectoks[0] == "J" && (vectoks.size() == 7 || vectoks.size() == 10))	// coupling
+		{
+			std::size_t site1 = from_str<std::size_t>(vectoks[1]);
+			std::size_t site2 = from_str<std::size_t>(vectoks[2]);
+			t_vec dist = create<t_vec>({
+				from_str<t_real>(vectoks[3]),
+				from_str<t_real>(vectoks[4]),
+				from_str<t_real>(vectoks[5]) });
+			t_real J = from_str<t_real>(vectoks[6]);
+
+			if(vectoks.size() == 10)
+			{
+				t_vec dmi = create<t_vec>({
+					from_str<t_real>(vectoks[7]),
+					from_str<t_real>(vectoks[8]),
+					from_str<t_real>(vectoks[9]) });
+				dyn.AddCoupling(site1, site2, dist, J, &dmi);
+			}
+			else
+			{
+				dyn.AddCoupling(site1, site2, dist, J);
+			}
+		}
+		else if(vectoks[0] == "q" && vectoks.size() == 4)	// Q path vertex
+		{
+			Qverts.emplace_back(create<t_vec>({
+				from_str<t_real>(vectoks[1]),
+				from_str<t_real>(vectoks[2]),
+				from_str<t_real>(vectoks[3]) }));
+		}
+		else if(vectoks[0] == "n" && vectoks.size() == 2)	// number of Q points
+		{
+			numQ = from_str<std::size_t>(vectoks[1]);
+		}
+		else if(vectoks.size() == 6)	// magnetic site
+		{
+			t_vec pos = create<t_vec>({
+				from_str<t_real>(vectoks[0]),
+				from_str<t_real>(vectoks[1]),
+				from_str<t_real>(vectoks[2]) });
+			t_vec M = create<t_vec>({
+				from_str<t_real>(vectoks[3]),
+				from_str<t_real>(vectoks[4]),
+				from_str<t_real>(vectoks[5]) });
+
+			if(equals<t_real>(norm<t_vec>(M), 0, 1e-6))
+			{
+				std::cerr << "Error in line " << linenr << ": zero moment." << std::endl;
+				bOk = false;
+				continue;
+			}
+
+			dyn.AddSite(pos, M);
+		}
+		else
+		{
+			std::cerr << "Error in line " << linenr << "." << std::endl;
+			bOk = false;
+			continue;
+		}
+	}
+
+	dyn.SetBMatrix(B_matrix<t_mat>(latt[0], latt[1], latt[2],
+		angle[0]/180.*pi<t_real>, angle[1]/180.*pi<t_real>, angle[2]/180.*pi<t_real>));
+
+	if(!dyn.IsValid())
+	{
+		std::cerr << "Error: invalid sites or couplings." << std::endl;
+		bOk = false;
+	}
+
+	return bOk;
+}
+
+
+void calc(const t_magdyn& dyn, const std::vector<t_vec>& Qverts, std::size_t numQ,
+	unsigned int iNumThreads)
+{
+	const std::vector<t_vec> Qs = t_magdyn::GetQPath(Qverts, numQ);
+	auto [modes, oks] = dyn.GetDispersion(Qs, iNumThreads);
+
+	std::size_t prec = 6;
+	std::cout.precision(prec);
+	std::cout << dyn.GetSites().size() << " magnetic site(s) defined.\n";
+	std::cout << dyn.GetCouplings().size() << " coupling(s) defined.\n";
+	std::cout << Qs.size() << " Q point(s) calculated.\n";
+
+	std::cout
+		<< std::setw(prec*2) << std::right << "h (rlu)" << " "
+		<< std::setw(prec*2) << std::right << "k (rlu)" << " "
+		<< std::setw(prec*2) << std::right << "l (rlu)";
+	for(std::size_t n=0; n<dyn.GetSites().size(); ++n)
+	{
+		std::cout << " "
+			<< std::setw(prec*2) << std::right << ("E_" + std::to_string(n)) << " "
+			<< std::setw(prec*2) << std::right << ("S_perp_" + std::to_string(n));
+	}
+	std::cout << "\n";
+
+	for(std::size_t iQ=0; iQ<Qs.size(); ++iQ)
+	{
+		const t_vec& Q = Qs[iQ];
+		std::cout
+			<< std::setw(prec*2) << std::right << Q[0] << " "
+			<< std::setw(prec*2) << std::right << Q[1] << " "
+			<< std::setw(prec*2) << std::right << Q[2];
+
+		if(!oks[iQ])
+		{
+			std::cout << "    # no stable solution\n";
+			continue;
+		}
+
+		for(const auto& mode : modes[iQ])
+		{
+			std::cout << " "
+				<< std::setw(prec*2) << std::right << mode.E << " "
+				<< std::setw(prec*2) << std::right << mode.weight;
+		}
+		std::cout << "\n";
+	}
+}
+
+
+/**
+ * Q points per second for ferromagnetic chains with increasing number of sites
+ */
+void bench(unsigned int iNumThreads)
+{
+	std::cout
+		<< std::setw(10) << std::right << "sites" << " "
+		<< std::setw(15) << std::right << "energies (Q/s)" << " "
+		<< std::setw(15) << std::right << "weights (Q/s)" << "\n";
+
+	for(std::size_t numSites : { 1, 2, 4, 8, 16, 32, 64 })
+	{
+		t_magdyn dyn;
+		for(std::size_t i=0; i<numSites; ++i)
+		{
+			dyn.AddSite(create<t_vec>({ t_real(i)/t_real(numSites), 0, 0 }),
+				create<t_vec>({ 0, 0, 1 }));
+		}
+
+		for(std::size_t i=0; i<numSites; ++i)
+		{
+			const bool bWrap = (i == numSites-1);
+			dyn.AddCoupling(i, bWrap ? 0 : i+1,
+				create<t_vec>({ bWrap ? t_real(1) : t_real(0), 0, 0 }), t_real(-1));
+		}
+
+		// fewer Q points for larger systems to keep the run time bounded
+		const std::size_t numQ = std::max<std::size_t>(8, 16384 / (numSites*numSites));
+		const std::vector<t_vec> Qs = t_magdyn::GetQPath(
+			{ create<t_vec>({0, 0, 0}), create<t_vec>({1, 0, 0}) }, numQ);
+
+		t_real rates[2] = { 0, 0 };
+		for(int iWeights=0; iWeights<2; ++iWeights)
+		{
+			auto start = std::chrono::steady_clock::now();
+			auto result = dyn.GetDispersion(Qs, iNumThreads, iWeights == 0);
+			auto stop = std::chrono::steady_clock::now();
+
+			t_real secs = std::chrono::duration<t_real>(stop - start).count();
+			rates[iWeights] = t_real(Qs.size()) / secs;
+		}
+
+		std::cout
+			<< std::setw(10) << std::right << numSites << " "
+			<< std::setw(15) << std::right << rates[0] << " "
+			<< std::setw(15) << std::right << rates[1] << std::endl;
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	if(argc < 2)
+	{
+		std::cerr << "Usage: " << argv[0] << " <input file> [num threads]" << std::endl;
+		std::cerr << "       " << argv[0] << " --bench [num threads]" << std::endl;
+		return -1;
+	}
+
+	unsigned int iNumThreads = 0;
+	if(argc >= 3)
+		iNumThreads = from_str<unsigned int>(argv[2]);
+
+	if(std::string(argv[1]) == "--bench")
+	{
+		bench(iNumThreads);
+		return 0;
+	}
+
+	std::ifstream ifstr(argv[1]);
+	if(!ifstr)
+	{
+		std::cerr << "Cannot open \"" << argv[1] << "\"." << std::endl;
+		return -1;
+	}
+
+	t_magdyn dyn;
+	std::vector<t_vec> Qverts;
+	std::size_t numQ = 128;
+	if(!load(ifstr, dyn, Qverts, numQ))
+		return -1;
+
+	if(Qverts.size() == 0)
+	{
+		std::cerr << "No Q path defined." << std::endl;
+		return -1;
+	}
+
+	calc(dyn, Qverts, numQ, iNumThreads);
+	return 0;
+}
@@ -0,0 +1,383 @@
+/**
+ * classical monte carlo simulation of heisenberg spin models
+ * @author Tobias Weber
+ * @date Nov-2018
+ * @license: see 'LICENSE.EUPL' file
+ *
+ * g++ -O2 -I../../ -o magmc magmc.cpp -std=c++17 -lpthread
+ *
+ * input file format (one entry per line):
+ *	x y z Mx My Mz                          magnetic site with initial moment (spin length = |M|)
+ *	x a b c alpha beta gamma                unit cell definition
+ *	J i j dx dy dz J [Dx Dy Dz]             coupling between sites i and j in cell distance d
+ *	Jm i j dx dy dz Jxx Jxy Jxz ... Jzz     coupling with a general exchange matrix
+ *	A i Axx Ayy Azz [Axy Axz Ayz]           single-ion anisotropy E = S^T A S of site i
+ *	h hx hy hz                              zeeman field, E = -h*S
+ *	s L1 L2 L3                              supercell size
+ *	T T1 [T2 ...]                           temperatures, several ones are exchanged by parallel tempering
+ *	n therm meas [interval]                 thermalisation and measurement sweeps, sweeps between measurements
+ *	u metropolis|heatbath                   update scheme
+ *
+ * the energies, fields and temperatures share the same units (k_B = 1),
+ * the spins are given in the orthonormal frame of the B matrix.
+ *
+ * usage:
+ *	magmc [-t <num threads>] [-r] [-u] <input file> [output file]
+ *
+ * the final configurations are written in the format of structurefactor, one file per temperature
+ * (with the temperature index appended for several temperatures). the positions are given in
+ * units of the supercell, with -u in units of the unit cell, as needed by magdiffuse.
+ * -r starts from random spin directions instead of the given moments.
+ */
+
+#include <boost/algorithm/string.hpp>
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "libs/magmc.h"
+
+using t_real = double;
+using t_mc = MagMC<t_real>;
+
+std::string g_ws = " \t";
+
+
+template<class T>
+T from_str(const std::string& str)
+{
+	T t;
+
+	std::istringstream istr(str);
+	istr >> t;
+
+	return t;
+}
+
+
+struct Sweeps
+{
+	std::size_t therm = 1000;
+	std::size_t meas = 1000;
+	std::size_t interval = 1;
+};
+
+
+/**
+ * reads sites, couplings and the simulation parameters
+ */
+bool load(std::istream& istr, t_mc& mc, t_real* latt, t_real* angle, Sweeps& sweeps)
+{
+	std::size_t linenr = 0;
+	bool bOk = true;
+
+	while(istr)
+	{
+		std::string line;
+		std::getline(istr, line);
+		++linenr;
+
+		boost::trim_if(line, boost::is_any_of(g_ws));
+		if(line == "" || line[0] == '#')
+			continue;
+
+		std::vector<std::string> vectoks;
+		boost::split(vectoks, line, boost::is_any_of(g_ws), boost::token_compress_on);
+
+		if(vectoks[0] == "x" && (vectoks.size() == 7 || vectoks.size() == 8))	// unit cell definition
+		{
+			for(int i=0; i<3; ++i)
+			{
+				latt[i] = from_str<t_real>(vectoks[1+i]);
+				angle[i] = from_str<t_real>(vectoks[4+i]);
+			}
+		}
+		else if((vectoks[0] == "J" && (vectoks.size() == 7 || vectoks.size() == 10))
+			|| (vectoks[0] == "Jm" && vectoks.size() == 15))	// coupling
+		{
+			std::size_t site1 = from_str<std::size_t>(vectoks[1]);
+			std::size_t site2 = from_str<std::size_t>(vectoks[2]);
+			long dist[3];
+			for(int i=0; i<3; ++i)
+				dist[i] = from_str<long>(vectoks[3+i]);
+
+			if(vectoks[0] == "Jm")
+			{
+				t_real J[9];
+				for(int i=0; i<9; ++i)
+					J[i] = from_str<t_real>(vectoks[6+i]);
+				mc.AddCoupling(site1, site2, dist, J);
+			}
+			else if(vectoks.size() == 10)
+			{
+				t_real dmi[3];
+				for(int i=0; i<3; ++i)
+					dmi[i] = from_str<t_real>(vectoks[7+i]);
+				mc.AddCoupling(site1, site2, dist, from_str<t_real>(vectoks[6]), dmi);
+			}
+			else
+			{
+				mc.AddCoupling(site1, site2, dist, from_str<t_real>(vectoks[6]));
+			}
+		}
+		else if(vectoks[0] == "A" && (vectoks.size() == 5 || vectoks.size() == 8))	// single-ion anisotropy
+		{
+			std::size_t site = from_str<std::size_t>(vectoks[1]);
+			if(site >= mc.GetNumSites())
+			{
+				std::cerr << "Error in line " << linenr << ": invalid site index." << std::endl;
+				bOk = false;
+				continue;
+			}
+
+			t_real A[9] = { 0, 0, 0,  0, 0, 0,  0, 0, 0 };
+			A[0] = from_str<t_real>(vectoks[2]);
+			A[4] = from_str<t_real>(vectoks[3]);
+			A[8] = from_str<t_real>(vectoks[4]);
+			if(vectoks.size() == 8)
+			{
+				A[1] = A[3] = from_str<t_real>(vectoks[5]);
+				A[2] = A[6] = from_str<t_real>(vectoks[6]);
+				A[5] = A[7] = from_str<t_real>(vectoks[7]);
+			}
+			mc.SetAnisotropy(site, A);
+		}
+		else if(vectoks[0] == "h" && vectoks.size() == 4)	// zeeman field
+		{
+			t_real h[3];
+			for(int i=0; i<3; ++i)
+				h[i] = from_str<t_real>(vectoks[1+i]);
+			mc.SetField(h);
+		}
+		else if(vectoks[0] == "s" && vectoks.size() == 4)	// supercell size
+		{
+			mc.SetSupercell(from_str<std::size_t>(vectoks[1]),
+				from_str<std::size_t>(vectoks[2]), from_str<std::size_t>(vectoks[3]));
+		}
+		else if(vectoks[0] == "T" && vectoks.size() >= 2)	// temperatures
+		{
+			std::vector<t_real> temps;
+			for(std::size_t i=1; i<vectoks.size(); ++i)
+				temps.push_back(from_str<t_real>(vectoks[i]));
+			mc.SetTemperatures(temps);
+		}
+		else if(vectoks[0] == "n" && (vectoks.size() == 3 || vectoks.size() == 4))	// number of sweeps
+		{
+			sweeps.therm = from_str<std::size_t>(vectoks[1]);
+			sweeps.meas = from_str<std::size_t>(vectoks[2]);
+			if(vectoks.size() == 4)
+				sweeps.interval = std::max<std::size_t>(from_str<std::size_t>(vectoks[3]), 1);
+		}
+		else if(vectoks[0] == "u" && vectoks.size() == 2)	// update scheme
+		{
+			if(vectoks[1] == "metropolis")
+				mc.SetUpdate(t_mc::Update::METROPOLIS);
+			else if(vectoks[1] == "heatbath")
+				mc.SetUpdate(t_mc::Update::HEATBATH);
+			else
+			{
+				std::cerr << "Error in line " << linenr << ": unknown update scheme." << std::endl;
+				bOk = false;
+			}
+		}
+		else if(vectoks.size() == 6)	// magnetic site
+		{
+			t_real pos[3], M[3];
+			for(int i=0; i<3; ++i)
+			{
+				pos[i] = from_str<t_real>(vectoks[i]);
+				M[i] = from_str<t_real>(vectoks[3+i]);
+			}
+
+			if(M[0]*M[0] + M[1]*M[1] + M[2]*M[2] < 1e-12)
+			{
+				std::cerr << "Error in line " << linenr << ": zero moment." << std::endl;
+				bOk = false;
+				continue;
+			}
+
+			mc.AddSite(pos, M);
+		}
+		else
+		{
+			std::cerr << "Error in line " << linenr << "." << std::endl;
+			bOk = false;
+			continue;
+		}
+	}
+
+	return bOk;
+}
+
+
+/**
+ * writes the configuration at the given temperature in the input format of structurefactor
+ */
+bool save(const std::string& file, const t_mc& mc, std::size_t iTemp,
+	const t_real* latt, const t_real* angle, bool bUnitCell)
+{
+	std::ofstream ofstr(file);
+	if(!ofstr)
+	{
+		std::cerr << "Error: cannot write \"" << file << "\"." << std::endl;
+		return false;
+	}
+
+	const auto& dims = mc.GetSupercell();
+	const t_real scale[3] = {
+		bUnitCell ? t_real(1) : t_real(dims[0]),
+		bUnitCell ? t_real(1) : t_real(dims[1]),
+		bUnitCell ? t_real(1) : t_real(dims[2]) };
+
+	ofstr.precision(8);
+	ofstr << "x " << latt[0]*scale[0] << " " << latt[1]*scale[1] << " " << latt[2]*scale[2] << " "
+		<< angle[0] << " " << angle[1] << " " << angle[2] << " 0\n";
+
+	for(std::size_t i1=0; i1<dims[0]; ++i1)
+	for(std::size_t i2=0; i2<dims[1]; ++i2)
+	for(std::size_t i3=0; i3<dims[2]; ++i3)
+	{
+		const std::size_t iCell = (i1*dims[1] + i2)*dims[2] + i3;
+		const std::size_t idx[3] = { i1, i2, i3 };
+
+		for(std::size_t iSite=0; iSite<mc.GetNumSites(); ++iSite)
+		{
+			const t_real* pos = mc.GetSitePosition(iSite);
+			const t_real* spin = mc.GetSpin(iTemp, iCell, iSite);
+
+			for(std::size_t i=0; i<3; ++i)
+				ofstr << (t_real(idx[i]) + pos[i]) / scale[i] << " ";
+			ofstr << spin[0] << " " << spin[1] << " " << spin[2] << "\n";
+		}
+	}
+
+	return true;
+}
+
+
+int main(int argc, char** argv)
+{
+	std::vector<std::string> args;
+	unsigned int iNumThreads = 0;
+	bool bRandom = false, bUnitCell = false;
+
+	for(int iArg=1; iArg<argc; ++iArg)
+	{
+		std::string arg = argv[iArg];
+		if(arg == "-t" && iArg+1 < argc)
+			iNumThreads = from_str<unsigned int>(argv[++iArg]);
+		else if(arg == "-r")
+			bRandom = true;
+		else if(arg == "-u")
+			bUnitCell = true;
+		else
+			args.push_back(arg);
+	}
+
+	if(args.size() < 1 || args.size() > 2)
+	{
+		std::cerr << "Usage: " << argv[0] << " [-t <num threads>] [-r] [-u] <input file> [output file]" << std::endl;
+		return -1;
+	}
+
+	std::ifstream ifstr(args[0]);
+	if(!ifstr)
+	{
+		std::cerr << "Cannot open \"" << args[0] << "\"." << std::endl;
+		return -1;
+	}
+
+	t_real latt[3] = {5., 5., 5.};
+	t_real angle[3] = {90., 90., 90.};
+	Sweeps sweeps;
+
+	t_mc mc;
+	mc.SetNumThreads(iNumThreads);
+	if(!load(ifstr, mc, latt, angle, sweeps) || !mc.Build())
+		return -1;
+	if(bRandom)
+		mc.Randomise();
+
+	const auto& dims = mc.GetSupercell();
+	const auto& temps = mc.GetTemperatures();
+	std::cout << mc.GetNumSites() << " magnetic site(s), " << mc.GetNumCouplings() << " coupling(s) defined.\n";
+	std::cout << mc.GetNumSpins() << " spin(s) in " << dims[0] << " x " << dims[1] << " x " << dims[2]
+		<< " supercell, " << mc.GetNumBonds() << " bond(s), " << mc.GetNumColours() << " colour(s), "
+		<< temps.size() << " temperature(s), "
+		<< t_real(mc.GetMemoryUsage()) / (1024.*1024.) << " MiB.\n";
+
+	// thermalisation, adapting the metropolis step sizes
+	auto timeStart = std::chrono::steady_clock::now();
+	for(std::size_t iSweep=0; iSweep<sweeps.therm; iSweep += sweeps.interval)
+	{
+		mc.Sweep(std::min(sweeps.interval, sweeps.therm - iSweep));
+		mc.Exchange();
+
+		if((iSweep / sweeps.interval) % 10 == 9)
+		{
+			mc.AdaptStepSizes();
+			mc.ResetStatistics();
+		}
+	}
+	mc.ResetStatistics();
+
+	// measurements
+	for(std::size_t iSweep=0; iSweep<sweeps.meas; iSweep += sweeps.interval)
+	{
+		mc.Sweep(std::min(sweeps.interval, sweeps.meas - iSweep));
+		mc.Measure();
+		mc.Exchange();
+	}
+	auto timeEnd = std::chrono::steady_clock::now();
+
+	const t_real numSweeps = t_real(sweeps.therm + sweeps.meas);
+	std::cout << "Simulation time: " << std::chrono::duration<t_real>(timeEnd - timeStart).count() << " s, "
+		<< std::chrono::duration<t_real>(timeEnd - timeStart).count() / numSweeps
+			/ t_real(mc.GetNumSpins() * temps.size()) * 1e9 << " ns per spin update.\n";
+
+	std::size_t prec = 6;
+	std::cout.precision(prec);
+	std::cout
+		<< std::setw(prec*2) << std::right << "T" << " "
+		<< std::setw(prec*2) << std::right << "E/N" << " "
+		<< std::setw(prec*2) << std::right << "C/N" << " "
+		<< std::setw(prec*2) << std::right << "|M|/N" << " "
+		<< std::setw(prec*2) << std::right << "chi/N" << " "
+		<< std::setw(prec*2) << std::right << "acc" << " "
+		<< std::setw(prec*2) << std::right << "swap_acc" << "\n";
+
+	for(std::size_t iTemp=0; iTemp<temps.size(); ++iTemp)
+	{
+		auto [E, C, M, chi] = mc.GetObservables(iTemp);
+		std::cout
+			<< std::setw(prec*2) << std::right << temps[iTemp] << " "
+			<< std::setw(prec*2) << std::right << E << " "
+			<< std::setw(prec*2) << std::right << C << " "
+			<< std::setw(prec*2) << std::right << M << " "
+			<< std::setw(prec*2) << std::right << chi << " "
+			<< std::setw(prec*2) << std::right << mc.GetAcceptance(iTemp) << " "
+			<< std::setw(prec*2) << std::right << mc.GetSwapAcceptance(iTemp) << "\n";
+	}
+
+	if(args.size() > 1)
+	{
+		for(std::size_t iTemp=0; iTemp<temps.size(); ++iTemp)
+		{
+			std::string file = args[1];
+			if(temps.size() > 1)
+				file += "." + std::to_string(iTemp);
+
+			if(!save(file, mc, iTemp, latt, angle, bUnitCell))
+				return -1;
+			std::cout << "Wrote \"" << file << "\" (T = " << temps[iTemp]
+				<< ", E/N = " << mc.GetEnergy(iTemp) / t_real(mc.GetNumSpins()) << ").\n";
+		}
+	}
+
+	return 0;
+}
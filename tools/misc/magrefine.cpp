@@ -0,0 +1,326 @@
+/**
+ * refinement of magnetic moments against observed intensities
+ * @author Tobias Weber
+ * @date Nov-2018
+ * @license: see 'LICENSE.EUPL' file
+ *
+ * g++ -I../../ -o magrefine magrefine.cpp -std=c++17 -fconcepts -O2 -lpthread
+ *
+ * usage:
+ *	magrefine [-s <fixed scale>] [-t <num threads>] <structure file> <intensity file> [magsg.info]
+ *
+ * the structure file uses the format of structurefactor: a line "x a b c alpha beta gamma [powder]"
+ * defines the unit cell, "g <BNS number>" selects a space group and "x y z Mx My Mz" defines a
+ * magnetic atom with its starting moment along the crystal axes. with a space group, the atoms are
+ * expanded into their orbits and their moments are restricted by their wyckoff sites.
+ * the intensity file contains lines "h k l I [sigma]", where hkl includes the propagation vector.
+ *
+ * without -s, the scale factor is refined, and the moment parameter with the largest starting
+ * value is kept fixed, since the scale and the moment lengths cannot be refined independently.
+ */
+
+#include <boost/algorithm/string.hpp>
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <chrono>
+
+#include "libs/math_algos.h"
+#include "libs/math_conts.h"
+#include "libs/magsg.h"
+#include "libs/magrefine.h"
+using namespace m;
+using namespace m_ops;
+
+using t_real = double;
+using t_vec = std::vector<t_real>;
+using t_mat = mat<t_real, std::vector>;
+
+std::string g_ws = " \t";
+
+
+template<class T>
+T from_str(const std::string& str)
+{
+	T t;
+
+	std::istringstream istr(str);
+	istr >> t;
+
+	return t;
+}
+
+
+/**
+ * reads the unit cell, space group and magnetic atoms
+ */
+bool load_structure(std::istream& istr, const std::string& strSgFile,
+	MagRefine<t_mat, t_vec>& refine, std::unique_ptr<Spacegroups<t_mat, t_vec>>& sgs)
+{
+	t_real latt[3] = {5., 5., 5.};
+	t_real angle[3] = {90., 90., 90.};
+	std::size_t linenr = 0;
+
+	while(istr)
+	{
+		std::string line;
+		std::getline(istr, line);
+		++linenr;
+
+		boost::trim_if(line, boost::is_any_of(g_ws));
+		if(line == "")
+			continue;
+
+		std::vector<std::string> vectoks;
+		boost::split(vectoks, line, boost::is_any_of(g_ws), boost::token_compress_on);
+
+		if(vectoks.size() == 6)		// magnetic atom
+		{
+			t_vec R = create<t_vec>({ from_str<t_real>(vectoks[0]),
+				from_str<t_real>(vectoks[1]), from_str<t_real>(vectoks[2]) });
+			t_vec M = create<t_vec>({ from_str<t_real>(vectoks[3]),
+				from_str<t_real>(vectoks[4]), from_str<t_real>(vectoks[5]) });
+
+			auto [site, numParams, bMomOk] = refine.AddAtom(R, M);
+			const std::size_t iAtom = refine.GetNumAtoms() - 1;
+
+			std::cout << "Atom " << iAtom+1 << " at " << R << ": ";
+			if(site != "")
+				std::cout << "Wyckoff site " << site << ", ";
+			std::cout << refine.GetAtomOrbitSize(iAtom) << " atom(s) in orbit, "
+				<< numParams << " free moment component(s).\n";
+			if(!bMomOk)
+				std::cout << "Warning: moment " << M << " was projected onto the allowed directions.\n";
+		}
+		else if(vectoks.size() == 4)	// nuclear atom
+		{
+			std::cerr << "Warning: ignoring nuclear atom in line " << linenr << "." << std::endl;
+		}
+		else if(vectoks.size() >= 7 && vectoks.size() <= 8 && vectoks[0] == "x")	// unit cell definition
+		{
+			for(int i=0; i<3; ++i)
+			{
+				latt[i] = from_str<t_real>(vectoks[1+i]);
+				angle[i] = from_str<t_real>(vectoks[4+i]);
+			}
+			refine.SetLattice(latt[0], latt[1], latt[2],
+				angle[0]/180.*pi<t_real>, angle[1]/180.*pi<t_real>, angle[2]/180.*pi<t_real>);
+		}
+		else if(vectoks.size() == 2 && vectoks[0] == "g")	// space group
+		{
+			if(refine.GetNumAtoms())
+			{
+				std::cerr << "Error in line " << linenr << ": the space group has to precede the atoms." << std::endl;
+				return false;
+			}
+
+			if(!sgs)
+			{
+				sgs = std::make_unique<Spacegroups<t_mat, t_vec>>();
+				if(!sgs->Load(strSgFile))
+				{
+					std::cerr << "Error: cannot load space groups from \"" << strSgFile << "\"." << std::endl;
+					return false;
+				}
+			}
+
+			const auto* sgsAll = sgs->GetSpacegroups();
+			auto iter = std::find_if(sgsAll->begin(), sgsAll->end(), [&vectoks](const auto& sg) -> bool
+			{
+				return sg.GetNumber() == vectoks[1];
+			});
+
+			if(iter == sgsAll->end() || !refine.SetSpacegroup(&*iter))
+			{
+				std::cerr << "Error in line " << linenr << ": invalid space group." << std::endl;
+				return false;
+			}
+
+			std::cout << "Space group: " << iter->GetName() << " (" << iter->GetNumber() << ").\n";
+		}
+		else if(vectoks.size() == 3)	// propagation vector, included in the observed hkl
+		{
+			continue;
+		}
+		else
+		{
+			std::cerr << "Error in line " << linenr << "." << std::endl;
+			continue;
+		}
+	}
+
+	std::cout << "Crystal lattice: a = " << latt[0] << ", b = " << latt[1] << ", c = " << latt[2]
+		<< ", alpha = " << angle[0] << ", beta = " << angle[1] << ", gamma = " << angle[2] << "\n";
+	return true;
+}
+
+
+/**
+ * reads the observed intensities
+ */
+void load_intensities(std::istream& istr, MagRefine<t_mat, t_vec>& refine)
+{
+	std::size_t linenr = 0;
+
+	while(istr)
+	{
+		std::string line;
+		std::getline(istr, line);
+		++linenr;
+
+		boost::trim_if(line, boost::is_any_of(g_ws));
+		if(line == "" || line[0] == '#')
+			continue;
+
+		std::vector<std::string> vectoks;
+		boost::split(vectoks, line, boost::is_any_of(g_ws), boost::token_compress_on);
+		if(vectoks.size() != 4 && vectoks.size() != 5)
+		{
+			std::cerr << "Error in line " << linenr << " of the intensity file." << std::endl;
+			continue;
+		}
+
+		t_vec hkl = create<t_vec>({ from_str<t_real>(vectoks[0]),
+			from_str<t_real>(vectoks[1]), from_str<t_real>(vectoks[2]) });
+		t_real I = from_str<t_real>(vectoks[3]);
+		t_real sigma = vectoks.size() == 5 ? from_str<t_real>(vectoks[4]) : t_real(1);
+
+		refine.AddReflection(hkl, I, sigma);
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	std::vector<std::string> args;
+	t_real fixedScale = -1;
+	unsigned int iNumThreads = 0;
+
+	for(int iArg=1; iArg<argc; ++iArg)
+	{
+		std::string arg = argv[iArg];
+		if(arg == "-s" && iArg+1 < argc)
+			fixedScale = from_str<t_real>(argv[++iArg]);
+		else if(arg == "-t" && iArg+1 < argc)
+			iNumThreads = from_str<unsigned int>(argv[++iArg]);
+		else
+			args.push_back(arg);
+	}
+
+	if(args.size() < 2 || args.size() > 3)
+	{
+		std::cerr << "Usage: " << argv[0]
+			<< " [-s <fixed scale>] [-t <num threads>] <structure file> <intensity file> [magsg.info]" << std::endl;
+		return -1;
+	}
+
+	std::string strSgFile = args.size() > 2 ? args[2] : "../../magsg.info";
+
+	std::ifstream ifstrStruct(args[0]), ifstrInt(args[1]);
+	if(!ifstrStruct || !ifstrInt)
+	{
+		std::cerr << "Cannot open input files." << std::endl;
+		return -1;
+	}
+
+	MagRefine<t_mat, t_vec> refine;
+	refine.SetNumThreads(iNumThreads);
+
+	// the space groups have to outlive the refinement
+	std::unique_ptr<Spacegroups<t_mat, t_vec>> sgs;
+	if(!load_structure(ifstrStruct, strSgFile, refine, sgs))
+		return -1;
+	load_intensities(ifstrInt, refine);
+
+	if(!refine.GetNumAtoms() || !refine.GetNumReflections())
+	{
+		std::cerr << "Error: no magnetic atoms or reflections defined." << std::endl;
+		return -1;
+	}
+
+	if(fixedScale > 0)
+	{
+		refine.SetScale(fixedScale);
+		refine.SetParamFixed(0, true);
+	}
+	else
+	{
+		refine.FitScale();
+
+		// fix the largest moment parameter, a zero one would keep its component at zero
+		std::size_t iFixed = 0;
+		t_real maxParam = 0;
+		for(std::size_t iParam=1; iParam<refine.GetNumParams(); ++iParam)
+		{
+			const t_real param = std::abs(refine.GetParam(iParam));
+			if(param > maxParam)
+			{
+				maxParam = param;
+				iFixed = iParam;
+			}
+		}
+
+		if(refine.GetNumParams() > 1 && !iFixed)
+		{
+			std::cerr << "Error: all starting moments are zero, "
+				<< "cannot refine the scale factor together with the moments." << std::endl;
+			return -1;
+		}
+		if(iFixed)
+			refine.SetParamFixed(iFixed, true);
+	}
+
+	std::cout << refine.GetNumReflections() << " reflection(s), "
+		<< refine.GetNumParams() << " parameter(s).\n";
+
+	auto timeStart = std::chrono::steady_clock::now();
+	auto [chi2, chi2red, iNumIter, bConverged] = refine.Refine();
+	auto timeEnd = std::chrono::steady_clock::now();
+
+	std::cout << (bConverged ? "Converged" : "Not converged") << " after " << iNumIter << " iteration(s) in "
+		<< std::chrono::duration<t_real>(timeEnd - timeStart).count()*1e3 << " ms.\n";
+	std::cout << "chi^2 = " << chi2 << ", reduced chi^2 = " << chi2red << ".\n";
+
+	// no errors are given for a singular covariance matrix
+	const bool bErrors = refine.HasErrors();
+
+	std::cout << "Scale: " << refine.GetScale();
+	if(bErrors)
+		std::cout << " +- " << refine.GetScaleError();
+	std::cout << "\n";
+
+	for(std::size_t iAtom=0; iAtom<refine.GetNumAtoms(); ++iAtom)
+	{
+		auto [mom, err] = refine.GetMoment(iAtom);
+		std::cout << "Atom " << iAtom+1 << ": M = " << mom;
+		if(bErrors)
+			std::cout << "+- " << err;
+		std::cout << "\n";
+	}
+
+	const std::size_t prec = 6;
+	std::cout.precision(prec);
+	std::cout
+		<< std::setw(prec*2) << std::right << "h (rlu)" << " "
+		<< std::setw(prec*2) << std::right << "k (rlu)" << " "
+		<< std::setw(prec*2) << std::right << "l (rlu)" << " "
+		<< std::setw(prec*2) << std::right << "I_obs" << " "
+		<< std::setw(prec*2) << std::right << "sigma" << " "
+		<< std::setw(prec*2) << std::right << "I_calc" << "\n";
+
+	for(std::size_t iRefl=0; iRefl<refine.GetNumReflections(); ++iRefl)
+	{
+		auto [hkl, Iobs, sigma, Icalc] = refine.GetReflection(iRefl);
+		std::cout
+			<< std::setw(prec*2) << std::right << hkl[0] << " "
+			<< std::setw(prec*2) << std::right << hkl[1] << " "
+			<< std::setw(prec*2) << std::right << hkl[2] << " "
+			<< std::setw(prec*2) << std::right << Iobs << " "
+			<< std::setw(prec*2) << std::right << sigma << " "
+			<< std::setw(prec*2) << std::right << Icalc << "\n";
+	}
+
+	return 0;
+}
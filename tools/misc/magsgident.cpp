@@ -0,0 +1,178 @@
+/**
+ * identifies the magnetic space group of a moment configuration
+ * @author Tobias Weber
+ * @date Nov-2018
+ * @license: see 'LICENSE.EUPL' file
+ *
+ * g++ -O2 -I../../ -o magsgident magsgident.cpp -std=c++17 -fconcepts -lpthread
+ *
+ * reads the same input files as structurefactor:
+ *	x y z b                       nuclear site with scattering length b
+ *	x y z Mx My Mz                magnetic site with moment along the lattice vectors
+ * positions are fractional coordinates of the crystal cell, supercells
+ * extend beyond [0, 1), cell definition and propagation vector lines are ignored.
+ *
+ * usage:
+ *	magsgident <magsg.info> <input file> [num threads]
+ */
+
+#include <boost/algorithm/string.hpp>
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <string>
+#include <map>
+
+#include "libs/magsg.h"
+#include "libs/magsgident.h"
+#include "libs/math_conts.h"
+using namespace m;
+using namespace m_ops;
+
+using t_real = double;
+using t_vec = std::vector<t_real>;
+using t_mat = mat<t_real, std::vector>;
+using t_ident = MagSgIdentifier<t_mat, t_vec>;
+
+std::string g_ws = " \t";
+
+
+template<class T>
+T from_str(const std::string& str)
+{
+	T t;
+
+	std::istringstream istr(str);
+	istr >> t;
+
+	return t;
+}
+
+
+/**
+ * reads the atoms, nuclear sites are distinguished by their scattering lengths
+ */
+bool load(std::istream& istr, t_ident& ident)
+{
+	std::map<std::string, int> species;
+	std::size_t linenr = 0;
+	bool bOk = true;
+
+	while(istr)
+	{
+		std::string line;
+		std::getline(istr, line);
+		++linenr;
+
+		boost::trim_if(line, boost::is_any_of(g_ws));
+		if(line == "" || line[0] == '#')
+			continue;
+
+		std::vector<std::string> vectoks;
+		boost::split(vectoks, line, boost::is_any_of(g_ws), boost::token_compress_on);
+
+		if(vectoks.size() == 4)		// nuclear
+		{
+			auto iter = species.find(vectoks[3]);
+			if(iter == species.end())
+				iter = species.emplace(vectoks[3], int(species.size()) + 1).first;
+
+			ident.AddSite(create<t_vec>({
+				from_str<t_real>(vectoks[0]),
+				from_str<t_real>(vectoks[1]),
+				from_str<t_real>(vectoks[2]) }),
+				zero<t_vec>(3), iter->second);
+		}
+		else if(vectoks.size() == 6)	// magnetic
+		{
+			ident.AddSite(create<t_vec>({
+				from_str<t_real>(vectoks[0]),
+				from_str<t_real>(vectoks[1]),
+				from_str<t_real>(vectoks[2]) }),
+				create<t_vec>({
+				from_str<t_real>(vectoks[3]),
+				from_str<t_real>(vectoks[4]),
+				from_str<t_real>(vectoks[5]) }), 0);
+		}
+		else if(vectoks.size() == 8 && vectoks[0] == "x")	// unit cell definition
+		{
+		}
+		else if(vectoks.size() == 3)	// propagation vector
+		{
+		}
+		else
+		{
+			std::cerr << "Error in line " << linenr << "." << std::endl;
+			bOk = false;
+		}
+	}
+
+	return bOk;
+}
+
+
+int main(int argc, char** argv)
+{
+	if(argc < 3)
+	{
+		std::cerr << "Usage: " << argv[0] << " <magsg.info> <input file> [num threads]" << std::endl;
+		return -1;
+	}
+
+	Spacegroups<t_mat, t_vec> sgs;
+	if(!sgs.Load(argv[1]))
+	{
+		std::cerr << "Cannot load \"" << argv[1] << "\"." << std::endl;
+		return -1;
+	}
+
+	std::ifstream ifstr(argv[2]);
+	if(!ifstr)
+	{
+		std::cerr << "Cannot open \"" << argv[2] << "\"." << std::endl;
+		return -1;
+	}
+
+	t_ident ident;
+	if(argc >= 4)
+		ident.SetNumThreads(from_str<unsigned int>(argv[3]));
+	if(!load(ifstr, ident))
+		return -1;
+
+	auto start = std::chrono::steady_clock::now();
+	auto matches = ident.Identify(sgs);
+	auto stop = std::chrono::steady_clock::now();
+
+	const auto& cell = ident.GetMagneticCell();
+	std::cout << ident.GetSites().size() << " atom(s) defined, "
+		<< ident.GetCellSites().size() << " in the magnetic cell "
+		<< cell[0] << "x" << cell[1] << "x" << cell[2] << ".\n";
+	std::cout << ident.GetNumSymmetries() << " symmetry operation(s) per magnetic cell found.\n";
+	std::cout << "Identification took "
+		<< std::chrono::duration<t_real, std::milli>(stop - start).count() << " ms.\n";
+
+	if(matches.size() == 0)
+	{
+		std::cout << "No matching space group found." << std::endl;
+		return -1;
+	}
+
+	std::cout << matches.size() << " matching space group(s), highest symmetry first:\n";
+	for(const auto& match : matches)
+	{
+		std::cout
+			<< std::setw(12) << std::left << match.sg->GetNumber() << " "
+			<< std::setw(16) << std::left << match.sg->GetName() << " "
+			<< "order " << std::setw(4) << std::left << match.order << " "
+			<< "origin " << match.origin[0] << " " << match.origin[1] << " " << match.origin[2];
+		if(match.order == ident.GetNumSymmetries())
+			std::cout << "  (complete)";
+		std::cout << "\n";
+	}
+
+	std::cout.flush();
+	return 0;
+}
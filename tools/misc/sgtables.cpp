@@ -0,0 +1,116 @@
+/**
+ * timing of the group table creation for all magnetic space groups
+ * @author Tobias Weber
+ * @date Nov-2018
+ * @license: see 'LICENSE.EUPL' file
+ *
+ * g++ -O2 -I../../ -o sgtables sgtables.cpp -std=c++17 -fconcepts
+ *
+ * usage:
+ *	sgtables [magsg.info]
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <string>
+
+#include "libs/magsg.h"
+#include "libs/math_conts.h"
+using namespace m;
+using namespace m_ops;
+
+using t_real = double;
+using t_vec = std::vector<t_real>;
+using t_mat = mat<t_real, std::vector>;
+
+
+/**
+ * run time of a function in milliseconds
+ */
+template<class t_func>
+t_real timing(t_func func)
+{
+	auto start = std::chrono::steady_clock::now();
+	func();
+	auto stop = std::chrono::steady_clock::now();
+
+	return std::chrono::duration<t_real, std::milli>(stop - start).count();
+}
+
+
+int main(int argc, char** argv)
+{
+	std::string strFile = "../../magsg.info";
+	if(argc >= 2)
+		strFile = argv[1];
+
+	Spacegroups<t_mat, t_vec> sgs;
+	bool bLoaded = false;
+	t_real tLoad = timing([&]() { bLoaded = sgs.Load(strFile); });
+	if(!bLoaded)
+	{
+		std::cerr << "Cannot load \"" << strFile << "\"." << std::endl;
+		return -1;
+	}
+
+	const auto* pSgs = sgs.GetSpacegroups();
+	std::cout << pSgs->size() << " space groups loaded in " << tLoad << " ms.\n";
+
+	// magnetic and structural tables in both settings
+	std::size_t iFailed[4] = { 0, 0, 0, 0 };
+	std::size_t iMaxOrder = 0, iNumOps = 0, iNumClasses = 0, iNumCosets = 0;
+
+	t_real tCreate = timing([&]()
+	{
+		for(const auto& sg : *pSgs)
+		{
+			for(int iSetting=0; iSetting<2; ++iSetting)
+			{
+				const bool bBNS = (iSetting == 0);
+				const SymGroupTable* tab = sg.GetGroupTable(bBNS);
+				const SymGroupTable* tabStruct = sg.GetStructGroupTable(bBNS);
+
+				if(!tab) ++iFailed[iSetting*2 + 0];
+				if(!tabStruct) ++iFailed[iSetting*2 + 1];
+				if(!tab || !tabStruct)
+					continue;
+
+				iMaxOrder = std::max(iMaxOrder, tab->GetOrder());
+				iNumOps += tab->GetOrder();
+				iNumClasses += tab->GetConjugacyClasses().size();
+
+				// structural group decomposed into cosets of the unitary subgroup
+				std::vector<SymOpExact> unitary;
+				for(auto idx : tab->GetUnitarySubgroup())
+					unitary.push_back(tab->GetOps()[idx]);
+				auto [sub, okSub] = tabStruct->FindOps(unitary);
+				auto [cosets, cosetOfOp, okCosets] = tabStruct->GetCosets(sub);
+				if(okSub && okCosets)
+					iNumCosets += cosets.size();
+			}
+		}
+	});
+
+	// second pass only uses the cached tables
+	t_real tCached = timing([&]()
+	{
+		for(const auto& sg : *pSgs)
+		{
+			sg.GetGroupTable(true);
+			sg.GetGroupTable(false);
+		}
+	});
+
+	std::cout << "Group tables created in " << tCreate << " ms ("
+		<< tCreate / t_real(pSgs->size()) * 1000. << " us per group), "
+		<< "cached access in " << tCached << " ms.\n";
+	std::cout << "Failed BNS: " << iFailed[0] << " magnetic, " << iFailed[1] << " structural.\n";
+	std::cout << "Failed OG:  " << iFailed[2] << " magnetic, " << iFailed[3] << " structural.\n";
+	std::cout << "Maximum order: " << iMaxOrder
+		<< ", total operations: " << iNumOps
+		<< ", total conjugacy classes: " << iNumClasses
+		<< ", total structural cosets: " << iNumCosets << "." << std::endl;
+
+	return 0;
+}
@@ -4,7 +4,18 @@
  * @date 18-mar-18
  * @license: see 'LICENSE.EUPL' file
  *
- * g++ -I../../ -o structurefactor structurefactor.cpp -std=c++17 -fconcepts
+ * g++ -I../../ -o structurefactor structurefactor.cpp -std=c++17 -fconcepts -lpthread
+ *
+ * usage:
+ *	structurefactor [input file] [magsg.info]
+ *
+ * after a line "g <BNS number>" the following atoms are expanded into their orbits
+ * under the given space group, using the database file (default: ../../magsg.info).
+ *
+ * in powder mode, a line "p <x_min> <x_max> <x_step> <U> <V> <W> <eta> [lambda]" additionally
+ * calculates the powder profile with pseudo-voigt peaks of the width fwhm^2 = U*t^2 + V*t + W.
+ * with a neutron wavelength lambda (A) the profile is on a 2theta axis (deg) with t = tan(theta),
+ * otherwise on a |Q| axis (1/A) with t = |Q|.
  */
 
 #include <boost/algorithm/string.hpp>
@@ -20,6 +31,9 @@ namespace consts = si::constants;
 
 #include "libs/math_algos.h"
 #include "libs/math_conts.h"
+#include "libs/magsg.h"
+#include "libs/magwyc.h"
+#include "libs/magpowder.h"
 using namespace m;
 using namespace m_ops;
 
@@ -54,12 +68,47 @@ struct PowderLine
 };
 
 
-void calc(std::istream& istr)
+/**
+ * expands an atom into its orbit, if a space group is selected
+ */
+void add_atoms(const WycLookup<t_mat, t_vec>* pWyc, const t_vec& R, const t_vec* M,
+	std::vector<t_vec>& Rs, std::vector<t_vec>& Ms)
+{
+	if(!pWyc)
+	{
+		Rs.push_back(R);
+		if(M) Ms.push_back(*M);
+		return;
+	}
+
+	auto [site, bFound] = pWyc->Find(R);
+	auto [orbit, moments, bMomOk] = pWyc->GetOrbit(R, M);
+
+	std::cout << "Atom at " << R << ": ";
+	if(bFound)
+		std::cout << "Wyckoff site " << site.mult << site.letter << ", ";
+	std::cout << orbit.size() << " atom(s) in orbit.\n";
+	if(M && !bMomOk)
+		std::cout << "Warning: moment " << *M << " is incompatible with the site symmetry.\n";
+
+	for(std::size_t i=0; i<orbit.size(); ++i)
+	{
+		Rs.push_back(orbit[i]);
+		if(M) Ms.push_back(moments[i]);
+	}
+}
+
+
+void calc(std::istream& istr, const std::string& strSgFile)
 {
 	std::vector<t_vec_cplx> Ms;
 	std::vector<t_cplx> bs;
 	std::vector<t_vec> Rs;
 
+	// optional space group to generate the atom orbits
+	std::unique_ptr<Spacegroups<t_mat, t_vec>> sgs;
+	std::unique_ptr<WycLookup<t_mat, t_vec>> wyc;
+
 	t_real latt[3] = {5., 5., 5.};
 	t_real angle[3] = {90., 90., 90.};
 
@@ -70,6 +119,10 @@ void calc(std::istream& istr)
 	// magnetic propagation vector
 	auto prop = create<t_vec>({0,0,0});
 
+	// optional powder profile
+	std::unique_ptr<PowderProfile<t_real>> profile;
+	t_real profileRange[3] = {0., 0., 0.};
+
 	while(istr)
 	{
 		std::string line;
@@ -83,7 +136,18 @@ void calc(std::istream& istr)
 		std::vector<std::string> vectoks;
 		boost::split(vectoks, line, boost::is_any_of(g_ws), boost::token_compress_on);
 
-		if(vectoks.size() == 4)		// nuclear
+		if(vectoks[0] == "p" && (vectoks.size() == 8 || vectoks.size() == 9))	// powder profile
+		{
+			for(int i=0; i<3; ++i)
+				profileRange[i] = from_str<t_real>(vectoks[1+i]);
+
+			profile = std::make_unique<PowderProfile<t_real>>();
+			profile->SetWidths(from_str<t_real>(vectoks[4]), from_str<t_real>(vectoks[5]), from_str<t_real>(vectoks[6]));
+			profile->SetEta(from_str<t_real>(vectoks[7]));
+			if(vectoks.size() == 9)
+				profile->SetWavelength(from_str<t_real>(vectoks[8]));
+		}
+		else if(vectoks.size() == 4)		// nuclear
 		{
 			// atomic position
 			t_real Rx = from_str<t_real>(vectoks[0]);
@@ -93,8 +157,13 @@ void calc(std::istream& istr)
 			// scattering length
 			t_cplx b = from_str<t_cplx>(vectoks[3]);
 
-			Rs.emplace_back(create<t_vec>({Rx, Ry, Rz}));
-			bs.emplace_back(b);
+			std::vector<t_vec> orbit, moments;
+			add_atoms(wyc.get(), create<t_vec>({Rx, Ry, Rz}), nullptr, orbit, moments);
+			for(const t_vec& R : orbit)
+			{
+				Rs.push_back(R);
+				bs.push_back(b);
+			}
 			bNucl = 1;
 		}
 		else if(vectoks.size() == 6)	// magnetic
@@ -110,8 +179,14 @@ void calc(std::istream& istr)
 			t_real My = from_str<t_real>(vectoks[4]);
 			t_real Mz = from_str<t_real>(vectoks[5]);
 
-			Rs.emplace_back(create<t_vec>({Rx, Ry, Rz}));
-			Ms.emplace_back(create<t_vec_cplx>({Mx, My, Mz}));
+			std::vector<t_vec> orbit, moments;
+			const t_vec M = create<t_vec>({Mx, My, Mz});
+			add_atoms(wyc.get(), create<t_vec>({Rx, Ry, Rz}), &M, orbit, moments);
+			for(std::size_t i=0; i<orbit.size(); ++i)
+			{
+				Rs.push_back(orbit[i]);
+				Ms.emplace_back(create<t_vec_cplx>({moments[i][0], moments[i][1], moments[i][2]}));
+			}
 			bNucl = 0;
 		}
 		else if(vectoks.size() == 8 && vectoks[0] == "x")	// unit cell definition
@@ -124,6 +199,35 @@ void calc(std::istream& istr)
 			angle[2] = from_str<t_real>(vectoks[6]);
 			bPowder = (from_str<int>(vectoks[7]) != 0);
 		}
+		else if(vectoks.size() == 2 && vectoks[0] == "g")	// space group
+		{
+			if(!sgs)
+			{
+				sgs = std::make_unique<Spacegroups<t_mat, t_vec>>();
+				if(!sgs->Load(strSgFile))
+				{
+					std::cerr << "Error: cannot load space groups from \"" << strSgFile << "\"." << std::endl;
+					sgs.reset();
+					continue;
+				}
+			}
+
+			const auto* sgsAll = sgs->GetSpacegroups();
+			auto iter = std::find_if(sgsAll->begin(), sgsAll->end(), [&vectoks](const auto& sg) -> bool
+			{
+				return sg.GetNumber() == vectoks[1];
+			});
+
+			wyc = std::make_unique<WycLookup<t_mat, t_vec>>();
+			if(iter == sgsAll->end() || !wyc->Create(*iter))
+			{
+				std::cerr << "Error in line " << linenr << ": invalid space group." << std::endl;
+				wyc.reset();
+				continue;
+			}
+
+			std::cout << "Space group: " << iter->GetName() << " (" << iter->GetNumber() << ").\n";
+		}
 		else if(vectoks.size() == 3 /*&& vectoks[0] == "k"*/)	// propagation vector k
 		{
 			prop[0] = from_str<t_real>(vectoks[0]);
@@ -344,6 +448,26 @@ void calc(std::istream& istr)
 				<< std::setw(prec*2) << std::right << line.I << " "
 				<< line.peaks << "\n";
 		}
+
+		if(profile)
+		{
+			// the lines already sum over all equivalent reflections
+			for(const auto& line : powderlines)
+				profile->AddLine(line.Q, line.I);
+
+			auto [xs, ys] = profile->Calc(profileRange[0], profileRange[1], profileRange[2]);
+
+			std::cout << "Powder profile:" << "\n";
+			std::cout
+				<< std::setw(prec*2) << std::right << (profile->Is2Theta() ? "2theta (deg)" : "|Q| (1/A)") << " "
+				<< std::setw(prec*2) << std::right << "I" << "\n";
+			for(std::size_t i=0; i<xs.size(); ++i)
+			{
+				std::cout
+					<< std::setw(prec*2) << std::right << xs[i] << " "
+					<< std::setw(prec*2) << std::right << ys[i] << "\n";
+			}
+		}
 	}
 }
 
@@ -359,6 +483,10 @@ int main(int argc, char **argv)
 		pIstr = ifstr.get();
 	}
 
-	calc(*pIstr);
+	std::string strSgFile = "../../magsg.info";
+	if(argc > 2)
+		strSgFile = argv[2];
+
+	calc(*pIstr, strSgFile);
 	return 0;
 }
@@ -0,0 +1,557 @@
+/**
+ * checks a converted magnetic space group database against the raw table
+ * @author Tobias Weber
+ * @date Nov-2018
+ * @license see 'LICENSE.EUPL' file
+ *
+ * g++ -o checkmag -O2 -std=c++17 -fconcepts -I. tools/setup/checkmag.cpp -lpthread
+ *
+ * the raw table is read with the tokenizer of convmag, the database with Spacegroups::Load.
+ * numbers, names, operators, lattice vectors, wyckoff positions and the BNS to OG
+ * transformation have to be reproduced exactly. the OG setting is checked for consistency
+ * with the BNS setting: the BNS rotations transformed with the BNS to OG matrix, and
+ * the rotations of the loaded OG setting, have to give the point group of the raw OG setting.
+ *
+ * usage:
+ *	checkmag [-t <num threads>] [-o] [mag.dat] [magsg.info]
+ *	-t: number of threads, 0: number of cores (default)
+ *	-o: also compare the OG settings exactly, for databases converted with bSaveOG
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <set>
+#include <limits>
+#include <chrono>
+#include <atomic>
+#include <type_traits>
+#include <cmath>
+
+#include "libs/magsg.h"
+#include "libs/math_conts.h"
+#include "libs/parallel.h"
+#include "magdat.h"
+using namespace m;
+using namespace m_ops;
+
+using t_real = double;
+using t_vec = std::vector<t_real>;
+using t_mat = mat<t_real, std::vector>;
+using t_sg = Spacegroup<t_mat, t_vec>;
+using t_sym = Symmetry<t_mat, t_vec>;
+using t_wyc = WycPositions<t_mat, t_vec>;
+using t_rotset = std::set<std::array<int, 9>>;
+
+
+t_mat read_matrix(Tokenizer& istr)
+{
+	t_mat mat = zero<t_mat>(3, 3);
+	for(std::size_t i=0; i<3; ++i)
+		for(std::size_t j=0; j<3; ++j)
+			mat(i,j) = istr.GetNum<t_real>();
+	return mat;
+}
+
+
+t_vec read_vector(Tokenizer& istr)
+{
+	t_vec vec = zero<t_vec>(3);
+	for(std::size_t i=0; i<3; ++i)
+		vec[i] = istr.GetNum<t_real>();
+	return vec;
+}
+
+
+/**
+ * bitwise equality, the database has to reproduce the table exactly
+ */
+bool same(const t_mat& mat1, const t_mat& mat2)
+{
+	if(mat1.size1() != mat2.size1() || mat1.size2() != mat2.size2())
+		return false;
+
+	for(std::size_t i=0; i<mat1.size1(); ++i)
+		for(std::size_t j=0; j<mat1.size2(); ++j)
+			if(mat1(i,j) != mat2(i,j))
+				return false;
+	return true;
+}
+
+
+bool same(const t_vec& vec1, const t_vec& vec2)
+{
+	if(vec1.size() != vec2.size())
+		return false;
+
+	for(std::size_t i=0; i<vec1.size(); ++i)
+		if(vec1[i] != vec2[i])
+			return false;
+	return true;
+}
+
+
+std::string to_str(const t_mat& mat)
+{
+	std::ostringstream ostr;
+	ostr.precision(std::numeric_limits<t_real>::max_digits10);
+
+	for(std::size_t i=0; i<mat.size1(); ++i)
+	{
+		for(std::size_t j=0; j<mat.size2(); ++j)
+			ostr << (i+j ? " " : "") << mat(i,j);
+	}
+	return "[" + ostr.str() + "]";
+}
+
+
+std::string to_str(const t_vec& vec)
+{
+	std::ostringstream ostr;
+	ostr.precision(std::numeric_limits<t_real>::max_digits10);
+
+	for(std::size_t i=0; i<vec.size(); ++i)
+		ostr << (i ? " " : "") << vec[i];
+	return "(" + ostr.str() + ")";
+}
+
+
+std::string to_str(const t_rotset& rots)
+{
+	std::ostringstream ostr;
+
+	for(const auto& rot : rots)
+	{
+		ostr << (ostr.tellp() ? " [" : "[");
+		for(std::size_t i=0; i<rot.size(); ++i)
+			ostr << (i ? " " : "") << rot[i];
+		ostr << "]";
+	}
+	return "{" + ostr.str() + "}";
+}
+
+
+/**
+ * integer rotation matrix, returns false if an element is not integral
+ */
+bool to_irot(const t_mat& rot, std::array<int, 9>& irot, t_real eps = 1e-6)
+{
+	for(std::size_t i=0; i<3; ++i)
+	{
+		for(std::size_t j=0; j<3; ++j)
+		{
+			const t_real elem = std::round(rot(i,j));
+			if(std::abs(elem - rot(i,j)) > eps)
+				return false;
+			irot[i*3 + j] = int(elem);
+		}
+	}
+	return true;
+}
+
+
+/**
+ * translation vec/div in units of 1/SymOpExact::s_denom,
+ * returns false if it is not an integer multiple
+ */
+bool to_itrans(const t_vec& vec, t_real div, std::array<int, 3>& itrans)
+{
+	if(div != std::round(div) || div == t_real(0))
+		return false;
+
+	for(std::size_t i=0; i<3; ++i)
+	{
+		const t_real num = vec[i] * t_real(SymOpExact::s_denom);
+		if(num != std::round(num) || std::fmod(num, div) != t_real(0))
+			return false;
+		itrans[i] = int(num / div);
+	}
+	return true;
+}
+
+
+// ----------------------------------------------------------------------------
+/**
+ * differences of one group
+ */
+class GroupDiffs
+{
+private:
+	std::ostringstream m_ostr;
+	std::size_t m_iNumDiffs = 0;
+
+public:
+	std::size_t GetNumDiffs() const { return m_iNumDiffs; }
+	std::string GetReport() const { return m_ostr.str(); }
+
+	void Add(const std::string& strWhat, const std::string& strRaw, const std::string& strDB)
+	{
+		m_ostr << "\t" << strWhat << ": table " << strRaw << ", database " << strDB << "\n";
+		++m_iNumDiffs;
+	}
+
+	template<class T>
+	void Check(const std::string& strWhat, const T& raw, const T& db)
+	{
+		if constexpr(std::is_same_v<T, t_mat> || std::is_same_v<T, t_vec>)
+		{
+			if(!same(raw, db))
+				Add(strWhat, to_str(raw), to_str(db));
+		}
+		else if constexpr(std::is_same_v<T, std::string>)
+		{
+			if(raw != db)
+				Add(strWhat, "\"" + raw + "\"", "\"" + db + "\"");
+		}
+		else
+		{
+			if(raw != db)
+				Add(strWhat, std::to_string(raw), std::to_string(db));
+		}
+	}
+};
+// ----------------------------------------------------------------------------
+
+
+// ----------------------------------------------------------------------------
+/**
+ * compares one setting of the table with the database, returns the structural rotations of the table
+ * without bCompare the setting is only parsed
+ */
+t_rotset check_setting(Tokenizer& istr, GroupDiffs& diffs, const std::string& strSetting, bool bIsHex,
+	const t_sym* sym, const std::vector<t_vec>* latt, const std::vector<t_wyc>* wycs,
+	const std::vector<t_mat>& ptOps, const std::vector<t_mat>& hexPtOps, bool bCompare)
+{
+	t_rotset rotset;
+
+	// operators
+	const std::size_t iNumOps = istr.GetNum<std::size_t>();
+	const std::size_t iNumOpsDB = sym ? sym->GetTranslations().size() : 0;
+	if(bCompare)
+		diffs.Check(strSetting + " number of operators", iNumOps, iNumOpsDB);
+
+	// exact operations hold the translations in units of 1/s_denom
+	const bool bExactDB = sym && iNumOpsDB && sym->GetExactOps().size() == iNumOpsDB;
+
+	for(std::size_t iOp=0; iOp<iNumOps; ++iOp)
+	{
+		const std::size_t iPtOp = istr.GetNum<std::size_t>();
+		const t_vec vec = read_vector(istr);
+		const t_real div = istr.GetNum<t_real>();
+		const int itInv = istr.GetNum<int>();
+		t_vec trans = vec / div;
+
+		const std::vector<t_mat>& ops = bIsHex ? hexPtOps : ptOps;
+		if(iPtOp < 1 || iPtOp > ops.size())
+		{
+			diffs.Add(strSetting + " operator " + std::to_string(iOp+1),
+				"point group index " + std::to_string(iPtOp), "-");
+			continue;
+		}
+		const t_mat& rot = ops[iPtOp-1];
+
+		std::array<int, 9> irot;
+		if(to_irot(rot, irot))
+			rotset.insert(irot);
+
+		if(!bCompare || iOp >= iNumOpsDB)
+			continue;
+
+		const std::string strOp = strSetting + " operator " + std::to_string(iOp+1);
+		diffs.Check(strOp + " rotation", rot, t_mat(sym->GetRotations()[iOp]));
+		diffs.Check(strOp + " time inversion", int(itInv < 0), int(sym->GetInversions()[iOp] < 0));
+
+		std::array<int, 3> itrans;
+		if(bExactDB && to_itrans(vec, div, itrans))
+		{
+			const auto& transDB = sym->GetExactOps()[iOp].trans;
+			if(!std::equal(itrans.begin(), itrans.end(), transDB.begin()))
+				diffs.Add(strOp + " translation", to_str(trans), to_str(sym->GetTranslations()[iOp]));
+		}
+		else
+		{
+			diffs.Check(strOp + " translation", trans, sym->GetTranslations()[iOp]);
+		}
+	}
+
+	// lattice vectors
+	const std::size_t iNumLatt = istr.GetNum<std::size_t>();
+	const std::size_t iNumLattDB = latt ? latt->size() : 0;
+	if(bCompare)
+		diffs.Check(strSetting + " number of lattice vectors", iNumLatt, iNumLattDB);
+
+	for(std::size_t iVec=0; iVec<iNumLatt; ++iVec)
+	{
+		t_vec vec = read_vector(istr);
+		vec /= istr.GetNum<t_real>();
+
+		if(bCompare && iVec < iNumLattDB)
+			diffs.Check(strSetting + " lattice vector " + std::to_string(iVec+1), vec, (*latt)[iVec]);
+	}
+
+	// wyckoff positions
+	const std::size_t iNumWyc = istr.GetNum<std::size_t>();
+	const std::size_t iNumWycDB = wycs ? wycs->size() : 0;
+	if(bCompare)
+		diffs.Check(strSetting + " number of wyckoff positions", iNumWyc, iNumWycDB);
+
+	for(std::size_t iWyc=0; iWyc<iNumWyc; ++iWyc)
+	{
+		const std::size_t iNumPos = istr.GetNum<std::size_t>();
+		const int iMult = istr.GetNum<int>();
+		const std::string strLetter{istr.GetString()};
+
+		const t_wyc* wyc = (bCompare && iWyc < iNumWycDB) ? &(*wycs)[iWyc] : nullptr;
+		const std::string strWyc = strSetting + " wyckoff position " + std::to_string(iWyc+1);
+		if(wyc)
+		{
+			diffs.Check(strWyc + " letter", strLetter, wyc->GetLetter());
+			diffs.Check(strWyc + " multiplicity", iMult, wyc->GetMultiplicity());
+			diffs.Check(strWyc + " number of entries", iNumPos, wyc->GetTranslations().size());
+		}
+
+		for(std::size_t iPos=0; iPos<iNumPos; ++iPos)
+		{
+			t_vec trans = read_vector(istr);
+			trans /= istr.GetNum<t_real>();
+			t_mat rot = read_matrix(istr);
+			t_mat rotMag = read_matrix(istr);
+
+			if(!wyc || iPos >= wyc->GetTranslations().size())
+				continue;
+
+			const std::string strPos = strWyc + " entry " + std::to_string(iPos+1);
+			diffs.Check(strPos + " translation", trans, wyc->GetTranslations()[iPos]);
+			diffs.Check(strPos + " rotation", rot, t_mat(wyc->GetRotations()[iPos]));
+			diffs.Check(strPos + " magnetic rotation", rotMag, t_mat(wyc->GetRotationsMag()[iPos]));
+		}
+	}
+
+	return rotset;
+}
+
+
+/**
+ * structural rotations of a setting in the database, optionally transformed as P*R*P^(-1)
+ */
+t_rotset get_rotations(const t_sym* sym, const t_mat* matP = nullptr, bool *pbIntegral = nullptr)
+{
+	t_rotset rotset;
+	if(!sym)
+		return rotset;
+
+	t_mat matPinv;
+	if(matP)
+	{
+		bool bInv = false;
+		std::tie(matPinv, bInv) = inv<t_mat>(*matP);
+		if(!bInv)
+		{
+			if(pbIntegral)
+				*pbIntegral = false;
+			return rotset;
+		}
+	}
+
+	const auto rots = sym->GetRotations();
+	for(std::size_t iOp=0; iOp<rots.size(); ++iOp)
+	{
+		t_mat rot = rots[iOp];
+		if(matP)
+			rot = (*matP) * rot * matPinv;
+
+		std::array<int, 9> irot;
+		if(to_irot(rot, irot))
+			rotset.insert(irot);
+		else if(pbIntegral)
+			*pbIntegral = false;
+	}
+
+	return rotset;
+}
+
+
+/**
+ * compares a group of the table with the database
+ */
+void check_group(Tokenizer& istr, GroupDiffs& diffs, const t_sg& sg,
+	const std::vector<t_mat>& ptOps, const std::vector<t_mat>& hexPtOps, bool bCompareOG)
+{
+	// numbers and names
+	const int iNrBNS0 = istr.GetNum<int>();
+	const int iNrBNS1 = istr.GetNum<int>();
+	istr.GetString();
+	const std::string strSGBNS{istr.GetString()};
+
+	const int iNrOG0 = istr.GetNum<int>();
+	const int iNrOG1 = istr.GetNum<int>();
+	const int iNrOG2 = istr.GetNum<int>();
+	istr.GetString();
+	const std::string strSGOG{istr.GetString()};
+
+	const std::string strNrBNS = std::to_string(iNrBNS0) + "." + std::to_string(iNrBNS1);
+	const std::string strNrOG = std::to_string(iNrOG0) + "." + std::to_string(iNrOG1)
+		+ "." + std::to_string(iNrOG2);
+
+	diffs.Check("BNS number", strNrBNS, sg.GetNumber(true));
+	diffs.Check("OG number", strNrOG, sg.GetNumber(false));
+	diffs.Check("BNS symbol", strSGBNS, sg.GetName(true));
+	diffs.Check("OG symbol", strSGOG, sg.GetName(false));
+	diffs.Check("structural group number", iNrBNS0, sg.GetStructNumber());
+	diffs.Check("magnetic group number", iNrBNS1, sg.GetMagNumber());
+
+	const bool bIsHex = (iNrBNS0>=143 && iNrBNS0<=194);
+
+	// BNS to OG trafo
+	const int iTy = istr.GetNum<int>();
+	t_mat matBNS2OG = unit<t_mat>(3);
+	if(iTy == 4)
+	{
+		matBNS2OG = read_matrix(istr);
+		t_vec vecBNS2OG = read_vector(istr);
+		vecBNS2OG /= istr.GetNum<t_real>();
+
+		diffs.Check("BNS to OG rotation", matBNS2OG, sg.GetRotBNS2OG());
+		diffs.Check("BNS to OG translation", vecBNS2OG, sg.GetTransBNS2OG());
+	}
+
+	const t_rotset rotsBNS = check_setting(istr, diffs, "BNS", bIsHex,
+		sg.GetSymmetries(true), sg.GetLattice(true), sg.GetWycPositions(true),
+		ptOps, hexPtOps, true);
+
+	if(iTy != 4)
+	{
+		// OG is identical to BNS
+		if(sg.GetSymmetries(false) != sg.GetSymmetries(true)
+			|| sg.GetLattice(false) != sg.GetLattice(true)
+			|| sg.GetWycPositions(false) != sg.GetWycPositions(true))
+			diffs.Add("OG setting", "identical to BNS", "different");
+		return;
+	}
+
+	const t_rotset rotsOG = check_setting(istr, diffs, "OG", bIsHex,
+		sg.GetSymmetries(false), sg.GetLattice(false), sg.GetWycPositions(false),
+		ptOps, hexPtOps, bCompareOG);
+
+	// BNS to OG consistency
+	bool bIntegral = true;
+	const t_rotset rotsBNS2OG = get_rotations(sg.GetSymmetries(true), &sg.GetRotBNS2OG(), &bIntegral);
+	if(!bIntegral)
+		diffs.Add("BNS rotations transformed to OG", "integral", "not integral");
+	else if(rotsBNS2OG != rotsOG)
+		diffs.Add("BNS rotations transformed to OG", to_str(rotsOG), to_str(rotsBNS2OG));
+
+	const t_rotset rotsOGDB = get_rotations(sg.GetSymmetries(false));
+	if(rotsOGDB != rotsOG)
+		diffs.Add("OG rotations", to_str(rotsOG), to_str(rotsOGDB));
+}
+// ----------------------------------------------------------------------------
+
+
+int main(int argc, char** argv)
+{
+	const char* pcFile = "mag.dat";
+	const char* pcDBFile = "magsg.info";
+	unsigned int iNumThreads = 0;
+	bool bCompareOG = false;
+
+	for(int iArg=1, iPos=0; iArg<argc; ++iArg)
+	{
+		const std::string arg = argv[iArg];
+		if(arg == "-t" && iArg+1 < argc)
+			iNumThreads = unsigned(std::stoul(argv[++iArg]));
+		else if(arg == "-o")
+			bCompareOG = true;
+		else if(iPos == 0)
+			pcFile = argv[iArg], ++iPos;
+		else
+			pcDBFile = argv[iArg];
+	}
+
+	auto start = std::chrono::steady_clock::now();
+
+	// raw table
+	MappedFile file;
+	if(!file.Open(pcFile))
+	{
+		std::cerr << "Cannot open \"" << pcFile << "\"." << std::endl;
+		return -1;
+	}
+
+	Tokenizer istr(file);
+	std::vector<t_mat> ptOps, hexPtOps;
+	for(std::size_t iOp=0; iOp<48+24; ++iOp)
+	{
+		istr.GetNum<int>();
+		istr.GetString();
+		istr.GetString();
+		(iOp < 48 ? ptOps : hexPtOps).emplace_back(read_matrix(istr));
+	}
+
+	const std::vector<std::size_t> offs = index_groups(istr, 1651);
+	if(!istr.IsOk())
+		return -1;
+
+	// database
+	Spacegroups<t_mat, t_vec> sgs;
+	if(!sgs.Load(pcDBFile))
+	{
+		std::cerr << "Cannot load \"" << pcDBFile << "\"." << std::endl;
+		return -1;
+	}
+	const auto* pSgs = sgs.GetSpacegroups();
+
+	auto loaded = std::chrono::steady_clock::now();
+
+	if(pSgs->size() != offs.size())
+	{
+		std::cerr << "Table has " << offs.size() << " groups, database has "
+			<< pSgs->size() << "." << std::endl;
+	}
+
+	// compare the groups in parallel
+	const std::size_t iNumGroups = std::min(offs.size(), pSgs->size());
+	std::vector<GroupDiffs> diffs(iNumGroups);
+	std::atomic<bool> bParsed{true};
+
+	m::run_parallel(iNumGroups, [&](std::size_t iGroup)
+	{
+		Tokenizer istrGroup = istr;
+		istrGroup.Seek(offs[iGroup]);
+
+		check_group(istrGroup, diffs[iGroup], (*pSgs)[iGroup], ptOps, hexPtOps, bCompareOG);
+		if(!istrGroup.IsOk())
+			bParsed = false;
+	}, iNumThreads);
+
+	auto stop = std::chrono::steady_clock::now();
+
+	// per-group report
+	std::size_t iNumDiffs = 0, iNumGroupsDiff = 0;
+	for(std::size_t iGroup=0; iGroup<iNumGroups; ++iGroup)
+	{
+		if(!diffs[iGroup].GetNumDiffs())
+			continue;
+
+		const t_sg& sg = (*pSgs)[iGroup];
+		std::cout << "Group " << (iGroup+1) << ", " << sg.GetNumber() << " " << sg.GetName()
+			<< ": " << diffs[iGroup].GetNumDiffs() << " difference(s)\n"
+			<< diffs[iGroup].GetReport();
+
+		iNumDiffs += diffs[iGroup].GetNumDiffs();
+		++iNumGroupsDiff;
+	}
+
+	std::cout << iNumGroups << " groups checked in "
+		<< std::chrono::duration<t_real, std::milli>(stop - start).count() << " ms (loading "
+		<< std::chrono::duration<t_real, std::milli>(loaded - start).count() << " ms), "
+		<< iNumDiffs << " difference(s) in " << iNumGroupsDiff << " group(s)." << std::endl;
+
+	const bool bOk = bParsed && iNumDiffs == 0 && pSgs->size() == offs.size();
+	return bOk ? 0 : -1;
+}
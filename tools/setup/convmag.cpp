@@ -4,27 +4,34 @@
  * @date 18-nov-17
  * @license see 'LICENSE.EUPL' file
  *
- * g++ -o convmag -O2 -std=c++17 tools/setup/convmag.cpp
+ * g++ -o convmag -O2 -std=c++17 tools/setup/convmag.cpp -lpthread
  */
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <string>
 #include <tuple>
+#include <limits>
+#include <chrono>
+#include <cmath>
+#include <type_traits>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
 
 #include <boost/numeric/ublas/matrix.hpp>
 #include <boost/numeric/ublas/vector.hpp>
 //#include <boost/numeric/ublas/io.hpp>
 namespace ublas = boost::numeric::ublas;
 
-#include <boost/property_tree/ptree.hpp>
-//#include <boost/property_tree/xml_parser.hpp>
-#include <boost/property_tree/info_parser.hpp>
-namespace ptree = boost::property_tree;
-
-#include <boost/algorithm/string/trim.hpp>
-namespace algo = boost::algorithm;
-
 #include "libs/math_algos.h"
+#include "libs/parallel.h"
+#include "magdat.h"
 
 
 using t_real = double;
@@ -118,82 +125,150 @@ std::ostream& operator<<(std::ostream& ostr, const t_vec& vec)
 }
 
 
-template<class T>
-T get_num(std::istream& istr)
+/**
+ * writes nodes directly in the info format, as ptree::write_info would
+ * write the corresponding property tree with tab indentation
+ */
+class InfoWriter
 {
-	T t;
-	istr >> t;
-	return t;
-}
+private:
+	std::string& m_str;
+	int m_iDepth = 0;
 
+	void Indent() { m_str.append(std::size_t(m_iDepth), '\t'); }
 
-std::string get_string(std::istream& istr)
-{
-	// skip whitespace
-	while(1)
+	void AppendData(std::string_view data)
 	{
-		char c = istr.get();
-		if(c!=' ' && c!='\t')
+		std::string esc;
+		esc.reserve(data.length());
+		for(char c : data)
+		{
+			switch(c)
+			{
+				case '\0': esc += "\\0"; break;
+				case '\a': esc += "\\a"; break;
+				case '\b': esc += "\\b"; break;
+				case '\f': esc += "\\f"; break;
+				case '\n': esc += "\\n"; break;
+				case '\r': esc += "\\r"; break;
+				case '\v': esc += "\\v"; break;
+				case '\"': esc += "\\\""; break;
+				case '\\': esc += "\\\\"; break;
+				default: esc += c; break;
+			}
+		}
+
+		const bool bSimple = !esc.empty() && esc.find_first_of(" \t{};\n\"") == std::string::npos;
+
+		m_str += ' ';
+		if(bSimple)
+		{
+			m_str += esc;
+		}
+		else
 		{
-			istr.unget();
-			break;
+			m_str += '\"';
+			m_str += esc;
+			m_str += '\"';
 		}
+		m_str += '\n';
 	}
 
-	// string start
-	char c = istr.get();
-	if(c != '\"')
+public:
+	InfoWriter(std::string& str, int iDepth = 0) : m_str{str}, m_iDepth{iDepth} {}
+
+	void Open(const std::string& key)
 	{
-		istr.unget();
-		std::cerr << "Expected a string." << std::endl;
+		Indent();
+		m_str += key;
+		m_str += '\n';
+		Indent();
+		m_str += "{\n";
+		++m_iDepth;
 	}
 
-	// read string
-	std::string str;
-	while(1)
+	void Close()
 	{
-		c = istr.get();
-		// end of string?
-		if(c == '\"')
-			break;
+		--m_iDepth;
+		Indent();
+		m_str += "}\n";
+	}
+
+	template<class T>
+	void Put(const std::string& key, const T& val)
+	{
+		Indent();
+		m_str += key;
 
-		str += c;
+		if constexpr(std::is_floating_point_v<T>)
+		{
+			// same precision as the property tree's stream translator
+			if(val == std::round(val) && std::abs(val) < T(1e15) && !std::signbit(val))
+			{
+				AppendData(std::to_string(static_cast<long long>(val)));
+			}
+			else
+			{
+				std::ostringstream ostr;
+				ostr.precision(std::numeric_limits<T>::max_digits10);
+				ostr << val;
+				AppendData(ostr.str());
+			}
+		}
+		else if constexpr(std::is_integral_v<T>)
+		{
+			AppendData(std::to_string(val));
+		}
+		else
+		{
+			AppendData(val);
+		}
 	}
+};
+
+
+template<class T>
+T get_num(Tokenizer& istr)
+{
+	return istr.GetNum<T>();
+}
 
-	algo::trim(str);
-	return str;
+
+std::string_view get_string(Tokenizer& istr)
+{
+	return istr.GetString();
 }
 
 
-t_mat get_matrix(std::size_t N, std::size_t M, std::istream& istr)
+t_mat get_matrix(std::size_t N, std::size_t M, Tokenizer& istr)
 {
 	t_mat mat(N,M);
 
 	for(std::size_t i=0; i<N; ++i)
 		for(std::size_t j=0; j<M; ++j)
-			istr >> mat(i,j);
+			mat(i,j) = istr.GetNum<t_real>();
 
 	return mat;
 }
 
 
-t_vec get_vector(std::size_t N, std::istream& istr)
+t_vec get_vector(std::size_t N, Tokenizer& istr)
 {
 	t_vec vec(N);
 
 	for(std::size_t i=0; i<N; ++i)
-		istr >> vec(i);
+		vec(i) = istr.GetNum<t_real>();
 
 	return vec;
 }
 
 
-std::tuple<std::string, t_mat> get_pointgroup_op(std::istream& istr)
+std::tuple<std::string, t_mat> get_pointgroup_op(Tokenizer& istr)
 {
 	int iNum = get_num<int>(istr);
 
-	std::string strName = get_string(istr);
-	std::string strOpXYZ = get_string(istr);
+	std::string strName{get_string(istr)};
+	get_string(istr);	// xyz notation of the operator, not needed
 	t_mat matOp = get_matrix(3,3, istr);
 
 	//std::cout << strName << ": " << matOp << "\n";
@@ -201,36 +276,137 @@ std::tuple<std::string, t_mat> get_pointgroup_op(std::istream& istr)
 }
 
 
-void convert_spacegroup(std::istream& istr, ptree::ptree& prop, const std::string& strPath,
+/**
+ * converts the operators, lattice vectors and wyckoff positions of one setting
+ * the nodes are only written if bSave is set
+ */
+void convert_setting(Tokenizer& istr, InfoWriter& out, bool bSave, bool bIsHex, std::string_view strSG,
+	const std::vector<std::tuple<std::string, t_mat>>* pPtOps,
+	const std::vector<std::tuple<std::string, t_mat>>* pHexPtOps)
+{
+	std::size_t iNumOps = get_num<std::size_t>(istr);
+	if(bSave && iNumOps)
+		out.Open("ops");
+	for(std::size_t iPtOp=0; iPtOp<iNumOps; ++iPtOp)
+	{
+		std::size_t iOper = get_num<std::size_t>(istr);
+		t_vec vec = get_vector(3, istr);
+		t_real num = get_num<t_real>(istr);
+		int itInv = get_num<int>(istr);
+
+		if(!bSave)
+			continue;
+
+		const std::string strOp = std::to_string(iPtOp+1);
+		if(pPtOps && !bIsHex)
+			out.Put("R" + strOp, to_str(std::get<1>(pPtOps->at(iOper-1))));
+		else if(pHexPtOps && bIsHex)
+			out.Put("R" + strOp, to_str(std::get<1>(pHexPtOps->at(iOper-1))));
+		else
+		{
+			std::cerr << "Invalid point group index for " << strSG << "." << std::endl;
+			out.Put("R" + strOp, iOper);
+		}
+		out.Put("v" + strOp, to_str(vec));
+		out.Put("d" + strOp, num);
+		out.Put("t" + strOp, itInv);
+	}
+	if(bSave && iNumOps)
+		out.Close();
+
+	std::size_t iNumLattVecs = get_num<std::size_t>(istr);
+	if(bSave && iNumLattVecs)
+		out.Open("lat");
+	for(std::size_t iVec=0; iVec<iNumLattVecs; ++iVec)
+	{
+		t_vec vec = get_vector(3, istr);
+		t_real num = get_num<t_real>(istr);
+
+		if(bSave)
+		{
+			out.Put("v" + std::to_string(iVec+1), to_str(vec));
+			out.Put("d" + std::to_string(iVec+1), num);
+		}
+	}
+	if(bSave && iNumLattVecs)
+		out.Close();
+
+	std::size_t iNumWyc = get_num<std::size_t>(istr);
+	if(bSave && iNumWyc)
+		out.Open("wyc");
+	for(std::size_t iWyc=0; iWyc<iNumWyc; ++iWyc)
+	{
+		std::size_t iNumPos = get_num<std::size_t>(istr);
+		std::size_t iMult = get_num<std::size_t>(istr);
+		std::string_view strWycName = get_string(istr);
+
+		if(bSave)
+		{
+			out.Open("s" + std::to_string(iWyc+1));
+			out.Put("l", strWycName);
+			out.Put("m", iMult);
+		}
+
+		for(std::size_t iPos=0; iPos<iNumPos; ++iPos)
+		{
+			t_vec vecWyc = get_vector(3, istr);
+			t_real numWyc = get_num<t_real>(istr);
+			t_mat matWycXYZ = get_matrix(3, 3, istr);
+			t_mat matWycMXMYMZ = get_matrix(3, 3, istr);
+
+			if(bSave)
+			{
+				const std::string strPos = std::to_string(iPos+1);
+				out.Put("v" + strPos, to_str(vecWyc));
+				out.Put("d" + strPos, numWyc);
+				out.Put("R" + strPos, to_str(matWycXYZ));
+				out.Put("M" + strPos, to_str(matWycMXMYMZ));
+			}
+		}
+
+		if(bSave)
+			out.Close();
+	}
+	if(bSave && iNumWyc)
+		out.Close();
+}
+
+
+/**
+ * converts a space group and appends its node to the output string
+ * the BNS, OG and BNS to OG nodes are written in the order of a property tree
+ */
+void convert_spacegroup(Tokenizer& istr, std::string& strOut, std::size_t iGroup,
 	const std::vector<std::tuple<std::string, t_mat>>* pPtOps = nullptr,
 	const std::vector<std::tuple<std::string, t_mat>>* pHexPtOps = nullptr)
 {
 	int iNrBNS[2];
-	istr >> iNrBNS[0] >> iNrBNS[1];
-	std::string strNrBNS = get_string(istr);
-	std::string strSGBNS = get_string(istr);
+	iNrBNS[0] = get_num<int>(istr);
+	iNrBNS[1] = get_num<int>(istr);
+	std::string_view strNrBNS = get_string(istr);
+	std::string_view strSGBNS = get_string(istr);
 
 	int iNrOG[3];
-	istr >> iNrOG[0] >> iNrOG[1] >> iNrOG[2];
-	std::string strNrOG = get_string(istr);
-	std::string strSGOG = get_string(istr);
-
-	prop.put(strPath + "bns.id", strSGBNS);
-	prop.put(strPath + "og.id", strSGOG);
-
-	std::ostringstream ostrNrBNS, ostrNrOG;
-	ostrNrBNS << iNrBNS[0] << "." << iNrBNS[1];
-	ostrNrOG << iNrOG[0] << "." << iNrOG[1] << "." << iNrOG[2];
+	iNrOG[0] = get_num<int>(istr);
+	iNrOG[1] = get_num<int>(istr);
+	iNrOG[2] = get_num<int>(istr);
+	std::string_view strNrOG = get_string(istr);
+	std::string_view strSGOG = get_string(istr);
 
-	prop.put(strPath + "bns.nr", ostrNrBNS.str());
-	prop.put(strPath + "og.nr", ostrNrOG.str());
+	const std::string strNrBNSCalc = std::to_string(iNrBNS[0]) + "." + std::to_string(iNrBNS[1]);
+	const std::string strNrOGCalc = std::to_string(iNrOG[0]) + "." + std::to_string(iNrOG[1])
+		+ "." + std::to_string(iNrOG[2]);
 
 	// consistency check
-	if(ostrNrBNS.str()!=strNrBNS || ostrNrOG.str()!=strNrOG)
+	if(strNrBNSCalc!=strNrBNS || strNrOGCalc!=strNrOG)
 		std::cerr << "Mismatch of space group number in " << strSGBNS << "." << std::endl;
 
 	bool bIsHex = (iNrBNS[0]>=143 && iNrBNS[0]<=194);
 
+	// group node and its sub-nodes at the depth of "mag_groups.sgN."
+	std::string strBNS, strOG, strBNS2OG;
+	InfoWriter outBNS(strBNS, 2), outOG(strOG, 2), outBNS2OG(strBNS2OG, 2);
+
 
 	int iTy = get_num<int>(istr);
 	if(iTy == 4)	// BNS -> OG trafo
@@ -239,201 +415,269 @@ void convert_spacegroup(std::istream& istr, ptree::ptree& prop, const std::strin
 		t_vec vecBNS2OG = get_vector(3, istr);
 		t_real numBNS2OG = get_num<t_real>(istr);
 
-		prop.put(strPath + "bns2og.R", to_str(matBNS2OG));
-		prop.put(strPath + "bns2og.v", to_str(vecBNS2OG));
-		prop.put(strPath + "bns2og.d", numBNS2OG);
+		outBNS2OG.Open("bns2og");
+		outBNS2OG.Put("R", to_str(matBNS2OG));
+		outBNS2OG.Put("v", to_str(vecBNS2OG));
+		outBNS2OG.Put("d", numBNS2OG);
+		outBNS2OG.Close();
 	}
 
 
-	//std::size_t iMaxOperBNS = 0;
-	std::size_t iNumOpsBNS = get_num<std::size_t>(istr);
-	for(std::size_t iPtOp=0; iPtOp<iNumOpsBNS; ++iPtOp)
-	{
-		std::size_t iOperBNS = get_num<std::size_t>(istr);
-		//iMaxOperBNS = std::max(iOperBNS, iMaxOperBNS);
-		t_vec vecBNS = get_vector(3, istr);
-		t_real numBNS = get_num<t_real>(istr);
-		int itInvBNS = get_num<int>(istr);
-
-		if(pPtOps && !bIsHex)
-			prop.put(strPath + "bns.ops.R" + std::to_string(iPtOp+1), to_str(std::get<1>(pPtOps->at(iOperBNS-1))));
-		else if(pHexPtOps && bIsHex)
-			prop.put(strPath + "bns.ops.R" + std::to_string(iPtOp+1), to_str(std::get<1>(pHexPtOps->at(iOperBNS-1))));
-		else
-		{
-			std::cerr << "Invalid point group index for " << strSGBNS << "." << std::endl;
-			prop.put(strPath + "bns.ops.R" + std::to_string(iPtOp+1), iOperBNS);
-		}
-		prop.put(strPath + "bns.ops.v" + std::to_string(iPtOp+1), to_str(vecBNS));
-		prop.put(strPath + "bns.ops.d" + std::to_string(iPtOp+1), numBNS);
-		prop.put(strPath + "bns.ops.t" + std::to_string(iPtOp+1), itInvBNS);
-	}
-	//std::cout << "\nmax op: " << iMaxOperBNS << std::endl;
+	outBNS.Open("bns");
+	outBNS.Put("id", strSGBNS);
+	outBNS.Put("nr", strNrBNSCalc);
+	convert_setting(istr, outBNS, true, bIsHex, strSGBNS, pPtOps, pHexPtOps);
+	outBNS.Close();
 
-	std::size_t iNumLattVecsBNS = get_num<std::size_t>(istr);
-	for(std::size_t iVec=0; iVec<iNumLattVecsBNS; ++iVec)
-	{
-		t_vec vecBNS = get_vector(3, istr);
-		t_real numBNS = get_num<t_real>(istr);
+	outOG.Open("og");
+	outOG.Put("id", strSGOG);
+	outOG.Put("nr", strNrOGCalc);
+	if(iTy == 4)
+		convert_setting(istr, outOG, bSaveOG, bIsHex, strSGOG, pPtOps, pHexPtOps);
+	outOG.Close();
 
-		prop.put(strPath + "bns.lat.v" + std::to_string(iVec+1), to_str(vecBNS));
-		prop.put(strPath + "bns.lat.d" + std::to_string(iVec+1), numBNS);
-	}
 
-	std::size_t iNumWycBNS = get_num<std::size_t>(istr);
-	for(std::size_t iWyc=0; iWyc<iNumWycBNS; ++iWyc)
-	{
-		std::size_t iNumPos = get_num<std::size_t>(istr);
-		std::size_t iMult = get_num<std::size_t>(istr);
-		std::string strWycName = get_string(istr);
+	InfoWriter out(strOut, 1);
+	out.Open("sg" + std::to_string(iGroup+1));
+	strOut += strBNS;
+	strOut += strOG;
+	strOut += strBNS2OG;
+	out.Close();
 
-		prop.put(strPath + "bns.wyc.s" + std::to_string(iWyc+1) + ".l", strWycName);
-		prop.put(strPath + "bns.wyc.s" + std::to_string(iWyc+1) + ".m", iMult);
+	//std::cout << strSGBNS << ", " << strSGOG << "\n";
+	//std::cout << "."; std::cout.flush();
+}
 
-		for(std::size_t iPos=0; iPos<iNumPos; ++iPos)
-		{
-			t_vec vecWyc = get_vector(3, istr);
-			t_real numWyc = get_num<t_real>(istr);
-			t_mat matWycXYZ = get_matrix(3, 3, istr);
-			t_mat matWycMXMYMZ = get_matrix(3, 3, istr);
 
-			prop.put(strPath + "bns.wyc.s" + std::to_string(iWyc+1)
-				+ ".v" + std::to_string(iPos+1), to_str(vecWyc));
-			prop.put(strPath + "bns.wyc.s" + std::to_string(iWyc+1)
-				+ ".d" + std::to_string(iPos+1), numWyc);
-			prop.put(strPath + "bns.wyc.s" + std::to_string(iWyc+1)
-				+ ".R" + std::to_string(iPos+1), to_str(matWycXYZ));
-			prop.put(strPath + "bns.wyc.s" + std::to_string(iWyc+1)
-				+ ".M" + std::to_string(iPos+1), to_str(matWycMXMYMZ));
-		}
-	}
+/**
+ * second pass: converts the groups independently on several threads,
+ * the outputs are written in order as soon as they are available
+ */
+bool convert_groups_parallel(const Tokenizer& istr, const std::vector<std::size_t>& offs,
+	std::ostream* pOstr, unsigned int iNumThreads, bool bVerbose,
+	const std::vector<std::tuple<std::string, t_mat>>* pPtOps,
+	const std::vector<std::tuple<std::string, t_mat>>* pHexPtOps)
+{
+	const std::size_t iNumGroups = offs.size();
 
+	std::vector<std::string> groups(iNumGroups);
+	std::vector<bool> done(iNumGroups, false);
+	std::mutex mtx;
+	std::condition_variable cond;
+	std::atomic<std::size_t> iNext{0};
+	std::atomic<bool> bOk{true};
 
-	if(iTy == 4)	// OG
+	auto worker = [&]()
 	{
-		std::size_t iNumPtOpsOG = get_num<std::size_t>(istr);
-		for(std::size_t iPtOp=0; iPtOp<iNumPtOpsOG; ++iPtOp)
+		for(std::size_t iGroup = iNext++; iGroup < iNumGroups; iGroup = iNext++)
 		{
-			std::size_t iOperOG = get_num<std::size_t>(istr);
-			t_vec vecOG = get_vector(3, istr);
-			t_real numOG = get_num<t_real>(istr);
-			int itInvOG = get_num<int>(istr);
+			Tokenizer istrGroup = istr;
+			istrGroup.Seek(offs[iGroup]);
+
+			std::string strGroup;
+			convert_spacegroup(istrGroup, strGroup, iGroup, pPtOps, pHexPtOps);
+			if(!istrGroup.IsOk())
+				bOk = false;
 
-			if(bSaveOG)
 			{
-				if(pPtOps && !bIsHex)
-					prop.put(strPath + "og.ops.R" + std::to_string(iPtOp+1), to_str(std::get<1>(pPtOps->at(iOperOG-1))));
-				else if(pHexPtOps && bIsHex)
-					prop.put(strPath + "og.ops.R" + std::to_string(iPtOp+1), to_str(std::get<1>(pHexPtOps->at(iOperOG-1))));
-				else
-					prop.put(strPath + "og.ops.R" + std::to_string(iPtOp+1), iOperOG);
-				prop.put(strPath + "og.ops.v" + std::to_string(iPtOp+1), to_str(vecOG));
-				prop.put(strPath + "og.ops.d" + std::to_string(iPtOp+1), numOG);
-				prop.put(strPath + "og.ops.t" + std::to_string(iPtOp+1), itInvOG);
+				std::lock_guard<std::mutex> lock(mtx);
+				groups[iGroup] = std::move(strGroup);
+				done[iGroup] = true;
 			}
+			cond.notify_one();
 		}
+	};
 
-		std::size_t iNumLattVecsOG = get_num<std::size_t>(istr);
-		for(std::size_t iVec=0; iVec<iNumLattVecsOG; ++iVec)
-		{
-			t_vec vecOG = get_vector(3, istr);
-			t_real numOG = get_num<t_real>(istr);
+	std::vector<std::thread> threads;
+	for(unsigned int iThread=0; iThread<iNumThreads; ++iThread)
+		threads.emplace_back(worker);
 
-			if(bSaveOG)
-			{
-				prop.put(strPath + "og.lat.v" + std::to_string(iVec+1), to_str(vecOG));
-				prop.put(strPath + "og.lat.d" + std::to_string(iVec+1), numOG);
-			}
+	// merge
+	for(std::size_t iGroup=0; iGroup<iNumGroups; ++iGroup)
+	{
+		if(bVerbose && (iGroup % 64 == 0 || iGroup+1 == iNumGroups))
+		{
+			std::cout << "\rGroup " << (iGroup+1) << " / " << iNumGroups << "...     ";
+			std::cout.flush();
 		}
 
-		std::size_t iNumWycOG = get_num<std::size_t>(istr);
-		for(std::size_t iWyc=0; iWyc<iNumWycOG; ++iWyc)
+		std::string strGroup;
 		{
-			std::size_t iNumPos = get_num<std::size_t>(istr);
-			std::size_t iMult = get_num<std::size_t>(istr);
-			std::string strWycName = get_string(istr);
-
-			if(bSaveOG)
-			{
-				prop.put(strPath + "og.wyc.s" + std::to_string(iWyc+1) + ".l", strWycName);
-				prop.put(strPath + "og.wyc.s" + std::to_string(iWyc+1) + ".m", iMult);
-			}
-
-			for(std::size_t iPos=0; iPos<iNumPos; ++iPos)
-			{
-				t_vec vecWyc = get_vector(3, istr);
-				t_real numWyc = get_num<t_real>(istr);
-				t_mat matWycXYZ = get_matrix(3, 3, istr);
-				t_mat matWycMXMYMZ = get_matrix(3, 3, istr);
-
-				if(bSaveOG)
-				{
-					prop.put(strPath + "og.wyc.s" + std::to_string(iWyc+1)
-						+ ".v" + std::to_string(iPos+1) , to_str(vecWyc));
-					prop.put(strPath + "og.wyc.s" + std::to_string(iWyc+1)
-						+ ".d" + std::to_string(iPos+1) , numWyc);
-					prop.put(strPath + "og.wyc.s" + std::to_string(iWyc+1)
-						+ ".R" + std::to_string(iPos+1) , to_str(matWycXYZ));
-					prop.put(strPath + "og.wyc.s" + std::to_string(iWyc+1)
-						+ ".M" + std::to_string(iPos+1), to_str(matWycMXMYMZ));
-				}
-			}
+			std::unique_lock<std::mutex> lock(mtx);
+			cond.wait(lock, [&done, iGroup]() -> bool { return done[iGroup]; });
+			std::swap(strGroup, groups[iGroup]);
 		}
+
+		if(pOstr)
+			(*pOstr) << strGroup;
 	}
 
-	//std::cout << strSGBNS << ", " << strSGOG << "\n";
-	//std::cout << "."; std::cout.flush();
+	for(auto& thread : threads)
+		thread.join();
+
+	return bOk;
 }
 
 
-void convert_table(const char* pcFile)
+/**
+ * converts the table, each group is written as soon as it is parsed
+ * the output is discarded if no stream is given
+ * with more than one thread the group records are indexed first and converted in parallel
+ */
+bool convert_table(const MappedFile& file, std::ostream* pOstr, unsigned int iNumThreads = 1, bool bVerbose = true)
 {
-	std::ifstream istr(pcFile);
-	if(!istr)
-	{
-		std::cerr << "Cannot open \"" << pcFile << "\"." << std::endl;
-		return;
-	}
-
+	constexpr std::size_t iNumGroups = 1651;
+	Tokenizer istr(file);
 	std::vector<std::tuple<std::string, t_mat>> vecPtOps, vecHexPtOps;
 
 	// read 48 point group operators
-	std::cout << "Reading point group operators...\n";
+	if(bVerbose)
+		std::cout << "Reading point group operators...\n";
 	for(std::size_t i=0; i<48; ++i)
 		vecPtOps.emplace_back(get_pointgroup_op(istr));
 
 	// read 24 hexagonal point group operators
-	std::cout << "Reading hexagonal point group operators...\n";
+	if(bVerbose)
+		std::cout << "Reading hexagonal point group operators...\n";
 	for(std::size_t i=0; i<24; ++i)
 		vecHexPtOps.emplace_back(get_pointgroup_op(istr));
 
 
-	ptree::ptree prop;
+	iNumThreads = m::get_num_threads(iNumThreads);
+
+	std::vector<std::size_t> offs;
+	if(iNumThreads > 1)
+	{
+		if(bVerbose)
+			std::cout << "Indexing space groups...\n";
+
+		Tokenizer istrIdx = istr;
+		offs = index_groups(istrIdx, iNumGroups);
+		if(!istrIdx.IsOk() || offs.size() != iNumGroups)
+			return false;
+	}
+
 
 	// convert the 1651 3D space groups
-	std::cout << "Converting space groups...\n";
-	for(std::size_t i=0; i<1651; ++i)
+	if(bVerbose)
+		std::cout << "Converting space groups...\n";
+	if(pOstr)
+		(*pOstr) << "mag_groups\n{\n";
+
+	bool bOk = true;
+	if(iNumThreads > 1)
+	{
+		bOk = convert_groups_parallel(istr, offs, pOstr, iNumThreads, bVerbose, &vecPtOps, &vecHexPtOps);
+	}
+	else
 	{
-		std::cout << "\rGroup " << (i+1) << " / 1651...     ";
-		std::cout.flush();
+		std::string strGroup;
+		for(std::size_t i=0; i<iNumGroups; ++i)
+		{
+			if(bVerbose && (i % 64 == 0 || i+1 == iNumGroups))
+			{
+				std::cout << "\rGroup " << (i+1) << " / " << iNumGroups << "...     ";
+				std::cout.flush();
+			}
 
-		std::string strPath = "mag_groups.sg" + std::to_string(i+1) + ".";
-		convert_spacegroup(istr, prop, strPath, &vecPtOps, &vecHexPtOps);
+			strGroup.clear();
+			convert_spacegroup(istr, strGroup, i, &vecPtOps, &vecHexPtOps);
+			if(pOstr)
+				(*pOstr) << strGroup;
+		}
+		bOk = istr.IsOk();
 	}
-	std::cout << "\n";
 
+	if(pOstr)
+		(*pOstr) << "}\n";
+	if(bVerbose)
+		std::cout << "\n";
+
+	return bOk;
+}
+
+
+/**
+ * mean time of repeated conversions without output
+ */
+void benchmark_table(const char* pcFile, std::size_t iNumRuns, unsigned int iNumThreads)
+{
+	t_real tOpen = 0, tConvert = 0;
+
+	for(std::size_t iRun=0; iRun<iNumRuns; ++iRun)
+	{
+		auto start = std::chrono::steady_clock::now();
+		MappedFile file;
+		if(!file.Open(pcFile))
+		{
+			std::cerr << "Cannot open \"" << pcFile << "\"." << std::endl;
+			return;
+		}
+		auto mid = std::chrono::steady_clock::now();
+		convert_table(file, nullptr, iNumThreads, false);
+		auto stop = std::chrono::steady_clock::now();
+
+		tOpen += std::chrono::duration<t_real, std::milli>(mid - start).count();
+		tConvert += std::chrono::duration<t_real, std::milli>(stop - mid).count();
+	}
 
-	/*ptree::write_xml("magsg.xml", prop,
-		std::locale(),
-		ptree::xml_writer_make_settings('\t', 1, std::string("utf-8")));*/
-	ptree::write_info("magsg.info", prop,
-		std::locale(),
-		ptree::info_writer_make_settings('\t', 1));
+	std::cout << "Mean over " << iNumRuns << " runs: "
+		<< "open " << tOpen / t_real(iNumRuns) << " ms, "
+		<< "parse and format " << tConvert / t_real(iNumRuns) << " ms ("
+		<< tConvert / t_real(iNumRuns) / 1651. * 1000. << " us per group)." << std::endl;
 }
 
 
-int main()
+/**
+ * usage: convmag [-b] [-t <num threads>] [mag.dat] [magsg.info]
+ *	-b: benchmark the conversion without writing the output
+ *	-t: number of conversion threads, 0: number of cores (default), 1: single pass
+ */
+int main(int argc, char** argv)
 {
-	convert_table("mag.dat");
-	return 0;
+	const char* pcFile = "mag.dat";
+	const char* pcOutFile = "magsg.info";
+	bool bBenchmark = false;
+	unsigned int iNumThreads = 0;
+
+	for(int iArg=1, iPos=0; iArg<argc; ++iArg)
+	{
+		const std::string arg = argv[iArg];
+		if(arg == "-b")
+			bBenchmark = true;
+		else if(arg == "-t" && iArg+1 < argc)
+			iNumThreads = unsigned(std::stoul(argv[++iArg]));
+		else if(iPos == 0)
+			pcFile = argv[iArg], ++iPos;
+		else
+			pcOutFile = argv[iArg];
+	}
+
+	if(bBenchmark)
+	{
+		benchmark_table(pcFile, 10, iNumThreads);
+		return 0;
+	}
+
+	MappedFile file;
+	if(!file.Open(pcFile))
+	{
+		std::cerr << "Cannot open \"" << pcFile << "\"." << std::endl;
+		return -1;
+	}
+
+	std::ofstream ostr(pcOutFile);
+	if(!ostr)
+	{
+		std::cerr << "Cannot open \"" << pcOutFile << "\"." << std::endl;
+		return -1;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	bool bOk = convert_table(file, &ostr, iNumThreads);
+	auto stop = std::chrono::steady_clock::now();
+
+	std::cout << "Conversion took "
+		<< std::chrono::duration<t_real, std::milli>(stop - start).count() << " ms." << std::endl;
+	return bOk ? 0 : -1;
 }
@@ -0,0 +1,250 @@
+/**
+ * tokenizer and record index for the raw magnetic space group table (mag.dat),
+ * shared by convmag and checkmag
+ * @author Tobias Weber
+ * @date 18-nov-17
+ * @license see 'LICENSE.EUPL' file
+ */
+
+#ifndef __MAG_DAT_H__
+#define __MAG_DAT_H__
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <charconv>
+#include <vector>
+#include <algorithm>
+#include <iterator>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+
+/**
+ * read-only memory mapping of the input table
+ */
+class MappedFile
+{
+private:
+	void *m_pMap = nullptr;
+	std::size_t m_iMapSize = 0;
+
+	// fallback if the file cannot be mapped
+	std::vector<char> m_buf;
+
+	const char *m_pBegin = nullptr, *m_pEnd = nullptr;
+
+public:
+	MappedFile() = default;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	~MappedFile()
+	{
+		if(m_pMap)
+			::munmap(m_pMap, m_iMapSize);
+	}
+
+	bool Open(const char* pcFile)
+	{
+		int fd = ::open(pcFile, O_RDONLY);
+		if(fd < 0)
+			return false;
+
+		struct stat st;
+		if(::fstat(fd, &st) == 0 && st.st_size > 0)
+		{
+			m_iMapSize = std::size_t(st.st_size);
+			m_pMap = ::mmap(nullptr, m_iMapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+			if(m_pMap == MAP_FAILED)
+				m_pMap = nullptr;
+		}
+		::close(fd);
+
+		if(m_pMap)
+		{
+			::madvise(m_pMap, m_iMapSize, MADV_SEQUENTIAL);
+			m_pBegin = static_cast<const char*>(m_pMap);
+			m_pEnd = m_pBegin + m_iMapSize;
+		}
+		else
+		{
+			// not mappable, read it instead
+			std::ifstream ifstr(pcFile, std::ios::binary);
+			if(!ifstr)
+				return false;
+			m_buf.assign(std::istreambuf_iterator<char>(ifstr), std::istreambuf_iterator<char>());
+			m_pBegin = m_buf.data();
+			m_pEnd = m_pBegin + m_buf.size();
+		}
+
+		return true;
+	}
+
+	const char* GetBegin() const { return m_pBegin; }
+	const char* GetEnd() const { return m_pEnd; }
+};
+
+
+/**
+ * tokenizer for the mapped input table, copies share the data
+ * numbers are parsed locale-independently with std::from_chars,
+ * quoted strings are returned as views into the mapped file
+ */
+class Tokenizer
+{
+private:
+	const char *m_pBegin = nullptr, *m_pCur = nullptr, *m_pEnd = nullptr;
+	bool m_bOk = true;
+
+protected:
+	static bool IsWS(char c) { return c==' ' || c=='\t' || c=='\n' || c=='\r'; }
+
+	void SkipWS()
+	{
+		while(m_pCur < m_pEnd && IsWS(*m_pCur))
+			++m_pCur;
+	}
+
+	void Error(const char* pcWhat)
+	{
+		if(m_bOk)
+		{
+			std::cerr << "Expected " << pcWhat << " at offset " << GetOffset() << "." << std::endl;
+			m_bOk = false;
+		}
+	}
+
+public:
+	Tokenizer(const MappedFile& file)
+		: m_pBegin{file.GetBegin()}, m_pCur{file.GetBegin()}, m_pEnd{file.GetEnd()}
+	{}
+
+	bool IsOk() const { return m_bOk; }
+	std::size_t GetOffset() const { return std::size_t(m_pCur - m_pBegin); }
+	void Seek(std::size_t iOffs) { m_pCur = m_pBegin + std::min(iOffs, std::size_t(m_pEnd - m_pBegin)); }
+
+	template<class T>
+	T GetNum()
+	{
+		SkipWS();
+
+		// from_chars does not accept a leading '+'
+		if(m_pCur < m_pEnd && *m_pCur == '+')
+			++m_pCur;
+
+		T t{};
+		auto [pcNext, err] = std::from_chars(m_pCur, m_pEnd, t);
+		if(err != std::errc{})
+		{
+			Error("a number");
+			return T{};
+		}
+
+		m_pCur = pcNext;
+		return t;
+	}
+
+	/**
+	 * quoted string with surrounding white space removed
+	 */
+	std::string_view GetString()
+	{
+		SkipWS();
+
+		if(m_pCur >= m_pEnd || *m_pCur != '\"')
+		{
+			Error("a string");
+			return std::string_view{};
+		}
+
+		const char *pcStart = ++m_pCur;
+		while(m_pCur < m_pEnd && *m_pCur != '\"')
+			++m_pCur;
+		const char *pcStop = m_pCur;
+		if(m_pCur < m_pEnd)
+			++m_pCur;
+
+		while(pcStart < pcStop && IsWS(*pcStart))
+			++pcStart;
+		while(pcStop > pcStart && IsWS(*(pcStop-1)))
+			--pcStop;
+
+		return std::string_view(pcStart, std::size_t(pcStop - pcStart));
+	}
+
+	/**
+	 * skips numbers without parsing them
+	 */
+	void Skip(std::size_t iNumTokens)
+	{
+		for(std::size_t i=0; i<iNumTokens; ++i)
+		{
+			SkipWS();
+			while(m_pCur < m_pEnd && !IsWS(*m_pCur))
+				++m_pCur;
+		}
+	}
+};
+
+
+/**
+ * skips the operators, lattice vectors and wyckoff positions of one setting
+ */
+inline void skip_setting(Tokenizer& istr)
+{
+	std::size_t iNumOps = istr.GetNum<std::size_t>();
+	istr.Skip(iNumOps * 6);
+
+	std::size_t iNumLattVecs = istr.GetNum<std::size_t>();
+	istr.Skip(iNumLattVecs * 4);
+
+	std::size_t iNumWyc = istr.GetNum<std::size_t>();
+	for(std::size_t iWyc=0; iWyc<iNumWyc && istr.IsOk(); ++iWyc)
+	{
+		std::size_t iNumPos = istr.GetNum<std::size_t>();
+		istr.Skip(1);
+		istr.GetString();
+		istr.Skip(iNumPos * 22);
+	}
+}
+
+
+/**
+ * first pass: byte offsets of the group records, only the counts are parsed
+ */
+inline std::vector<std::size_t> index_groups(Tokenizer& istr, std::size_t iNumGroups)
+{
+	std::vector<std::size_t> offs;
+	offs.reserve(iNumGroups);
+
+	for(std::size_t iGroup=0; iGroup<iNumGroups && istr.IsOk(); ++iGroup)
+	{
+		offs.push_back(istr.GetOffset());
+
+		// numbers and names
+		istr.Skip(2);
+		istr.GetString();
+		istr.GetString();
+		istr.Skip(3);
+		istr.GetString();
+		istr.GetString();
+
+		int iTy = istr.GetNum<int>();
+		if(iTy == 4)
+			istr.Skip(13);	// BNS -> OG trafo
+
+		skip_setting(istr);
+		if(iTy == 4)
+			skip_setting(istr);
+	}
+
+	return offs;
+}
+
+
+#endif